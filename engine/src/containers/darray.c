@@ -8,7 +8,7 @@ void* _darray_create(u64 length, u64 stride)
     u64 header_size = DARRAY_FIELD_LENGTH * sizeof(u64);
     u64 array_size = length * stride;
     // Prepend the header before the data.
-    u64* new_array = kallocate(header_size + array_size, MEMORY_TAG_DARRAY); // casting it to u64 to move on the fields in a much more readable fashion.
+    u64* new_array = kallocate_no_zero(header_size + array_size, MEMORY_TAG_DARRAY); // casting it to u64 to move on the fields in a much more readable fashion.
     kset_memory(new_array, 0, header_size + array_size);
     new_array[DARRAY_CAPACITY] = length;
     new_array[DARRAY_LENGTH] = 0;
@@ -1,153 +1,506 @@
 #include "hashtable.h"
 
 #include "core/kmemory.h"
+#include "core/kstring.h"
 #include "core/logger.h"
 
-// A very primitive hashing function
-u64 hash_name(const char* name, u32 element_count) 
+/*
+    wyhash (final version 4) by Wang Yi, released into the public domain.
+    Fast, good quality and small enough to live here. Reads go through memcpy so unaligned
+    keys are fine.
+*/
+static const u64 wyhash_secret[4] = {0x2d358dccaa6c78a5ull, 0x8bb84b93962eacc9ull, 0x4b33a62ed433d4a3ull, 0x4d5a2da51de1aa47ull};
+
+KINLINE void wy_mum(u64* a, u64* b)
+{
+    __uint128_t r = *a;
+    r *= *b;
+    *a = (u64)r;
+    *b = (u64)(r >> 64);
+}
+
+KINLINE u64 wy_mix(u64 a, u64 b)
+{
+    wy_mum(&a, &b);
+    return a ^ b;
+}
+
+KINLINE u64 wy_read8(const u8* p)
+{
+    u64 v;
+    __builtin_memcpy(&v, p, 8);
+    return v;
+}
+
+KINLINE u64 wy_read4(const u8* p)
+{
+    u32 v;
+    __builtin_memcpy(&v, p, 4);
+    return v;
+}
+
+KINLINE u64 wy_read3(const u8* p, u64 k)
+{
+    return (((u64)p[0]) << 16) | (((u64)p[k >> 1]) << 8) | p[k - 1];
+}
+
+u64 hash_bytes(const void* data, u64 size, u64 seed)
+{
+    const u8* p = (const u8*)data;
+    const u64* secret = wyhash_secret;
+    seed ^= wy_mix(seed ^ secret[0], secret[1]);
+    u64 a, b;
+    if(size <= 16)
+    {
+        if(size >= 4)
+        {
+            a = (wy_read4(p) << 32) | wy_read4(p + ((size >> 3) << 2));
+            b = (wy_read4(p + size - 4) << 32) | wy_read4(p + size - 4 - ((size >> 3) << 2));
+        }
+        else if(size > 0)
+        {
+            a = wy_read3(p, size);
+            b = 0;
+        }
+        else
+        {
+            a = b = 0;
+        }
+    }
+    else
+    {
+        u64 i = size;
+        if(i > 48)
+        {
+            u64 see1 = seed, see2 = seed;
+            do
+            {
+                seed = wy_mix(wy_read8(p) ^ secret[1], wy_read8(p + 8) ^ seed);
+                see1 = wy_mix(wy_read8(p + 16) ^ secret[2], wy_read8(p + 24) ^ see1);
+                see2 = wy_mix(wy_read8(p + 32) ^ secret[3], wy_read8(p + 40) ^ see2);
+                p += 48;
+                i -= 48;
+            } while(i > 48);
+            seed ^= see1 ^ see2;
+        }
+        while(i > 16)
+        {
+            seed = wy_mix(wy_read8(p) ^ secret[1], wy_read8(p + 8) ^ seed);
+            i -= 16;
+            p += 16;
+        }
+        a = wy_read8(p + i - 16);
+        b = wy_read8(p + i - 8);
+    }
+
+    a ^= secret[1];
+    b ^= seed;
+    wy_mum(&a, &b);
+    return wy_mix(a ^ secret[0] ^ size, b ^ secret[1]);
+}
+
+KINLINE u64 hash_name(const char* name)
+{
+    return hash_bytes(name, string_length(name), 0);
+}
+
+// Maps a hash onto [0, element_count) without a division (Lemire's multiply-shift reduction).
+KINLINE u32 home_slot(u64 hash, u32 element_count)
+{
+    return (u32)(((__uint128_t)hash * element_count) >> 64);
+}
+
+// Key arena bytes per element when a table is created, which fits typical asset names without growing.
+#define KEY_ARENA_BYTES_PER_ELEMENT 32
+
+KINLINE void* value_at(hashtable* table, u32 index)
+{
+    return (u8*)table->memory + (table->element_size * index);
+}
+
+KINLINE const char* key_at(hashtable* table, u32 index)
+{
+    return table->key_arena + table->slots[index].key_offset;
+}
+
+/**
+ * Returns the slot index holding name, or INVALID_ID if it does not exist.
+ * Robin Hood ordering allows the search to stop as soon as a slot with a shorter
+ * probe distance than ours is found, since the key would have displaced it.
+ */
+static u32 find_slot(hashtable* table, const char* name, u64 hash)
+{
+    u32 count = table->element_count;
+    u32 index = home_slot(hash, count);
+    for(u32 distance = 1; distance <= count; ++distance)
+    {
+        const hashtable_slot* slot = &table->slots[index];
+        if(slot->probe_length < distance)
+        {
+            // Either empty (0) or a "richer" entry - ours cannot be further along.
+            return INVALID_ID;
+        }
+
+        if(slot->hash == hash && strings_equal(table->key_arena + slot->key_offset, name))
+        {
+            return index;
+        }
+
+        index = (index + 1 == count) ? 0 : index + 1;
+    }
+
+    return INVALID_ID;
+}
+
+/**
+ * Copies the live keys into a new arena, at least twice the size they and required_size need, and
+ * points the slots at their new offsets. Returns false if the arena would not fit its u32 offsets.
+ */
+static b8 compact_key_arena(hashtable* table, u64 required_size)
+{
+    u64 needed = (u64)table->key_arena_live + required_size;
+    u64 capacity = table->key_arena_capacity;
+    while(capacity < needed * 2)
+    {
+        capacity *= 2;
+    }
+    if(capacity > 0xFFFFFFFFull)
+    {
+        return false;
+    }
+
+    char* arena = kallocate(capacity, MEMORY_TAG_DICT);
+    u32 used = 0;
+    for(u32 i = 0; i < table->element_count; ++i)
+    {
+        hashtable_slot* slot = &table->slots[i];
+        if(slot->probe_length != 0)
+        {
+            u32 size = (u32)string_length(key_at(table, i)) + 1;
+            kcopy_memory(arena + used, key_at(table, i), size);
+            slot->key_offset = used;
+            used += size;
+        }
+    }
+
+    kfree(table->key_arena, table->key_arena_capacity, MEMORY_TAG_DICT);
+    table->key_arena = arena;
+    table->key_arena_capacity = (u32)capacity;
+    table->key_arena_used = used;
+    return true;
+}
+
+/**
+ * Copies a key into the arena, returning its offset, or INVALID_ID if there is no room for it.
+ */
+static u32 store_key(hashtable* table, const char* name)
+{
+    u64 size = string_length(name) + 1;
+    if(table->key_arena_used + size > table->key_arena_capacity && !compact_key_arena(table, size))
+    {
+        return INVALID_ID;
+    }
+
+    u32 offset = table->key_arena_used;
+    kcopy_memory(table->key_arena + offset, name, size);
+    table->key_arena_used += (u32)size;
+    table->key_arena_live += (u32)size;
+    return offset;
+}
+
+/**
+ * Inserts a new entry. The caller must have verified that the name does not already exist.
+ */
+static b8 insert_new(hashtable* table, const char* name, u64 hash, const void* value)
 {
-    // A multipler to use when generating a hash. Prime to hopefully avoid collisions.
-    static const u64 multiplier = 97;
+    if(table->entry_count >= table->element_count)
+    {
+        KERROR("hashtable insert failed for '%s' - table is full (%u entries).", name, table->element_count);
+        return false;
+    }
 
-    unsigned const char* us;
-    u64 hash = 0;
+    u32 key_offset = store_key(table, name);
+    if(key_offset == INVALID_ID)
+    {
+        KERROR("hashtable insert failed for '%s' - keys exceed 4GiB.", name);
+        return false;
+    }
+
+    u64 size = table->element_size;
+    void* carry_value = table->swap_space;
+    void* temp_value = (u8*)table->swap_space + size;
+    kcopy_memory(carry_value, value, size);
 
-    for(us = (unsigned const char*)name; *us; us++) 
+    hashtable_slot carry = {hash, 1, key_offset};
+
+    u32 count = table->element_count;
+    u32 index = home_slot(hash, count);
+    while(true)
     {
-        hash = hash * multiplier + *us;
+        hashtable_slot* slot = &table->slots[index];
+        if(slot->probe_length == 0)
+        {
+            // Empty slot - settle the carried entry here.
+            *slot = carry;
+            kcopy_memory(value_at(table, index), carry_value, size);
+            table->entry_count++;
+            return true;
+        }
+
+        if(slot->probe_length < carry.probe_length)
+        {
+            // Take from the rich, give to the poor: swap the carried entry with the resident one.
+            hashtable_slot resident = *slot;
+            *slot = carry;
+            carry = resident;
+
+            kcopy_memory(temp_value, value_at(table, index), size);
+            kcopy_memory(value_at(table, index), carry_value, size);
+            kcopy_memory(carry_value, temp_value, size);
+        }
+
+        index = (index + 1 == count) ? 0 : index + 1;
+        carry.probe_length++;
     }
+}
+
+/**
+ * Removes the entry at index using backward-shift deletion, so no tombstones are needed.
+ */
+static void remove_at(hashtable* table, u32 index)
+{
+    u32 count = table->element_count;
+    u64 size = table->element_size;
 
-    // Mod it against the size of the table.
-    hash %= element_count;
+    // The key's bytes are reclaimed the next time the arena is compacted.
+    table->key_arena_live -= (u32)string_length(key_at(table, index)) + 1;
+
+    while(true)
+    {
+        u32 next = (index + 1 == count) ? 0 : index + 1;
+        hashtable_slot* next_slot = &table->slots[next];
+        if(next_slot->probe_length <= 1)
+        {
+            // Next slot is empty or already in its home position. Stop shifting.
+            kzero_memory(&table->slots[index], sizeof(hashtable_slot));
+            kzero_memory(value_at(table, index), size);
+            break;
+        }
+
+        table->slots[index] = *next_slot;
+        table->slots[index].probe_length--;
+        kcopy_memory(value_at(table, index), value_at(table, next), size);
+        index = next;
+    }
 
-    return hash;
+    table->entry_count--;
 }
 
-void hashtable_create(u64 element_size, u32 element_count, void* memory, b8 is_pointer_type, hashtable* out_hashtable) 
+void hashtable_create(u64 element_size, u32 element_count, void* memory, b8 is_pointer_type, hashtable* out_hashtable)
 {
-    if(!memory || !out_hashtable) 
+    if(!memory || !out_hashtable)
     {
         KERROR("hashtable_create failed! Pointer to memory and out_hashtable are required.");
         return;
     }
 
-    if(!element_count || !element_size) 
+    if(!element_count || !element_size)
     {
         KERROR("element_size and element_count must be a positive non-zero value.");
         return;
     }
 
-    // TODO: Might want to require an allocator and allocate this memory instead.
     out_hashtable->memory = memory;
     out_hashtable->element_count = element_count;
     out_hashtable->element_size = element_size;
     out_hashtable->is_pointer_type = is_pointer_type;
+    out_hashtable->entry_count = 0;
     kzero_memory(out_hashtable->memory, element_size * element_count);
+
+    // Bookkeeping lives in a single block: slots, then default value and scratch space.
+    u64 slots_size = sizeof(hashtable_slot) * element_count;
+    u64 values_size = element_size * 3;
+    out_hashtable->internal_block_size = slots_size + values_size;
+    out_hashtable->internal_block = kallocate(out_hashtable->internal_block_size, MEMORY_TAG_DICT);
+
+    u8* block = out_hashtable->internal_block;
+    out_hashtable->slots = (hashtable_slot*)block;
+    out_hashtable->default_value = block + slots_size;
+    out_hashtable->swap_space = (u8*)out_hashtable->default_value + element_size;
+    kzero_memory(out_hashtable->internal_block, out_hashtable->internal_block_size);
+
+    // Keys live in a separate block, since it is replaced when it grows.
+    u64 arena_capacity = (u64)element_count * KEY_ARENA_BYTES_PER_ELEMENT;
+    out_hashtable->key_arena_capacity = arena_capacity < 0x80000000ull ? (u32)arena_capacity : 0x80000000u;
+    out_hashtable->key_arena = kallocate(out_hashtable->key_arena_capacity, MEMORY_TAG_DICT);
+    out_hashtable->key_arena_used = 0;
+    out_hashtable->key_arena_live = 0;
 }
 
 void hashtable_destroy(hashtable* table)
 {
-    if(table) 
+    if(table)
     {
-        // TODO: If using allocator above, free memory here.
+        if(table->internal_block)
+        {
+            kfree(table->internal_block, table->internal_block_size, MEMORY_TAG_DICT);
+        }
+        if(table->key_arena)
+        {
+            kfree(table->key_arena, table->key_arena_capacity, MEMORY_TAG_DICT);
+        }
         kzero_memory(table, sizeof(hashtable));
     }
 }
 
-b8 hashtable_set(hashtable* table, const char* name, void* value) 
+b8 hashtable_set(hashtable* table, const char* name, void* value)
 {
-    if(!table || !name || !value) 
+    if(!table || !name || !value)
     {
         KERROR("hashtable_set requires table, name and value to exist.");
         return false;
     }
 
-    if(table->is_pointer_type) 
+    if(table->is_pointer_type)
     {
         KERROR("hashtable_set should not be used with tables that have pointer types. Use hashtable_set_ptr instead.");
         return false;
     }
 
-    u64 hash = hash_name(name, table->element_count);
-    kcopy_memory(table->memory + (table->element_size * hash), value, table->element_size);
-    return true;
+    u64 hash = hash_name(name);
+    u32 index = find_slot(table, name, hash);
+    if(index != INVALID_ID)
+    {
+        kcopy_memory(value_at(table, index), value, table->element_size);
+        return true;
+    }
+
+    return insert_new(table, name, hash, value);
 }
 
-b8 hashtable_set_ptr(hashtable* table, const char* name, void** value) 
+b8 hashtable_set_ptr(hashtable* table, const char* name, void** value)
 {
-    if(!table || !name) 
+    if(!table || !name)
     {
         KWARN("hashtable_set_ptr requires table and name  to exist.");
         return false;
     }
 
-    if(!table->is_pointer_type) 
+    if(!table->is_pointer_type)
     {
         KERROR("hashtable_set_ptr should not be used with tables that do not have pointer types. Use hashtable_set instead.");
         return false;
     }
 
-    u64 hash = hash_name(name, table->element_count);
-    ((void**)table->memory)[hash] = value ? *value : 0;
-    return true;
+    u64 hash = hash_name(name);
+    u32 index = find_slot(table, name, hash);
+    if(!value || !*value)
+    {
+        // Unsetting an entry removes it entirely.
+        if(index != INVALID_ID)
+        {
+            remove_at(table, index);
+        }
+        return true;
+    }
+
+    if(index != INVALID_ID)
+    {
+        ((void**)table->memory)[index] = *value;
+        return true;
+    }
+
+    return insert_new(table, name, hash, value);
 }
 
-b8 hashtable_get(hashtable* table, const char* name, void* out_value) 
+b8 hashtable_get(hashtable* table, const char* name, void* out_value)
 {
-    if(!table || !name || !out_value) 
+    if(!table || !name || !out_value)
     {
         KWARN("hashtable_get requires table, name and out_value to exist.");
         return false;
     }
 
-    if(table->is_pointer_type) 
+    if(table->is_pointer_type)
     {
         KERROR("hashtable_get should not be used with tables that have pointer types. Use hashtable_get_ptr instead.");
         return false;
     }
 
-    u64 hash = hash_name(name, table->element_count);
-    kcopy_memory(out_value, table->memory + (table->element_size * hash), table->element_size);
+    u32 index = find_slot(table, name, hash_name(name));
+    const void* source = index != INVALID_ID ? value_at(table, index) : table->default_value;
+    kcopy_memory(out_value, source, table->element_size);
     return true;
 }
 
-b8 hashtable_get_ptr(hashtable* table, const char* name, void** out_value) 
+b8 hashtable_get_ptr(hashtable* table, const char* name, void** out_value)
 {
-    if(!table || !name || !out_value) 
+    if(!table || !name || !out_value)
     {
         KWARN("hashtable_get_ptr requires table, name and out_value to exist.");
         return false;
     }
 
-    if(!table->is_pointer_type) 
+    if(!table->is_pointer_type)
     {
         KERROR("hashtable_get_ptr should not be used with tables that do not have pointer types. Use hashtable_get instead.");
         return false;
     }
 
-    u64 hash = hash_name(name, table->element_count);
-    *out_value = ((void**)table->memory)[hash];
+    u32 index = find_slot(table, name, hash_name(name));
+    *out_value = index != INVALID_ID ? ((void**)table->memory)[index] : 0;
     return *out_value != 0;
 }
 
-b8 hashtable_fill(hashtable* table, void* value) 
+b8 hashtable_fill(hashtable* table, void* value)
 {
     if(!table || !value)
     {
         KWARN("hashtable_fill requires table and value to exist.");
         return false;
     }
-    
-    if(table->is_pointer_type) 
+
+    if(table->is_pointer_type)
     {
         KERROR("hashtable_fill should not be used with tables that have pointer types.");
         return false;
     }
 
-    for(u32 i = 0; i < table->element_count; ++i) 
+    // Names which do not exist yet report this value from now on.
+    kcopy_memory(table->default_value, value, table->element_size);
+
+    for(u32 i = 0; i < table->element_count; ++i)
     {
-        kcopy_memory(table->memory + (table->element_size * i), value, table->element_size);
+        kcopy_memory(value_at(table, i), value, table->element_size);
     }
 
     return true;
-}
\ No newline at end of file
+}
+
+b8 hashtable_remove(hashtable* table, const char* name)
+{
+    if(!table || !name)
+    {
+        KWARN("hashtable_remove requires table and name to exist.");
+        return false;
+    }
+
+    u32 index = find_slot(table, name, hash_name(name));
+    if(index == INVALID_ID)
+    {
+        return false;
+    }
+
+    remove_at(table, index);
+    return true;
+}
+
+b8 hashtable_contains(hashtable* table, const char* name)
+{
+    if(!table || !name)
+    {
+        return false;
+    }
+
+    return find_slot(table, name, hash_name(name)) != INVALID_ID;
+}
@@ -2,6 +2,17 @@
 
 #include "defines.h"
 
+// Bookkeeping for one slot of a hashtable. Probing only reads these, 4 to a cache line.
+typedef struct hashtable_slot
+{
+    // Full hash of the key. Compared before the key itself.
+    u64 hash;
+    // Probe distance plus one. 0 means the slot is empty.
+    u32 probe_length;
+    // Offset of the key's copy in the table's key arena.
+    u32 key_offset;
+} hashtable_slot;
+
 /**
  * @brief Represents a simple hashtable with string keys. Members of this structure
  * should not be modified outside the functions associated with it.
@@ -12,13 +23,38 @@
  * and should be managed externally.
  * 
  * This hashtable has a fixed size. It will not get resized as it grows. So, once it is full, it is full.
+ * 
+ * Internally this is an open-addressing table using Robin Hood hashing. Keys are copied into an arena
+ * owned by the table and stored alongside their full 64-bit hash, so colliding names never overwrite
+ * each other. Removal uses backward-shift deletion, which means no tombstones are ever left behind.
  */
 typedef struct hashtable 
 {
     u64 element_size;
     u32 element_count;
     b8 is_pointer_type;
+    // Value storage provided by the caller. One slot per element.
     void* memory;
+
+    // The number of slots currently occupied.
+    u32 entry_count;
+    // Hash, probe distance and key of each slot.
+    hashtable_slot* slots;
+    // Value returned by hashtable_get for names which do not exist. Zeroed unless hashtable_fill is used.
+    void* default_value;
+    // Scratch space used to carry values around while inserting.
+    void* swap_space;
+    // Bookkeeping block holding all of the above.
+    void* internal_block;
+    u64 internal_block_size;
+
+    // Terminated copies of the keys, appended as they are inserted. Space left by removed keys is
+    // reclaimed by compacting the arena when it fills, which also grows it if it is more than half live.
+    char* key_arena;
+    u32 key_arena_capacity;
+    u32 key_arena_used;
+    // Bytes of the arena held by keys still in the table.
+    u32 key_arena_live;
 } hashtable;
 
 /**
@@ -27,6 +63,7 @@ typedef struct hashtable
  * @param element_size The size of each element in bytes.
  * @param element_count The maximum number of elements. Cannot be resized.
  * @param memory A block of memory to be used. Should be equal in size to element_size * element_count;
+ * Key and probe bookkeeping is allocated separately by the table and released in hashtable_destroy.
  * @param is_pointer_type Indicates if this hashtable will hold pointer types.
  * @param out_hashtable A pointer to a hashtable in which to hold relevant data.
  */
@@ -34,6 +71,7 @@ KAPI void hashtable_create(u64 element_size, u32 element_count, void* memory, b8
 
 /**
  * @brief Destroys the provided hashtable. Does not release memory for pointer types.
+ * Frees the internally allocated keys and bookkeeping.
  * 
  * @param table A pointer to the table to be destroyed.
  */
@@ -46,7 +84,7 @@ KAPI void hashtable_destroy(hashtable* table);
  * @param table A pointer to the table to get from. Required.
  * @param name The name of the entry to set. Required.
  * @param value The value to be set. Required.
- * @return True, or false if a null pointer is passed.
+ * @return True, or false if a null pointer is passed or the table is full.
  */
 KAPI b8 hashtable_set(hashtable* table, const char* name, void* value);
 
@@ -56,14 +94,15 @@ KAPI b8 hashtable_set(hashtable* table, const char* name, void* value);
  * 
  * @param table A pointer to the table to get from. Required.
  * @param name The name of the entry to set. Required.
- * @param value A pointer value to be set. Can pass 0 to 'unset' an entry.
- * @return True; or false if a null pointer is passed or if the entry is 0.
+ * @param value A pointer value to be set. Can pass 0 to 'unset' (remove) an entry.
+ * @return True; or false if a null pointer is passed or the table is full.
  */
 KAPI b8 hashtable_set_ptr(hashtable* table, const char* name, void** value);
 
 /**
  * @brief Obtains a copy of data present in the hashtable.
  * Only use for tables which were *NOT* created with is_pointer_type = true.
+ * If the name does not exist, the default value (zero, or the one given to hashtable_fill) is copied.
  * 
  * @param table A pointer to the table to retrieved from. Required.
  * @param name The name of the entry to retrieved. Required.
@@ -92,4 +131,34 @@ KAPI b8 hashtable_get_ptr(hashtable* table, const char* name, void** out_value);
  * @param value The value to be filled with. Required.
  * @return True if successful; otherwise false.
  */
-KAPI b8 hashtable_fill(hashtable* table, void* value);
\ No newline at end of file
+KAPI b8 hashtable_fill(hashtable* table, void* value);
+
+/**
+ * @brief Removes the entry with the given name from the table, if it exists.
+ * Works for both pointer and non-pointer tables.
+ * 
+ * @param table A pointer to the table to remove from. Required.
+ * @param name The name of the entry to remove. Required.
+ * @return True if an entry was removed; otherwise false.
+ */
+KAPI b8 hashtable_remove(hashtable* table, const char* name);
+
+/**
+ * @brief Indicates whether an entry with the given name exists in the table.
+ * 
+ * @param table A pointer to the table to search. Required.
+ * @param name The name of the entry to look for. Required.
+ * @return True if the entry exists; otherwise false.
+ */
+KAPI b8 hashtable_contains(hashtable* table, const char* name);
+
+/**
+ * @brief Hashes the provided bytes with a fast, non-cryptographic hash (wyhash).
+ * This is the hash used for all hashtable keys.
+ * 
+ * @param data The bytes to be hashed.
+ * @param size The number of bytes to hash.
+ * @param seed A seed to mix into the hash. 0 is fine for most uses.
+ * @return The 64-bit hash.
+ */
+KAPI u64 hash_bytes(const void* data, u64 size, u64 seed);
\ No newline at end of file
@@ -4,17 +4,21 @@
 #include "logger.h"
 
 #include "platform/platform.h"
+#include "platform/vfs.h"
 #include "core/kmemory.h"
 #include "core/event.h"
 #include "core/input.h"
 #include "core/clock.h"
+#include "core/profiler.h"
 
 #include "memory/linear_allocator.h"
+#include "memory/frame_allocator.h"
 
 #include "renderer/renderer_frontend.h"
 
 // Systems
 #include "systems/texture_system.h"
+#include "systems/job_system.h"
 
 typedef struct application_state 
 {
@@ -26,6 +30,10 @@ typedef struct application_state
     clock clock;
     f64 last_time;
     linear_allocator systems_allocator;
+    // Transient memory reset at the end of every frame.
+    frame_allocator frame_allocator;
+    // Transient memory which survives into the following frame.
+    frame_allocator double_frame_allocator;
 
     u64 event_system_memory_requirement;
     void* event_system_state;
@@ -36,9 +44,18 @@ typedef struct application_state
     u64 logging_system_memory_requirement;
     void* logging_system_state;
 
+    u64 profiler_memory_requirement;
+    void* profiler_state;
+
     u64 input_system_memory_requirement;
     void* input_system_state;
 
+    u64 job_system_memory_requirement;
+    void* job_system_state;
+
+    u64 vfs_memory_requirement;
+    void* vfs_state;
+
     u64 platform_system_memory_requirement;
     void* platform_system_state;
 
@@ -81,24 +98,78 @@ b8 application_create(game* game_inst)
     event_system_initialize(&app_state->event_system_memory_requirement, app_state->event_system_state);
 
     // Memory
-    memory_system_initialize(&app_state->memory_system_memory_requirement, 0);
+    memory_system_config memory_config;
+    memory_config.total_alloc_size = 512 * 1024 * 1024; // 512 MB
+    memory_config.alignment = 16;
+    memory_system_initialize(&app_state->memory_system_memory_requirement, 0, memory_config);
     app_state->memory_system_state = linear_allocator_allocate(&app_state->systems_allocator, app_state->memory_system_memory_requirement);
-    memory_system_initialize(&app_state->memory_system_memory_requirement, app_state->memory_system_state);
+    if(!memory_system_initialize(&app_state->memory_system_memory_requirement, app_state->memory_system_state, memory_config))
+    {
+        KERROR("Failed to initialize the memory system: shutting down...");
+        return false;
+    }
+
+    // Frame allocators
+    frame_allocator_create(8 * 1024 * 1024, false, &app_state->frame_allocator); // 8 MB
+    frame_allocator_create(4 * 1024 * 1024, true, &app_state->double_frame_allocator); // 2 x 4 MB
 
     // Logging
-    initialize_logging(&app_state->logging_system_memory_requirement, 0);
+    // Messages are written on a background thread. Low priority ones are dropped rather than stall a frame.
+    logger_config logging_config = {};
+    logging_config.overflow_policy = LOG_OVERFLOW_DROP;
+    logging_config.queue_capacity = LOG_DEFAULT_QUEUE_CAPACITY;
+    logging_config.console_output = true;
+    // Set to write console.log in the compact binary format; bin/logdecode turns it back into text.
+    logging_config.binary = false;
+    initialize_logging(&app_state->logging_system_memory_requirement, 0, logging_config);
     app_state->logging_system_state = linear_allocator_allocate(&app_state->systems_allocator, app_state->logging_system_memory_requirement);
-    if(!initialize_logging(&app_state->logging_system_memory_requirement, app_state->logging_system_state))
+    if(!initialize_logging(&app_state->logging_system_memory_requirement, app_state->logging_system_state, logging_config))
     {
         KERROR("Failed to initialize the logging system: shutting down...");
         return false;
     }
 
+    // Profiler. Before the job system, so that its workers only ever see it running.
+    profiler_config profiler_sys_config = {};
+    profiler_initialize(&app_state->profiler_memory_requirement, 0, profiler_sys_config);
+    app_state->profiler_state = linear_allocator_allocate(&app_state->systems_allocator, app_state->profiler_memory_requirement);
+    if(!profiler_initialize(&app_state->profiler_memory_requirement, app_state->profiler_state, profiler_sys_config))
+    {
+        KERROR("Failed to initialize the profiler: shutting down...");
+        return false;
+    }
+
     // Input
     input_system_initialize(&app_state->input_system_memory_requirement, 0);
     app_state->input_system_state = linear_allocator_allocate(&app_state->systems_allocator, app_state->input_system_memory_requirement);
     input_system_initialize(&app_state->input_system_memory_requirement, app_state->input_system_state);
 
+    // Jobs. One worker per core, less the main thread.
+    job_system_config job_sys_config = {};
+    job_system_initialize(&app_state->job_system_memory_requirement, 0, job_sys_config);
+    app_state->job_system_state = linear_allocator_allocate_aligned(&app_state->systems_allocator, app_state->job_system_memory_requirement, 64);
+    if(!job_system_initialize(&app_state->job_system_memory_requirement, app_state->job_system_state, job_sys_config))
+    {
+        KFATAL("Failed to initialize the job system. Application cannot continue.");
+        return false;
+    }
+
+    // Virtual file system. Assets are read from the working directory, or from a pack of them built
+    // next to it, which takes over the files it holds.
+    vfs_config vfs_sys_config = {};
+    vfs_initialize(&app_state->vfs_memory_requirement, 0, vfs_sys_config);
+    app_state->vfs_state = linear_allocator_allocate(&app_state->systems_allocator, app_state->vfs_memory_requirement);
+    if(!vfs_initialize(&app_state->vfs_memory_requirement, app_state->vfs_state, vfs_sys_config) || !vfs_mount_directory("", "."))
+    {
+        KFATAL("Failed to initialize the virtual file system. Application cannot continue.");
+        return false;
+    }
+    const char* asset_pack = "assets." VFS_PACK_EXTENSION;
+    if(filesystem_exists(asset_pack) && !vfs_mount_pack("", asset_pack))
+    {
+        KWARN("Asset pack '%s' could not be mounted. Loose files will be used.", asset_pack);
+    }
+
     // Register for engine-level events
     event_register(EVENT_CODE_APPLICATION_QUIT, 0, application_on_event);
     event_register(EVENT_CODE_KEY_PRESSED, 0, application_on_key);
@@ -106,7 +177,7 @@ b8 application_create(game* game_inst)
     event_register(EVENT_CODE_RESIZED, 0, application_on_resized);
 
     // Platform
-    platform_system_startup(&app_state->platform_system_memory_requirement, 0, 0, 0, 0, 0, 0);
+    platform_system_startup(&app_state->platform_system_memory_requirement, 0, 0, 0, 0, 0, 0, false);
     app_state->platform_system_state = linear_allocator_allocate(&app_state->systems_allocator, app_state->platform_system_memory_requirement);
     if(!platform_system_startup(
             &app_state->platform_system_memory_requirement,
@@ -115,23 +186,44 @@ b8 application_create(game* game_inst)
             game_inst->app_config.start_pos_x,
             game_inst->app_config.start_pos_y,
             game_inst->app_config.start_width,
-            game_inst->app_config.start_height)) 
+            game_inst->app_config.start_height,
+            game_inst->app_config.headless)) 
     {
         return false;
     }
 
+    if(game_inst->app_config.headless)
+    {
+        // No window will report its size, so the configured one is the framebuffer size.
+        app_state->width = game_inst->app_config.start_width;
+        app_state->height = game_inst->app_config.start_height;
+    }
+
     // Renderer system
-    renderer_system_initialize(&app_state->renderer_system_memory_requirement, 0, 0);
+    renderer_backend_config backend_config = {};
+    backend_config.type = RENDERER_BACKEND_TYPE_VULKAN;
+    if(game_inst->app_config.headless)
+    {
+        backend_config.offscreen = game_inst->app_config.offscreen;
+        backend_config.readback = game_inst->app_config.offscreen_readback;
+        if(!backend_config.offscreen)
+        {
+            backend_config.type = RENDERER_BACKEND_TYPE_NULL;
+        }
+    }
+    renderer_system_initialize(&app_state->renderer_system_memory_requirement, 0, 0, backend_config);
     app_state->renderer_system_state = linear_allocator_allocate(&app_state->systems_allocator, app_state->renderer_system_memory_requirement);
-    if(!renderer_system_initialize(&app_state->renderer_system_memory_requirement, app_state->renderer_system_state, game_inst->app_config.name)) 
+    if(!renderer_system_initialize(&app_state->renderer_system_memory_requirement, app_state->renderer_system_state, game_inst->app_config.name, backend_config)) 
     {
         KFATAL("Failed to initialize renderer. Aborting application.");
         return false;
     }
 
     // Texture system
-    texture_system_config texture_sys_config;
+    texture_system_config texture_sys_config = {};
     texture_sys_config.max_texture_count = 65536;
+    // Textures start at a low resolution mip, and stream in higher ones as they are drawn larger.
+    texture_sys_config.stream_base_size = 128;
     texture_system_initialize(&app_state->texture_system_memory_requirement, 0, texture_sys_config);
     app_state->texture_system_state = linear_allocator_allocate(&app_state->systems_allocator, app_state->texture_system_memory_requirement);
     if(!texture_system_initialize(&app_state->texture_system_memory_requirement, app_state->texture_system_state, texture_sys_config)) 
@@ -160,17 +252,36 @@ b8 application_run()
     app_state->last_time = app_state->clock.elapsed;
     f64 running_time = 0;
     u8 frame_count = 0;
-    f64 target_frame_seconds = 1.0f / 60;
+    u64 total_frame_count = 0;
+
+    application_config* config = &app_state->game_inst->app_config;
+
+    // Frame pacing. Each frame is due target_frame_seconds after the one before it.
+    f64 target_frame_seconds = config->target_frame_rate ? 1.0 / config->target_frame_rate : 0;
+    f64 pacing_spin_seconds = config->frame_pacing_spin_ms / 1000.0;
+    f64 frame_due_time = platform_get_absolute_time();
+
+    b8 fixed_loop = config->loop_mode == APPLICATION_LOOP_MODE_FIXED;
+    fixed_timestep timestep;
+    fixed_timestep_create(
+        1.0 / (config->fixed_update_rate ? config->fixed_update_rate : 60),
+        config->max_updates_per_frame ? config->max_updates_per_frame : 5,
+        &timestep);
 
     KINFO(get_memory_usage_str());
 
     while(app_state->is_running)
     {
+        KPROFILE_FRAME();
+
         if(!platform_pump_messages())
         {
             app_state->is_running = false;
         }
 
+        // Everything posted while pumping, e.g. a burst of resizes, is handled once here.
+        event_dispatch_queued();
+
         if(!app_state->is_suspended)
         {
             // Update clock and get delta time.
@@ -180,15 +291,42 @@ b8 application_run()
             // Needed to implement the frame limiting logic.
             f64 frame_start_time = platform_get_absolute_time();
 
-            if(!app_state->game_inst->update(app_state->game_inst, (f32)delta))
+            KPROFILE_BEGIN("game update");
+            b8 updated = true;
+            f32 interpolation = 1.0f;
+            if(fixed_loop)
+            {
+                u32 step_count = fixed_timestep_advance(&timestep, delta);
+                for(u32 i = 0; i < step_count && updated; ++i)
+                {
+                    updated = app_state->game_inst->update(app_state->game_inst, (f32)timestep.step);
+
+                    // Each step sees the input which arrived since the step before it, so a key press
+                    // is seen once however many steps the frame runs.
+                    input_update(timestep.step);
+                }
+                interpolation = fixed_timestep_alpha(&timestep);
+            }
+            else
+            {
+                updated = app_state->game_inst->update(app_state->game_inst, (f32)delta);
+            }
+            KPROFILE_END();
+            if(!updated)
             {
                 KFATAL("Game update failed, shutting down");
                 app_state->is_running = false;
                 break;
             }
 
+            // Upload textures which finished loading in the background, before anything draws with them.
+            texture_system_update();
+
             // Call the game's render routine.
-            if (!app_state->game_inst->render(app_state->game_inst, (f32)delta)) 
+            KPROFILE_BEGIN("game render");
+            b8 rendered = app_state->game_inst->render(app_state->game_inst, (f32)delta, interpolation);
+            KPROFILE_END();
+            if (!rendered) 
             {
                 KFATAL("Game render failed, shutting down.");
                 app_state->is_running = false;
@@ -198,34 +336,51 @@ b8 application_run()
             // TODO: refactor packet creation
             render_packet packet;
             packet.delta_time = delta;
+            packet.frame_allocator = &app_state->frame_allocator;
             renderer_draw_frame(&packet);
 
-            // Figure out how long the frame took and if below limit the FPS by sleeping
+            // Figure out how long the frame took, then wait until the next one is due.
             f64 frame_end_time = platform_get_absolute_time();
             f64 frame_elapsed_time = frame_end_time - frame_start_time;
             running_time += frame_elapsed_time;
-            f64 remaining_seconds = target_frame_seconds - frame_elapsed_time;
-            if(remaining_seconds > 0)
+            if(target_frame_seconds > 0)
             {
-                u64 remaining_ms = (remaining_seconds * 1000);
-
-                // if there is time left, give it back to the OS
-                b8 limit_frames = false;
-                if(remaining_ms > 0 && limit_frames)
+                KPROFILE_BEGIN("frame pacing");
+                frame_due_time += target_frame_seconds;
+                if(frame_due_time < frame_end_time)
+                {
+                    // Missed it. Pace from now on, rather than rushing the next frames to make up for it.
+                    frame_due_time = frame_end_time;
+                }
+                else
                 {
-                    // -1 to ensure that sleep time is slightly less than the actual remaining time. This is due to the overhead of calling
-                    // the sleep function and returning from it. So, this helps compensating that.
-                    platform_sleep(remaining_ms - 1);
+                    clock_wait_until(frame_due_time, pacing_spin_seconds);
                 }
+                KPROFILE_END();
             }
 
             ++frame_count;
+            ++total_frame_count;
+            if(app_state->game_inst->app_config.frame_limit && total_frame_count >= app_state->game_inst->app_config.frame_limit)
+            {
+                app_state->is_running = false;
+            }
 
             // NOTE: Input update/state copying should always be handled
             // after any input should be recorded; I.E. before this line.
             // As a safety, input is the last thing to be updated before
-            // this frame ends.
-            input_update(delta);
+            // this frame ends. The fixed loop has done so after each step.
+            if(!fixed_loop)
+            {
+                input_update(delta);
+            }
+
+            // Release this frame's transient memory.
+            frame_allocator_end_frame(&app_state->frame_allocator);
+            frame_allocator_end_frame(&app_state->double_frame_allocator);
+
+            // Publish this frame's allocation deltas.
+            memory_system_end_frame();
 
             // Update last time
             app_state->last_time = current_time;
@@ -234,6 +389,16 @@ b8 application_run()
 
     app_state->is_running = false;
 
+    if(total_frame_count > 0)
+    {
+        KINFO("Ran %llu frames. Average frame time: %.3f ms.", total_frame_count, running_time * 1000.0 / total_frame_count);
+    }
+
+    if(timestep.dropped_steps > 0)
+    {
+        KWARN("Dropped %llu fixed updates which the loop could not keep up with.", timestep.dropped_steps);
+    }
+
     // Shutdown the event system
     event_unregister(EVENT_CODE_APPLICATION_QUIT, 0, application_on_event);
     event_unregister(EVENT_CODE_KEY_PRESSED, 0, application_on_key);
@@ -241,21 +406,53 @@ b8 application_run()
     
     input_system_shutdown(app_state->input_system_state);
 
+    // Runs any jobs still queued, which may depend on the systems below.
+    job_system_shutdown(app_state->job_system_state);
+
     texture_system_shutdown(app_state->texture_system_state);
 
     renderer_system_shutdown(app_state->renderer_system_state);
 
-    platform_system_shutdown(app_state->platform_system_state);
+    // After everything which reads files through it.
+    vfs_shutdown(app_state->vfs_state);
 
-    memory_system_shutdown(app_state->memory_system_state);
+    platform_system_shutdown(app_state->platform_system_state);
 
     event_system_shutdown(app_state->event_system_state);
 
+    profiler_shutdown(app_state->profiler_state);
+
+    // Writes out anything still queued.
+    shutdown_logging(app_state->logging_system_state);
+
+    frame_allocator_destroy(&app_state->double_frame_allocator);
+    frame_allocator_destroy(&app_state->frame_allocator);
+
+    // Memory goes last, as the systems above still free blocks from its allocator on shutdown.
+    memory_system_shutdown(app_state->memory_system_state);
+
     return true;
 }
 
+frame_allocator* application_get_frame_allocator()
+{
+    return &app_state->frame_allocator;
+}
+
+frame_allocator* application_get_double_frame_allocator()
+{
+    return &app_state->double_frame_allocator;
+}
+
 void application_get_framebuffer_size(u32* width, u32* height)
 {
+    // Renderer backends may be brought up without an application, e.g. in tests.
+    if(!app_state)
+    {
+        *width = 0;
+        *height = 0;
+        return;
+    }
     *width = app_state->width;
     *height = app_state->height;
 }
@@ -290,6 +487,12 @@ b8 application_on_key(u16 code, void* sender, void* listener_inst, event_context
             // Block anything else from processing this.
             return true;
         } 
+        else if(key_code == KEY_F12)
+        {
+            // Dump the last few seconds of frames for chrome://tracing or ui.perfetto.dev.
+            profiler_export_chrome_trace("profile.json");
+            return true;
+        }
         else if(key_code == KEY_A) 
         {
             // Example on checking for a key
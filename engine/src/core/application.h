@@ -3,6 +3,17 @@
 #include "defines.h"
 
 struct game;
+struct frame_allocator;
+
+// How the main loop drives game updates.
+typedef enum application_loop_mode
+{
+    // One update per frame, given the frame's elapsed time.
+    APPLICATION_LOOP_MODE_VARIABLE,
+    // Updates run in fixed steps, as many per frame as the elapsed time covers. Render receives the
+    // fraction of a step left over, to interpolate between simulated states.
+    APPLICATION_LOOP_MODE_FIXED
+} application_loop_mode;
 
 // Application configuration.
 typedef struct application_config 
@@ -21,10 +32,45 @@ typedef struct application_config
 
     // The application name used in windowing, if applicable.
     char* name;
+
+    // Runs without a window, display or GPU, rendering through the null backend. For CI and benchmarks.
+    b8 headless;
+
+    // With headless, renders through Vulkan into offscreen images instead of the null backend. Needs a
+    // Vulkan device, which may be a software one such as lavapipe.
+    b8 offscreen;
+
+    // With offscreen, copies every frame back to host memory for renderer_read_last_frame.
+    b8 offscreen_readback;
+
+    // Stops the application after this many frames. 0 runs until quit.
+    u64 frame_limit;
+
+    // How game updates are driven. Variable unless set.
+    application_loop_mode loop_mode;
+
+    // Fixed loop only. Updates per second. 0 uses 60.
+    u32 fixed_update_rate;
+
+    // Fixed loop only. Most updates run in one frame to catch up; time beyond that is dropped. 0 uses 5.
+    u32 max_updates_per_frame;
+
+    // Frames per second the loop is paced to. 0 runs as fast as it can.
+    u32 target_frame_rate;
+
+    // Pacing sleeps until this many milliseconds before a frame is due, then spins, as sleeps can
+    // overshoot. Higher is more precise but burns more CPU.
+    f32 frame_pacing_spin_ms;
 } application_config;
 
 KAPI b8 application_create(struct game* game_inst);
 
 KAPI b8 application_run();
 
-void application_get_framebuffer_size(u32* width, u32* height);
\ No newline at end of file
+void application_get_framebuffer_size(u32* width, u32* height);
+
+// Scratch memory valid until the end of the current frame.
+KAPI struct frame_allocator* application_get_frame_allocator();
+
+// Scratch memory valid until the end of the next frame.
+KAPI struct frame_allocator* application_get_double_frame_allocator();
\ No newline at end of file
@@ -19,4 +19,68 @@ void clock_start(clock* clock)
 void clock_stop(clock* clock) 
 {
     clock->start_time = 0;
-}
\ No newline at end of file
+}
+
+void clock_wait_until(f64 target_time, f64 spin_seconds)
+{
+    f64 now = platform_get_absolute_time();
+
+    // Sleep in whole milliseconds while the target is further away than the spin window.
+    while(target_time - now > spin_seconds)
+    {
+        u64 sleep_ms = (u64)((target_time - now - spin_seconds) * 1000.0);
+        if(sleep_ms == 0)
+        {
+            break;
+        }
+
+        platform_sleep(sleep_ms);
+        now = platform_get_absolute_time();
+    }
+
+    // Spin out the rest.
+    while(now < target_time)
+    {
+        platform_thread_yield();
+        now = platform_get_absolute_time();
+    }
+}
+
+void fixed_timestep_create(f64 step_seconds, u32 max_steps, fixed_timestep* out_timestep)
+{
+    out_timestep->step = step_seconds;
+    out_timestep->accumulator = 0;
+    out_timestep->max_steps = max_steps > 0 ? max_steps : 1;
+    out_timestep->dropped_steps = 0;
+}
+
+u32 fixed_timestep_advance(fixed_timestep* timestep, f64 delta_time)
+{
+    if(delta_time > 0)
+    {
+        timestep->accumulator += delta_time;
+    }
+
+    u32 steps = 0;
+    while(timestep->accumulator >= timestep->step && steps < timestep->max_steps)
+    {
+        timestep->accumulator -= timestep->step;
+        ++steps;
+    }
+
+    // Still behind after the most steps allowed. Running more would make the next frame take longer
+    // still, so drop the backlog and keep only the partial step.
+    if(timestep->accumulator >= timestep->step)
+    {
+        u64 dropped = (u64)(timestep->accumulator / timestep->step);
+        timestep->accumulator -= dropped * timestep->step;
+        timestep->dropped_steps += dropped;
+    }
+
+    return steps;
+}
+
+f32 fixed_timestep_alpha(const fixed_timestep* timestep)
+{
+    return (f32)(timestep->accumulator / timestep->step);
+}
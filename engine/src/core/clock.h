@@ -16,4 +16,47 @@ KAPI void clock_update(clock* clock);
 KAPI void clock_start(clock* clock);
 
 // Stops the provided clock. Does not reset elapsed time.
-KAPI void clock_stop(clock* clock);
\ No newline at end of file
+KAPI void clock_stop(clock* clock);
+
+/**
+ * Waits until platform_get_absolute_time() reaches target_time. Sleeps through most of the wait, then
+ * spins through the last spin_seconds, as a sleep can overshoot by up to the scheduler's granularity.
+ * Returns at once if target_time has passed.
+ */
+KAPI void clock_wait_until(f64 target_time, f64 spin_seconds);
+
+/*
+    Accumulates frame time and hands it out as whole simulation steps of a fixed length, so the
+    simulation advances identically however frames are timed. What is left over is the fraction of a
+    step still to simulate, used to interpolate between the last two simulated states when rendering.
+*/
+typedef struct fixed_timestep
+{
+    // Length of one step in seconds.
+    f64 step;
+    // Time received but not yet handed out as steps. Kept below step between frames.
+    f64 accumulator;
+    // Most steps handed out in one frame. Beyond that, time is dropped rather than caught up.
+    u32 max_steps;
+    // Steps dropped since creation because the simulation could not keep up.
+    u64 dropped_steps;
+} fixed_timestep;
+
+/**
+ * Creates a fixed timestep.
+ * @param step_seconds Length of one step in seconds.
+ * @param max_steps Most steps run in one frame before falling behind. At least 1.
+ */
+KAPI void fixed_timestep_create(f64 step_seconds, u32 max_steps, fixed_timestep* out_timestep);
+
+/**
+ * Adds a frame's elapsed time and takes out the steps to run for it.
+ * @return The number of steps to run this frame, at most max_steps.
+ */
+KAPI u32 fixed_timestep_advance(fixed_timestep* timestep, f64 delta_time);
+
+/**
+ * The fraction of a step accumulated but not yet run, in [0, 1). Render at this point between the
+ * previous and current simulated states.
+ */
+KAPI f32 fixed_timestep_alpha(const fixed_timestep* timestep);
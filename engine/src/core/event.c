@@ -1,28 +1,107 @@
 #include "core/event.h"
 
 #include "core/kmemory.h"
+#include "core/logger.h"
 
 #include "containers/darray.h"
 
+#include "platform/platform.h"
+
 typedef struct registered_event
 {
     void* listener;
+    // Cleared in place when the listener is unregistered, until the registry is next rebuilt.
     PFN_on_event callback;
+    // Index of the handle slot that owns this registration.
+    u32 slot;
+    i32 priority;
 } registered_event;
 
-typedef struct event_code_entry
+/*
+    All registered listeners, grouped by code. The listeners of a code are contiguous and in
+    dispatch order, and the codes are sorted so one is found with a binary search over a few cache
+    lines. Registering publishes a rebuilt registry rather than changing this one, so event_fire can
+    walk it without taking a lock. Unregistering only clears a callback.
+*/
+typedef struct event_registry
+{
+    // Size of the allocation holding this registry and its arrays.
+    u64 allocation_size;
+    u32 code_count;
+    u32 listener_count;
+    // Listeners of codes[i] are listeners[firsts[i]] up to, but not including, listeners[firsts[i + 1]].
+    registered_event* listeners;
+    u32* firsts;
+    u16* codes;
+} event_registry;
+
+typedef struct listener_slot
 {
-    registered_event* events;
-} event_code_entry;
+    // Bumped on unregister, so stale handles to the slot are rejected.
+    u32 generation;
+    // Index of the registration in the current registry.
+    u32 record;
+    b8 in_use;
+} listener_slot;
 
-// This should be more than enough codes...
-#define MAX_MESSAGE_CODES 16384
+typedef struct coalesce_rule
+{
+    u16 code;
+    u8 mode;
+} coalesce_rule;
+
+typedef struct queued_event
+{
+    u16 code;
+    void* sender;
+    event_context context;
+} queued_event;
+
+typedef struct inbox_cell
+{
+    // Equal to the cell's position when it is free to write, and one past it once written.
+    volatile i64 sequence;
+    queued_event event;
+} inbox_cell;
+
+// Codes which can have a coalesce mode other than EVENT_COALESCE_NONE.
+#define MAX_COALESCE_RULES 32
+
+// Events that can be posted between dispatches. Must be a power of two.
+#define EVENT_INBOX_CAPACITY 1024
 
 // State structure
 typedef struct event_system_state
 {
-    // Lookup table for event codes
-    event_code_entry registered[MAX_MESSAGE_CODES];
+    // The current registry, or 0 if nothing is registered.
+    event_registry* volatile registry;
+
+    // Serializes registering and unregistering. Firing never takes it.
+    platform_mutex registry_mutex;
+    // Registries replaced while an event_fire may still be walking them. Freed once none is.
+    event_registry** retired;
+    // Number of event_fire calls in progress, on any thread.
+    volatile i32 active_fires;
+    // Number of unregistered listeners still taking up space in the registry.
+    u32 cleared_count;
+
+    // Handle slots, one per registration, and the indices of the free ones.
+    listener_slot* slots;
+    u32* free_slots;
+
+    coalesce_rule coalesce_rules[MAX_COALESCE_RULES];
+    u32 coalesce_rule_count;
+
+    // Posted events. A bounded multi-producer, single-consumer ring: any thread may post, and
+    // only the main thread drains it, in event_dispatch_queued.
+    inbox_cell inbox[EVENT_INBOX_CAPACITY];
+    volatile i64 inbox_write;
+    i64 inbox_read;
+    // Events dropped since the last dispatch because the inbox was full.
+    volatile i32 dropped_count;
+
+    // The events of the dispatch in progress, after coalescing.
+    queued_event batch[EVENT_INBOX_CAPACITY];
 } event_system_state;
 
 /**
@@ -30,123 +109,555 @@ typedef struct event_system_state
  */
 static event_system_state* state_ptr;
 
-void event_system_initialize(u64* memory_requirement, void* state) 
+KINLINE PFN_on_event load_callback(registered_event* e)
 {
-    *memory_requirement = sizeof(event_system_state);
-    if(state == 0) 
+    return (PFN_on_event)platform_atomic_load_ptr((void* volatile*)&e->callback);
+}
+
+static void free_registry(event_registry* registry)
+{
+    if(registry)
     {
-        return;
+        kfree(registry, registry->allocation_size, MEMORY_TAG_EVENT);
     }
+}
 
-    kzero_memory(state, sizeof(state));
-    state_ptr = state;
+// Frees retired registries if no event_fire could still be using them.
+static void reclaim_retired_registries()
+{
+    platform_mutex_lock(&state_ptr->registry_mutex);
+    // Every retired registry was unpublished before this point, so a fire which starts from now on
+    // cannot see one. If none are in progress, nothing can be walking them.
+    if(platform_atomic_load_i32(&state_ptr->active_fires) == 0)
+    {
+        u64 count = darray_length(state_ptr->retired);
+        for(u64 i = 0; i < count; ++i)
+        {
+            free_registry(state_ptr->retired[i]);
+        }
+        darray_clear(state_ptr->retired);
+    }
+    platform_mutex_unlock(&state_ptr->registry_mutex);
 }
 
-void event_system_shutdown(void* state) 
+// Returns the index of code in the registry, or INVALID_ID if it has no listeners.
+static u32 find_code(const event_registry* registry, u16 code)
 {
-    if(state_ptr) 
+    if(!registry)
+    {
+        return INVALID_ID;
+    }
+
+    u32 low = 0;
+    u32 high = registry->code_count;
+    while(low < high)
     {
-        // Free the events arrays. And objects pointed to should be destroyed on their own.
-        for(u16 i = 0; i < MAX_MESSAGE_CODES; ++i) 
+        u32 middle = (low + high) / 2;
+        if(registry->codes[middle] < code)
         {
-            if(state_ptr->registered[i].events != 0) 
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+    return (low < registry->code_count && registry->codes[low] == code) ? low : INVALID_ID;
+}
+
+typedef struct registry_builder
+{
+    event_registry* registry;
+    // First listener of the code being written.
+    u32 code_first;
+} registry_builder;
+
+static void builder_add_listener(registry_builder* builder, const registered_event* e, PFN_on_event callback)
+{
+    event_registry* registry = builder->registry;
+    u32 record = registry->listener_count++;
+    registry->listeners[record] = *e;
+    registry->listeners[record].callback = callback;
+    state_ptr->slots[e->slot].record = record;
+}
+
+static void builder_end_code(registry_builder* builder, u16 code)
+{
+    event_registry* registry = builder->registry;
+    if(registry->listener_count > builder->code_first)
+    {
+        registry->codes[registry->code_count] = code;
+        registry->firsts[registry->code_count] = builder->code_first;
+        registry->code_count++;
+    }
+    builder->code_first = registry->listener_count;
+}
+
+/**
+ * Builds a registry from the current one without its cleared listeners, and with added inserted
+ * if it is not 0. Listeners are ordered by descending priority, then by registration order.
+ * Updates the handle slots to the new records. The registry mutex must be held.
+ * Returns 0 if nothing is left registered.
+ */
+static event_registry* build_registry(u16 added_code, const registered_event* added)
+{
+    const event_registry* current = state_ptr->registry;
+    u32 max_codes = (current ? current->code_count : 0) + 1;
+    u32 max_listeners = (current ? current->listener_count : 0) + 1;
+    if(!added && (!current || current->listener_count == state_ptr->cleared_count))
+    {
+        state_ptr->cleared_count = 0;
+        return 0;
+    }
+
+    // One allocation: the header, then the listeners, then the ranges, then the codes.
+    u64 listeners_offset = sizeof(event_registry);
+    u64 firsts_offset = listeners_offset + sizeof(registered_event) * max_listeners;
+    u64 codes_offset = firsts_offset + sizeof(u32) * (max_codes + 1);
+    u64 allocation_size = codes_offset + sizeof(u16) * max_codes;
+
+    event_registry* registry = kallocate(allocation_size, MEMORY_TAG_EVENT);
+    registry->allocation_size = allocation_size;
+    registry->code_count = 0;
+    registry->listener_count = 0;
+    registry->listeners = (registered_event*)((u8*)registry + listeners_offset);
+    registry->firsts = (u32*)((u8*)registry + firsts_offset);
+    registry->codes = (u16*)((u8*)registry + codes_offset);
+
+    registry_builder builder = {registry, 0};
+    b8 inserted = added == 0;
+    u32 code_count = current ? current->code_count : 0;
+    for(u32 c = 0; c < code_count; ++c)
+    {
+        u16 code = current->codes[c];
+        if(!inserted && added_code < code)
+        {
+            builder_add_listener(&builder, added, added->callback);
+            builder_end_code(&builder, added_code);
+            inserted = true;
+        }
+
+        for(u32 i = current->firsts[c]; i < current->firsts[c + 1]; ++i)
+        {
+            registered_event* e = &current->listeners[i];
+            PFN_on_event callback = load_callback(e);
+            if(!callback)
             {
-                darray_destroy(state_ptr->registered[i].events);
-                state_ptr->registered[i].events = 0;
+                continue;
             }
+            if(!inserted && added_code == code && added->priority > e->priority)
+            {
+                builder_add_listener(&builder, added, added->callback);
+                inserted = true;
+            }
+            builder_add_listener(&builder, e, callback);
+        }
+        if(!inserted && added_code == code)
+        {
+            builder_add_listener(&builder, added, added->callback);
+            inserted = true;
         }
+        builder_end_code(&builder, code);
+    }
+    if(!inserted)
+    {
+        builder_add_listener(&builder, added, added->callback);
+        builder_end_code(&builder, added_code);
     }
+    registry->firsts[registry->code_count] = registry->listener_count;
 
-    state_ptr = 0;
+    state_ptr->cleared_count = 0;
+    return registry;
 }
 
-b8 event_register(u16 code, void* listener, PFN_on_event on_event) 
+// Swaps in a new registry. The registry mutex must be held.
+static void publish_registry(event_registry* registry)
 {
-    if(!state_ptr) 
+    event_registry* old = state_ptr->registry;
+    platform_atomic_store_ptr((void* volatile*)&state_ptr->registry, registry);
+    if(old)
     {
-        return false;
+        darray_push(state_ptr->retired, old);
     }
+}
+
+// Clears the registration owned by a slot and frees the slot. The registry mutex must be held.
+static void clear_registration(u32 slot_index)
+{
+    listener_slot* slot = &state_ptr->slots[slot_index];
+    registered_event* e = &state_ptr->registry->listeners[slot->record];
+    platform_atomic_store_ptr((void* volatile*)&e->callback, 0);
+    state_ptr->cleared_count++;
+
+    slot->in_use = false;
+    slot->generation++;
+    darray_push(state_ptr->free_slots, slot_index);
+}
 
-    if(state_ptr->registered[code].events == 0) 
+KINLINE event_listener_handle make_handle(u32 slot_index, u32 generation)
+{
+    return ((u64)generation << 32) | slot_index;
+}
+
+void event_system_initialize(u64* memory_requirement, void* state)
+{
+    *memory_requirement = sizeof(event_system_state);
+    if(state == 0)
     {
-        state_ptr->registered[code].events = darray_create(registered_event);
+        return;
     }
 
-    u64 registered_count = darray_length(state_ptr->registered[code].events);
-    for(u64 i = 0; i < registered_count; ++i) 
+    kzero_memory(state, sizeof(event_system_state));
+    state_ptr = state;
+
+    if(!platform_mutex_create(&state_ptr->registry_mutex))
     {
-        // Registering the same listener more than once is not allowed.
-        if(state_ptr->registered[code].events[i].listener == listener) 
+        KERROR("event_system_initialize - unable to create the registry mutex.");
+    }
+    state_ptr->retired = darray_create(event_registry*);
+    state_ptr->slots = darray_create(listener_slot);
+    state_ptr->free_slots = darray_create(u32);
+
+    for(u32 i = 0; i < EVENT_INBOX_CAPACITY; ++i)
+    {
+        state_ptr->inbox[i].sequence = i;
+    }
+
+    event_set_coalesce_mode(EVENT_CODE_RESIZED, EVENT_COALESCE_KEEP_LAST);
+    event_set_coalesce_mode(EVENT_CODE_MOUSE_MOVED, EVENT_COALESCE_KEEP_LAST);
+    event_set_coalesce_mode(EVENT_CODE_MOUSE_WHEEL, EVENT_COALESCE_SUM_I8);
+}
+
+void event_system_shutdown(void* state)
+{
+    if(state_ptr)
+    {
+        // Free the registries. And objects pointed to should be destroyed on their own.
+        free_registry(state_ptr->registry);
+        state_ptr->registry = 0;
+
+        u64 retired_count = darray_length(state_ptr->retired);
+        for(u64 i = 0; i < retired_count; ++i)
         {
-            // TODO: warn
-            return false;
+            free_registry(state_ptr->retired[i]);
+        }
+        darray_destroy(state_ptr->retired);
+        darray_destroy(state_ptr->slots);
+        darray_destroy(state_ptr->free_slots);
+        state_ptr->retired = 0;
+        state_ptr->slots = 0;
+        state_ptr->free_slots = 0;
+
+        platform_mutex_destroy(&state_ptr->registry_mutex);
+    }
+
+    state_ptr = 0;
+}
+
+event_listener_handle event_register_listener(u16 code, void* listener, PFN_on_event on_event, i32 priority)
+{
+    if(!state_ptr || !on_event)
+    {
+        return INVALID_EVENT_LISTENER_HANDLE;
+    }
+
+    platform_mutex_lock(&state_ptr->registry_mutex);
+
+    event_registry* current = state_ptr->registry;
+    u32 code_index = find_code(current, code);
+    if(code_index != INVALID_ID)
+    {
+        for(u32 i = current->firsts[code_index]; i < current->firsts[code_index + 1]; ++i)
+        {
+            // Registering the same listener/callback combo more than once is not allowed.
+            registered_event* e = &current->listeners[i];
+            if(e->listener == listener && load_callback(e) == on_event)
+            {
+                platform_mutex_unlock(&state_ptr->registry_mutex);
+                return INVALID_EVENT_LISTENER_HANDLE;
+            }
         }
     }
 
     // If at this point, no duplicate was found. Proceed with registration.
-    registered_event event;
-    event.listener = listener;
-    event.callback = on_event;
-    darray_push(state_ptr->registered[code].events, event);
+    u32 slot_index;
+    if(darray_length(state_ptr->free_slots) > 0)
+    {
+        darray_pop(state_ptr->free_slots, &slot_index);
+    }
+    else
+    {
+        slot_index = (u32)darray_length(state_ptr->slots);
+        listener_slot new_slot = {};
+        new_slot.generation = 1;
+        darray_push(state_ptr->slots, new_slot);
+    }
+    state_ptr->slots[slot_index].in_use = true;
 
-    return true;
+    registered_event added;
+    added.listener = listener;
+    added.callback = on_event;
+    added.slot = slot_index;
+    added.priority = priority;
+    publish_registry(build_registry(code, &added));
+
+    event_listener_handle handle = make_handle(slot_index, state_ptr->slots[slot_index].generation);
+    platform_mutex_unlock(&state_ptr->registry_mutex);
+    return handle;
 }
 
-b8 event_unregister(u16 code, void* listener, PFN_on_event on_event) 
+b8 event_unregister_listener(event_listener_handle handle)
 {
-    if(!state_ptr) 
+    if(!state_ptr)
     {
         return false;
     }
 
-    // On nothing is registered for the code, boot out.
-    if(state_ptr->registered[code].events == 0) 
+    u32 slot_index = (u32)(handle & 0xFFFFFFFF);
+    u32 generation = (u32)(handle >> 32);
+
+    platform_mutex_lock(&state_ptr->registry_mutex);
+    b8 valid = slot_index < darray_length(state_ptr->slots) &&
+               state_ptr->slots[slot_index].in_use &&
+               state_ptr->slots[slot_index].generation == generation;
+    if(valid)
+    {
+        clear_registration(slot_index);
+    }
+    platform_mutex_unlock(&state_ptr->registry_mutex);
+    return valid;
+}
+
+b8 event_register(u16 code, void* listener, PFN_on_event on_event)
+{
+    return event_register_listener(code, listener, on_event, EVENT_PRIORITY_DEFAULT) != INVALID_EVENT_LISTENER_HANDLE;
+}
+
+b8 event_unregister(u16 code, void* listener, PFN_on_event on_event)
+{
+    if(!state_ptr)
     {
-        // TODO: warn
         return false;
     }
 
-    u64 registered_count = darray_length(state_ptr->registered[code].events);
-    for(u64 i = 0; i < registered_count; ++i) 
+    platform_mutex_lock(&state_ptr->registry_mutex);
+
+    event_registry* current = state_ptr->registry;
+    u32 code_index = find_code(current, code);
+    if(code_index != INVALID_ID)
     {
-        registered_event e = state_ptr->registered[code].events[i];
-        if(e.listener == listener && e.callback == on_event) 
+        for(u32 i = current->firsts[code_index]; i < current->firsts[code_index + 1]; ++i)
         {
-            // Found one, remove it
-            registered_event popped_event;
-            darray_pop_at(state_ptr->registered[code].events, i, &popped_event);
-            return true;
+            registered_event* e = &current->listeners[i];
+            if(e->listener == listener && load_callback(e) == on_event)
+            {
+                // Found one, remove it
+                clear_registration(e->slot);
+                platform_mutex_unlock(&state_ptr->registry_mutex);
+                return true;
+            }
         }
     }
 
     // Not found.
+    platform_mutex_unlock(&state_ptr->registry_mutex);
     return false;
 }
 
-b8 event_fire(u16 code, void* sender, event_context context) 
+b8 event_fire(u16 code, void* sender, event_context context)
 {
-    if(!state_ptr) 
+    if(!state_ptr)
     {
         return false;
     }
 
-    // If nothing is registered for the code, boot out.
-    if(state_ptr->registered[code].events == 0) 
+    // Announce the fire before loading the registry, so it cannot be freed while in use.
+    platform_atomic_add_i32(&state_ptr->active_fires, 1);
+    event_registry* registry = platform_atomic_load_ptr((void* volatile*)&state_ptr->registry);
+
+    b8 handled = false;
+    u32 code_index = find_code(registry, code);
+    if(code_index != INVALID_ID)
+    {
+        u32 end = registry->firsts[code_index + 1];
+        for(u32 i = registry->firsts[code_index]; i < end; ++i)
+        {
+            registered_event* e = &registry->listeners[i];
+            PFN_on_event callback = load_callback(e);
+            if(callback && callback(code, sender, e->listener, context))
+            {
+                // Message has been handled, do not send to other listeners.
+                handled = true;
+                break;
+            }
+        }
+    }
+
+    platform_atomic_add_i32(&state_ptr->active_fires, -1);
+    return handled;
+}
+
+b8 event_post(u16 code, void* sender, event_context context)
+{
+    if(!state_ptr)
     {
         return false;
     }
 
-    u64 registered_count = darray_length(state_ptr->registered[code].events);
-    for(u64 i = 0; i < registered_count; ++i) 
+    // Claim a cell by advancing the write position, then fill it in and mark it written.
+    i64 position = platform_atomic_load_i64(&state_ptr->inbox_write);
+    inbox_cell* cell;
+    for(;;)
     {
-        registered_event e = state_ptr->registered[code].events[i];
-        if(e.callback(code, sender, e.listener, context)) 
+        cell = &state_ptr->inbox[position & (EVENT_INBOX_CAPACITY - 1)];
+        i64 sequence = platform_atomic_load_i64(&cell->sequence);
+        if(sequence == position)
         {
-            // Message has been handled, do not send to other listeners.
-            return true;
+            if(platform_atomic_compare_exchange_i64(&state_ptr->inbox_write, position, position + 1))
+            {
+                break;
+            }
+        }
+        else if(sequence < position)
+        {
+            // The cell has not been drained since the last lap, so the inbox is full.
+            platform_atomic_add_i32(&state_ptr->dropped_count, 1);
+            return false;
         }
+        // Another thread claimed this position first.
+        position = platform_atomic_load_i64(&state_ptr->inbox_write);
     }
 
-    // Not found.
-    return false;
-}
\ No newline at end of file
+    cell->event.code = code;
+    cell->event.sender = sender;
+    cell->event.context = context;
+    platform_atomic_store_i64(&cell->sequence, position + 1);
+    return true;
+}
+
+void event_set_coalesce_mode(u16 code, event_coalesce_mode mode)
+{
+    if(!state_ptr)
+    {
+        return;
+    }
+
+    for(u32 i = 0; i < state_ptr->coalesce_rule_count; ++i)
+    {
+        if(state_ptr->coalesce_rules[i].code == code)
+        {
+            state_ptr->coalesce_rules[i].mode = (u8)mode;
+            return;
+        }
+    }
+
+    if(mode == EVENT_COALESCE_NONE)
+    {
+        return;
+    }
+    if(state_ptr->coalesce_rule_count == MAX_COALESCE_RULES)
+    {
+        KWARN("event_set_coalesce_mode - no room for a coalesce mode for code %u.", code);
+        return;
+    }
+    coalesce_rule* rule = &state_ptr->coalesce_rules[state_ptr->coalesce_rule_count++];
+    rule->code = code;
+    rule->mode = (u8)mode;
+}
+
+static u8 get_coalesce_mode(u16 code)
+{
+    for(u32 i = 0; i < state_ptr->coalesce_rule_count; ++i)
+    {
+        if(state_ptr->coalesce_rules[i].code == code)
+        {
+            return state_ptr->coalesce_rules[i].mode;
+        }
+    }
+    return EVENT_COALESCE_NONE;
+}
+
+// Adds an event to the batch, merging it with a batched event of the same code if it coalesces.
+static void batch_event(u32* count, const queued_event* event)
+{
+    u8 mode = get_coalesce_mode(event->code);
+    if(mode != EVENT_COALESCE_NONE)
+    {
+        // At most one event per coalescing code is batched, so the first match is the only one.
+        for(u32 i = 0; i < *count; ++i)
+        {
+            queued_event* batched = &state_ptr->batch[i];
+            if(batched->code != event->code)
+            {
+                continue;
+            }
+
+            batched->sender = event->sender;
+            if(mode == EVENT_COALESCE_SUM_I8)
+            {
+                for(u32 lane = 0; lane < 16; ++lane)
+                {
+                    i32 sum = batched->context.data.i8[lane] + event->context.data.i8[lane];
+                    batched->context.data.i8[lane] = (i8)(sum > 127 ? 127 : (sum < -128 ? -128 : sum));
+                }
+            }
+            else
+            {
+                batched->context = event->context;
+            }
+            return;
+        }
+    }
+
+    state_ptr->batch[(*count)++] = *event;
+}
+
+u32 event_dispatch_queued()
+{
+    if(!state_ptr)
+    {
+        return 0;
+    }
+
+    // Compact away unregistered listeners, then free what is no longer in use.
+    platform_mutex_lock(&state_ptr->registry_mutex);
+    if(state_ptr->cleared_count > 0)
+    {
+        publish_registry(build_registry(0, 0));
+    }
+    platform_mutex_unlock(&state_ptr->registry_mutex);
+    reclaim_retired_registries();
+
+    i32 dropped_count = platform_atomic_load_i32(&state_ptr->dropped_count);
+    if(dropped_count > 0)
+    {
+        KWARN("event_dispatch_queued - the event queue was full, %i posted events were dropped.", dropped_count);
+        platform_atomic_add_i32(&state_ptr->dropped_count, -dropped_count);
+    }
+
+    // Drain what has been posted so far into the batch. Events posted after this point, by other threads
+    // while draining or by listeners while the batch is fired, stay in the inbox for the next dispatch.
+    // Positions up to the end have been claimed, so at most one inbox's worth fits in the batch.
+    i64 end = platform_atomic_load_i64(&state_ptr->inbox_write);
+    u32 count = 0;
+    while(state_ptr->inbox_read < end)
+    {
+        inbox_cell* cell = &state_ptr->inbox[state_ptr->inbox_read & (EVENT_INBOX_CAPACITY - 1)];
+        if(platform_atomic_load_i64(&cell->sequence) != state_ptr->inbox_read + 1)
+        {
+            // Empty, or the next event is still being written. Either way it waits for next time.
+            break;
+        }
+
+        batch_event(&count, &cell->event);
+        platform_atomic_store_i64(&cell->sequence, state_ptr->inbox_read + EVENT_INBOX_CAPACITY);
+        state_ptr->inbox_read++;
+    }
+
+    for(u32 i = 0; i < count; ++i)
+    {
+        event_fire(state_ptr->batch[i].code, state_ptr->batch[i].sender, state_ptr->batch[i].context);
+    }
+
+    return count;
+}
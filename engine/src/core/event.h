@@ -28,15 +28,41 @@ typedef struct event_context
     } data;
 } event_context;
 
+/*
+    How events posted with event_post are merged with one of the same code that is already queued
+    for the frame. A merged event keeps the queue position of the first one posted.
+*/
+typedef enum event_coalesce_mode
+{
+    // Every posted event is queued and dispatched.
+    EVENT_COALESCE_NONE,
+    // Only the last posted context and sender are kept. Suits absolute state such as a new size.
+    EVENT_COALESCE_KEEP_LAST,
+    // Each of the 16 i8 lanes of the context is added, saturating. Suits deltas such as the mouse wheel.
+    EVENT_COALESCE_SUM_I8
+} event_coalesce_mode;
+
 // Should return true if handled.
 typedef b8 (*PFN_on_event)(u16 code, void* sender, void* listener_inst, event_context data);
 
+/*
+    Identifies one registration, for unregistering it without a search. A handle is never reused
+    once its registration is gone, so unregistering with a stale one safely does nothing.
+*/
+typedef u64 event_listener_handle;
+
+#define INVALID_EVENT_LISTENER_HANDLE 0
+
+// Priority of listeners registered with event_register. Higher priorities are called first.
+#define EVENT_PRIORITY_DEFAULT 0
+
 void event_system_initialize(u64* memory_requirement, void* state);
 void event_system_shutdown(void* state);
 
 /**
  * Register to listen for when events are sent with the provided code. Events with duplicate
  * listener/callback combos will not be registered again and will cause this to return false.
+ * Safe to call from any thread, including from within a listener.
  * @param code The event code to listen for.
  * @param listener A pointer to a listener instance. Can be 0/NULL.
  * @param on_event The callback function pointer to be invoked when the event code is fired.
@@ -46,7 +72,8 @@ KAPI b8 event_register(u16 code, void* listener, PFN_on_event on_event);
 
 /**
  * Unregister from listening for when events are sent with the provided code. If no matching
- * registration is found, this function returns false.
+ * registration is found, this function returns false. Safe to call from any thread. A fire already
+ * in progress may still call the listener once. Prefer event_unregister_listener, which needs no search.
  * @param code The event code to stop listening for.
  * @param listener A pointer to a listener instance. Can be 0/NULL.
  * @param on_event The callback function pointer to be unregistered.
@@ -54,9 +81,30 @@ KAPI b8 event_register(u16 code, void* listener, PFN_on_event on_event);
  */
 KAPI b8 event_unregister(u16 code, void* listener, PFN_on_event on_event);
 
+/**
+ * Registers like event_register, but with a priority, and returns a handle to unregister with.
+ * Listeners of a code are called in descending order of priority, and in the order they were
+ * registered within a priority.
+ * @param code The event code to listen for.
+ * @param listener A pointer to a listener instance. Can be 0/NULL.
+ * @param on_event The callback function pointer to be invoked when the event code is fired.
+ * @param priority The priority of the listener. EVENT_PRIORITY_DEFAULT is what event_register uses.
+ * @returns A handle to the registration, or INVALID_EVENT_LISTENER_HANDLE if it is a duplicate.
+ */
+KAPI event_listener_handle event_register_listener(u16 code, void* listener, PFN_on_event on_event, i32 priority);
+
+/**
+ * Unregisters the registration a handle refers to, in constant time. Safe to call from any thread.
+ * @param handle A handle returned by event_register_listener.
+ * @returns true if the registration was found and removed; false if the handle is stale or invalid.
+ */
+KAPI b8 event_unregister_listener(event_listener_handle handle);
+
 /**
  * Fires an event to listeners of the given code. If an event handler returns 
  * true, the event is considered handled and is not passed on to any more listeners.
+ * Listeners are called on the calling thread, without taking a lock. To have them called on the
+ * main thread instead, use event_post.
  * @param code The event code to fire.
  * @param sender A pointer to the sender. Can be 0/NULL.
  * @param data The event data.
@@ -64,6 +112,34 @@ KAPI b8 event_unregister(u16 code, void* listener, PFN_on_event on_event);
  */
 KAPI b8 event_fire(u16 code, void* sender, event_context context);
 
+/**
+ * Queues an event to be fired by the next call to event_dispatch_queued, merging it with a queued
+ * event of the same code according to that code's coalesce mode. Safe to call from any thread, and
+ * never blocks; events posted by one thread are dispatched in the order that thread posted them.
+ * @param code The event code to post.
+ * @param sender A pointer to the sender. Can be 0/NULL.
+ * @param context The event data.
+ * @returns true if the event was queued or merged; false if the queue is full and it was dropped.
+ */
+KAPI b8 event_post(u16 code, void* sender, event_context context);
+
+/**
+ * Sets how posted events with the given code are merged with one already queued. Events fired
+ * directly are unaffected. EVENT_CODE_RESIZED and EVENT_CODE_MOUSE_MOVED default to keeping the last,
+ * and EVENT_CODE_MOUSE_WHEEL to summing; everything else defaults to EVENT_COALESCE_NONE.
+ * Must only be called from the main thread.
+ * @param code The event code.
+ * @param mode The coalesce mode to use.
+ */
+KAPI void event_set_coalesce_mode(u16 code, event_coalesce_mode mode);
+
+/**
+ * Fires every event queued with event_post, in the order they were first posted. Events posted
+ * by listeners while this runs are queued for the next call. Must only be called from the main thread.
+ * @returns The number of events fired.
+ */
+KAPI u32 event_dispatch_queued();
+
 
 // System internal event codes. Application should use codes beyond 255.
 typedef enum system_event_code 
@@ -104,7 +180,7 @@ typedef enum system_event_code
 
     // Mouse moved.
     /* Context usage:
-     * u8 z_delta = data.data.u8[0];
+     * i8 z_delta = data.data.i8[0];
      */
     EVENT_CODE_MOUSE_WHEEL = 0x07,
 
@@ -125,11 +125,11 @@ void input_process_mouse_move(i16 x, i16 y)
         state_ptr->mouse_current.x = x;
         state_ptr->mouse_current.y = y;
 
-        // Fire the event.
+        // Post the event. Moves are coalesced, so listeners only see the last position each frame.
         event_context context;
         context.data.u16[0] = x;
         context.data.u16[1] = y;
-        event_fire(EVENT_CODE_MOUSE_MOVED, 0, context);
+        event_post(EVENT_CODE_MOUSE_MOVED, 0, context);
     }
 }
 
@@ -137,10 +137,10 @@ void input_process_mouse_wheel(i8 z_delta)
 {
     // NOTE: no internal state to update.
 
-    // Fire the event.
-    event_context context;
-    context.data.u8[0] = z_delta;
-    event_fire(EVENT_CODE_MOUSE_WHEEL, 0, context);
+    // Post the event. Wheel deltas are summed per frame, so the unused lanes must be zero.
+    event_context context = {};
+    context.data.i8[0] = z_delta;
+    event_post(EVENT_CODE_MOUSE_WHEEL, 0, context);
 }
 
 /*
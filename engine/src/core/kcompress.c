@@ -0,0 +1,207 @@
+#include "kcompress.h"
+
+#include <string.h>
+
+#define MIN_MATCH 4
+#define MAX_OFFSET 65535
+// The format requires the last 5 bytes to be literals, and no match to start in the last 12.
+#define LAST_LITERALS 5
+#define MATCH_FIND_LIMIT 12
+// Positions of recently seen 4 byte sequences, by hash.
+#define HASH_BITS 12
+#define HASH_SIZE (1 << HASH_BITS)
+
+KINLINE u32 read_u32(const u8* p)
+{
+    u32 value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+KINLINE u32 hash_sequence(u32 sequence)
+{
+    return (sequence * 2654435761U) >> (32 - HASH_BITS);
+}
+
+// Lengths of 15 or more continue in bytes of 255 until one is less.
+static u8* write_length(u8* op, u64 length)
+{
+    while(length >= 255)
+    {
+        *op++ = 255;
+        length -= 255;
+    }
+    *op++ = (u8)length;
+    return op;
+}
+
+// Writes literals and, if match_length is not 0, the match after them. Returns 0 if out of room.
+static u8* write_sequence(u8* op, u8* op_end, const u8* literals, u64 literal_length, u64 offset, u64 match_length)
+{
+    // Token, both lengths' extra bytes, the literals and the offset, at the most.
+    u64 worst_case = 1 + (literal_length / 255 + 1) + literal_length + 2 + (match_length / 255 + 1);
+    if(worst_case > (u64)(op_end - op))
+    {
+        return 0;
+    }
+
+    u64 match_code = match_length ? match_length - MIN_MATCH : 0;
+    u8* token = op++;
+    *token = (u8)(((literal_length >= 15 ? 15 : literal_length) << 4) | (match_code >= 15 ? 15 : match_code));
+    if(literal_length >= 15)
+    {
+        op = write_length(op, literal_length - 15);
+    }
+    memcpy(op, literals, literal_length);
+    op += literal_length;
+
+    if(match_length)
+    {
+        *op++ = (u8)(offset & 0xFF);
+        *op++ = (u8)(offset >> 8);
+        if(match_code >= 15)
+        {
+            op = write_length(op, match_code - 15);
+        }
+    }
+    return op;
+}
+
+u64 kcompress_bound(u64 source_size)
+{
+    return source_size + source_size / 255 + 16;
+}
+
+u64 kcompress(const u8* source, u64 source_size, u8* out_data, u64 out_capacity)
+{
+    u32 table[HASH_SIZE] = {};
+    const u8* ip = source;
+    const u8* anchor = source;
+    const u8* end = source + source_size;
+    u8* op = out_data;
+    u8* op_end = out_data + out_capacity;
+
+    // Greedy: take the first match the table offers, then carry on after it.
+    if(source_size > MATCH_FIND_LIMIT)
+    {
+        const u8* find_limit = end - MATCH_FIND_LIMIT;
+        const u8* match_limit = end - LAST_LITERALS;
+        while(ip < find_limit)
+        {
+            u32 sequence = read_u32(ip);
+            u32 h = hash_sequence(sequence);
+            const u8* candidate = source + table[h];
+            table[h] = (u32)(ip - source);
+
+            if(candidate >= ip || ip - candidate > MAX_OFFSET || read_u32(candidate) != sequence)
+            {
+                ip++;
+                continue;
+            }
+
+            u64 match_length = MIN_MATCH;
+            while(ip + match_length < match_limit && candidate[match_length] == ip[match_length])
+            {
+                match_length++;
+            }
+
+            op = write_sequence(op, op_end, anchor, ip - anchor, ip - candidate, match_length);
+            if(!op)
+            {
+                return 0;
+            }
+            ip += match_length;
+            anchor = ip;
+        }
+    }
+
+    // Everything after the last match.
+    op = write_sequence(op, op_end, anchor, end - anchor, 0, 0);
+    return op ? (u64)(op - out_data) : 0;
+}
+
+// Reads the extra bytes of a length. Returns false if they run past the end.
+static b8 read_length(const u8** ip, const u8* ip_end, u64* length)
+{
+    u8 b;
+    do
+    {
+        if(*ip >= ip_end)
+        {
+            return false;
+        }
+        b = *(*ip)++;
+        *length += b;
+    } while(b == 255);
+    return true;
+}
+
+b8 kdecompress(const u8* source, u64 source_size, u8* out_data, u64 out_size)
+{
+    const u8* ip = source;
+    const u8* ip_end = source + source_size;
+    u8* op = out_data;
+    u8* op_end = out_data + out_size;
+
+    while(ip < ip_end)
+    {
+        u8 token = *ip++;
+        u64 literal_length = token >> 4;
+        if(literal_length == 15 && !read_length(&ip, ip_end, &literal_length))
+        {
+            return false;
+        }
+        if(literal_length > (u64)(ip_end - ip) || literal_length > (u64)(op_end - op))
+        {
+            return false;
+        }
+        memcpy(op, ip, literal_length);
+        op += literal_length;
+        ip += literal_length;
+
+        // The last sequence has no match.
+        if(ip == ip_end)
+        {
+            break;
+        }
+
+        if(ip_end - ip < 2)
+        {
+            return false;
+        }
+        u64 offset = ip[0] | ((u64)ip[1] << 8);
+        ip += 2;
+        if(offset == 0 || offset > (u64)(op - out_data))
+        {
+            return false;
+        }
+
+        u64 match_length = token & 15;
+        if(match_length == 15 && !read_length(&ip, ip_end, &match_length))
+        {
+            return false;
+        }
+        match_length += MIN_MATCH;
+        if(match_length > (u64)(op_end - op))
+        {
+            return false;
+        }
+
+        // A match can overlap the bytes it produces, which repeats them, so those are copied a byte at a time.
+        const u8* match = op - offset;
+        if(offset >= match_length)
+        {
+            memcpy(op, match, match_length);
+        }
+        else
+        {
+            for(u64 i = 0; i < match_length; ++i)
+            {
+                op[i] = match[i];
+            }
+        }
+        op += match_length;
+    }
+
+    return op == op_end;
+}
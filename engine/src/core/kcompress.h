@@ -0,0 +1,38 @@
+#pragma once
+
+#include "defines.h"
+
+/*
+    Fast lossless compression in the LZ4 block format: a run of literal bytes, then a copy of up to
+    64KiB back in the output, repeated. Compresses less than general purpose formats, but decompresses
+    at close to the speed of a memory copy, which is what loading assets needs. There is no framing,
+    so the sizes before and after compression must be stored alongside the data.
+*/
+
+/**
+ * The most bytes kcompress can write for source_size bytes of input.
+ * @param source_size The size of the data to compress.
+ * @returns The size of output buffer which is always large enough.
+ */
+KAPI u64 kcompress_bound(u64 source_size);
+
+/**
+ * Compresses data.
+ * @param source The data to compress.
+ * @param source_size The size of source.
+ * @param out_data A buffer to hold the compressed data.
+ * @param out_capacity The size of out_data. kcompress_bound(source_size) is always enough.
+ * @returns The size of the compressed data, or 0 if it did not fit.
+ */
+KAPI u64 kcompress(const u8* source, u64 source_size, u8* out_data, u64 out_capacity);
+
+/**
+ * Decompresses data compressed with kcompress. Checks every length and offset, so malformed data
+ * fails rather than reading or writing out of bounds.
+ * @param source The compressed data.
+ * @param source_size The size of source.
+ * @param out_data A buffer to hold the decompressed data.
+ * @param out_size The size the data had before it was compressed.
+ * @returns True if source decompressed to exactly out_size bytes; otherwise false.
+ */
+KAPI b8 kdecompress(const u8* source, u64 source_size, u8* out_data, u64 out_size);
@@ -3,17 +3,12 @@
 #include "core/logger.h"
 #include "core/kstring.h"
 #include "platform/platform.h"
+#include "memory/dynamic_allocator.h"
 
 // TODO: Custom string lib
 #include <string.h>
 #include <stdio.h>
 
-struct memory_stats
-{
-    u64 total_allocated;
-    u64 tagged_allocations[MEMORY_TAG_MAX_TAGS];
-};
-
 static const char* memory_tag_strings[MEMORY_TAG_MAX_TAGS] = 
 {
     "UNKNOWN    ",
@@ -33,77 +28,217 @@ static const char* memory_tag_strings[MEMORY_TAG_MAX_TAGS] =
     "TRANSFORM  ",
     "ENTITY     ",
     "ENTITY_NODE",
-    "SCENE      "
+    "SCENE      ",
+    "PROFILER   ",
+    "EVENT      "
 };
 
 typedef struct memory_system_state
 {
-    struct memory_stats stats;
-    u64 alloc_count;
+    memory_system_config config;
+    memory_stats stats;
+    // Totals at the start of the current frame, used to produce the per-frame deltas.
+    u64 frame_start_allocated;
+    u64 frame_start_allocation_count;
+    // Serves every allocation made after initialization. Falls back to the platform once exhausted.
+    dynamic_allocator allocator;
+    void* allocator_block;
+    // Guards the allocator and the stats, as allocations may come from job threads.
+    platform_mutex allocation_mutex;
 } memory_system_state; 
 
 // Pointer to the system state
 static memory_system_state* state_ptr;
 
-void memory_system_initialize(u64* memory_requirements, void* state)
+b8 memory_system_initialize(u64* memory_requirements, void* state, memory_system_config config)
 {
     *memory_requirements = sizeof(memory_system_state);
     if(state == 0)
     {
-        return;
+        return true;
     }
 
-    state_ptr = state;
-    state_ptr->alloc_count = 0;
-    platform_zero_memory(&state_ptr->stats, sizeof(state_ptr->stats));
+    if(config.alignment == 0)
+    {
+        config.alignment = 16;
+    }
+
+    if((config.alignment & (config.alignment - 1)) != 0)
+    {
+        KERROR("memory_system_initialize - alignment %llu is not a power of two.", config.alignment);
+        return false;
+    }
+
+    memory_system_state* new_state = state;
+    platform_zero_memory(new_state, sizeof(memory_system_state));
+    new_state->config = config;
+
+    // Reserve the whole block once so that steady-state allocations never reach the platform allocator.
+    new_state->allocator_block = platform_allocate_aligned(config.total_alloc_size, 64);
+    if(!new_state->allocator_block || !dynamic_allocator_create(config.total_alloc_size, new_state->allocator_block, &new_state->allocator))
+    {
+        KERROR("memory_system_initialize - unable to reserve %lluB for the dynamic allocator.", config.total_alloc_size);
+        if(new_state->allocator_block)
+        {
+            platform_free_aligned(new_state->allocator_block);
+        }
+        return false;
+    }
+
+    if(!platform_mutex_create(&new_state->allocation_mutex))
+    {
+        KERROR("memory_system_initialize - unable to create the allocation mutex.");
+        platform_free_aligned(new_state->allocator_block);
+        return false;
+    }
+
+    state_ptr = new_state;
+    return true;
 }
 
 void memory_system_shutdown(void* state) 
 {
+    if(state_ptr)
+    {
+        dynamic_allocator_destroy(&state_ptr->allocator);
+        platform_free_aligned(state_ptr->allocator_block);
+        platform_mutex_destroy(&state_ptr->allocation_mutex);
+        state_ptr->allocator_block = 0;
+    }
     state_ptr = 0;
 }
 
-void* kallocate(u64 size, memory_tag tag)
+static void track_allocation(u64 size, memory_tag tag)
+{
+    memory_stats* stats = &state_ptr->stats;
+    stats->total_allocated += size;
+    stats->allocation_count++;
+    if(stats->total_allocated > stats->peak_allocated)
+    {
+        stats->peak_allocated = stats->total_allocated;
+    }
+
+    memory_tag_stats* tag_stats = &stats->tags[tag];
+    tag_stats->current_bytes += size;
+    tag_stats->allocation_count++;
+    if(tag_stats->current_bytes > tag_stats->peak_bytes)
+    {
+        tag_stats->peak_bytes = tag_stats->current_bytes;
+    }
+}
+
+static void track_free(u64 size, memory_tag tag)
+{
+    memory_stats* stats = &state_ptr->stats;
+    stats->total_allocated -= size;
+    stats->free_count++;
+
+    memory_tag_stats* tag_stats = &stats->tags[tag];
+    tag_stats->current_bytes -= size;
+    tag_stats->free_count++;
+}
+
+static void* allocate_block(u64 size, u64 alignment, memory_tag tag)
 {
     if(tag == MEMORY_TAG_UNKNOWN)
     {
         KWARN("kallocate called using MEMORY_TAG_UNKNOWN. Re-class this allocation.");
     }
 
-    // TODO: Memory Alignment
-    void* block = platform_allocate(size, false);
-    // Always zero-out the memory. Any memory we get will be zeroed out, so we won't be concerned about rubbish data
-    platform_zero_memory(block, size);
-    
+    void* block = 0;
     if(state_ptr)
     {
+        if(alignment < state_ptr->config.alignment)
+        {
+            alignment = state_ptr->config.alignment;
+        }
+
+        platform_mutex_lock(&state_ptr->allocation_mutex);
+        block = dynamic_allocator_allocate_aligned(&state_ptr->allocator, size, alignment);
         // Keep track of memory stats
-        state_ptr->stats.total_allocated += size;
-        state_ptr->stats.tagged_allocations[tag] += size;
-        state_ptr->alloc_count++;
+        track_allocation(size, tag);
+        platform_mutex_unlock(&state_ptr->allocation_mutex);
+
+        if(!block)
+        {
+            KWARN("kallocate - dynamic allocator exhausted, falling back to the platform for %lluB.", size);
+        }
+    }
+
+    if(!block)
+    {
+        // Before the memory system is up (or once its block is exhausted) go straight to the platform.
+        block = platform_allocate_aligned(size, alignment);
     }
 
     return block;
 }
 
-void kfree(void* block, u64 size, memory_tag tag)
+static void free_block(void* block, u64 size, memory_tag tag)
 {
     if(tag == MEMORY_TAG_UNKNOWN)
     {
         KWARN("kfree called using MEMORY_TAG_UNKNOWN. Re-class this allocation.");
     }
 
-    // TODO: Memory alignment
-    platform_free(block, false);
+    if(!state_ptr)
+    {
+        platform_free_aligned(block);
+        return;
+    }
+
+    platform_mutex_lock(&state_ptr->allocation_mutex);
+    b8 owned = dynamic_allocator_owns(&state_ptr->allocator, block);
+    if(owned)
+    {
+        dynamic_allocator_free(&state_ptr->allocator, block);
+    }
+    // Keep track of memory stats
+    track_free(size, tag);
+    platform_mutex_unlock(&state_ptr->allocation_mutex);
 
-    if(state_ptr)
+    if(!owned)
     {
-        // Keep track of memory stats
-        state_ptr->stats.total_allocated -= size;   
-        state_ptr->stats.tagged_allocations[tag] -= size;
+        platform_free_aligned(block);
     }
 }
 
+void* kallocate(u64 size, memory_tag tag)
+{
+    void* block = allocate_block(size, 16, tag);
+    // Always zero-out the memory. Any memory we get will be zeroed out, so we won't be concerned about rubbish data
+    platform_zero_memory(block, size);
+    return block;
+}
+
+void* kallocate_no_zero(u64 size, memory_tag tag)
+{
+    return allocate_block(size, 16, tag);
+}
+
+void* kallocate_aligned(u64 size, u64 alignment, memory_tag tag)
+{
+    if(alignment == 0 || (alignment & (alignment - 1)) != 0)
+    {
+        KERROR("kallocate_aligned - alignment %llu is not a power of two.", alignment);
+        return 0;
+    }
+
+    void* block = allocate_block(size, alignment, tag);
+    platform_zero_memory(block, size);
+    return block;
+}
+
+void kfree(void* block, u64 size, memory_tag tag)
+{
+    free_block(block, size, tag);
+}
+
+void kfree_aligned(void* block, u64 size, u64 alignment, memory_tag tag)
+{
+    free_block(block, size, tag);
+}
+
 void* kzero_memory(void* block, u64 size) 
 {
     return platform_zero_memory(block, size);
@@ -119,41 +254,44 @@ void* kset_memory(void* dest, i32 value, u64 size)
     return platform_set_memory(dest, value, size);
 }
 
-char* get_memory_usage_str()
+// Splits a byte count into an amount and a binary unit suffix for display.
+static const char* size_unit(u64 bytes, f32* out_amount)
 {
     const u64 gib = 1024 * 1024 * 1024;
     const u64 mib = 1024 * 1024;
     const u64 kib = 1024;
 
+    if(bytes >= gib)
+    {
+        *out_amount = bytes / (f32)gib;
+        return "GiB";
+    }
+    else if(bytes >= mib)
+    {
+        *out_amount = bytes / (f32)mib;
+        return "MiB";
+    }
+    else if(bytes >= kib)
+    {
+        *out_amount = bytes / (f32)kib;
+        return "KiB";
+    }
+
+    *out_amount = (f32)bytes;
+    return "B";
+}
+
+char* get_memory_usage_str()
+{
     char buffer[8000] = "System memory use (tagged):\n";
     u64 offset = strlen(buffer);
     for (u32 i = 0; i < MEMORY_TAG_MAX_TAGS; ++i) 
     {
-        char unit[4] = "XiB";
-        float amount = 1.0f;
-        if (state_ptr->stats.tagged_allocations[i] >= gib) 
-        {
-            unit[0] = 'G';
-            amount = state_ptr->stats.tagged_allocations[i] / (float)gib;
-        } 
-        else if (state_ptr->stats.tagged_allocations[i] >= mib)
-        {
-            unit[0] = 'M';
-            amount = state_ptr->stats.tagged_allocations[i] / (float)mib;
-        } 
-        else if (state_ptr->stats.tagged_allocations[i] >= kib)
-        {
-            unit[0] = 'K';
-            amount = state_ptr->stats.tagged_allocations[i] / (float)kib;
-        } 
-        else 
-        {
-            unit[0] = 'B';
-            unit[1] = 0;
-            amount = (float)state_ptr->stats.tagged_allocations[i];
-        }
+        f32 amount, peak;
+        const char* unit = size_unit(state_ptr->stats.tags[i].current_bytes, &amount);
+        const char* peak_unit = size_unit(state_ptr->stats.tags[i].peak_bytes, &peak);
 
-        i32 length = snprintf(buffer + offset, 8000, "  %s: %.2f%s\n", memory_tag_strings[i], amount, unit);
+        i32 length = snprintf(buffer + offset, 8000 - offset, "  %s: %.2f%s (peak %.2f%s)\n", memory_tag_strings[i], amount, unit, peak, peak_unit);
         offset += length;
     }
     char* out_string = string_duplicate(buffer);
@@ -164,8 +302,40 @@ u64 get_memory_alloc_count()
 {
     if(state_ptr)
     {
-        return state_ptr->alloc_count;
+        return state_ptr->stats.allocation_count;
     }
 
     return 0;
-}
\ No newline at end of file
+}
+
+b8 memory_system_get_stats(memory_stats* out_stats)
+{
+    if(!state_ptr || !out_stats)
+    {
+        return false;
+    }
+
+    platform_mutex_lock(&state_ptr->allocation_mutex);
+    kcopy_memory(out_stats, &state_ptr->stats, sizeof(memory_stats));
+    platform_mutex_unlock(&state_ptr->allocation_mutex);
+    return true;
+}
+
+void memory_system_end_frame()
+{
+    if(state_ptr)
+    {
+        platform_mutex_lock(&state_ptr->allocation_mutex);
+        memory_stats* stats = &state_ptr->stats;
+        stats->frame_delta_bytes = (i64)stats->total_allocated - (i64)state_ptr->frame_start_allocated;
+        stats->frame_allocation_count = stats->allocation_count - state_ptr->frame_start_allocation_count;
+        state_ptr->frame_start_allocated = stats->total_allocated;
+        state_ptr->frame_start_allocation_count = stats->allocation_count;
+        platform_mutex_unlock(&state_ptr->allocation_mutex);
+    }
+}
+
+const char* memory_tag_name(memory_tag tag)
+{
+    return tag < MEMORY_TAG_MAX_TAGS ? memory_tag_strings[tag] : "INVALID    ";
+}
@@ -23,18 +23,61 @@ typedef enum memory_tag
     MEMORY_TAG_ENTITY,
     MEMORY_TAG_ENTITY_NODE,
     MEMORY_TAG_SCENE,
+    MEMORY_TAG_PROFILER,
+    MEMORY_TAG_EVENT,
 
     MEMORY_TAG_MAX_TAGS // Number of tags we have
 } memory_tag;
 
 
-KAPI void memory_system_initialize(u64* memory_requirement, void* state);
+typedef struct memory_tag_stats
+{
+    // Bytes currently allocated under this tag.
+    u64 current_bytes;
+    // Highest value current_bytes has reached.
+    u64 peak_bytes;
+    u64 allocation_count;
+    u64 free_count;
+} memory_tag_stats;
+
+typedef struct memory_stats
+{
+    u64 total_allocated;
+    u64 peak_allocated;
+    u64 allocation_count;
+    u64 free_count;
+    // Net bytes allocated during the last completed frame (negative if more was freed).
+    i64 frame_delta_bytes;
+    // Number of allocations made during the last completed frame.
+    u64 frame_allocation_count;
+    memory_tag_stats tags[MEMORY_TAG_MAX_TAGS];
+} memory_stats;
+
+typedef struct memory_system_config
+{
+    // Size in bytes of the block reserved up front for the dynamic allocator backing kallocate.
+    u64 total_alloc_size;
+    // Alignment of blocks returned by kallocate. Must be a power of two; 0 selects the default of 16.
+    u64 alignment;
+} memory_system_config;
+
+KAPI b8 memory_system_initialize(u64* memory_requirement, void* state, memory_system_config config);
 KAPI void memory_system_shutdown(void* state);
 
+// Allocates a zeroed block of memory.
 KAPI void* kallocate(u64 size, memory_tag tag);
 
+// Allocates a block of memory without zeroing it. Use when the caller overwrites the whole block anyway.
+KAPI void* kallocate_no_zero(u64 size, memory_tag tag);
+
+// Allocates a zeroed block aligned to alignment, which must be a power of two.
+KAPI void* kallocate_aligned(u64 size, u64 alignment, memory_tag tag);
+
 KAPI void kfree(void* block, u64 size, memory_tag tag);
 
+// Frees a block obtained from kallocate_aligned. Size and alignment must match the allocation.
+KAPI void kfree_aligned(void* block, u64 size, u64 alignment, memory_tag tag);
+
 KAPI void* kzero_memory(void* block, u64 size);
 
 KAPI void* kcopy_memory(void* dest, const void* source, u64 size);
@@ -43,4 +86,13 @@ KAPI void* kset_memory(void* dest, i32 value, u64 size);
 
 KAPI char* get_memory_usage_str();
 
-KAPI u64 get_memory_alloc_count();
\ No newline at end of file
+KAPI u64 get_memory_alloc_count();
+
+// Copies the current statistics into out_stats. Returns false if the memory system is not initialized.
+KAPI b8 memory_system_get_stats(memory_stats* out_stats);
+
+// Closes the current frame, publishing its deltas in memory_stats. Called once per frame by the application.
+KAPI void memory_system_end_frame();
+
+// Returns the fixed-width display name of the given tag.
+KAPI const char* memory_tag_name(memory_tag tag);
\ No newline at end of file
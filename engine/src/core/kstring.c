@@ -17,7 +17,7 @@ u64 string_length(const char* str)
 char* string_duplicate(const char* str) 
 {
     u64 length = string_length(str);
-    char* copy = kallocate(length + 1, MEMORY_TAG_STRING);
+    char* copy = kallocate_no_zero(length + 1, MEMORY_TAG_STRING);
     kcopy_memory(copy, str, length + 1);
     return copy;
 }
@@ -66,4 +66,21 @@ i32 string_format_v(char* dest, const char* format, void* va_listp)
     }
 
     return -1;
-}
\ No newline at end of file
+}
+
+i32 string_format_n_v(char* dest, u64 size, const char* format, void* va_listp)
+{
+    if(dest && size > 0)
+    {
+        i32 written = vsnprintf(dest, size, format, va_listp);
+        if(written < 0)
+        {
+            dest[0] = 0;
+            return -1;
+        }
+
+        return (u64)written < size ? written : (i32)(size - 1);
+    }
+
+    return -1;
+}
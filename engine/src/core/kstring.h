@@ -24,4 +24,15 @@ KAPI i32 string_format(char* dest, const char* format, ...);
  * @param va_list The variadic argument list.
  * @returns The size of the data written.
  */
-KAPI i32 string_format_v(char* dest, const char* format, void* va_list);
\ No newline at end of file
+KAPI i32 string_format_v(char* dest, const char* format, void* va_list);
+
+/**
+ * Performs variadic string formatting directly into dest, writing at most size bytes including the terminator.
+ * Unlike string_format_v this never uses an intermediate buffer.
+ * @param dest The destination for the formatted string.
+ * @param size The size of dest in bytes.
+ * @param format The string to be formatted.
+ * @param va_list The variadic argument list.
+ * @returns The number of characters written, excluding the terminator. Output that does not fit is truncated.
+ */
+KAPI i32 string_format_n_v(char* dest, u64 size, const char* format, void* va_list);
\ No newline at end of file
@@ -0,0 +1,588 @@
+#include "log_binary.h"
+
+#include "core/kmemory.h"
+#include "core/kstring.h"
+#include "containers/darray.h"
+
+// TODO: temporary
+#include <stdarg.h>
+#include <stdio.h>
+#include <stddef.h>
+
+// The C type an argument was passed as, which decides how it is read from the va_list.
+typedef enum argument_type
+{
+    ARGUMENT_NONE,
+    ARGUMENT_INT,
+    ARGUMENT_LONG,
+    ARGUMENT_LONG_LONG,
+    ARGUMENT_SIZE,
+    ARGUMENT_DOUBLE,
+    ARGUMENT_STRING,
+    ARGUMENT_POINTER
+} argument_type;
+
+typedef enum length_modifier
+{
+    LENGTH_NONE,
+    LENGTH_CHAR,
+    LENGTH_SHORT,
+    LENGTH_LONG,
+    LENGTH_LONG_LONG,
+    LENGTH_SIZE,
+    LENGTH_LONG_DOUBLE
+} length_modifier;
+
+KINLINE b8 char_in_set(const char* set, char c)
+{
+    for(; *set; ++set)
+    {
+        if(*set == c)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+typedef struct conversion_spec
+{
+    // The whole spec, from '%' up to and including the conversion character.
+    const char* start;
+    u32 length;
+    // Number of '*' widths and precisions, each taking an int argument before the value.
+    u32 star_count;
+    length_modifier length_modifier;
+    char conversion;
+    argument_type type;
+    b8 is_signed;
+} conversion_spec;
+
+/**
+ * Finds the next conversion in format. Literal text and "%%" are skipped.
+ * Returns the position after the conversion, or 0 if there are no more conversions.
+ */
+static const char* next_conversion(const char* format, conversion_spec* out_spec)
+{
+    const char* p = format;
+    for(;;)
+    {
+        while(*p && *p != '%')
+        {
+            p++;
+        }
+        if(!*p)
+        {
+            return 0;
+        }
+        if(p[1] == '%')
+        {
+            p += 2;
+            continue;
+        }
+        break;
+    }
+
+    kzero_memory(out_spec, sizeof(conversion_spec));
+    out_spec->start = p;
+    p++;
+
+    // Flags, width and precision.
+    while(*p && (char_in_set("-+ #0123456789.", *p) || *p == '*'))
+    {
+        if(*p == '*')
+        {
+            out_spec->star_count++;
+        }
+        p++;
+    }
+
+    // Length modifier.
+    switch(*p)
+    {
+        case 'h':
+            p++;
+            out_spec->length_modifier = LENGTH_SHORT;
+            if(*p == 'h')
+            {
+                p++;
+                out_spec->length_modifier = LENGTH_CHAR;
+            }
+            break;
+        case 'l':
+            p++;
+            out_spec->length_modifier = LENGTH_LONG;
+            if(*p == 'l')
+            {
+                p++;
+                out_spec->length_modifier = LENGTH_LONG_LONG;
+            }
+            break;
+        case 'j':
+        case 'q':
+            p++;
+            out_spec->length_modifier = LENGTH_LONG_LONG;
+            break;
+        case 'z':
+        case 't':
+            p++;
+            out_spec->length_modifier = LENGTH_SIZE;
+            break;
+        case 'L':
+            p++;
+            out_spec->length_modifier = LENGTH_LONG_DOUBLE;
+            break;
+        default:
+            break;
+    }
+
+    out_spec->conversion = *p;
+    switch(*p)
+    {
+        case 'd':
+        case 'i':
+            out_spec->is_signed = true;
+            // Fall through.
+        case 'u':
+        case 'x':
+        case 'X':
+        case 'o':
+            switch(out_spec->length_modifier)
+            {
+                case LENGTH_LONG: out_spec->type = ARGUMENT_LONG; break;
+                case LENGTH_LONG_LONG: out_spec->type = ARGUMENT_LONG_LONG; break;
+                case LENGTH_SIZE: out_spec->type = ARGUMENT_SIZE; break;
+                default: out_spec->type = ARGUMENT_INT; break;
+            }
+            break;
+        case 'c':
+            out_spec->type = ARGUMENT_INT;
+            break;
+        case 'f':
+        case 'F':
+        case 'e':
+        case 'E':
+        case 'g':
+        case 'G':
+        case 'a':
+        case 'A':
+            // A long double does not fit the 8 bytes each argument is captured in.
+            out_spec->type = out_spec->length_modifier == LENGTH_LONG_DOUBLE ? ARGUMENT_NONE : ARGUMENT_DOUBLE;
+            break;
+        case 's':
+            out_spec->type = ARGUMENT_STRING;
+            break;
+        case 'p':
+            out_spec->type = ARGUMENT_POINTER;
+            break;
+        default:
+            // %n, wide characters and anything unknown.
+            out_spec->type = ARGUMENT_NONE;
+            break;
+    }
+
+    if(*p)
+    {
+        p++;
+    }
+    out_spec->length = (u32)(p - out_spec->start);
+    return p;
+}
+
+b8 log_binary_format_supported(const char* format)
+{
+    conversion_spec spec;
+    u32 argument_count = 0;
+    const char* p = format;
+    while((p = next_conversion(p, &spec)))
+    {
+        // Wide strings and characters (%ls, %lc) are not supported either.
+        if(spec.type == ARGUMENT_NONE || (spec.length_modifier == LENGTH_LONG && (spec.conversion == 's' || spec.conversion == 'c')))
+        {
+            return false;
+        }
+        argument_count += spec.star_count + 1;
+    }
+    return argument_count <= LOG_BINARY_MAX_ARGUMENTS;
+}
+
+KINLINE void write_u64(u8* out, u64 value)
+{
+    kcopy_memory(out, &value, sizeof(u64));
+}
+
+KINLINE u64 read_u64(const u8* in)
+{
+    u64 value;
+    kcopy_memory(&value, in, sizeof(u64));
+    return value;
+}
+
+// Narrows an integer the same way printf would for the given length modifier.
+static i64 narrow_integer(i64 value, const conversion_spec* spec)
+{
+    switch(spec->length_modifier)
+    {
+        case LENGTH_CHAR: return spec->is_signed ? (i64)(signed char)value : (i64)(unsigned char)value;
+        case LENGTH_SHORT: return spec->is_signed ? (i64)(short)value : (i64)(unsigned short)value;
+        case LENGTH_NONE: return spec->is_signed || spec->conversion == 'c' ? (i64)(int)value : (i64)(unsigned int)value;
+        case LENGTH_LONG: return spec->is_signed ? (i64)(long)value : (i64)(unsigned long)value;
+        default: return value;
+    }
+}
+
+u32 log_binary_capture(const char* format, u8* payload, u32 capacity, __builtin_va_list* args)
+{
+    u32 offset = 0;
+    conversion_spec spec;
+    const char* p = format;
+    while((p = next_conversion(p, &spec)))
+    {
+        for(u32 i = 0; i < spec.star_count; ++i)
+        {
+            i64 star = va_arg(*args, int);
+            if(offset + sizeof(u64) <= capacity)
+            {
+                write_u64(payload + offset, (u64)star);
+                offset += sizeof(u64);
+            }
+        }
+
+        u64 bits = 0;
+        switch(spec.type)
+        {
+            case ARGUMENT_INT:
+                bits = (u64)narrow_integer(va_arg(*args, int), &spec);
+                break;
+            case ARGUMENT_LONG:
+                bits = (u64)narrow_integer(va_arg(*args, long), &spec);
+                break;
+            case ARGUMENT_LONG_LONG:
+                bits = (u64)va_arg(*args, long long);
+                break;
+            case ARGUMENT_SIZE:
+                bits = (u64)va_arg(*args, size_t);
+                break;
+            case ARGUMENT_DOUBLE:
+            {
+                f64 value = va_arg(*args, double);
+                kcopy_memory(&bits, &value, sizeof(f64));
+            } break;
+            case ARGUMENT_POINTER:
+                bits = (u64)va_arg(*args, void*);
+                break;
+            case ARGUMENT_STRING:
+            {
+                const char* str = va_arg(*args, const char*);
+                if(!str)
+                {
+                    str = "(null)";
+                }
+                // Length prefix, bytes and terminator, truncated to whatever room is left.
+                if(offset + sizeof(u16) + 1 > capacity)
+                {
+                    continue;
+                }
+                u64 length = string_length(str);
+                u64 room = capacity - offset - sizeof(u16) - 1;
+                if(length > room)
+                {
+                    length = room;
+                }
+                if(length > 0xFFFF)
+                {
+                    length = 0xFFFF;
+                }
+                u16 length16 = (u16)length;
+                kcopy_memory(payload + offset, &length16, sizeof(u16));
+                kcopy_memory(payload + offset + sizeof(u16), str, length);
+                payload[offset + sizeof(u16) + length] = 0;
+                offset += sizeof(u16) + length16 + 1;
+            }
+                continue;
+            default:
+                continue;
+        }
+
+        if(offset + sizeof(u64) <= capacity)
+        {
+            write_u64(payload + offset, bits);
+            offset += sizeof(u64);
+        }
+    }
+
+    return offset;
+}
+
+/**
+ * Copies format text between start and end to out, unescaping "%%". Returns the new write position.
+ */
+static u64 append_literal(char* out, u64 out_size, u64 written, const char* start, const char* end)
+{
+    for(const char* p = start; p < end && written + 1 < out_size; ++p)
+    {
+        out[written++] = *p;
+        if(*p == '%' && p + 1 < end && p[1] == '%')
+        {
+            p++;
+        }
+    }
+    return written;
+}
+
+i32 log_binary_format(const char* format, const u8* payload, u32 payload_size, char* out, u64 out_size)
+{
+    if(!out || out_size == 0)
+    {
+        return -1;
+    }
+
+    u64 written = 0;
+    u32 offset = 0;
+    const char* literal = format;
+    conversion_spec spec;
+    const char* p;
+    while((p = next_conversion(literal, &spec)))
+    {
+        written = append_literal(out, out_size, written, literal, spec.start);
+        literal = p;
+
+        // Rebuild the spec with the length modifier the payload was stored with.
+        char spec_text[64];
+        u32 spec_length = 0;
+        for(u32 i = 0; i < spec.length - 1 && spec_length < sizeof(spec_text) - 4; ++i)
+        {
+            char c = spec.start[i];
+            if(!char_in_set("hljqztL", c))
+            {
+                spec_text[spec_length++] = c;
+            }
+        }
+        if(spec.type == ARGUMENT_INT || spec.type == ARGUMENT_LONG || spec.type == ARGUMENT_LONG_LONG || spec.type == ARGUMENT_SIZE)
+        {
+            if(spec.conversion != 'c')
+            {
+                spec_text[spec_length++] = 'l';
+                spec_text[spec_length++] = 'l';
+            }
+        }
+        spec_text[spec_length++] = spec.conversion;
+        spec_text[spec_length] = 0;
+
+        int stars[2] = {0, 0};
+        for(u32 i = 0; i < spec.star_count; ++i)
+        {
+            if(offset + sizeof(u64) > payload_size)
+            {
+                // Truncated payload; end the message here.
+                out[written < out_size ? written : out_size - 1] = 0;
+                return (i32)(written < out_size ? written : out_size - 1);
+            }
+            if(i < 2)
+            {
+                stars[i] = (int)(i64)read_u64(payload + offset);
+            }
+            offset += sizeof(u64);
+        }
+
+        if(written >= out_size)
+        {
+            continue;
+        }
+
+        char* dest = out + written;
+        u64 room = out_size - written;
+        i32 length = 0;
+
+#define EMIT(value)                                                                      \
+    length = spec.star_count == 0   ? snprintf(dest, room, spec_text, value)             \
+             : spec.star_count == 1 ? snprintf(dest, room, spec_text, stars[0], value)   \
+                                    : snprintf(dest, room, spec_text, stars[0], stars[1], value)
+
+        if(spec.type == ARGUMENT_STRING)
+        {
+            if(offset + sizeof(u16) > payload_size)
+            {
+                break;
+            }
+            u16 string_length_value;
+            kcopy_memory(&string_length_value, payload + offset, sizeof(u16));
+            const char* str = (const char*)payload + offset + sizeof(u16);
+            offset += sizeof(u16) + string_length_value + 1;
+            if(offset > payload_size)
+            {
+                break;
+            }
+            EMIT(str);
+        }
+        else
+        {
+            if(offset + sizeof(u64) > payload_size)
+            {
+                break;
+            }
+            u64 bits = read_u64(payload + offset);
+            offset += sizeof(u64);
+
+            switch(spec.type)
+            {
+                case ARGUMENT_DOUBLE:
+                {
+                    f64 value;
+                    kcopy_memory(&value, &bits, sizeof(f64));
+                    EMIT(value);
+                } break;
+                case ARGUMENT_POINTER:
+                    EMIT((void*)bits);
+                    break;
+                default:
+                    if(spec.conversion == 'c')
+                    {
+                        EMIT((int)bits);
+                    }
+                    else
+                    {
+                        EMIT((long long)bits);
+                    }
+                    break;
+            }
+        }
+#undef EMIT
+
+        written += length > 0 ? (u64)length : 0;
+    }
+
+    // Trailing literal text.
+    written = append_literal(out, out_size, written, literal, literal + string_length(literal));
+
+    if(written >= out_size)
+    {
+        written = out_size - 1;
+    }
+    out[written] = 0;
+    return (i32)written;
+}
+
+void log_binary_write_record_header(u8* out, log_binary_record_type type, log_level level, u16 size)
+{
+    out[0] = (u8)type;
+    out[1] = (u8)level;
+    kcopy_memory(out + 2, &size, sizeof(u16));
+}
+
+b8 log_binary_decode(const u8* data, u64 size, log_binary_message_callback callback, void* user_data)
+{
+    static const char* level_strings[6] = {"[FATAL]: ", "[ERROR]: ", "[WARN]:  ", "[INFO]:  ", "[DEBUG]: ", "[TRACE]: "};
+
+    if(!data || size < LOG_BINARY_MAGIC_LENGTH || !callback)
+    {
+        return false;
+    }
+    for(u32 i = 0; i < LOG_BINARY_MAGIC_LENGTH; ++i)
+    {
+        if(data[i] != (u8)LOG_BINARY_MAGIC[i])
+        {
+            return false;
+        }
+    }
+
+    // Format strings indexed by id. Each is a terminated copy owned by the decoder.
+    char** formats = darray_create(char*);
+    b8 result = true;
+    char text[LOG_MAX_MESSAGE_LENGTH + 8];
+
+    u64 offset = LOG_BINARY_MAGIC_LENGTH;
+    while(offset < size)
+    {
+        if(offset + LOG_BINARY_RECORD_HEADER_SIZE > size)
+        {
+            result = false;
+            break;
+        }
+
+        u8 type = data[offset];
+        u8 level = data[offset + 1];
+        u16 body_size;
+        kcopy_memory(&body_size, data + offset + 2, sizeof(u16));
+        const u8* body = data + offset + LOG_BINARY_RECORD_HEADER_SIZE;
+        offset += LOG_BINARY_RECORD_HEADER_SIZE + body_size;
+        if(offset > size || level > LOG_LEVEL_TRACE)
+        {
+            result = false;
+            break;
+        }
+
+        if(type == LOG_BINARY_RECORD_TEXT)
+        {
+            u32 length = body_size < LOG_MAX_MESSAGE_LENGTH + 7 ? body_size : LOG_MAX_MESSAGE_LENGTH + 7;
+            kcopy_memory(text, body, length);
+            text[length] = 0;
+            callback(level, text, length, user_data);
+            continue;
+        }
+
+        if(body_size < sizeof(u32))
+        {
+            result = false;
+            break;
+        }
+        u32 id;
+        kcopy_memory(&id, body, sizeof(u32));
+
+        if(id >= LOG_BINARY_MAX_FORMATS)
+        {
+            result = false;
+            break;
+        }
+
+        if(type == LOG_BINARY_RECORD_FORMAT)
+        {
+            u32 length = body_size - sizeof(u32);
+            char* format = kallocate(length + 1, MEMORY_TAG_STRING);
+            kcopy_memory(format, body + sizeof(u32), length);
+            format[length] = 0;
+            while(darray_length(formats) <= id)
+            {
+                char* empty = 0;
+                darray_push(formats, empty);
+            }
+            if(formats[id])
+            {
+                kfree(formats[id], string_length(formats[id]) + 1, MEMORY_TAG_STRING);
+            }
+            formats[id] = format;
+        }
+        else if(type == LOG_BINARY_RECORD_MESSAGE)
+        {
+            if(id >= darray_length(formats) || !formats[id])
+            {
+                result = false;
+                break;
+            }
+
+            u64 prefix_length = string_length(level_strings[level]);
+            kcopy_memory(text, level_strings[level], prefix_length);
+            i32 length = log_binary_format(formats[id], body + sizeof(u32), body_size - sizeof(u32), text + prefix_length, LOG_MAX_MESSAGE_LENGTH - prefix_length);
+            length = prefix_length + (length > 0 ? length : 0);
+            text[length] = '\n';
+            text[length + 1] = 0;
+            callback(level, text, length + 1, user_data);
+        }
+        else
+        {
+            result = false;
+            break;
+        }
+    }
+
+    u64 format_count = darray_length(formats);
+    for(u64 i = 0; i < format_count; ++i)
+    {
+        if(formats[i])
+        {
+            kfree(formats[i], string_length(formats[i]) + 1, MEMORY_TAG_STRING);
+        }
+    }
+    darray_destroy(formats);
+    return result;
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "defines.h"
+#include "core/logger.h"
+
+/*
+    Binary log stream, as written to console.log when logger_config.binary is set.
+
+    The stream starts with LOG_BINARY_MAGIC and is followed by records, each with a 4 byte header:
+    u8 type, u8 level, u16 body size. Record bodies:
+      FORMAT:  u32 format id, then the format string (no terminator). Precedes the first message using it.
+      MESSAGE: u32 format id, then the captured arguments in order. Integers, characters, floats and
+               pointers take 8 bytes each; strings are a u16 length followed by that many bytes and a
+               terminator. '*' widths and precisions are captured as integers.
+      TEXT:    An already formatted message, used for formats the binary encoding cannot represent,
+               such as long doubles.
+
+    Decoding reproduces exactly the text a text-mode log would have contained.
+*/
+
+#define LOG_BINARY_MAGIC "KLOGBIN1"
+#define LOG_BINARY_MAGIC_LENGTH 8
+#define LOG_BINARY_RECORD_HEADER_SIZE 4
+// Most arguments a single binary-encoded message may have.
+#define LOG_BINARY_MAX_ARGUMENTS 32
+// Distinct format strings binary mode can assign ids to. Must be a power of two. Ids at or above it are corrupt.
+#define LOG_BINARY_MAX_FORMATS 1024
+
+typedef enum log_binary_record_type
+{
+    LOG_BINARY_RECORD_FORMAT = 1,
+    LOG_BINARY_RECORD_MESSAGE = 2,
+    LOG_BINARY_RECORD_TEXT = 3
+} log_binary_record_type;
+
+/**
+ * Indicates if every conversion in format can be captured. %n, long doubles and unknown conversions cannot.
+ */
+b8 log_binary_format_supported(const char* format);
+
+/**
+ * Captures the arguments of format into payload.
+ * @param format A format string for which log_binary_format_supported returned true.
+ * @param payload The buffer to capture into.
+ * @param capacity The size of payload in bytes. Strings are truncated to fit.
+ * @param args The arguments. Consumed by this call.
+ * @return The number of bytes written to payload.
+ */
+u32 log_binary_capture(const char* format, u8* payload, u32 capacity, __builtin_va_list* args);
+
+/**
+ * Formats a captured payload the way vsnprintf would have formatted the original arguments.
+ * @return The number of characters written, excluding the terminator.
+ */
+i32 log_binary_format(const char* format, const u8* payload, u32 payload_size, char* out, u64 out_size);
+
+/**
+ * Writes a record header to out, which must have LOG_BINARY_RECORD_HEADER_SIZE bytes available.
+ */
+void log_binary_write_record_header(u8* out, log_binary_record_type type, log_level level, u16 size);
+
+typedef void (*log_binary_message_callback)(log_level level, const char* text, u32 length, void* user_data);
+
+/**
+ * Decodes a complete binary log stream, calling callback for every message in order. The text passed
+ * to the callback includes the level prefix and trailing newline and is only valid during the call.
+ * @return True if the whole stream decoded; false if it is not a binary log or is corrupt. Messages
+ * before the point of failure have still been passed to the callback.
+ */
+KAPI b8 log_binary_decode(const u8* data, u64 size, log_binary_message_callback callback, void* user_data);
@@ -1,58 +1,448 @@
 #include "logger.h"
-#include "asserts.h" // Need to include this to define the report_assertion_failure function. 
+#include "asserts.h" // Need to include this to define the report_assertion_failure function.
 #include "platform/platform.h"
 #include "platform/filesystem.h"
 #include "core/kstring.h"
 #include "core/kmemory.h"
+#include "core/log_binary.h"
 
 // TODO: temporary
 #include <stdarg.h> // Allows us to work with variadic arguments
 
+// Size of the buffer the writer thread batches file writes into.
+#define LOG_WRITE_BATCH_SIZE (64 * 1024)
+// Longest format string binary mode will assign an id to. Longer ones are logged as text.
+#define LOG_BINARY_MAX_FORMAT_LENGTH 256
+
+static const char* level_strings[6] = {"[FATAL]: ", "[ERROR]: ", "[WARN]:  ", "[INFO]:  ", "[DEBUG]: ", "[TRACE]: "};
+
+/*
+    One queued message. sequence tells producers and the writer whose turn it is: the slot is free for
+    the producer claiming position p when sequence == p, and ready for the writer when sequence == p + 1.
+*/
+typedef struct log_record
+{
+    volatile i64 sequence;
+    u32 level;
+    u32 length;
+    // A log_binary_record_type. Always LOG_BINARY_RECORD_TEXT in text mode.
+    u32 kind;
+    u32 format_id;
+    // Formatted text, a format string, or captured arguments, depending on kind.
+    char text[LOG_MAX_MESSAGE_LENGTH + 8];
+} log_record;
+
+/*
+    A format string which has been given an id in binary mode; the id is its index in the table.
+    Entries are keyed by the address of the format string and are never removed.
+*/
+typedef struct log_format_entry
+{
+    volatile i64 key;
+    // 0 while being registered, 1 once its definition has been queued, -1 if it can only be logged as text.
+    volatile i32 status;
+    // Copy of the string, so a reused buffer at the same address is detected.
+    char format[LOG_BINARY_MAX_FORMAT_LENGTH];
+} log_format_entry;
+
 typedef struct logger_system_state
 {
+    logger_config config;
     file_handle log_file_handle;
+
+    // Bounded multi-producer queue drained by the writer thread.
+    log_record* records;
+    i64 mask;
+    // Next position to be claimed by a producer.
+    volatile i64 enqueue_position;
+    // Next position to be written. Only advanced by the writer.
+    volatile i64 dequeue_position;
+    // Positions before this are in the log file, not just the writer's batch. Only advanced by the writer.
+    volatile i64 written_position;
+    volatile i64 dropped_count;
+
+    // Binary mode only.
+    log_format_entry* formats;
+
+    volatile i32 running;
+    // Set while the writer is about to wait, or is waiting, on wake_semaphore.
+    volatile i32 writer_sleeping;
+    platform_semaphore wake_semaphore;
+    platform_thread writer_thread;
+
+    // Only touched by the writer thread.
+    u64 batch_length;
+    i64 reported_dropped_count;
+    char batch[LOG_WRITE_BATCH_SIZE];
 } logger_system_state;
 
 static logger_system_state* state_ptr;
 
-void append_to_log_file(const char* message) 
+static void write_to_console(const char* message, log_level level)
+{
+    if(level < LOG_LEVEL_WARN)
+    {
+        platform_console_write_error(message, level);
+    }
+    else
+    {
+        platform_console_write(message, level);
+    }
+}
+
+static void flush_batch(logger_system_state* state)
 {
-    if(state_ptr && state_ptr->log_file_handle.is_valid) 
+    if(state->batch_length > 0 && state->log_file_handle.is_valid)
     {
-        // Since the message already contains a '\n', just write the bytes directly.
-        u64 length = string_length(message);
         u64 written = 0;
-        if(!filesystem_write(&state_ptr->log_file_handle, length, message, &written)) 
+        if(!filesystem_write(&state->log_file_handle, state->batch_length, state->batch, &written))
         {
             platform_console_write_error("ERROR writing to console.log.", LOG_LEVEL_ERROR);
         }
     }
+    state->batch_length = 0;
+}
+
+static void append_to_batch(logger_system_state* state, const char* message, u64 length)
+{
+    if(state->batch_length + length > LOG_WRITE_BATCH_SIZE)
+    {
+        flush_batch(state);
+    }
+    kcopy_memory(state->batch + state->batch_length, message, length);
+    state->batch_length += length;
+}
+
+static void write_text(logger_system_state* state, const char* text, u64 length, log_level level)
+{
+    if(state->config.console_output)
+    {
+        write_to_console(text, level);
+    }
+    if(state->config.binary)
+    {
+        u8 header[LOG_BINARY_RECORD_HEADER_SIZE];
+        log_binary_write_record_header(header, LOG_BINARY_RECORD_TEXT, level, (u16)length);
+        append_to_batch(state, (const char*)header, LOG_BINARY_RECORD_HEADER_SIZE);
+    }
+    append_to_batch(state, text, length);
+}
+
+static void write_binary_record(logger_system_state* state, log_record* record)
+{
+    u8 header[LOG_BINARY_RECORD_HEADER_SIZE + sizeof(u32)];
+    log_binary_write_record_header(header, record->kind, record->level, (u16)(record->length + sizeof(u32)));
+    kcopy_memory(header + LOG_BINARY_RECORD_HEADER_SIZE, &record->format_id, sizeof(u32));
+    append_to_batch(state, (const char*)header, sizeof(header));
+    append_to_batch(state, record->text, record->length);
+
+    if(record->kind == LOG_BINARY_RECORD_MESSAGE && state->config.console_output)
+    {
+        // Formatting still happens, just not on the thread which logged the message.
+        char text[LOG_MAX_MESSAGE_LENGTH + 8];
+        u64 prefix_length = string_length(level_strings[record->level]);
+        kcopy_memory(text, level_strings[record->level], prefix_length);
+        i32 length = log_binary_format(state->formats[record->format_id].format, (const u8*)record->text, record->length, text + prefix_length, LOG_MAX_MESSAGE_LENGTH - prefix_length);
+        length = prefix_length + (length > 0 ? length : 0);
+        text[length] = '\n';
+        text[length + 1] = 0;
+        write_to_console(text, record->level);
+    }
+}
+
+KINLINE b8 record_ready(logger_system_state* state, i64 position)
+{
+    log_record* record = &state->records[position & state->mask];
+    return platform_atomic_load_i64(&record->sequence) == position + 1;
+}
+
+/**
+ * Writes every published record. Returns the number of records written.
+ */
+static u32 drain_records(logger_system_state* state)
+{
+    u32 count = 0;
+    i64 position = state->dequeue_position;
+    while(record_ready(state, position))
+    {
+        log_record* record = &state->records[position & state->mask];
+        if(record->kind == LOG_BINARY_RECORD_TEXT)
+        {
+            write_text(state, record->text, record->length, record->level);
+        }
+        else
+        {
+            write_binary_record(state, record);
+        }
+
+        // Hand the slot back to producers for the next lap around the ring.
+        platform_atomic_store_i64(&record->sequence, position + state->mask + 1);
+        position++;
+        platform_atomic_store_i64(&state->dequeue_position, position);
+        count++;
+    }
+
+    i64 dropped = platform_atomic_load_i64(&state->dropped_count);
+    if(dropped != state->reported_dropped_count)
+    {
+        char notice[128];
+        i32 length = string_format(notice, "%s%lli log messages dropped: the queue was full.\n", level_strings[LOG_LEVEL_WARN], dropped - state->reported_dropped_count);
+        write_text(state, notice, length, LOG_LEVEL_WARN);
+        state->reported_dropped_count = dropped;
+    }
+
+    flush_batch(state);
+    platform_atomic_store_i64(&state->written_position, position);
+    return count;
+}
+
+static u32 writer_thread_run(void* params)
+{
+    logger_system_state* state = params;
+    for(;;)
+    {
+        // Sample running first, so messages queued before shutdown are always drained.
+        b8 running = platform_atomic_load_i32(&state->running);
+        if(drain_records(state) > 0)
+        {
+            continue;
+        }
+        if(!running)
+        {
+            break;
+        }
+
+        // Announce the intent to sleep before checking once more, so a producer publishing in between
+        // either gets seen here or sees the flag and signals.
+        platform_atomic_store_i32(&state->writer_sleeping, true);
+        if(record_ready(state, state->dequeue_position) || !platform_atomic_load_i32(&state->running))
+        {
+            platform_atomic_store_i32(&state->writer_sleeping, false);
+            continue;
+        }
+        platform_semaphore_wait(&state->wake_semaphore);
+        platform_atomic_store_i32(&state->writer_sleeping, false);
+    }
+
+    flush_batch(state);
+    return 0;
+}
+
+static void wake_writer(logger_system_state* state)
+{
+    // Only the producer which clears the flag signals, so the semaphore count stays small.
+    if(platform_atomic_load_i32(&state->writer_sleeping) && platform_atomic_compare_exchange_i32(&state->writer_sleeping, true, false))
+    {
+        platform_semaphore_signal(&state->wake_semaphore, 1);
+    }
 }
 
-b8 initialize_logging(u64* memory_requirement, void* state)
+/**
+ * Claims a free record, or returns 0 if the message should be dropped.
+ */
+static log_record* claim_record(logger_system_state* state, log_level level, i64* out_position)
 {
-    *memory_requirement = sizeof(logger_system_state);
+    b8 may_drop = state->config.overflow_policy == LOG_OVERFLOW_DROP && level > LOG_LEVEL_ERROR;
+    for(;;)
+    {
+        i64 position = platform_atomic_load_i64(&state->enqueue_position);
+        log_record* record = &state->records[position & state->mask];
+        i64 difference = platform_atomic_load_i64(&record->sequence) - position;
+        if(difference == 0)
+        {
+            if(platform_atomic_compare_exchange_i64(&state->enqueue_position, position, position + 1))
+            {
+                *out_position = position;
+                return record;
+            }
+        }
+        else if(difference < 0)
+        {
+            // Full: the writer has not released this slot from the previous lap yet.
+            if(may_drop)
+            {
+                platform_atomic_add_i64(&state->dropped_count, 1);
+                return 0;
+            }
+            wake_writer(state);
+            platform_thread_yield();
+        }
+        // Otherwise another producer claimed this position first; try the next one.
+    }
+}
+
+/**
+ * Finds or assigns the id for a format string in binary mode, queueing its definition the first time.
+ * Returns -1 if the message has to be logged as text instead.
+ */
+static i32 acquire_format_id(logger_system_state* state, const char* format)
+{
+    // Fibonacci hash of the address; the low bits are mostly alignment.
+    u64 hash = ((u64)format >> 2) * 0x9E3779B97F4A7C15ull;
+    u32 index = (u32)(hash >> 32) & (LOG_BINARY_MAX_FORMATS - 1);
+
+    for(u32 probe = 0; probe < LOG_BINARY_MAX_FORMATS; ++probe, index = (index + 1) & (LOG_BINARY_MAX_FORMATS - 1))
+    {
+        log_format_entry* entry = &state->formats[index];
+        i64 key = platform_atomic_load_i64(&entry->key);
+        if(key == 0)
+        {
+            if(!platform_atomic_compare_exchange_i64(&entry->key, 0, (i64)format))
+            {
+                // Lost the slot to another thread. It may have been claimed for this same format.
+                key = platform_atomic_load_i64(&entry->key);
+            }
+            else
+            {
+                u64 length = string_length(format);
+                if(length >= LOG_BINARY_MAX_FORMAT_LENGTH || !log_binary_format_supported(format))
+                {
+                    platform_atomic_store_i32(&entry->status, -1);
+                    return -1;
+                }
+                kcopy_memory(entry->format, format, length + 1);
+
+                // Queue the definition before publishing the entry, so every message using this id is
+                // queued after it. Definitions are never dropped, whatever the overflow policy.
+                i64 position;
+                log_record* record = claim_record(state, LOG_LEVEL_FATAL, &position);
+                kcopy_memory(record->text, format, length);
+                record->length = (u32)length;
+                record->level = LOG_LEVEL_TRACE;
+                record->kind = LOG_BINARY_RECORD_FORMAT;
+                record->format_id = index;
+                platform_atomic_store_i64(&record->sequence, position + 1);
+
+                platform_atomic_store_i32(&entry->status, 1);
+                return (i32)index;
+            }
+        }
+
+        if(key != (i64)format)
+        {
+            continue;
+        }
+
+        // Registered, or being registered by another thread.
+        i32 status;
+        while((status = platform_atomic_load_i32(&entry->status)) == 0)
+        {
+            platform_thread_yield();
+        }
+        if(status < 0 || !strings_equal(entry->format, format))
+        {
+            // Unsupported, or a buffer now holding a different string than when it was registered.
+            return -1;
+        }
+        return (i32)index;
+    }
+
+    // Table full.
+    return -1;
+}
+
+b8 initialize_logging(u64* memory_requirement, void* state, logger_config config)
+{
+    u32 capacity = 16;
+    u32 requested = config.queue_capacity ? config.queue_capacity : LOG_DEFAULT_QUEUE_CAPACITY;
+    while(capacity < requested)
+    {
+        capacity <<= 1;
+    }
+
+    u64 record_requirement = sizeof(log_record) * capacity;
+    u64 format_requirement = config.binary ? sizeof(log_format_entry) * LOG_BINARY_MAX_FORMATS : 0;
+    *memory_requirement = sizeof(logger_system_state) + record_requirement + format_requirement;
     if(state == 0)
     {
         return true;
     }
 
-    state_ptr = state;
+    logger_system_state* new_state = state;
+    kzero_memory(new_state, sizeof(logger_system_state));
+    new_state->config = config;
+    new_state->config.queue_capacity = capacity;
+    new_state->records = (void*)((u8*)state + sizeof(logger_system_state));
+    new_state->mask = capacity - 1;
+    for(u32 i = 0; i < capacity; ++i)
+    {
+        new_state->records[i].sequence = i;
+    }
+    if(config.binary)
+    {
+        new_state->formats = (void*)((u8*)new_state->records + record_requirement);
+        kzero_memory(new_state->formats, format_requirement);
+    }
 
     // Create new/wipe existing log file, then open it.
-    if(!filesystem_open("console.log", FILE_MODE_WRITE, false, &state_ptr->log_file_handle))
+    if(!filesystem_open("console.log", FILE_MODE_WRITE, config.binary, &new_state->log_file_handle))
     {
         platform_console_write_error("ERROR: Unable to open console.log for writing", LOG_LEVEL_ERROR);
         return false;
     }
+    if(config.binary)
+    {
+        u64 written = 0;
+        filesystem_write(&new_state->log_file_handle, LOG_BINARY_MAGIC_LENGTH, LOG_BINARY_MAGIC, &written);
+    }
+
+    if(!platform_semaphore_create(0, &new_state->wake_semaphore))
+    {
+        platform_console_write_error("ERROR: Unable to create the logging semaphore", LOG_LEVEL_ERROR);
+        filesystem_close(&new_state->log_file_handle);
+        return false;
+    }
 
+    new_state->running = true;
+    if(!platform_thread_create(writer_thread_run, new_state, false, &new_state->writer_thread))
+    {
+        platform_console_write_error("ERROR: Unable to start the logging thread", LOG_LEVEL_ERROR);
+        platform_semaphore_destroy(&new_state->wake_semaphore);
+        filesystem_close(&new_state->log_file_handle);
+        return false;
+    }
+
+    state_ptr = new_state;
     return true;
 }
 
 void shutdown_logging(void* state)
 {
+    if(!state_ptr)
+    {
+        return;
+    }
+
+    // Stop queueing first; anything logged from here on goes straight to the console.
+    logger_system_state* old_state = state_ptr;
     state_ptr = 0;
-    // TODO: cleanup logging/write queued entries
+
+    platform_atomic_store_i32(&old_state->running, false);
+    platform_semaphore_signal(&old_state->wake_semaphore, 1);
+    platform_thread_join(&old_state->writer_thread);
+
+    platform_semaphore_destroy(&old_state->wake_semaphore);
+    filesystem_close(&old_state->log_file_handle);
+}
+
+void logger_flush()
+{
+    if(!state_ptr)
+    {
+        return;
+    }
+
+    i64 target = platform_atomic_load_i64(&state_ptr->enqueue_position);
+    while(platform_atomic_load_i64(&state_ptr->written_position) < target)
+    {
+        wake_writer(state_ptr);
+        platform_thread_yield();
+    }
+}
+
+u64 logger_dropped_count()
+{
+    return state_ptr ? (u64)platform_atomic_load_i64(&state_ptr->dropped_count) : 0;
 }
 
 /*
@@ -60,45 +450,75 @@ void shutdown_logging(void* state)
 */
 void log_output(log_level level, const char* message, ...)
 {
-    // TODO: These string operations are all pretty slow. This needs to be
-    // moved to another thread eventually, along with the file writes, to
-    // avoid slowing things down while the engine is trying to run.
-    const char* level_strings[6] = {"[FATAL]: ", "[ERROR]: ", "[WARN]:  ", "[INFO]:  ", "[DEBUG]: ", "[TRACE]: "};
-    b8 is_error = level < LOG_LEVEL_WARN;
-
-    // Technically imposes a 32k character limit on a single log entry, but...
-    // DON'T DO THAT!
-    char out_message[32000];
-    kzero_memory(out_message, sizeof(out_message));
-
-    // Format original message.
     // NOTE: Oddly enough, MS's headers override the GCC/Clang va_list type with a "typedef char* va_list" in some
     // cases, and as a result throws a strange error here. The workaround for now is to just use __builtin_va_list,
     // which is the type GCC/Clang's va_start expects.
     __builtin_va_list arg_ptr;
-    va_start(arg_ptr, message);
-    string_format_v(out_message, message, arg_ptr);
-    va_end(arg_ptr);
 
-    // Prepend log level to message.
-    string_format(out_message, "%s%s\n", level_strings[level], out_message);
+    logger_system_state* state = state_ptr;
+    if(!state)
+    {
+        // Not running (yet), so write synchronously.
+        char out_message[LOG_MAX_MESSAGE_LENGTH + 8];
+        u64 prefix_length = string_length(level_strings[level]);
+        kcopy_memory(out_message, level_strings[level], prefix_length);
+        va_start(arg_ptr, message);
+        i32 length = string_format_n_v(out_message + prefix_length, LOG_MAX_MESSAGE_LENGTH - prefix_length, message, arg_ptr);
+        va_end(arg_ptr);
+        length = prefix_length + (length > 0 ? length : 0);
+        out_message[length] = '\n';
+        out_message[length + 1] = 0;
+        write_to_console(out_message, level);
+        return;
+    }
+
+    // The format id has to be acquired before claiming a record, so the definition is queued first.
+    i32 format_id = state->config.binary ? acquire_format_id(state, message) : -1;
+    i64 position;
+    log_record* record = claim_record(state, level, &position);
+    if(!record)
+    {
+        return;
+    }
 
-    // Print accordingly
-    if(is_error) 
+    record->level = level;
+    if(format_id >= 0)
     {
-        platform_console_write_error(out_message, level);
-    } 
+        // Capture the raw arguments; formatting is left to whoever reads the log.
+        va_start(arg_ptr, message);
+        record->length = log_binary_capture(message, (u8*)record->text, LOG_MAX_MESSAGE_LENGTH, &arg_ptr);
+        va_end(arg_ptr);
+        record->kind = LOG_BINARY_RECORD_MESSAGE;
+        record->format_id = format_id;
+    }
     else
     {
-        platform_console_write(out_message, level);
+        // Format once, straight into the record.
+        u64 prefix_length = string_length(level_strings[level]);
+        kcopy_memory(record->text, level_strings[level], prefix_length);
+        va_start(arg_ptr, message);
+        i32 length = string_format_n_v(record->text + prefix_length, LOG_MAX_MESSAGE_LENGTH - prefix_length, message, arg_ptr);
+        va_end(arg_ptr);
+        length = prefix_length + (length > 0 ? length : 0);
+        record->text[length] = '\n';
+        record->text[length + 1] = 0;
+        record->length = length + 1;
+        record->kind = LOG_BINARY_RECORD_TEXT;
     }
-    // Queue a copy to be written to the log file.
-    append_to_log_file(out_message);
 
+    // Publish.
+    platform_atomic_store_i64(&record->sequence, position + 1);
+    wake_writer(state);
+
+    if(level == LOG_LEVEL_FATAL)
+    {
+        // The process may be about to go down, so don't leave this sitting in the queue.
+        logger_flush();
+    }
 }
 
 
-void report_assertion_failure(const char* expression, const char* message, const char* file, i32 line) 
+void report_assertion_failure(const char* expression, const char* message, const char* file, i32 line)
 {
     log_output(LOG_LEVEL_FATAL, "Assertion Failure: %s, message: '%s', in file: %s, line: %d\n", expression, message, file, line);
-}
\ No newline at end of file
+}
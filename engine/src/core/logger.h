@@ -23,18 +23,65 @@ typedef enum log_level
     LOG_LEVEL_TRACE = 5,
 } log_level;
 
+// What log_output does when the queue to the writer thread is full.
+typedef enum log_overflow_policy
+{
+    // Discard the message and count it. FATAL and ERROR messages always block instead.
+    LOG_OVERFLOW_DROP,
+    // Wait for the writer thread to make room.
+    LOG_OVERFLOW_BLOCK
+} log_overflow_policy;
+
+// Default number of messages which can be queued for the writer thread.
+#define LOG_DEFAULT_QUEUE_CAPACITY 1024
+// Longest formatted message, level prefix included. Longer messages are truncated.
+#define LOG_MAX_MESSAGE_LENGTH 1000
+
+typedef struct logger_config
+{
+    log_overflow_policy overflow_policy;
+    // Number of queued messages. Rounded up to a power of two. 0 uses LOG_DEFAULT_QUEUE_CAPACITY.
+    u32 queue_capacity;
+    // If false, messages only go to the log file.
+    b8 console_output;
+    /*
+        If true, log_output does not format messages. It queues an id for the format string plus the raw
+        arguments, and console.log is written in the binary format described in log_binary.h. Formatting
+        happens offline (see the logdecode tool), or on the writer thread if console_output is set.
+    */
+    b8 binary;
+} logger_config;
 
 /**
  * @brief Initializes logging system. Call twice; once with state = 0 to get required memory size,
  * then a second time passing allocated memory to state.
+ *
+ * Once initialized, log_output only formats the message and queues it. A background thread writes
+ * queued messages to the console and appends them to console.log in batches.
  * 
  * @param memory_requirement A pointer to hold the required memory size of internal state.
  * @param state 0 if just requesting memory requirement, otherwise allocated block of memory.
+ * @param config The logging configuration.
  * @return b8 True on success; otherwise false.
  */
-b8 initialize_logging(u64* memory_requirement, void* state);
+b8 initialize_logging(u64* memory_requirement, void* state, logger_config config);
+
+/**
+ * @brief Writes every queued message, stops the writer thread and closes the log file.
+ * Messages logged afterwards go straight to the console.
+ */
 void shutdown_logging(void* state);
 
+/**
+ * @brief Blocks until every message logged so far has been written to the log file.
+ */
+KAPI void logger_flush();
+
+/**
+ * @brief The number of messages discarded because the queue was full.
+ */
+KAPI u64 logger_dropped_count();
+
 /*
     ... is called variadic arguments. It works in the same way it works in printf.
 */
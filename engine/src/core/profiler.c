@@ -0,0 +1,450 @@
+#include "profiler.h"
+
+#include "core/logger.h"
+#include "core/kmemory.h"
+#include "core/kstring.h"
+#include "platform/platform.h"
+#include "platform/filesystem.h"
+
+// TODO: temporary
+#include <stdarg.h>
+
+// Size of the buffer exported traces are batched into before each file write.
+#define PROFILER_EXPORT_BATCH_SIZE (64 * 1024)
+#define PROFILER_THREAD_NAME_LENGTH 32
+
+typedef struct profiler_zone
+{
+    const char* name;
+    u64 start;
+    u64 end;
+} profiler_zone;
+
+typedef struct profiler_thread
+{
+    // Set once the thread has finished registering. Export skips threads which have not.
+    volatile i32 ready;
+    char name[PROFILER_THREAD_NAME_LENGTH];
+
+    // Completed zones. Written by the owning thread; the mutex only keeps export from reading a
+    // zone while it is being written, so it is never contended during a frame.
+    platform_mutex mutex;
+    profiler_zone* zones;
+    u64 zone_count;
+
+    // Open zones. Only touched by the owning thread.
+    profiler_zone stack[PROFILER_MAX_ZONE_DEPTH];
+    u32 depth;
+    // Zones opened past PROFILER_MAX_ZONE_DEPTH, which are ignored.
+    u32 overflow_depth;
+} profiler_thread;
+
+typedef struct profiler_state
+{
+    profiler_config config;
+    u64 zone_mask;
+    // Distinguishes this run from earlier ones, whose thread registrations are stale.
+    u32 generation;
+    // Every timestamp is exported relative to this.
+    u64 origin;
+
+    volatile i32 thread_count;
+    profiler_thread threads[PROFILER_MAX_THREADS];
+
+    // Start times of recent frames, as a ring.
+    platform_mutex frame_mutex;
+    u64* frame_starts;
+    u64 frame_count;
+} profiler_state;
+
+static profiler_state* state_ptr;
+static u32 generation_counter;
+
+static _Thread_local profiler_thread* current_thread;
+static _Thread_local u32 current_generation;
+
+// Copies name into a thread's name buffer, truncating it if needed.
+static void set_name(profiler_thread* thread, const char* name)
+{
+    u32 length = 0;
+    for(; name[length] && length < PROFILER_THREAD_NAME_LENGTH - 1; ++length)
+    {
+        thread->name[length] = name[length];
+    }
+    thread->name[length] = 0;
+}
+
+/**
+ * Returns the calling thread's profiler data, registering the thread first if needed.
+ * Returns 0 if there is no room for another thread.
+ */
+static profiler_thread* get_current_thread(profiler_state* state)
+{
+    if(current_generation == state->generation)
+    {
+        return current_thread;
+    }
+
+    current_generation = state->generation;
+    current_thread = 0;
+
+    i32 index = platform_atomic_add_i32(&state->thread_count, 1) - 1;
+    if(index >= PROFILER_MAX_THREADS)
+    {
+        return 0;
+    }
+
+    profiler_thread* thread = &state->threads[index];
+    thread->zones = kallocate(sizeof(profiler_zone) * state->config.zones_per_thread, MEMORY_TAG_PROFILER);
+    if(!platform_mutex_create(&thread->mutex))
+    {
+        kfree(thread->zones, sizeof(profiler_zone) * state->config.zones_per_thread, MEMORY_TAG_PROFILER);
+        thread->zones = 0;
+        return 0;
+    }
+    string_format(thread->name, "Thread %i", index);
+    platform_atomic_store_i32(&thread->ready, true);
+
+    current_thread = thread;
+    return thread;
+}
+
+b8 profiler_initialize(u64* memory_requirement, void* state, profiler_config config)
+{
+    u32 frame_capacity = config.frame_capacity ? config.frame_capacity : PROFILER_DEFAULT_FRAME_CAPACITY;
+    u32 requested = config.zones_per_thread ? config.zones_per_thread : PROFILER_DEFAULT_ZONES_PER_THREAD;
+    u32 zones_per_thread = 16;
+    while(zones_per_thread < requested)
+    {
+        zones_per_thread <<= 1;
+    }
+
+    // Block of memory will contain the state structure, then the frame ring.
+    *memory_requirement = sizeof(profiler_state) + sizeof(u64) * frame_capacity;
+    if(!state)
+    {
+        return true;
+    }
+
+    profiler_state* new_state = state;
+    kzero_memory(new_state, *memory_requirement);
+    new_state->config.frame_capacity = frame_capacity;
+    new_state->config.zones_per_thread = zones_per_thread;
+    new_state->zone_mask = zones_per_thread - 1;
+    new_state->generation = ++generation_counter;
+    new_state->frame_starts = (void*)((u8*)state + sizeof(profiler_state));
+    new_state->origin = platform_get_absolute_time_ns();
+
+    if(!platform_mutex_create(&new_state->frame_mutex))
+    {
+        KERROR("profiler_initialize - failed to create the frame mutex.");
+        return false;
+    }
+
+    // The initializing thread is the main thread, and always the first in the trace.
+    profiler_thread* main_thread = get_current_thread(new_state);
+    if(main_thread)
+    {
+        set_name(main_thread, "Main thread");
+    }
+
+    state_ptr = new_state;
+    return true;
+}
+
+void profiler_shutdown(void* state)
+{
+    if(!state_ptr)
+    {
+        return;
+    }
+
+    profiler_state* old_state = state_ptr;
+    state_ptr = 0;
+
+    i32 thread_count = old_state->thread_count < PROFILER_MAX_THREADS ? old_state->thread_count : PROFILER_MAX_THREADS;
+    for(i32 i = 0; i < thread_count; ++i)
+    {
+        profiler_thread* thread = &old_state->threads[i];
+        if(thread->ready)
+        {
+            platform_mutex_destroy(&thread->mutex);
+            kfree(thread->zones, sizeof(profiler_zone) * old_state->config.zones_per_thread, MEMORY_TAG_PROFILER);
+        }
+    }
+    platform_mutex_destroy(&old_state->frame_mutex);
+}
+
+void profiler_frame_mark()
+{
+    profiler_state* state = state_ptr;
+    if(!state)
+    {
+        return;
+    }
+
+    u64 now = platform_get_absolute_time_ns();
+    platform_mutex_lock(&state->frame_mutex);
+    state->frame_starts[state->frame_count % state->config.frame_capacity] = now;
+    state->frame_count++;
+    platform_mutex_unlock(&state->frame_mutex);
+}
+
+void profiler_zone_begin(const char* name)
+{
+    profiler_state* state = state_ptr;
+    if(!state)
+    {
+        return;
+    }
+
+    profiler_thread* thread = get_current_thread(state);
+    if(!thread)
+    {
+        return;
+    }
+
+    if(thread->depth == PROFILER_MAX_ZONE_DEPTH)
+    {
+        thread->overflow_depth++;
+        return;
+    }
+
+    profiler_zone* zone = &thread->stack[thread->depth++];
+    zone->name = name;
+    // Last, so the bookkeeping above is not part of the zone.
+    zone->start = platform_get_absolute_time_ns();
+}
+
+void profiler_zone_end()
+{
+    // First, so the bookkeeping below is not part of the zone.
+    u64 end = platform_get_absolute_time_ns();
+
+    profiler_state* state = state_ptr;
+    if(!state)
+    {
+        return;
+    }
+
+    profiler_thread* thread = get_current_thread(state);
+    if(!thread)
+    {
+        return;
+    }
+
+    if(thread->overflow_depth > 0)
+    {
+        thread->overflow_depth--;
+        return;
+    }
+    if(thread->depth == 0)
+    {
+        KWARN("profiler_zone_end called without a matching profiler_zone_begin.");
+        return;
+    }
+
+    profiler_zone* open = &thread->stack[--thread->depth];
+    platform_mutex_lock(&thread->mutex);
+    profiler_zone* zone = &thread->zones[thread->zone_count & state->zone_mask];
+    zone->name = open->name;
+    zone->start = open->start;
+    zone->end = end;
+    thread->zone_count++;
+    platform_mutex_unlock(&thread->mutex);
+}
+
+void profiler_set_thread_name(const char* name)
+{
+    profiler_state* state = state_ptr;
+    if(!state || !name)
+    {
+        return;
+    }
+
+    profiler_thread* thread = get_current_thread(state);
+    if(thread)
+    {
+        platform_mutex_lock(&thread->mutex);
+        set_name(thread, name);
+        platform_mutex_unlock(&thread->mutex);
+    }
+}
+
+typedef struct trace_writer
+{
+    file_handle file;
+    char* batch;
+    u64 batch_length;
+    b8 wrote_event;
+    b8 failed;
+} trace_writer;
+
+static void trace_flush(trace_writer* writer)
+{
+    if(writer->batch_length > 0 && !writer->failed)
+    {
+        u64 written = 0;
+        if(!filesystem_write(&writer->file, writer->batch_length, writer->batch, &written))
+        {
+            writer->failed = true;
+        }
+    }
+    writer->batch_length = 0;
+}
+
+static void trace_write(trace_writer* writer, const char* format, ...)
+{
+    char line[512];
+    __builtin_va_list arg_ptr;
+    va_start(arg_ptr, format);
+    i32 length = string_format_n_v(line, sizeof(line), format, arg_ptr);
+    va_end(arg_ptr);
+    if(length <= 0)
+    {
+        return;
+    }
+    if(length >= (i32)sizeof(line))
+    {
+        length = sizeof(line) - 1;
+    }
+
+    if(writer->batch_length + length > PROFILER_EXPORT_BATCH_SIZE)
+    {
+        trace_flush(writer);
+    }
+    kcopy_memory(writer->batch + writer->batch_length, line, length);
+    writer->batch_length += length;
+}
+
+// Starts the next entry of the traceEvents array.
+static void trace_next_event(trace_writer* writer)
+{
+    trace_write(writer, writer->wrote_event ? ",\n" : "\n");
+    writer->wrote_event = true;
+}
+
+// Copies str to out as the contents of a JSON string.
+static void escape_json(const char* str, char* out, u64 out_size)
+{
+    u64 length = 0;
+    for(; *str && length + 2 < out_size; ++str)
+    {
+        char c = *str;
+        if(c == '"' || c == '\\')
+        {
+            out[length++] = '\\';
+        }
+        out[length++] = (c >= 0 && c < 0x20) ? ' ' : c;
+    }
+    out[length] = 0;
+}
+
+KINLINE f64 to_trace_time(profiler_state* state, u64 timestamp)
+{
+    // Trace timestamps are in microseconds.
+    return (timestamp > state->origin ? (f64)(timestamp - state->origin) : 0.0) / 1000.0;
+}
+
+b8 profiler_export_chrome_trace(const char* path)
+{
+    profiler_state* state = state_ptr;
+    if(!state)
+    {
+        KERROR("profiler_export_chrome_trace - the profiler is not running.");
+        return false;
+    }
+
+    trace_writer writer = {};
+    if(!filesystem_open(path, FILE_MODE_WRITE, true, &writer.file))
+    {
+        KERROR("profiler_export_chrome_trace - unable to open '%s' for writing.", path);
+        return false;
+    }
+    writer.batch = kallocate(PROFILER_EXPORT_BATCH_SIZE, MEMORY_TAG_PROFILER);
+
+    u64 now = platform_get_absolute_time_ns();
+    trace_write(&writer, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+
+    // Frames, as zones on the main thread. Everything older than the oldest kept frame is left out.
+    u64 frame_capacity = state->config.frame_capacity;
+    u64 window_start = 0;
+    platform_mutex_lock(&state->frame_mutex);
+    u64 frame_count = state->frame_count;
+    u64 first_frame = frame_count > frame_capacity ? frame_count - frame_capacity : 0;
+    if(frame_count > 0)
+    {
+        window_start = state->frame_starts[first_frame % frame_capacity];
+    }
+    for(u64 i = first_frame; i < frame_count; ++i)
+    {
+        u64 start = state->frame_starts[i % frame_capacity];
+        u64 end = i + 1 < frame_count ? state->frame_starts[(i + 1) % frame_capacity] : now;
+        trace_next_event(&writer);
+        trace_write(&writer, "{\"name\":\"Frame\",\"cat\":\"frame\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":0,\"args\":{\"frame\":%llu}}",
+                    to_trace_time(state, start), (f64)(end - start) / 1000.0, i);
+    }
+    platform_mutex_unlock(&state->frame_mutex);
+
+    // Zones. Each thread's ring is copied out under its lock so the thread is only held up briefly.
+    u64 zones_per_thread = state->config.zones_per_thread;
+    profiler_zone* zones = kallocate(sizeof(profiler_zone) * zones_per_thread, MEMORY_TAG_PROFILER);
+    i32 thread_count = platform_atomic_load_i32(&state->thread_count);
+    if(thread_count > PROFILER_MAX_THREADS)
+    {
+        thread_count = PROFILER_MAX_THREADS;
+    }
+    for(i32 t = 0; t < thread_count; ++t)
+    {
+        profiler_thread* thread = &state->threads[t];
+        if(!platform_atomic_load_i32(&thread->ready))
+        {
+            continue;
+        }
+
+        char name[PROFILER_THREAD_NAME_LENGTH * 2];
+        platform_mutex_lock(&thread->mutex);
+        escape_json(thread->name, name, sizeof(name));
+        u64 count = thread->zone_count < zones_per_thread ? thread->zone_count : zones_per_thread;
+        for(u64 i = 0; i < count; ++i)
+        {
+            zones[i] = thread->zones[(thread->zone_count - count + i) & state->zone_mask];
+        }
+        platform_mutex_unlock(&thread->mutex);
+
+        trace_next_event(&writer);
+        trace_write(&writer, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%i,\"args\":{\"name\":\"%s\"}}", t, name);
+        trace_next_event(&writer);
+        trace_write(&writer, "{\"name\":\"thread_sort_index\",\"ph\":\"M\",\"pid\":1,\"tid\":%i,\"args\":{\"sort_index\":%i}}", t, t);
+
+        for(u64 i = 0; i < count; ++i)
+        {
+            if(zones[i].end < window_start)
+            {
+                continue;
+            }
+            char zone_name[256];
+            escape_json(zones[i].name, zone_name, sizeof(zone_name));
+            trace_next_event(&writer);
+            trace_write(&writer, "{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%i}",
+                        zone_name, to_trace_time(state, zones[i].start), (f64)(zones[i].end - zones[i].start) / 1000.0, t);
+        }
+    }
+    kfree(zones, sizeof(profiler_zone) * zones_per_thread, MEMORY_TAG_PROFILER);
+
+    trace_write(&writer, "\n]}\n");
+    trace_flush(&writer);
+    b8 result = !writer.failed;
+    filesystem_close(&writer.file);
+    kfree(writer.batch, PROFILER_EXPORT_BATCH_SIZE, MEMORY_TAG_PROFILER);
+
+    if(result)
+    {
+        KINFO("Profile of the last %llu frames written to '%s'.", frame_count - first_frame, path);
+    }
+    else
+    {
+        KERROR("profiler_export_chrome_trace - failed writing to '%s'.", path);
+    }
+    return result;
+}
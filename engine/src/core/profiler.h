@@ -0,0 +1,83 @@
+#pragma once
+
+#include "defines.h"
+
+// Define as 0 to compile every KPROFILE_ macro out.
+#ifndef KPROFILE_ENABLED
+#define KPROFILE_ENABLED 1
+#endif
+
+// Threads which can record zones. Zones from any further threads are ignored.
+#define PROFILER_MAX_THREADS 64
+// Deepest zone nesting recorded per thread. Deeper zones are ignored, but still balanced.
+#define PROFILER_MAX_ZONE_DEPTH 64
+// Frames kept for export when the config does not say otherwise.
+#define PROFILER_DEFAULT_FRAME_CAPACITY 300
+// Zones each thread keeps when the config does not say otherwise.
+#define PROFILER_DEFAULT_ZONES_PER_THREAD (32 * 1024)
+
+typedef struct profiler_config
+{
+    // Number of most recent frames kept for export. 0 uses PROFILER_DEFAULT_FRAME_CAPACITY.
+    u32 frame_capacity;
+    // Completed zones each thread keeps before overwriting its oldest. Rounded up to a power of two.
+    // 0 uses PROFILER_DEFAULT_ZONES_PER_THREAD.
+    u32 zones_per_thread;
+} profiler_config;
+
+/*
+    Hierarchical CPU profiler. Code is instrumented with begin/end pairs which nest into zones; each
+    thread keeps its own zone stack and ring of completed zones, timestamped in nanoseconds. The main
+    loop marks frame boundaries, and the last frame_capacity frames can be exported as a Chrome trace
+    (chrome://tracing or https://ui.perfetto.dev).
+
+    The thread which initializes the profiler is named the main thread. Other threads register on
+    their first zone. Before initialization and after shutdown, zones cost a single branch.
+*/
+b8 profiler_initialize(u64* memory_requirement, void* state, profiler_config config);
+
+void profiler_shutdown(void* state);
+
+/**
+ * Marks the start of a frame. Called by the main loop.
+ */
+KAPI void profiler_frame_mark();
+
+/**
+ * Opens a zone on the calling thread.
+ * @param name The name of the zone. Must stay valid until the profiler shuts down; use literals.
+ */
+KAPI void profiler_zone_begin(const char* name);
+
+/**
+ * Closes the zone most recently opened on the calling thread.
+ */
+KAPI void profiler_zone_end();
+
+/**
+ * Names the calling thread in exported traces.
+ * @param name The name. Copied, and truncated to 31 characters.
+ */
+KAPI void profiler_set_thread_name(const char* name);
+
+/**
+ * Writes the zones from the frames still kept to path, in the Chrome trace event JSON format.
+ * @return True on success; otherwise false.
+ */
+KAPI b8 profiler_export_chrome_trace(const char* path);
+
+#if KPROFILE_ENABLED == 1
+// Opens a zone with the given name. Must be matched by KPROFILE_END.
+#define KPROFILE_BEGIN(name) profiler_zone_begin(name)
+// Opens a zone named after the enclosing function. Must be matched by KPROFILE_END.
+#define KPROFILE_FUNCTION_BEGIN() profiler_zone_begin(__FUNCTION__)
+// Closes the most recent zone.
+#define KPROFILE_END() profiler_zone_end()
+// Marks the start of a frame.
+#define KPROFILE_FRAME() profiler_frame_mark()
+#else
+#define KPROFILE_BEGIN(name)
+#define KPROFILE_FUNCTION_BEGIN()
+#define KPROFILE_END()
+#define KPROFILE_FRAME()
+#endif
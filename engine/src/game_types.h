@@ -17,8 +17,9 @@ typedef struct game
     // Function pointer to game's update function.
     b8 (*update)(struct game* game_inst, f32 delta_time);
 
-    // Function pointer to game's render function.
-    b8 (*render)(struct game* game_inst, f32 delta_time);
+    // Function pointer to game's render function. interpolation is how far, in [0, 1], the frame lies
+    // between the previous and latest updates. Always 1 with a variable loop.
+    b8 (*render)(struct game* game_inst, f32 delta_time, f32 interpolation);
 
     // Function pointer to handle resizes, if applicable.
     void (*on_resize)(struct game* game_inst, u32 width, u32 height);
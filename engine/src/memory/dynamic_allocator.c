@@ -0,0 +1,377 @@
+#include "dynamic_allocator.h"
+
+#include "core/kmemory.h"
+#include "core/logger.h"
+#include "core/asserts.h"
+
+#define BLOCK_USED 0x1ull
+#define BLOCK_SMALL 0x2ull
+#define BLOCK_FLAGS_MASK 0xFull
+// Size class of a small block. Kept in the header because a block may be up to MIN_BLOCK_SIZE - 16
+// bytes larger than its class, when the remainder was too small to split off.
+#define BLOCK_CLASS_SHIFT 56
+#define BLOCK_CLASS_MASK (0xFFull << BLOCK_CLASS_SHIFT)
+
+// Marks the word preceding an over-aligned payload as an offset back to its block.
+#define ALIGNED_OFFSET_BIT 0x1ull
+
+#define BLOCK_HEADER_SIZE 16ull
+// Free blocks keep their list links in the payload, so a block can never be smaller than this.
+#define MIN_BLOCK_SIZE 32ull
+#define SMALL_CLASS_GRANULARITY 16ull
+#define SMALL_MAX_SIZE (DYNAMIC_ALLOCATOR_SMALL_CLASS_COUNT * SMALL_CLASS_GRANULARITY)
+
+/*
+    Every block starts with this header. The order matters: for a default aligned payload the word just
+    before it is prev_size, which is always a multiple of 16 and so never has ALIGNED_OFFSET_BIT set.
+*/
+typedef struct block_header
+{
+    u64 size_flags;
+    // Size of the physically preceding block, or 0 for the first block.
+    u64 prev_size;
+} block_header;
+
+typedef struct free_block
+{
+    block_header header;
+    struct free_block* next;
+    struct free_block* prev;
+} free_block;
+
+KINLINE u64 align_up(u64 value, u64 alignment)
+{
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+KINLINE u64 block_size(const block_header* block)
+{
+    return block->size_flags & ~(BLOCK_FLAGS_MASK | BLOCK_CLASS_MASK);
+}
+
+KINLINE b8 block_used(const block_header* block)
+{
+    return (block->size_flags & BLOCK_USED) != 0;
+}
+
+KINLINE u32 bin_index(u64 size)
+{
+    return 63 - __builtin_clzll(size);
+}
+
+KINLINE block_header* next_block(dynamic_allocator* allocator, block_header* block)
+{
+    u8* next = (u8*)block + block_size(block);
+    return next < (u8*)allocator->memory + allocator->total_size ? (block_header*)next : 0;
+}
+
+static void insert_free(dynamic_allocator* allocator, free_block* block)
+{
+    u32 index = bin_index(block_size(&block->header));
+    free_block* head = allocator->large_bins[index];
+    block->prev = 0;
+    block->next = head;
+    if(head)
+    {
+        head->prev = block;
+    }
+    allocator->large_bins[index] = block;
+    allocator->large_bin_mask |= (1ull << index);
+}
+
+static void remove_free(dynamic_allocator* allocator, free_block* block)
+{
+    u32 index = bin_index(block_size(&block->header));
+    if(block->prev)
+    {
+        block->prev->next = block->next;
+    }
+    else
+    {
+        allocator->large_bins[index] = block->next;
+        if(!block->next)
+        {
+            allocator->large_bin_mask &= ~(1ull << index);
+        }
+    }
+
+    if(block->next)
+    {
+        block->next->prev = block->prev;
+    }
+}
+
+static free_block* find_free(dynamic_allocator* allocator, u64 size)
+{
+    u32 index = bin_index(size);
+
+    // The smallest bin may hold blocks both above and below the requested size, so search it first-fit.
+    for(free_block* block = allocator->large_bins[index]; block; block = block->next)
+    {
+        if(block_size(&block->header) >= size)
+        {
+            return block;
+        }
+    }
+
+    // Every block in any larger bin fits.
+    u64 mask = index < 63 ? allocator->large_bin_mask & ~((2ull << index) - 1) : 0;
+    if(!mask)
+    {
+        return 0;
+    }
+
+    return allocator->large_bins[__builtin_ctzll(mask)];
+}
+
+/**
+ * Takes a block of at least size bytes (header included) from the free lists, splitting off the remainder.
+ */
+static block_header* take_block(dynamic_allocator* allocator, u64 size, u64 flags)
+{
+    free_block* found = find_free(allocator, size);
+    if(!found)
+    {
+        return 0;
+    }
+
+    remove_free(allocator, found);
+    block_header* block = &found->header;
+    u64 found_size = block_size(block);
+
+    if(found_size - size >= MIN_BLOCK_SIZE)
+    {
+        free_block* remainder = (free_block*)((u8*)block + size);
+        remainder->header.size_flags = found_size - size;
+        remainder->header.prev_size = size;
+        block_header* after = next_block(allocator, &remainder->header);
+        if(after)
+        {
+            after->prev_size = found_size - size;
+        }
+        insert_free(allocator, remainder);
+        found_size = size;
+    }
+
+    block->size_flags = found_size | flags;
+    allocator->free_space -= found_size;
+    return block;
+}
+
+/**
+ * Returns a block to the free lists, merging it with free physical neighbours.
+ */
+static void release_block(dynamic_allocator* allocator, block_header* block)
+{
+    u64 size = block_size(block);
+    allocator->free_space += size;
+
+    block_header* next = next_block(allocator, block);
+    if(next && !block_used(next))
+    {
+        remove_free(allocator, (free_block*)next);
+        size += block_size(next);
+    }
+
+    if(block->prev_size)
+    {
+        block_header* prev = (block_header*)((u8*)block - block->prev_size);
+        if(!block_used(prev))
+        {
+            remove_free(allocator, (free_block*)prev);
+            size += block_size(prev);
+            block = prev;
+        }
+    }
+
+    block->size_flags = size;
+    block_header* after = next_block(allocator, block);
+    if(after)
+    {
+        after->prev_size = size;
+    }
+    insert_free(allocator, (free_block*)block);
+}
+
+/**
+ * Hands every block cached in the small bins back to the free lists. Used as a last resort when
+ * a large allocation cannot otherwise be satisfied.
+ */
+static void flush_small_bins(dynamic_allocator* allocator)
+{
+    for(u32 i = 0; i < DYNAMIC_ALLOCATOR_SMALL_CLASS_COUNT; ++i)
+    {
+        void* payload = allocator->small_bins[i];
+        while(payload)
+        {
+            void* next = *(void**)payload;
+            release_block(allocator, (block_header*)((u8*)payload - BLOCK_HEADER_SIZE));
+            payload = next;
+        }
+        allocator->small_bins[i] = 0;
+    }
+}
+
+static block_header* payload_to_block(const void* block)
+{
+    u64 word = *(const u64*)((const u8*)block - sizeof(u64));
+    if(word & ALIGNED_OFFSET_BIT)
+    {
+        return (block_header*)((u8*)block - (word & ~ALIGNED_OFFSET_BIT));
+    }
+    return (block_header*)((u8*)block - BLOCK_HEADER_SIZE);
+}
+
+b8 dynamic_allocator_create(u64 total_size, void* memory, dynamic_allocator* out_allocator)
+{
+    if(!memory || !out_allocator)
+    {
+        KERROR("dynamic_allocator_create requires memory and out_allocator.");
+        return false;
+    }
+
+    kzero_memory(out_allocator, sizeof(dynamic_allocator));
+
+    // Blocks must start on a 16 byte boundary and be a multiple of 16 in size.
+    u64 start = align_up((u64)memory, BLOCK_HEADER_SIZE);
+    u64 end = ((u64)memory + total_size) & ~(BLOCK_HEADER_SIZE - 1);
+    if(end <= start || end - start < MIN_BLOCK_SIZE * 2)
+    {
+        KERROR("dynamic_allocator_create - a block of %lluB is too small to be managed.", total_size);
+        return false;
+    }
+
+    out_allocator->memory = (void*)start;
+    out_allocator->total_size = end - start;
+
+    free_block* first = out_allocator->memory;
+    first->header.size_flags = out_allocator->total_size;
+    first->header.prev_size = 0;
+    insert_free(out_allocator, first);
+    out_allocator->free_space = out_allocator->total_size;
+    return true;
+}
+
+void dynamic_allocator_destroy(dynamic_allocator* allocator)
+{
+    if(allocator)
+    {
+        kzero_memory(allocator, sizeof(dynamic_allocator));
+    }
+}
+
+void* dynamic_allocator_allocate(dynamic_allocator* allocator, u64 size)
+{
+    return dynamic_allocator_allocate_aligned(allocator, size, BLOCK_HEADER_SIZE);
+}
+
+void* dynamic_allocator_allocate_aligned(dynamic_allocator* allocator, u64 size, u64 alignment)
+{
+    if(!allocator || !allocator->memory)
+    {
+        KERROR("dynamic_allocator_allocate - provided allocator is not initialized");
+        return 0;
+    }
+
+    if(alignment == 0 || (alignment & (alignment - 1)) != 0)
+    {
+        KERROR("dynamic_allocator_allocate - alignment %llu is not a power of two.", alignment);
+        return 0;
+    }
+
+    if(alignment <= BLOCK_HEADER_SIZE)
+    {
+        if(size <= SMALL_MAX_SIZE)
+        {
+            u64 class_size = size ? align_up(size, SMALL_CLASS_GRANULARITY) : SMALL_CLASS_GRANULARITY;
+            u32 class_index = (u32)(class_size / SMALL_CLASS_GRANULARITY) - 1;
+            void* payload = allocator->small_bins[class_index];
+            if(payload)
+            {
+                allocator->small_bins[class_index] = *(void**)payload;
+                return payload;
+            }
+
+            u64 flags = BLOCK_USED | BLOCK_SMALL | ((u64)class_index << BLOCK_CLASS_SHIFT);
+            block_header* block = take_block(allocator, BLOCK_HEADER_SIZE + class_size, flags);
+            return block ? (u8*)block + BLOCK_HEADER_SIZE : 0;
+        }
+
+        u64 required = BLOCK_HEADER_SIZE + align_up(size, BLOCK_HEADER_SIZE);
+        block_header* block = take_block(allocator, required, BLOCK_USED);
+        if(!block)
+        {
+            flush_small_bins(allocator);
+            block = take_block(allocator, required, BLOCK_USED);
+        }
+        return block ? (u8*)block + BLOCK_HEADER_SIZE : 0;
+    }
+
+    // Over-aligned: reserve enough slack to align the payload and leave room for the offset word before it.
+    u64 required = BLOCK_HEADER_SIZE + align_up(size + alignment, BLOCK_HEADER_SIZE);
+    block_header* block = take_block(allocator, required, BLOCK_USED);
+    if(!block)
+    {
+        flush_small_bins(allocator);
+        block = take_block(allocator, required, BLOCK_USED);
+        if(!block)
+        {
+            return 0;
+        }
+    }
+
+    u8* payload = (u8*)align_up((u64)block + BLOCK_HEADER_SIZE + sizeof(u64), alignment);
+    *(u64*)(payload - sizeof(u64)) = (u64)(payload - (u8*)block) | ALIGNED_OFFSET_BIT;
+    return payload;
+}
+
+b8 dynamic_allocator_free(dynamic_allocator* allocator, void* block)
+{
+    if(!allocator || !block || !dynamic_allocator_owns(allocator, block))
+    {
+        KERROR("dynamic_allocator_free - block %p does not belong to this allocator.", block);
+        return false;
+    }
+
+    block_header* header = payload_to_block(block);
+    if(!block_used(header))
+    {
+        KERROR("dynamic_allocator_free - block %p is already free.", block);
+        return false;
+    }
+
+    if(header->size_flags & BLOCK_SMALL)
+    {
+        // Small blocks stay reserved for their size class and are simply pushed back onto the bin.
+        u32 class_index = (u32)((header->size_flags & BLOCK_CLASS_MASK) >> BLOCK_CLASS_SHIFT);
+        KASSERT_MSG(class_index < DYNAMIC_ALLOCATOR_SMALL_CLASS_COUNT, "dynamic_allocator_free - small block has an invalid size class.");
+        *(void**)block = allocator->small_bins[class_index];
+        allocator->small_bins[class_index] = block;
+        return true;
+    }
+
+    release_block(allocator, header);
+    return true;
+}
+
+b8 dynamic_allocator_owns(const dynamic_allocator* allocator, const void* block)
+{
+    const u8* start = allocator->memory;
+    return (const u8*)block > start && (const u8*)block < start + allocator->total_size;
+}
+
+u64 dynamic_allocator_block_size(const dynamic_allocator* allocator, const void* block)
+{
+    if(!allocator || !block || !dynamic_allocator_owns(allocator, block))
+    {
+        return 0;
+    }
+
+    const block_header* header = payload_to_block(block);
+    return block_size(header) - (u64)((const u8*)block - (const u8*)header);
+}
+
+u64 dynamic_allocator_free_space(const dynamic_allocator* allocator)
+{
+    return allocator ? allocator->free_space : 0;
+}
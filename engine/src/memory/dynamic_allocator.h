@@ -0,0 +1,94 @@
+#pragma once
+
+#include "defines.h"
+
+// Number of small size classes. Each class is 16 bytes wide, so requests up to 256 bytes are binned.
+#define DYNAMIC_ALLOCATOR_SMALL_CLASS_COUNT 16
+// Number of free list bins for large blocks, one per power of two of the block size.
+#define DYNAMIC_ALLOCATOR_LARGE_BIN_COUNT 64
+
+/*
+    General purpose allocator working inside a single block of memory.
+
+    Large allocations are served from segregated free lists (one per power of two) using boundary tags,
+    so freed blocks are coalesced with free neighbours in O(1). Small allocations (up to 256 bytes with
+    default alignment) are served from exact size-class bins, which are singly linked lists of recycled
+    blocks and never need to search or coalesce.
+
+    Every block starts with a 16 byte header, so payloads are 16-byte aligned by default. Larger
+    power-of-two alignments are supported per allocation.
+*/
+typedef struct dynamic_allocator
+{
+    u64 total_size;
+    void* memory;
+
+    // Bytes currently available to the large free lists. Blocks cached in small bins count as used.
+    u64 free_space;
+
+    // Bitmask of large bins which contain at least one block.
+    u64 large_bin_mask;
+    void* large_bins[DYNAMIC_ALLOCATOR_LARGE_BIN_COUNT];
+    void* small_bins[DYNAMIC_ALLOCATOR_SMALL_CLASS_COUNT];
+} dynamic_allocator;
+
+/**
+ * @brief Creates a dynamic allocator which manages the provided block of memory.
+ *
+ * @param total_size The size of the block in bytes. Must be at least 64 bytes.
+ * @param memory The block of memory to be managed. Required. Should be 16-byte aligned.
+ * @param out_allocator A pointer to hold the allocator.
+ * @return True on success; otherwise false.
+ */
+KAPI b8 dynamic_allocator_create(u64 total_size, void* memory, dynamic_allocator* out_allocator);
+
+/**
+ * @brief Destroys the allocator. The memory block itself is owned by the caller and is not released.
+ *
+ * @param allocator A pointer to the allocator to be destroyed.
+ */
+KAPI void dynamic_allocator_destroy(dynamic_allocator* allocator);
+
+/**
+ * @brief Allocates a 16-byte aligned block of at least size bytes. Memory is not zeroed.
+ *
+ * @param allocator A pointer to the allocator.
+ * @param size The number of bytes required.
+ * @return A pointer to the block, or 0 if there is not enough contiguous space.
+ */
+KAPI void* dynamic_allocator_allocate(dynamic_allocator* allocator, u64 size);
+
+/**
+ * @brief Allocates a block of at least size bytes aligned to alignment. Memory is not zeroed.
+ *
+ * @param allocator A pointer to the allocator.
+ * @param size The number of bytes required.
+ * @param alignment The required alignment. Must be a power of two.
+ * @return A pointer to the block, or 0 if there is not enough contiguous space.
+ */
+KAPI void* dynamic_allocator_allocate_aligned(dynamic_allocator* allocator, u64 size, u64 alignment);
+
+/**
+ * @brief Returns a block previously obtained from this allocator.
+ *
+ * @param allocator A pointer to the allocator.
+ * @param block The block to be freed.
+ * @return True on success; false if the block does not belong to this allocator.
+ */
+KAPI b8 dynamic_allocator_free(dynamic_allocator* allocator, void* block);
+
+/**
+ * @brief Indicates if the given block lies within the memory managed by this allocator.
+ */
+KAPI b8 dynamic_allocator_owns(const dynamic_allocator* allocator, const void* block);
+
+/**
+ * @brief Obtains the usable size of a block allocated from this allocator.
+ * This may be larger than the size originally requested.
+ */
+KAPI u64 dynamic_allocator_block_size(const dynamic_allocator* allocator, const void* block);
+
+/**
+ * @brief Returns the number of bytes available to the large free lists.
+ */
+KAPI u64 dynamic_allocator_free_space(const dynamic_allocator* allocator);
@@ -0,0 +1,51 @@
+#include "frame_allocator.h"
+
+#include "core/kmemory.h"
+
+void frame_allocator_create(u64 buffer_size, b8 double_buffered, frame_allocator* out_allocator)
+{
+    if(out_allocator)
+    {
+        kzero_memory(out_allocator, sizeof(frame_allocator));
+        out_allocator->buffer_count = double_buffered ? 2 : 1;
+        for(u8 i = 0; i < out_allocator->buffer_count; ++i)
+        {
+            linear_allocator_create(buffer_size, 0, &out_allocator->buffers[i]);
+        }
+    }
+}
+
+void frame_allocator_destroy(frame_allocator* allocator)
+{
+    if(allocator)
+    {
+        for(u8 i = 0; i < allocator->buffer_count; ++i)
+        {
+            linear_allocator_destroy(&allocator->buffers[i]);
+        }
+        kzero_memory(allocator, sizeof(frame_allocator));
+    }
+}
+
+void* frame_allocator_allocate(frame_allocator* allocator, u64 size)
+{
+    return frame_allocator_allocate_aligned(allocator, size, 16);
+}
+
+void* frame_allocator_allocate_aligned(frame_allocator* allocator, u64 size, u64 alignment)
+{
+    return linear_allocator_allocate_aligned(&allocator->buffers[allocator->current], size, alignment);
+}
+
+void frame_allocator_end_frame(frame_allocator* allocator)
+{
+    linear_allocator* finished = &allocator->buffers[allocator->current];
+    if(finished->allocated > allocator->peak_allocated)
+    {
+        allocator->peak_allocated = finished->allocated;
+    }
+
+    // With two buffers, the one just finished stays intact for the next frame; the older one is reclaimed.
+    allocator->current = (allocator->current + 1) % allocator->buffer_count;
+    linear_allocator_free_all(&allocator->buffers[allocator->current], false);
+}
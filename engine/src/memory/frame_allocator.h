@@ -0,0 +1,48 @@
+#pragma once
+
+#include "defines.h"
+#include "memory/linear_allocator.h"
+
+/*
+    Transient per-frame memory built on linear allocators. Everything allocated during a frame is
+    released at once by frame_allocator_end_frame, which costs nothing beyond resetting an offset.
+
+    A double-buffered frame allocator alternates between two buffers, so data allocated in frame N
+    remains valid throughout frame N + 1 and is only reclaimed when frame N + 2 begins.
+*/
+typedef struct frame_allocator
+{
+    linear_allocator buffers[2];
+    // 1 for single, 2 for double-buffered.
+    u8 buffer_count;
+    // The buffer allocations are currently served from.
+    u8 current;
+    // Highest number of bytes used by any single frame. Useful for sizing the buffers.
+    u64 peak_allocated;
+} frame_allocator;
+
+/**
+ * @brief Creates a frame allocator.
+ *
+ * @param buffer_size The size in bytes of each buffer.
+ * @param double_buffered If true, allocations survive until the end of the following frame.
+ * @param out_allocator A pointer to hold the allocator.
+ */
+KAPI void frame_allocator_create(u64 buffer_size, b8 double_buffered, frame_allocator* out_allocator);
+KAPI void frame_allocator_destroy(frame_allocator* allocator);
+
+/**
+ * @brief Allocates 16-byte aligned, uninitialized memory which is valid until the frame ends
+ * (or the next frame ends, if double-buffered).
+ */
+KAPI void* frame_allocator_allocate(frame_allocator* allocator, u64 size);
+
+/**
+ * @brief Allocates memory with the given power-of-two alignment. Same lifetime as frame_allocator_allocate.
+ */
+KAPI void* frame_allocator_allocate_aligned(frame_allocator* allocator, u64 size, u64 alignment);
+
+/**
+ * @brief Ends the frame, moving to the next buffer and releasing everything it held. Memory is not zeroed.
+ */
+KAPI void frame_allocator_end_frame(frame_allocator* allocator);
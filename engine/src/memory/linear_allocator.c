@@ -57,12 +57,36 @@ void* linear_allocator_allocate(linear_allocator* allocator, u64 size)
     return 0;
 }
 
-void linear_allocator_free_all(linear_allocator* allocator)
+void* linear_allocator_allocate_aligned(linear_allocator* allocator, u64 size, u64 alignment)
+{
+    if(allocator && allocator->memory)
+    {
+        u64 address = (u64)allocator->memory + allocator->allocated;
+        u64 padding = ((address + alignment - 1) & ~(alignment - 1)) - address;
+        if(allocator->allocated + padding + size > allocator->total_size)
+        {
+            u64 remaining = allocator->total_size - allocator->allocated;
+            KERROR("linear_allocator_allocate_aligned - Tried to allocate %lluB (+%lluB padding), but only %lluB remaining.", size, padding, remaining);
+            return 0;
+        }
+
+        allocator->allocated += padding;
+        return linear_allocator_allocate(allocator, size);
+    }
+
+    KERROR("linear_allocator_allocate_aligned - provided allocator is not initialized");
+    return 0;
+}
+
+void linear_allocator_free_all(linear_allocator* allocator, b8 clear)
 {
     if(allocator && allocator->memory)
     {
         allocator->allocated = 0;
-        // Safe-guard (also makes it easier to debug)
-        kzero_memory(allocator->memory, allocator->total_size);
+        if(clear)
+        {
+            // Safe-guard (also makes it easier to debug)
+            kzero_memory(allocator->memory, allocator->total_size);
+        }
     }   
 }
\ No newline at end of file
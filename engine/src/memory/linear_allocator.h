@@ -15,4 +15,7 @@ KAPI void linear_allocator_create(u64 total_size, void* memory, linear_allocator
 KAPI void linear_allocator_destroy(linear_allocator* allocator);
 
 KAPI void* linear_allocator_allocate(linear_allocator* allocator, u64 size);
-KAPI void linear_allocator_free_all(linear_allocator* allocator);
\ No newline at end of file
+// Allocates size bytes with the start of the block rounded up to alignment (a power of two).
+KAPI void* linear_allocator_allocate_aligned(linear_allocator* allocator, u64 size, u64 alignment);
+// Resets the allocator. If clear is true the whole block is zeroed, which is only worth paying for when debugging.
+KAPI void linear_allocator_free_all(linear_allocator* allocator, b8 clear);
\ No newline at end of file
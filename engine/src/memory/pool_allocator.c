@@ -0,0 +1,217 @@
+#include "pool_allocator.h"
+
+#include "containers/darray.h"
+#include "core/logger.h"
+
+#define POOL_CACHE_LINE 64ull
+#define POOL_GUARD_SIZE 16ull
+#define POOL_POISON_BYTE 0xDD
+#define POOL_GUARD_BYTE 0xFD
+
+#define POOL_SLOT_LIVE 0x4C495645u
+#define POOL_SLOT_FREE 0x46524545u
+
+/*
+    Every slot ends with a trailer recording its chunk and state. This keeps free O(1), as the chunk
+    (and thus the live bit) can be found without searching, and catches double frees.
+*/
+typedef struct pool_slot_trailer
+{
+    u32 chunk_index;
+    u32 state;
+} pool_slot_trailer;
+
+KINLINE pool_slot_trailer* slot_trailer(pool_allocator* allocator, u8* slot)
+{
+    return (pool_slot_trailer*)(slot + allocator->slot_size - sizeof(pool_slot_trailer));
+}
+
+KINLINE u64 live_word_count(pool_allocator* allocator)
+{
+    return (allocator->slots_per_chunk + 63) / 64;
+}
+
+static b8 add_chunk(pool_allocator* allocator)
+{
+    u32 chunk_index = (u32)darray_length(allocator->chunks);
+    pool_chunk chunk;
+    chunk.slots = kallocate_aligned(allocator->slot_size * allocator->slots_per_chunk, POOL_CACHE_LINE, allocator->tag);
+    chunk.live_bits = kallocate(sizeof(u64) * live_word_count(allocator), allocator->tag);
+    if(!chunk.slots || !chunk.live_bits)
+    {
+        KERROR("pool_allocator - failed to allocate a chunk of %u slots.", allocator->slots_per_chunk);
+        return false;
+    }
+    darray_push(allocator->chunks, chunk);
+
+    // Thread the new slots onto the free list in address order.
+    for(u32 i = allocator->slots_per_chunk; i > 0; --i)
+    {
+        u8* slot = chunk.slots + (u64)(i - 1) * allocator->slot_size;
+        pool_slot_trailer* trailer = slot_trailer(allocator, slot);
+        trailer->chunk_index = chunk_index;
+        trailer->state = POOL_SLOT_FREE;
+        if(allocator->guard_mode)
+        {
+            kset_memory(slot, POOL_POISON_BYTE, allocator->element_size);
+        }
+        *(u8**)slot = allocator->free_list;
+        allocator->free_list = slot;
+    }
+
+    return true;
+}
+
+b8 _pool_allocator_create(u64 element_size, u32 slots_per_chunk, b8 guard_mode, memory_tag tag, pool_allocator* out_allocator)
+{
+    if(!out_allocator || element_size == 0 || slots_per_chunk == 0)
+    {
+        KERROR("pool_allocator_create requires a non-zero element size, slots per chunk and an out_allocator.");
+        return false;
+    }
+
+    kzero_memory(out_allocator, sizeof(pool_allocator));
+    out_allocator->element_size = element_size;
+    out_allocator->slots_per_chunk = slots_per_chunk;
+    out_allocator->guard_mode = guard_mode;
+    out_allocator->tag = tag;
+
+    // The free list link is stored in the object itself, so it must hold at least a pointer.
+    u64 payload = element_size < sizeof(void*) ? sizeof(void*) : element_size;
+    if(guard_mode)
+    {
+        payload += POOL_GUARD_SIZE;
+    }
+    u64 unaligned = payload + sizeof(pool_slot_trailer);
+    out_allocator->slot_size = (unaligned + POOL_CACHE_LINE - 1) & ~(POOL_CACHE_LINE - 1);
+
+    out_allocator->chunks = darray_create(pool_chunk);
+    return true;
+}
+
+void pool_allocator_destroy(pool_allocator* allocator)
+{
+    if(allocator && allocator->chunks)
+    {
+        u32 chunk_count = (u32)darray_length(allocator->chunks);
+        for(u32 i = 0; i < chunk_count; ++i)
+        {
+            kfree_aligned(allocator->chunks[i].slots, allocator->slot_size * allocator->slots_per_chunk, POOL_CACHE_LINE, allocator->tag);
+            kfree(allocator->chunks[i].live_bits, sizeof(u64) * live_word_count(allocator), allocator->tag);
+        }
+        darray_destroy(allocator->chunks);
+        kzero_memory(allocator, sizeof(pool_allocator));
+    }
+}
+
+void* pool_allocator_allocate(pool_allocator* allocator)
+{
+    if(!allocator->free_list && !add_chunk(allocator))
+    {
+        return 0;
+    }
+
+    u8* slot = allocator->free_list;
+    allocator->free_list = *(u8**)slot;
+
+    pool_slot_trailer* trailer = slot_trailer(allocator, slot);
+    if(allocator->guard_mode)
+    {
+        // Everything past the free list link must still hold poison, otherwise something wrote to a freed object.
+        for(u64 i = sizeof(u8*); i < allocator->element_size; ++i)
+        {
+            if(slot[i] != POOL_POISON_BYTE)
+            {
+                KERROR("pool_allocator - slot %p was modified after being freed.", slot);
+                break;
+            }
+        }
+        kset_memory(slot + allocator->element_size, POOL_GUARD_BYTE, POOL_GUARD_SIZE);
+    }
+
+    trailer->state = POOL_SLOT_LIVE;
+    u32 index = (u32)((slot - allocator->chunks[trailer->chunk_index].slots) / allocator->slot_size);
+    allocator->chunks[trailer->chunk_index].live_bits[index / 64] |= (1ull << (index % 64));
+    allocator->live_count++;
+
+    kzero_memory(slot, allocator->element_size);
+    return slot;
+}
+
+b8 pool_allocator_free(pool_allocator* allocator, void* object)
+{
+    if(!allocator || !object)
+    {
+        return false;
+    }
+
+    u8* slot = object;
+    pool_slot_trailer* trailer = slot_trailer(allocator, slot);
+    if(trailer->state != POOL_SLOT_LIVE || trailer->chunk_index >= darray_length(allocator->chunks))
+    {
+        KERROR("pool_allocator_free - %p is not a live object of this pool (double free?).", object);
+        return false;
+    }
+
+    pool_chunk* chunk = &allocator->chunks[trailer->chunk_index];
+    u64 offset = (u64)(slot - chunk->slots);
+    if(slot < chunk->slots || offset % allocator->slot_size != 0 || offset / allocator->slot_size >= allocator->slots_per_chunk)
+    {
+        KERROR("pool_allocator_free - %p does not point at the start of a slot.", object);
+        return false;
+    }
+
+    if(allocator->guard_mode)
+    {
+        u8* guard = slot + allocator->element_size;
+        for(u64 i = 0; i < POOL_GUARD_SIZE; ++i)
+        {
+            if(guard[i] != POOL_GUARD_BYTE)
+            {
+                KERROR("pool_allocator - object %p wrote past its end (%lluB).", object, allocator->element_size);
+                break;
+            }
+        }
+        kset_memory(slot, POOL_POISON_BYTE, allocator->element_size);
+    }
+
+    u32 index = (u32)(offset / allocator->slot_size);
+    chunk->live_bits[index / 64] &= ~(1ull << (index % 64));
+    trailer->state = POOL_SLOT_FREE;
+    allocator->live_count--;
+
+    *(u8**)slot = allocator->free_list;
+    allocator->free_list = slot;
+    return true;
+}
+
+void* pool_allocator_next(pool_allocator* allocator, pool_iterator* iterator)
+{
+    u32 chunk_count = (u32)darray_length(allocator->chunks);
+    while(iterator->chunk < chunk_count)
+    {
+        pool_chunk* chunk = &allocator->chunks[iterator->chunk];
+        while(iterator->slot < allocator->slots_per_chunk)
+        {
+            u32 word_index = iterator->slot / 64;
+            // Mask off slots already visited in this word, then jump to the next live one.
+            u64 word = chunk->live_bits[word_index] & (~0ull << (iterator->slot % 64));
+            if(word)
+            {
+                u32 index = word_index * 64 + __builtin_ctzll(word);
+                iterator->slot = index + 1;
+                return chunk->slots + (u64)index * allocator->slot_size;
+            }
+            iterator->slot = (word_index + 1) * 64;
+        }
+        iterator->chunk++;
+        iterator->slot = 0;
+    }
+
+    return 0;
+}
+
+u32 pool_allocator_live_count(const pool_allocator* allocator)
+{
+    return allocator ? allocator->live_count : 0;
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "defines.h"
+#include "core/kmemory.h"
+
+/*
+    Pool of fixed-size objects. Slots are cache-line aligned and carved from chunks which are added
+    as the pool grows, so objects never move. Free slots form an intrusive singly linked list, making
+    both allocation and release O(1). Each chunk also keeps a live bitmask so that live objects can
+    be iterated without touching free slots.
+
+    Guard mode is meant for debugging: freed slots are poisoned and checked for writes on reuse, and
+    a guard band after each object is checked for overruns on free.
+*/
+typedef struct pool_chunk
+{
+    u8* slots;
+    // One bit per slot, set while the slot is live.
+    u64* live_bits;
+} pool_chunk;
+
+typedef struct pool_allocator
+{
+    // Size of the object type stored in the pool.
+    u64 element_size;
+    // Distance between slots, a multiple of the cache line size.
+    u64 slot_size;
+    u32 slots_per_chunk;
+    u32 live_count;
+    b8 guard_mode;
+    memory_tag tag;
+    // darray of chunks
+    pool_chunk* chunks;
+    // First free slot, or 0 if a new chunk is needed.
+    u8* free_list;
+} pool_allocator;
+
+// Cursor for pool_allocator_next. Zero-initialize to start from the first object.
+typedef struct pool_iterator
+{
+    u32 chunk;
+    u32 slot;
+} pool_iterator;
+
+/**
+ * @brief Creates a pool allocator for objects of element_size bytes.
+ *
+ * @param element_size The size of each object.
+ * @param slots_per_chunk The number of slots added each time the pool grows.
+ * @param guard_mode Enables poisoning of free slots and overrun guards.
+ * @param tag The memory tag chunks are allocated with.
+ * @param out_allocator A pointer to hold the allocator.
+ * @return True on success; otherwise false.
+ */
+KAPI b8 _pool_allocator_create(u64 element_size, u32 slots_per_chunk, b8 guard_mode, memory_tag tag, pool_allocator* out_allocator);
+
+#define pool_allocator_create(type, slots_per_chunk, guard_mode, tag, out_allocator) \
+    _pool_allocator_create(sizeof(type), slots_per_chunk, guard_mode, tag, out_allocator)
+
+/**
+ * @brief Destroys the pool and releases all chunks. Live objects are released with it.
+ */
+KAPI void pool_allocator_destroy(pool_allocator* allocator);
+
+/**
+ * @brief Takes a zeroed, cache-line aligned object from the pool, growing it if required.
+ */
+KAPI void* pool_allocator_allocate(pool_allocator* allocator);
+
+/**
+ * @brief Returns an object to the pool.
+ * @return True on success; false if the object is not a live object of this pool.
+ */
+KAPI b8 pool_allocator_free(pool_allocator* allocator, void* object);
+
+/**
+ * @brief Advances the iterator to the next live object.
+ * @return The next live object, or 0 once all have been visited.
+ */
+KAPI void* pool_allocator_next(pool_allocator* allocator, pool_iterator* iterator);
+
+/**
+ * @brief Returns the number of objects currently allocated from the pool.
+ */
+KAPI u32 pool_allocator_live_count(const pool_allocator* allocator);
@@ -7,12 +7,33 @@
 #include <string.h>
 #include <sys/stat.h>
 
+#if KPLATFORM_WINDOWS
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
 b8 filesystem_exists(const char* path) 
 {
     struct stat buffer;
     return stat(path, &buffer) == 0;
 }
 
+b8 filesystem_get_info(const char* path, file_info* out_info)
+{
+    struct stat buffer;
+    if(stat(path, &buffer) != 0)
+    {
+        return false;
+    }
+
+    out_info->size = (u64)buffer.st_size;
+    out_info->modified_time = (u64)buffer.st_mtime;
+    return true;
+}
+
 b8 filesystem_open(const char* path, file_modes mode, b8 binary, file_handle* out_handle) {
     out_handle->is_valid = false;
     out_handle->handle = 0;
@@ -118,7 +139,7 @@ b8 filesystem_read_all_bytes(file_handle* handle, u8** out_bytes, u64* out_bytes
         u64 size = ftell((FILE*)handle->handle);
         rewind((FILE*)handle->handle);
 
-        *out_bytes = kallocate(sizeof(u8) * size, MEMORY_TAG_STRING);
+        *out_bytes = kallocate_no_zero(sizeof(u8) * size, MEMORY_TAG_STRING);
         *out_bytes_read = fread(*out_bytes, 1, size, (FILE*)handle->handle);
         if(*out_bytes_read != size) 
         {
@@ -142,4 +163,114 @@ b8 filesystem_write(file_handle* handle, u64 data_size, const void* data, u64* o
         return true;
     }
     return false;
-}
\ No newline at end of file
+}
+
+b8 filesystem_map(const char* path, file_mapping* out_mapping)
+{
+    kzero_memory(out_mapping, sizeof(file_mapping));
+
+#if KPLATFORM_WINDOWS
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+    if(file == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+
+    LARGE_INTEGER size;
+    if(!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+    {
+        CloseHandle(file);
+        return false;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, 0, PAGE_READONLY, 0, 0, 0);
+    const void* data = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : 0;
+    if(!data)
+    {
+        if(mapping)
+        {
+            CloseHandle(mapping);
+        }
+        CloseHandle(file);
+        return false;
+    }
+
+    out_mapping->data = data;
+    out_mapping->size = (u64)size.QuadPart;
+    out_mapping->internal_data[0] = file;
+    out_mapping->internal_data[1] = mapping;
+#else
+    i32 file = open(path, O_RDONLY);
+    if(file < 0)
+    {
+        return false;
+    }
+
+    struct stat buffer;
+    if(fstat(file, &buffer) != 0 || buffer.st_size == 0)
+    {
+        close(file);
+        return false;
+    }
+
+    // The mapping keeps the file referenced, so the descriptor is not needed past this point.
+    void* data = mmap(0, (size_t)buffer.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+    close(file);
+    if(data == MAP_FAILED)
+    {
+        return false;
+    }
+
+    out_mapping->data = data;
+    out_mapping->size = (u64)buffer.st_size;
+#endif
+    return true;
+}
+
+void filesystem_unmap(file_mapping* mapping)
+{
+    if(!mapping->data)
+    {
+        return;
+    }
+
+#if KPLATFORM_WINDOWS
+    UnmapViewOfFile(mapping->data);
+    CloseHandle(mapping->internal_data[1]);
+    CloseHandle(mapping->internal_data[0]);
+#else
+    munmap((void*)mapping->data, (size_t)mapping->size);
+#endif
+    kzero_memory(mapping, sizeof(file_mapping));
+}
+
+b8 filesystem_replace(const char* source_path, const char* destination_path)
+{
+#if KPLATFORM_WINDOWS
+    return MoveFileExA(source_path, destination_path, MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+    return rename(source_path, destination_path) == 0;
+#endif
+}
+
+b8 filesystem_remove(const char* path)
+{
+    return remove(path) == 0;
+}
+
+b8 filesystem_drop_cached_pages(const char* path)
+{
+#if KPLATFORM_WINDOWS
+    // There is no per-file way to do this on Windows.
+    return false;
+#else
+    int fd = open(path, O_RDONLY);
+    if(fd < 0)
+    {
+        return false;
+    }
+    b8 result = posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED) == 0;
+    close(fd);
+    return result;
+#endif
+}
@@ -10,6 +10,23 @@ typedef struct file_handle
     b8 is_valid;
 } file_handle;
 
+// Size and modification time of a file.
+typedef struct file_info
+{
+    u64 size;
+    // Seconds since the epoch.
+    u64 modified_time;
+} file_info;
+
+// A read-only view of a whole file, mapped into memory.
+typedef struct file_mapping
+{
+    const void* data;
+    u64 size;
+    // Opaque handles to the internal mapping.
+    void* internal_data[2];
+} file_mapping;
+
 typedef enum file_modes
 {
     FILE_MODE_READ = 0x1,
@@ -23,6 +40,14 @@ typedef enum file_modes
  */
 KAPI b8 filesystem_exists(const char* path);
 
+/**
+ * Gets the size and modification time of a file.
+ * @param path The path of the file.
+ * @param out_info A pointer to hold the file's information.
+ * @returns True if the file exists; otherwise false.
+ */
+KAPI b8 filesystem_get_info(const char* path, file_info* out_info);
+
 /** 
  * Attempt to open file located at path.
  * @param path The path of the file to be opened.
@@ -84,4 +109,43 @@ KAPI b8 filesystem_read_all_bytes(file_handle* handle, u8** out_bytes, u64* out_
  * @param out_bytes_written A pointer to a number which will be populated with the number of bytes actually written to the file.
  * @returns True if successful; otherwise false.
  */
-KAPI b8 filesystem_write(file_handle* handle, u64 data_size, const void* data, u64* out_bytes_written);
\ No newline at end of file
+KAPI b8 filesystem_write(file_handle* handle, u64 data_size, const void* data, u64* out_bytes_written);
+
+/**
+ * Maps a whole file into memory for reading. Pages are read from disk as they are first touched, so
+ * nothing is copied up front. Must be unmapped with filesystem_unmap.
+ * @param path The path of the file to map.
+ * @param out_mapping A pointer to a file_mapping structure to hold the mapping.
+ * @returns True if mapped successfully; otherwise false. Empty files cannot be mapped.
+ */
+KAPI b8 filesystem_map(const char* path, file_mapping* out_mapping);
+
+/**
+ * Unmaps a file mapped with filesystem_map.
+ * @param mapping A pointer to the mapping to be released.
+ */
+KAPI void filesystem_unmap(file_mapping* mapping);
+
+/**
+ * Moves a file over another, replacing it in one step. Anything holding the old file open or mapped
+ * keeps reading its old contents, where the platform allows replacing it at all.
+ * @param source_path The path of the file to move.
+ * @param destination_path The path to move it to. Replaced if it exists.
+ * @returns True on success; otherwise false, in which case the destination is left as it was.
+ */
+KAPI b8 filesystem_replace(const char* source_path, const char* destination_path);
+
+/**
+ * Deletes a file.
+ * @param path The path of the file to delete.
+ * @returns True on success; otherwise false.
+ */
+KAPI b8 filesystem_remove(const char* path);
+
+/**
+ * Asks the OS to drop a file's pages from its cache, so the next read comes from the disk again.
+ * Only pages which are clean and not mapped anywhere can be dropped.
+ * @param path The path of the file.
+ * @returns True if the request was made; false if it failed or the platform does not support it.
+ */
+KAPI b8 filesystem_drop_cached_pages(const char* path);
@@ -2,6 +2,10 @@
 
 #include "defines.h"
 
+/*
+    Starts the platform layer. When headless, no window is created and no display is needed;
+    platform_pump_messages then has nothing to process.
+*/
 b8 platform_system_startup
 (
     u64* memory_requirement,
@@ -10,7 +14,8 @@ b8 platform_system_startup
     i32 x,
     i32 y,
     i32 width,
-    i32 height
+    i32 height,
+    b8 headless
 );
 
 void platform_system_shutdown(void* plat_state);
@@ -20,6 +25,10 @@ b8 platform_pump_messages();
 
 void* platform_allocate(u64 size, b8 aligned);
 void platform_free(void* block, b8 aligned);
+// Allocates a block aligned to alignment, which must be a power of two.
+void* platform_allocate_aligned(u64 size, u64 alignment);
+// Frees a block obtained from platform_allocate_aligned.
+void platform_free_aligned(void* block);
 void* platform_zero_memory(void* block, u64 size);
 void* platform_copy_memory(void* dest, const void* source, u64 size);
 void* platform_set_memory(void* dest, i32 value, u64 size);
@@ -29,7 +38,89 @@ void platform_console_write_error(const char* message, u8 colour);
 
 f64 platform_get_absolute_time();
 
+// Monotonic time in nanoseconds, from an arbitrary starting point. Used where doubles lose precision.
+u64 platform_get_absolute_time_ns();
+
 // Sleep on the thread for the provided ms. This blocks the main thread.
 // Should only be used for giving time back to the OS for unused update power.
 // Therefore it is not exported.
-void platform_sleep(u64 ms);
\ No newline at end of file
+void platform_sleep(u64 ms);
+
+// Threading
+
+// Entry point of a thread. The return value is discarded.
+typedef u32 (*platform_thread_start)(void* params);
+
+typedef struct platform_thread
+{
+    void* internal_data;
+    u64 thread_id;
+} platform_thread;
+
+typedef struct platform_mutex
+{
+    void* internal_data;
+} platform_mutex;
+
+typedef struct platform_semaphore
+{
+    void* internal_data;
+} platform_semaphore;
+
+/**
+ * Starts a new thread running start_function(params).
+ * @param auto_detach If true the thread cleans itself up when it exits and cannot be joined.
+ * @param out_thread A pointer to hold the thread. Required, even if auto-detached.
+ * @return True on success; otherwise false.
+ */
+KAPI b8 platform_thread_create(platform_thread_start start_function, void* params, b8 auto_detach, platform_thread* out_thread);
+// Waits for the thread to exit and releases it.
+KAPI void platform_thread_join(platform_thread* thread);
+// Gives up the remainder of the calling thread's time slice.
+KAPI void platform_thread_yield();
+KAPI u64 platform_current_thread_id();
+// The number of logical processors available to the process.
+KAPI i32 platform_get_processor_count();
+
+KAPI b8 platform_mutex_create(platform_mutex* out_mutex);
+KAPI void platform_mutex_destroy(platform_mutex* mutex);
+KAPI b8 platform_mutex_lock(platform_mutex* mutex);
+KAPI b8 platform_mutex_unlock(platform_mutex* mutex);
+
+/**
+ * Creates a counting semaphore.
+ * @param initial_count The count the semaphore starts with.
+ */
+KAPI b8 platform_semaphore_create(u32 initial_count, platform_semaphore* out_semaphore);
+KAPI void platform_semaphore_destroy(platform_semaphore* semaphore);
+// Increments the count by count, waking up to that many waiting threads.
+KAPI b8 platform_semaphore_signal(platform_semaphore* semaphore, u32 count);
+// Blocks until the count is above zero, then decrements it.
+KAPI b8 platform_semaphore_wait(platform_semaphore* semaphore);
+
+// Atomics. All operations are sequentially consistent. GCC and Clang (the compilers used on every
+// platform) provide these as builtins, so they are inlined rather than going through the platform layer.
+
+KINLINE i32 platform_atomic_load_i32(volatile i32* value) { return __atomic_load_n(value, __ATOMIC_SEQ_CST); }
+KINLINE void platform_atomic_store_i32(volatile i32* value, i32 desired) { __atomic_store_n(value, desired, __ATOMIC_SEQ_CST); }
+// Adds amount and returns the new value.
+KINLINE i32 platform_atomic_add_i32(volatile i32* value, i32 amount) { return __atomic_add_fetch(value, amount, __ATOMIC_SEQ_CST); }
+// Replaces the value with desired if it equals expected. Returns true if the exchange happened.
+KINLINE b8 platform_atomic_compare_exchange_i32(volatile i32* value, i32 expected, i32 desired)
+{
+    return __atomic_compare_exchange_n(value, &expected, desired, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+
+KINLINE i64 platform_atomic_load_i64(volatile i64* value) { return __atomic_load_n(value, __ATOMIC_SEQ_CST); }
+KINLINE void platform_atomic_store_i64(volatile i64* value, i64 desired) { __atomic_store_n(value, desired, __ATOMIC_SEQ_CST); }
+KINLINE i64 platform_atomic_add_i64(volatile i64* value, i64 amount) { return __atomic_add_fetch(value, amount, __ATOMIC_SEQ_CST); }
+KINLINE b8 platform_atomic_compare_exchange_i64(volatile i64* value, i64 expected, i64 desired)
+{
+    return __atomic_compare_exchange_n(value, &expected, desired, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+
+KINLINE void* platform_atomic_load_ptr(void* volatile* value) { return __atomic_load_n(value, __ATOMIC_SEQ_CST); }
+KINLINE void platform_atomic_store_ptr(void* volatile* value, void* desired) { __atomic_store_n(value, desired, __ATOMIC_SEQ_CST); }
+
+// Full memory barrier.
+KINLINE void platform_atomic_fence() { __atomic_thread_fence(__ATOMIC_SEQ_CST); }
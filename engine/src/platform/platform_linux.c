@@ -6,6 +6,7 @@
 #include "core/logger.h"
 #include "core/event.h"
 #include "core/input.h"
+#include "core/profiler.h"
 
 #include "containers/darray.h"
 
@@ -25,6 +26,11 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <sched.h>
+#include <errno.h>
+#include <unistd.h>  // sysconf
 
 // For surface creation
 #define VK_USE_PLATFORM_XCB_KHR
@@ -32,6 +38,7 @@
 #include "renderer/vulkan/vulkan_types.inl"
 
 typedef struct platform_state {
+    b8 headless;
     Display* display;
     xcb_connection_t* connection;
     xcb_window_t window;
@@ -53,13 +60,19 @@ b8 platform_system_startup(
     i32 x,
     i32 y,
     i32 width,
-    i32 height) {
+    i32 height,
+    b8 headless) {
     *memory_requirement = sizeof(platform_state);
     if (state == 0) {
         return true;
     }
 
     state_ptr = state;
+    state_ptr->headless = headless;
+    if (headless) {
+        // No X server required.
+        return true;
+    }
 
     // Connect to X
     state_ptr->display = XOpenDisplay(NULL);
@@ -179,7 +192,7 @@ b8 platform_system_startup(
 }
 
 void platform_system_shutdown(void* plat_state) {
-    if (state_ptr) {
+    if (state_ptr && !state_ptr->headless) {
         // Turn key repeats back on since this is global for the OS... just... wow.
         XAutoRepeatOn(state_ptr->display);
 
@@ -188,7 +201,8 @@ void platform_system_shutdown(void* plat_state) {
 }
 
 b8 platform_pump_messages() {
-    if (state_ptr) {
+    if (state_ptr && !state_ptr->headless) {
+        KPROFILE_FUNCTION_BEGIN();
         xcb_generic_event_t* event;
         xcb_client_message_event_t* cm;
 
@@ -255,12 +269,13 @@ b8 platform_pump_messages() {
                     // The application layer can decide what to do with this.
                     xcb_configure_notify_event_t* configure_event = (xcb_configure_notify_event_t*)event;
 
-                    // Fire the event. The application layer should pick this up, but not handle it
-                    // as it shouldn be visible to other parts of the application.
+                    // Post the event. The application layer should pick this up, but not handle it
+                    // as it shouldn be visible to other parts of the application. Resizes are
+                    // coalesced, so a burst of them while dragging only recreates the swapchain once.
                     event_context context;
                     context.data.u16[0] = configure_event->width;
                     context.data.u16[1] = configure_event->height;
-                    event_fire(EVENT_CODE_RESIZED, 0, context);
+                    event_post(EVENT_CODE_RESIZED, 0, context);
 
                 } break;
 
@@ -279,6 +294,7 @@ b8 platform_pump_messages() {
 
             free(event);
         }
+        KPROFILE_END();
         return !quit_flagged;
     }
     return true;
@@ -290,6 +306,20 @@ void* platform_allocate(u64 size, b8 aligned) {
 void platform_free(void* block, b8 aligned) {
     free(block);
 }
+void* platform_allocate_aligned(u64 size, u64 alignment) {
+    // posix_memalign needs at least pointer alignment.
+    if(alignment < sizeof(void*)) {
+        alignment = sizeof(void*);
+    }
+    void* block = 0;
+    if(posix_memalign(&block, alignment, size) != 0) {
+        return 0;
+    }
+    return block;
+}
+void platform_free_aligned(void* block) {
+    free(block);
+}
 void* platform_zero_memory(void* block, u64 size) {
     return memset(block, 0, size);
 }
@@ -317,6 +347,13 @@ f64 platform_get_absolute_time() {
     return now.tv_sec + now.tv_nsec * 0.000000001;
 }
 
+u64 platform_get_absolute_time_ns() {
+    // Raw, so NTP slewing doesn't stretch or shrink measured intervals.
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC_RAW, &now);
+    return (u64)now.tv_sec * 1000000000ull + (u64)now.tv_nsec;
+}
+
 void platform_sleep(u64 ms) {
 #if _POSIX_C_SOURCE >= 199309L
     struct timespec ts;
@@ -331,13 +368,141 @@ void platform_sleep(u64 ms) {
 #endif
 }
 
+// NOTE: Threads, mutexes and semaphores are heap allocated so that their handles stay valid when copied.
+
+b8 platform_thread_create(platform_thread_start start_function, void* params, b8 auto_detach, platform_thread* out_thread) {
+    if (!start_function || !out_thread) {
+        return false;
+    }
+
+    pthread_t thread_id;
+    // The start function only differs from what pthread expects in its return type, which is ignored.
+    i32 result = pthread_create(&thread_id, 0, (void* (*)(void*))start_function, params);
+    if (result != 0) {
+        KERROR("platform_thread_create - pthread_create failed with error %i.", result);
+        return false;
+    }
+
+    out_thread->thread_id = (u64)thread_id;
+    out_thread->internal_data = 0;
+    if (auto_detach) {
+        pthread_detach(thread_id);
+    } else {
+        out_thread->internal_data = platform_allocate(sizeof(pthread_t), false);
+        *(pthread_t*)out_thread->internal_data = thread_id;
+    }
+    return true;
+}
+
+void platform_thread_join(platform_thread* thread) {
+    if (thread && thread->internal_data) {
+        pthread_join(*(pthread_t*)thread->internal_data, 0);
+        platform_free(thread->internal_data, false);
+        thread->internal_data = 0;
+        thread->thread_id = 0;
+    }
+}
+
+void platform_thread_yield() {
+    sched_yield();
+}
+
+u64 platform_current_thread_id() {
+    return (u64)pthread_self();
+}
+
+i32 platform_get_processor_count() {
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (i32)count : 1;
+}
+
+b8 platform_mutex_create(platform_mutex* out_mutex) {
+    if (!out_mutex) {
+        return false;
+    }
+
+    pthread_mutex_t* mutex = platform_allocate(sizeof(pthread_mutex_t), false);
+    if (pthread_mutex_init(mutex, 0) != 0) {
+        KERROR("platform_mutex_create - pthread_mutex_init failed.");
+        platform_free(mutex, false);
+        return false;
+    }
+    out_mutex->internal_data = mutex;
+    return true;
+}
+
+void platform_mutex_destroy(platform_mutex* mutex) {
+    if (mutex && mutex->internal_data) {
+        pthread_mutex_destroy(mutex->internal_data);
+        platform_free(mutex->internal_data, false);
+        mutex->internal_data = 0;
+    }
+}
+
+b8 platform_mutex_lock(platform_mutex* mutex) {
+    return mutex && pthread_mutex_lock(mutex->internal_data) == 0;
+}
+
+b8 platform_mutex_unlock(platform_mutex* mutex) {
+    return mutex && pthread_mutex_unlock(mutex->internal_data) == 0;
+}
+
+b8 platform_semaphore_create(u32 initial_count, platform_semaphore* out_semaphore) {
+    if (!out_semaphore) {
+        return false;
+    }
+
+    sem_t* semaphore = platform_allocate(sizeof(sem_t), false);
+    if (sem_init(semaphore, 0, initial_count) != 0) {
+        KERROR("platform_semaphore_create - sem_init failed.");
+        platform_free(semaphore, false);
+        return false;
+    }
+    out_semaphore->internal_data = semaphore;
+    return true;
+}
+
+void platform_semaphore_destroy(platform_semaphore* semaphore) {
+    if (semaphore && semaphore->internal_data) {
+        sem_destroy(semaphore->internal_data);
+        platform_free(semaphore->internal_data, false);
+        semaphore->internal_data = 0;
+    }
+}
+
+b8 platform_semaphore_signal(platform_semaphore* semaphore, u32 count) {
+    if (!semaphore || !semaphore->internal_data) {
+        return false;
+    }
+    for (u32 i = 0; i < count; ++i) {
+        if (sem_post(semaphore->internal_data) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+b8 platform_semaphore_wait(platform_semaphore* semaphore) {
+    if (!semaphore || !semaphore->internal_data) {
+        return false;
+    }
+    // Retry if a signal handler interrupted the wait.
+    while (sem_wait(semaphore->internal_data) != 0) {
+        if (errno != EINTR) {
+            return false;
+        }
+    }
+    return true;
+}
+
 void platform_get_required_extension_names(const char*** names_darray) {
     darray_push(*names_darray, &"VK_KHR_xcb_surface");  // VK_KHR_xlib_surface?
 }
 
 // Surface creation for Vulkan
 b8 platform_create_vulkan_surface(vulkan_context* context) {
-    if(!state_ptr) {
+    // There is no window to present to when headless.
+    if(!state_ptr || state_ptr->headless) {
         return false;
     }
 
@@ -6,12 +6,15 @@
 #include "core/logger.h"
 #include "core/input.h"
 #include "core/event.h"
+#include "core/profiler.h"
 
 #include "containers/darray.h"
 
 #include <windows.h>
 #include <windowsx.h>  // param input extraction
+#include <timeapi.h>   // timeBeginPeriod
 #include <stdlib.h>
+#include <malloc.h>  // _aligned_malloc
 
 // For surface creation
 #include <vulkan/vulkan.h>
@@ -21,6 +24,7 @@
 
 typedef struct platform_state
 {
+    b8 headless;
     HINSTANCE h_instance;
     HWND hwnd;
     VkSurfaceKHR surface; // Temporarily storing a copy of it here too.
@@ -31,6 +35,7 @@ static platform_state* state_ptr;
 
 // Clock
 static f64 clock_frequency;
+static u64 clock_ticks_per_second;
 static LARGE_INTEGER start_time;
 
 LRESULT CALLBACK win32_process_message(HWND hwnd, u32 msg, WPARAM w_param, LPARAM l_param);
@@ -40,6 +45,7 @@ void clock_setup()
     LARGE_INTEGER frequency;
     QueryPerformanceFrequency(&frequency);
     clock_frequency = 1.0 / (f64)frequency.QuadPart;
+    clock_ticks_per_second = frequency.QuadPart;
     QueryPerformanceCounter(&start_time);
 }
 
@@ -51,7 +57,8 @@ b8 platform_system_startup
     i32 x,
     i32 y,
     i32 width,
-    i32 height
+    i32 height,
+    b8 headless
 )
 {
     *memory_requirement = sizeof(platform_state);
@@ -61,6 +68,16 @@ b8 platform_system_startup
     }
 
     state_ptr = state;
+    state_ptr->headless = headless;
+
+    // Ask for 1 ms scheduler granularity, so that platform_sleep is precise enough to pace frames with.
+    timeBeginPeriod(1);
+    if(headless)
+    {
+        // No window; just the clock.
+        clock_setup();
+        return true;
+    }
     
     state_ptr->h_instance = GetModuleHandleA(0); // When 0 is passed, gives a handle to the application that is currently executing this code.
 
@@ -157,20 +174,27 @@ void platform_system_shutdown(void* plat_state)
         state_ptr->hwnd = 0;
     }
 
+    if(state_ptr)
+    {
+        timeEndPeriod(1);
+    }
+
     state_ptr = 0;
 }
 
 
 b8 platform_pump_messages() 
 {
-    if(state_ptr)
+    if(state_ptr && !state_ptr->headless)
     {
+        KPROFILE_FUNCTION_BEGIN();
         MSG message;
         while(PeekMessageA(&message, NULL, 0, 0, PM_REMOVE)) 
         {
             TranslateMessage(&message);
             DispatchMessageA(&message);
         }
+        KPROFILE_END();
     }
 
     return true;
@@ -186,6 +210,16 @@ void platform_free(void *block, b8 aligned)
     free(block);
 }
 
+void* platform_allocate_aligned(u64 size, u64 alignment) 
+{
+    return _aligned_malloc(size, alignment);
+}
+
+void platform_free_aligned(void *block) 
+{
+    _aligned_free(block);
+}
+
 void* platform_zero_memory(void *block, u64 size) 
 {
     return memset(block, 0, size);
@@ -238,11 +272,167 @@ f64 platform_get_absolute_time()
     return (f64)now_time.QuadPart * clock_frequency;
 }
 
+u64 platform_get_absolute_time_ns() 
+{
+    if(!clock_frequency) 
+    {
+        clock_setup();
+    }
+
+    // Split into whole seconds and remainder so the multiplication cannot overflow.
+    LARGE_INTEGER now_time;
+    QueryPerformanceCounter(&now_time);
+    u64 ticks = now_time.QuadPart;
+    return (ticks / clock_ticks_per_second) * 1000000000ull + ((ticks % clock_ticks_per_second) * 1000000000ull) / clock_ticks_per_second;
+}
+
 void platform_sleep(u64 ms) 
 {
     Sleep(ms);
 }
 
+// NOTE: Mutexes are heap allocated critical sections so that their handles stay valid when copied.
+
+b8 platform_thread_create(platform_thread_start start_function, void* params, b8 auto_detach, platform_thread* out_thread)
+{
+    if(!start_function || !out_thread)
+    {
+        return false;
+    }
+
+    DWORD thread_id;
+    HANDLE handle = CreateThread(0, 0, (LPTHREAD_START_ROUTINE)start_function, params, 0, &thread_id);
+    if(!handle)
+    {
+        KERROR("platform_thread_create - CreateThread failed with error %u.", GetLastError());
+        return false;
+    }
+
+    out_thread->thread_id = thread_id;
+    out_thread->internal_data = handle;
+    if(auto_detach)
+    {
+        CloseHandle(handle);
+        out_thread->internal_data = 0;
+    }
+    return true;
+}
+
+void platform_thread_join(platform_thread* thread)
+{
+    if(thread && thread->internal_data)
+    {
+        WaitForSingleObject(thread->internal_data, INFINITE);
+        CloseHandle(thread->internal_data);
+        thread->internal_data = 0;
+        thread->thread_id = 0;
+    }
+}
+
+void platform_thread_yield()
+{
+    SwitchToThread();
+}
+
+u64 platform_current_thread_id()
+{
+    return (u64)GetCurrentThreadId();
+}
+
+i32 platform_get_processor_count()
+{
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors > 0 ? (i32)info.dwNumberOfProcessors : 1;
+}
+
+b8 platform_mutex_create(platform_mutex* out_mutex)
+{
+    if(!out_mutex)
+    {
+        return false;
+    }
+
+    CRITICAL_SECTION* section = platform_allocate(sizeof(CRITICAL_SECTION), false);
+    InitializeCriticalSection(section);
+    out_mutex->internal_data = section;
+    return true;
+}
+
+void platform_mutex_destroy(platform_mutex* mutex)
+{
+    if(mutex && mutex->internal_data)
+    {
+        DeleteCriticalSection(mutex->internal_data);
+        platform_free(mutex->internal_data, false);
+        mutex->internal_data = 0;
+    }
+}
+
+b8 platform_mutex_lock(platform_mutex* mutex)
+{
+    if(!mutex || !mutex->internal_data)
+    {
+        return false;
+    }
+    EnterCriticalSection(mutex->internal_data);
+    return true;
+}
+
+b8 platform_mutex_unlock(platform_mutex* mutex)
+{
+    if(!mutex || !mutex->internal_data)
+    {
+        return false;
+    }
+    LeaveCriticalSection(mutex->internal_data);
+    return true;
+}
+
+b8 platform_semaphore_create(u32 initial_count, platform_semaphore* out_semaphore)
+{
+    if(!out_semaphore)
+    {
+        return false;
+    }
+
+    HANDLE handle = CreateSemaphoreA(0, (LONG)initial_count, 0x7FFFFFFF, 0);
+    if(!handle)
+    {
+        KERROR("platform_semaphore_create - CreateSemaphore failed with error %u.", GetLastError());
+        return false;
+    }
+    out_semaphore->internal_data = handle;
+    return true;
+}
+
+void platform_semaphore_destroy(platform_semaphore* semaphore)
+{
+    if(semaphore && semaphore->internal_data)
+    {
+        CloseHandle(semaphore->internal_data);
+        semaphore->internal_data = 0;
+    }
+}
+
+b8 platform_semaphore_signal(platform_semaphore* semaphore, u32 count)
+{
+    if(!semaphore || !semaphore->internal_data)
+    {
+        return false;
+    }
+    return ReleaseSemaphore(semaphore->internal_data, (LONG)count, 0) != 0;
+}
+
+b8 platform_semaphore_wait(platform_semaphore* semaphore)
+{
+    if(!semaphore || !semaphore->internal_data)
+    {
+        return false;
+    }
+    return WaitForSingleObject(semaphore->internal_data, INFINITE) == WAIT_OBJECT_0;
+}
+
 void platform_get_required_extension_names(const char*** names_darray)
 {
     darray_push(*names_darray, &"VK_KHR_win32_surface");
@@ -251,7 +441,8 @@ void platform_get_required_extension_names(const char*** names_darray)
 // Surface creation for Vulkan
 b8 platform_create_vulkan_surface(vulkan_context* context) 
 {
-    if(!state_ptr)
+    // There is no window to present to when headless.
+    if(!state_ptr || state_ptr->headless)
     {
         return false;
     }
@@ -294,12 +485,13 @@ LRESULT CALLBACK win32_process_message(HWND hwnd, u32 msg, WPARAM w_param, LPARA
             u32 width = r.right - r.left;
             u32 height = r.bottom - r.top;
 
-            // Fire the event. The application layer should pick this up, but not handle it
-            // as it shouldn be visible to other parts of the application.
+            // Post the event. The application layer should pick this up, but not handle it
+            // as it shouldn be visible to other parts of the application. Resizes are
+            // coalesced, so a burst of them while dragging only recreates the swapchain once.
             event_context context;
             context.data.u16[0] = (u16)width;
             context.data.u16[1] = (u16)height;
-            event_fire(EVENT_CODE_RESIZED, 0, context);
+            event_post(EVENT_CODE_RESIZED, 0, context);
         } 
         break;
         case WM_KEYDOWN:
@@ -0,0 +1,682 @@
+#include "vfs.h"
+
+#include "core/logger.h"
+#include "core/kmemory.h"
+#include "core/kstring.h"
+#include "core/kcompress.h"
+#include "containers/hashtable.h"
+
+// Mounts when the config does not say otherwise.
+#define DEFAULT_MAX_MOUNTS 8
+// Longest path on disk a file in a mounted directory can have.
+#define MAX_REAL_PATH_LENGTH 512
+// Files are stored compressed only if that saves at least an eighth of their size.
+#define MIN_COMPRESSION_SAVING 8
+
+typedef enum vfs_mount_type
+{
+    VFS_MOUNT_DIRECTORY,
+    VFS_MOUNT_PACK
+} vfs_mount_type;
+
+typedef struct vfs_mount
+{
+    vfs_mount_type type;
+    // Without a trailing '/'. Empty for the root.
+    char* mount_point;
+    u64 mount_point_length;
+
+    // Directory mounts. Without a trailing '/'.
+    char* directory;
+
+    // Pack mounts, pointing into the mapping.
+    file_mapping pack;
+    const vfs_pack_header* header;
+    const vfs_pack_entry* entries;
+    const char* paths;
+} vfs_mount;
+
+typedef struct vfs_state
+{
+    vfs_config config;
+    u32 mount_count;
+    // Most recent last.
+    vfs_mount* mounts;
+} vfs_state;
+
+static vfs_state* state_ptr = 0;
+
+b8 vfs_initialize(u64* memory_requirement, void* state, vfs_config config)
+{
+    if(config.max_mounts == 0)
+    {
+        config.max_mounts = DEFAULT_MAX_MOUNTS;
+    }
+
+    // Block of memory will contain the state structure, then the mounts.
+    u64 struct_requirement = sizeof(vfs_state);
+    u64 mounts_requirement = sizeof(vfs_mount) * config.max_mounts;
+    *memory_requirement = struct_requirement + mounts_requirement;
+
+    if(!state)
+    {
+        return true;
+    }
+
+    kzero_memory(state, *memory_requirement);
+    state_ptr = state;
+    state_ptr->config = config;
+    state_ptr->mounts = state + struct_requirement;
+    return true;
+}
+
+void vfs_shutdown(void* state)
+{
+    if(state_ptr)
+    {
+        for(u32 i = 0; i < state_ptr->mount_count; ++i)
+        {
+            vfs_mount* mount = &state_ptr->mounts[i];
+            kfree(mount->mount_point, mount->mount_point_length + 1, MEMORY_TAG_STRING);
+            if(mount->directory)
+            {
+                kfree(mount->directory, string_length(mount->directory) + 1, MEMORY_TAG_STRING);
+            }
+            if(mount->type == VFS_MOUNT_PACK)
+            {
+                filesystem_unmap(&mount->pack);
+            }
+        }
+        state_ptr = 0;
+    }
+}
+
+u64 vfs_path_hash(const char* path, u64 length)
+{
+    return hash_bytes(path, length, 0);
+}
+
+// Copies a path, leaving off any trailing '/'.
+static char* duplicate_without_trailing_slash(const char* path, u64* out_length)
+{
+    char* copy = string_duplicate(path);
+    u64 length = string_length(copy);
+    while(length > 0 && copy[length - 1] == '/')
+    {
+        copy[--length] = 0;
+    }
+    *out_length = length;
+    return copy;
+}
+
+// Takes the next mount, filled in with its mount point. Returns 0 if there is no room left.
+static vfs_mount* add_mount(vfs_mount_type type, const char* mount_point)
+{
+    if(!state_ptr)
+    {
+        KERROR("vfs - cannot mount '%s' before the VFS is initialized.", mount_point);
+        return 0;
+    }
+    if(state_ptr->mount_count == state_ptr->config.max_mounts)
+    {
+        KERROR("vfs - cannot mount '%s', all %u mounts are in use. Adjust configuration to allow more.", mount_point, state_ptr->config.max_mounts);
+        return 0;
+    }
+
+    vfs_mount* mount = &state_ptr->mounts[state_ptr->mount_count];
+    kzero_memory(mount, sizeof(vfs_mount));
+    mount->type = type;
+    mount->mount_point = duplicate_without_trailing_slash(mount_point, &mount->mount_point_length);
+    return mount;
+}
+
+b8 vfs_mount_directory(const char* mount_point, const char* directory)
+{
+    if(!filesystem_exists(directory))
+    {
+        KWARN("vfs_mount_directory - directory '%s' does not exist.", directory);
+        return false;
+    }
+
+    vfs_mount* mount = add_mount(VFS_MOUNT_DIRECTORY, mount_point);
+    if(!mount)
+    {
+        return false;
+    }
+
+    u64 length = 0;
+    mount->directory = duplicate_without_trailing_slash(directory, &length);
+    state_ptr->mount_count++;
+    return true;
+}
+
+// Checks that a mapped pack's header and table of contents are in bounds.
+static b8 validate_pack(const file_mapping* pack)
+{
+    u64 size = pack->size;
+    const vfs_pack_header* header = pack->data;
+    if(size < sizeof(vfs_pack_header) ||
+       header->magic != VFS_PACK_MAGIC ||
+       header->version != VFS_PACK_VERSION ||
+       header->table_size == 0 ||
+       (header->table_size & (header->table_size - 1)) != 0 ||
+       header->entry_count > header->table_size)
+    {
+        return false;
+    }
+
+    u64 table_end = sizeof(vfs_pack_header) + sizeof(vfs_pack_entry) * (u64)header->table_size;
+    if(table_end > size || header->paths_offset < table_end || header->paths_offset > size || header->paths_size > size - header->paths_offset)
+    {
+        return false;
+    }
+
+    const vfs_pack_entry* entries = (const vfs_pack_entry*)(header + 1);
+    for(u32 i = 0; i < header->table_size; ++i)
+    {
+        const vfs_pack_entry* entry = &entries[i];
+        if(entry->path_length == 0)
+        {
+            continue;
+        }
+        b8 path_in_bounds = entry->path_offset <= header->paths_size && entry->path_length <= header->paths_size - entry->path_offset;
+        b8 data_in_bounds = entry->offset <= size && entry->stored_size <= size - entry->offset;
+        // Data read in place relies on the alignment, such as SPIR-V, which must be 4 byte aligned.
+        b8 data_aligned = entry->offset % VFS_PACK_ALIGNMENT == 0;
+        // A compressed entry cannot claim more than kcompress could have produced from its stored
+        // bytes, so a corrupt size cannot make vfs_read allocate without bound.
+        b8 sizes_match = entry->compression == VFS_COMPRESSION_NONE
+                             ? entry->stored_size == entry->size
+                             : entry->compression == VFS_COMPRESSION_LZ4 && entry->size <= entry->stored_size * 255 + 16;
+        if(!path_in_bounds || !data_in_bounds || !data_aligned || !sizes_match)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+b8 vfs_mount_pack(const char* mount_point, const char* pack_path)
+{
+    file_mapping pack;
+    if(!filesystem_map(pack_path, &pack))
+    {
+        KWARN("vfs_mount_pack - could not open pack '%s'.", pack_path);
+        return false;
+    }
+    if(!validate_pack(&pack))
+    {
+        KWARN("vfs_mount_pack - '%s' is not a valid pack.", pack_path);
+        filesystem_unmap(&pack);
+        return false;
+    }
+
+    vfs_mount* mount = add_mount(VFS_MOUNT_PACK, mount_point);
+    if(!mount)
+    {
+        filesystem_unmap(&pack);
+        return false;
+    }
+
+    mount->pack = pack;
+    mount->header = pack.data;
+    mount->entries = (const vfs_pack_entry*)(mount->header + 1);
+    mount->paths = (const char*)pack.data + mount->header->paths_offset;
+    state_ptr->mount_count++;
+    KDEBUG("Mounted pack '%s' with %u files.", pack_path, mount->header->entry_count);
+    return true;
+}
+
+// Gets the part of path under a mount point, or 0 if the mount point does not cover it.
+static const char* path_under_mount(const vfs_mount* mount, const char* path)
+{
+    u64 length = mount->mount_point_length;
+    if(length == 0)
+    {
+        return path;
+    }
+    for(u64 i = 0; i < length; ++i)
+    {
+        if(path[i] != mount->mount_point[i])
+        {
+            return 0;
+        }
+    }
+    return path[length] == '/' ? path + length + 1 : 0;
+}
+
+static const vfs_pack_entry* find_pack_entry(const vfs_mount* mount, const char* relative_path)
+{
+    u64 length = string_length(relative_path);
+    u64 hash = vfs_path_hash(relative_path, length);
+    u32 mask = mount->header->table_size - 1;
+    for(u32 probe = 0; probe <= mask; ++probe)
+    {
+        const vfs_pack_entry* entry = &mount->entries[(hash + probe) & mask];
+        if(entry->path_length == 0)
+        {
+            return 0;
+        }
+        if(entry->path_hash == hash && entry->path_length == length)
+        {
+            const char* entry_path = mount->paths + entry->path_offset;
+            b8 equal = true;
+            for(u64 i = 0; i < length && equal; ++i)
+            {
+                equal = entry_path[i] == relative_path[i];
+            }
+            if(equal)
+            {
+                return entry;
+            }
+        }
+    }
+    return 0;
+}
+
+// Joins a directory and a path under it. Returns false if too long for out_path.
+static b8 join_path(const char* directory, const char* relative_path, char* out_path, u64 out_path_size)
+{
+    u64 directory_length = string_length(directory);
+    u64 relative_length = string_length(relative_path);
+    if(directory_length + 1 + relative_length + 1 > out_path_size)
+    {
+        return false;
+    }
+    kcopy_memory(out_path, directory, directory_length);
+    out_path[directory_length] = '/';
+    kcopy_memory(out_path + directory_length + 1, relative_path, relative_length + 1);
+    return true;
+}
+
+/*
+    Where a file is found. For a loose file, real_path is filled in; for one in a pack, entry is.
+    Before initialization, every path is a loose file at the same path on disk.
+*/
+typedef struct vfs_location
+{
+    const vfs_mount* mount;
+    const vfs_pack_entry* entry;
+    char real_path[MAX_REAL_PATH_LENGTH];
+    file_info info;
+} vfs_location;
+
+static b8 locate(const char* path, vfs_location* out_location)
+{
+    out_location->mount = 0;
+    out_location->entry = 0;
+
+    if(!state_ptr)
+    {
+        if(string_length(path) + 1 > MAX_REAL_PATH_LENGTH || !filesystem_get_info(path, &out_location->info))
+        {
+            return false;
+        }
+        kcopy_memory(out_location->real_path, path, string_length(path) + 1);
+        return true;
+    }
+
+    for(u32 i = state_ptr->mount_count; i > 0; --i)
+    {
+        const vfs_mount* mount = &state_ptr->mounts[i - 1];
+        const char* relative_path = path_under_mount(mount, path);
+        if(!relative_path)
+        {
+            continue;
+        }
+
+        if(mount->type == VFS_MOUNT_PACK)
+        {
+            const vfs_pack_entry* entry = find_pack_entry(mount, relative_path);
+            if(entry)
+            {
+                out_location->mount = mount;
+                out_location->entry = entry;
+                out_location->info.size = entry->size;
+                out_location->info.modified_time = entry->modified_time;
+                return true;
+            }
+        }
+        else if(join_path(mount->directory, relative_path, out_location->real_path, MAX_REAL_PATH_LENGTH) &&
+                filesystem_get_info(out_location->real_path, &out_location->info))
+        {
+            out_location->mount = mount;
+            return true;
+        }
+    }
+    return false;
+}
+
+b8 vfs_exists(const char* path)
+{
+    vfs_location location;
+    return locate(path, &location);
+}
+
+b8 vfs_get_info(const char* path, file_info* out_info)
+{
+    vfs_location location;
+    if(!locate(path, &location))
+    {
+        return false;
+    }
+    *out_info = location.info;
+    return true;
+}
+
+b8 vfs_read(const char* path, vfs_file* out_file)
+{
+    kzero_memory(out_file, sizeof(vfs_file));
+    vfs_location location;
+    if(!locate(path, &location))
+    {
+        return false;
+    }
+
+    if(!location.entry)
+    {
+        // Empty files cannot be mapped, and have nothing to read anyway.
+        if(location.info.size == 0)
+        {
+            return true;
+        }
+        if(!filesystem_map(location.real_path, &out_file->mapping))
+        {
+            return false;
+        }
+        out_file->data = out_file->mapping.data;
+        out_file->size = out_file->mapping.size;
+        return true;
+    }
+
+    const vfs_pack_entry* entry = location.entry;
+    const u8* stored = (const u8*)location.mount->pack.data + entry->offset;
+    if(entry->compression == VFS_COMPRESSION_NONE)
+    {
+        out_file->data = stored;
+        out_file->size = entry->size;
+        return true;
+    }
+
+    out_file->decompressed = kallocate_no_zero(entry->size, MEMORY_TAG_STRING);
+    out_file->size = entry->size;
+    if(!kdecompress(stored, entry->stored_size, out_file->decompressed, entry->size))
+    {
+        KWARN("vfs_read - '%s' is corrupt in its pack.", path);
+        vfs_close(out_file);
+        return false;
+    }
+    out_file->data = out_file->decompressed;
+    return true;
+}
+
+void vfs_close(vfs_file* file)
+{
+    if(file->decompressed)
+    {
+        kfree(file->decompressed, file->size, MEMORY_TAG_STRING);
+    }
+    else if(file->mapping.data)
+    {
+        filesystem_unmap(&file->mapping);
+    }
+    kzero_memory(file, sizeof(vfs_file));
+}
+
+b8 vfs_get_real_path(const char* path, char* out_path, u64 out_path_size)
+{
+    vfs_location location;
+    if(locate(path, &location))
+    {
+        if(location.entry || string_length(location.real_path) + 1 > out_path_size)
+        {
+            return false;
+        }
+        kcopy_memory(out_path, location.real_path, string_length(location.real_path) + 1);
+        return true;
+    }
+
+    if(!state_ptr)
+    {
+        if(string_length(path) + 1 > out_path_size)
+        {
+            return false;
+        }
+        kcopy_memory(out_path, path, string_length(path) + 1);
+        return true;
+    }
+
+    // Not in any mount yet, so where it would be written.
+    for(u32 i = state_ptr->mount_count; i > 0; --i)
+    {
+        const vfs_mount* mount = &state_ptr->mounts[i - 1];
+        const char* relative_path = path_under_mount(mount, path);
+        if(relative_path && mount->type == VFS_MOUNT_DIRECTORY)
+        {
+            return join_path(mount->directory, relative_path, out_path, out_path_size);
+        }
+    }
+    return false;
+}
+
+KINLINE u64 align_up(u64 value, u64 alignment)
+{
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+/*
+    Reads a file to pack, and compresses it if asked to and it is worth it. The result is either
+    *out_compressed, which must be freed with compressed_capacity, or the file's own bytes.
+*/
+typedef struct pack_source
+{
+    u8* bytes;
+    u64 size;
+    u8* compressed;
+    u64 compressed_capacity;
+    u64 compressed_size;
+} pack_source;
+
+static void free_pack_source(pack_source* source);
+
+static b8 read_pack_source(const char* path, b8 compress, pack_source* out_source)
+{
+    kzero_memory(out_source, sizeof(pack_source));
+    file_info info;
+    if(!filesystem_get_info(path, &info))
+    {
+        return false;
+    }
+    if(info.size == 0)
+    {
+        return true;
+    }
+
+    file_handle f;
+    if(!filesystem_open(path, FILE_MODE_READ, true, &f))
+    {
+        return false;
+    }
+    b8 read = filesystem_read_all_bytes(&f, &out_source->bytes, &out_source->size);
+    filesystem_close(&f);
+    if(!read)
+    {
+        free_pack_source(out_source);
+        return false;
+    }
+
+    if(compress && out_source->size > 0)
+    {
+        out_source->compressed_capacity = kcompress_bound(out_source->size);
+        out_source->compressed = kallocate_no_zero(out_source->compressed_capacity, MEMORY_TAG_STRING);
+        out_source->compressed_size = kcompress(out_source->bytes, out_source->size, out_source->compressed, out_source->compressed_capacity);
+        if(out_source->compressed_size == 0 || out_source->compressed_size > out_source->size - out_source->size / MIN_COMPRESSION_SAVING)
+        {
+            kfree(out_source->compressed, out_source->compressed_capacity, MEMORY_TAG_STRING);
+            out_source->compressed = 0;
+        }
+    }
+    return true;
+}
+
+static void free_pack_source(pack_source* source)
+{
+    if(source->bytes)
+    {
+        kfree(source->bytes, source->size, MEMORY_TAG_STRING);
+    }
+    if(source->compressed)
+    {
+        kfree(source->compressed, source->compressed_capacity, MEMORY_TAG_STRING);
+    }
+    kzero_memory(source, sizeof(pack_source));
+}
+
+b8 vfs_pack_write(const char* pack_path, u32 count, const char** source_paths, const char** entry_paths, b8 compress)
+{
+    vfs_pack_header header = {};
+    header.magic = VFS_PACK_MAGIC;
+    header.version = VFS_PACK_VERSION;
+    header.entry_count = count;
+    // At most half full, so probes stay short.
+    header.table_size = 1;
+    while(header.table_size < (u64)count * 2)
+    {
+        header.table_size <<= 1;
+    }
+
+    u64 table_bytes = sizeof(vfs_pack_entry) * (u64)header.table_size;
+    vfs_pack_entry* table = kallocate(table_bytes, MEMORY_TAG_ARRAY);
+    // Slot of each file in the table, in the order given.
+    u32* slots = kallocate(sizeof(u32) * (count ? count : 1), MEMORY_TAG_ARRAY);
+    b8 result = true;
+
+    // Lay out the table of contents first, so it can be written ahead of the data. Every file is read
+    // here to find its stored size, and again below to write it, so only one is held at a time.
+    u64 paths_size = 0;
+    for(u32 i = 0; i < count && result; ++i)
+    {
+        paths_size += string_length(entry_paths[i]);
+    }
+    header.paths_offset = sizeof(vfs_pack_header) + table_bytes;
+    header.paths_size = paths_size;
+    u64 offset = align_up(header.paths_offset + paths_size, VFS_PACK_ALIGNMENT);
+    u64 path_offset = 0;
+
+    for(u32 i = 0; i < count && result; ++i)
+    {
+        u64 length = string_length(entry_paths[i]);
+        if(length == 0)
+        {
+            KWARN("vfs_pack_write - files cannot have an empty path.");
+            result = false;
+            break;
+        }
+
+        u64 hash = vfs_path_hash(entry_paths[i], length);
+        u32 mask = header.table_size - 1;
+        u32 slot = hash & mask;
+        while(table[slot].path_length != 0 && result)
+        {
+            if(table[slot].path_hash == hash && strings_equal(entry_paths[table[slot].reserved], entry_paths[i]))
+            {
+                KWARN("vfs_pack_write - '%s' is given more than once.", entry_paths[i]);
+                result = false;
+            }
+            slot = (slot + 1) & mask;
+        }
+        if(!result)
+        {
+            break;
+        }
+
+        file_info info;
+        pack_source source;
+        if(!filesystem_get_info(source_paths[i], &info) || !read_pack_source(source_paths[i], compress, &source))
+        {
+            KWARN("vfs_pack_write - could not read '%s'.", source_paths[i]);
+            result = false;
+            break;
+        }
+
+        vfs_pack_entry* entry = &table[slot];
+        entry->path_hash = hash;
+        entry->offset = offset;
+        entry->size = source.size;
+        entry->compression = source.compressed ? VFS_COMPRESSION_LZ4 : VFS_COMPRESSION_NONE;
+        entry->stored_size = source.compressed ? source.compressed_size : source.size;
+        entry->modified_time = info.modified_time;
+        entry->path_offset = (u32)path_offset;
+        entry->path_length = (u32)length;
+        // Which file the slot holds, while writing. Zeroed before the table is written.
+        entry->reserved = i;
+        slots[i] = slot;
+        free_pack_source(&source);
+
+        path_offset += length;
+        offset = align_up(offset + entry->stored_size, VFS_PACK_ALIGNMENT);
+    }
+
+    file_handle file;
+    if(result && !filesystem_open(pack_path, FILE_MODE_WRITE, true, &file))
+    {
+        result = false;
+    }
+    if(!result)
+    {
+        kfree(slots, sizeof(u32) * (count ? count : 1), MEMORY_TAG_ARRAY);
+        kfree(table, table_bytes, MEMORY_TAG_ARRAY);
+        return false;
+    }
+
+    for(u32 i = 0; i < header.table_size; ++i)
+    {
+        table[i].reserved = 0;
+    }
+
+    u64 written = 0;
+    result = filesystem_write(&file, sizeof(header), &header, &written) &&
+             filesystem_write(&file, table_bytes, table, &written);
+    for(u32 i = 0; i < count && result; ++i)
+    {
+        result = filesystem_write(&file, string_length(entry_paths[i]), entry_paths[i], &written);
+    }
+    u64 position = header.paths_offset + paths_size;
+
+    const u8 padding[VFS_PACK_ALIGNMENT] = {};
+    for(u32 i = 0; i < count && result; ++i)
+    {
+        const vfs_pack_entry* entry = &table[slots[i]];
+        pack_source source;
+        // Compression is deterministic, so this stores what was laid out above.
+        if(!read_pack_source(source_paths[i], entry->compression == VFS_COMPRESSION_LZ4, &source) ||
+           source.size != entry->size || (source.compressed ? source.compressed_size : source.size) != entry->stored_size)
+        {
+            KWARN("vfs_pack_write - '%s' changed while it was being packed.", source_paths[i]);
+            free_pack_source(&source);
+            result = false;
+            break;
+        }
+
+        if(entry->offset > position)
+        {
+            result = filesystem_write(&file, entry->offset - position, padding, &written);
+        }
+        if(entry->stored_size > 0)
+        {
+            result = result && filesystem_write(&file, entry->stored_size, source.compressed ? source.compressed : source.bytes, &written);
+        }
+        position = entry->offset + entry->stored_size;
+        free_pack_source(&source);
+    }
+
+    filesystem_close(&file);
+    kfree(slots, sizeof(u32) * (count ? count : 1), MEMORY_TAG_ARRAY);
+    kfree(table, table_bytes, MEMORY_TAG_ARRAY);
+
+    if(!result)
+    {
+        KWARN("vfs_pack_write - failed writing '%s'.", pack_path);
+    }
+    return result;
+}
@@ -0,0 +1,168 @@
+#pragma once
+
+#include "defines.h"
+#include "platform/filesystem.h"
+
+/*
+    The virtual file system. Assets are read by path through it rather than straight from disk, so
+    they can come either from loose files in a mounted directory, or from a mounted pack: one archive
+    holding many files, which is opened once rather than a file at a time.
+
+    Mounts are searched most recent first, so a pack mounted after a directory takes over the files it
+    holds. A mount point of "" covers every path. Paths use '/'. Before the system is initialized,
+    paths are read as loose files relative to the working directory.
+
+    Mounting is not thread safe and should happen at startup. Once it has, files may be read from any
+    thread.
+*/
+
+#define VFS_PACK_EXTENSION "kpak"
+// "KPAK"
+#define VFS_PACK_MAGIC 0x4B41504B
+#define VFS_PACK_VERSION 1
+// Each entry's data starts on this many bytes, which keeps data read in place from the mapping aligned.
+#define VFS_PACK_ALIGNMENT 16
+
+/*
+    Pack layout, all little-endian:
+        vfs_pack_header
+        vfs_pack_entry[table_size]    Open addressed by path hash, probing forward. Unused slots have a
+                                      path_length of 0.
+        Paths, not terminated, at each entry's path_offset from paths_offset.
+        Each entry's data, at its offset.
+*/
+
+typedef enum vfs_compression
+{
+    VFS_COMPRESSION_NONE = 0,
+    // Compressed with kcompress.
+    VFS_COMPRESSION_LZ4 = 1
+} vfs_compression;
+
+typedef struct vfs_pack_header
+{
+    u32 magic;
+    u32 version;
+    u32 entry_count;
+    // A power of two.
+    u32 table_size;
+    u64 paths_offset;
+    u64 paths_size;
+} vfs_pack_header;
+
+typedef struct vfs_pack_entry
+{
+    // vfs_path_hash of the path.
+    u64 path_hash;
+    // From the start of the pack.
+    u64 offset;
+    // Bytes in the pack, which is less than size if compressed.
+    u64 stored_size;
+    u64 size;
+    // Of the file it was packed from, in seconds since the epoch.
+    u64 modified_time;
+    u32 path_offset;
+    u32 path_length;
+    u32 compression;
+    u32 reserved;
+} vfs_pack_entry;
+
+typedef struct vfs_config
+{
+    // Mounts which can be made. 0 uses 8.
+    u32 max_mounts;
+} vfs_config;
+
+// A whole file read through the VFS. Must be closed with vfs_close.
+typedef struct vfs_file
+{
+    const u8* data;
+    u64 size;
+    // What has to be released on close: a buffer the file was decompressed into, or a loose file's mapping.
+    u8* decompressed;
+    file_mapping mapping;
+} vfs_file;
+
+b8 vfs_initialize(u64* memory_requirement, void* state, vfs_config config);
+
+/**
+ * Unmounts everything. Files still open from packs are left pointing at unmapped memory.
+ */
+void vfs_shutdown(void* state);
+
+/**
+ * Mounts a directory on disk.
+ * @param mount_point The path under which the directory's files appear, or "" for the root.
+ * @param directory The directory's path on disk.
+ * @returns True on success; otherwise false.
+ */
+KAPI b8 vfs_mount_directory(const char* mount_point, const char* directory);
+
+/**
+ * Mounts a pack written by vfs_pack_write. The pack is mapped into memory and its table of contents
+ * checked once here.
+ * @param mount_point The path under which the pack's files appear, or "" for the root.
+ * @param pack_path The pack's path on disk.
+ * @returns True on success; otherwise false.
+ */
+KAPI b8 vfs_mount_pack(const char* mount_point, const char* pack_path);
+
+/**
+ * Checks if a file exists in any mount.
+ * @param path The path of the file.
+ * @returns True if it exists; otherwise false.
+ */
+KAPI b8 vfs_exists(const char* path);
+
+/**
+ * Gets the size and modification time of a file. For a file in a pack, those of the file it was packed from.
+ * @param path The path of the file.
+ * @param out_info A pointer to hold the file's information.
+ * @returns True if the file exists; otherwise false.
+ */
+KAPI b8 vfs_get_info(const char* path, file_info* out_info);
+
+/**
+ * Reads a whole file. Files stored uncompressed in a pack, and loose files, are read in place from a
+ * mapping rather than copied.
+ * @param path The path of the file.
+ * @param out_file A pointer to hold the file. Must be closed with vfs_close.
+ * @returns True on success; otherwise false, in which case nothing needs to be closed.
+ */
+KAPI b8 vfs_read(const char* path, vfs_file* out_file);
+
+/**
+ * Releases a file read with vfs_read.
+ * @param file A pointer to the file.
+ */
+KAPI void vfs_close(vfs_file* file);
+
+/**
+ * Gets the path on disk of a file in a mounted directory, for writing files next to those read from
+ * it. The directory mount the file is read from is used, or if it does not exist yet, the most
+ * recently mounted directory covering its path.
+ * @param path The path of the file.
+ * @param out_path A buffer to hold the path on disk.
+ * @param out_path_size The size of out_path.
+ * @returns True on success; otherwise false, such as for a file which is read from a pack.
+ */
+KAPI b8 vfs_get_real_path(const char* path, char* out_path, u64 out_path_size);
+
+/**
+ * Hashes a path the way pack tables of contents are keyed.
+ * @param path The path, relative to the pack's mount point.
+ * @param length The length of path.
+ * @returns The hash.
+ */
+KAPI u64 vfs_path_hash(const char* path, u64 length);
+
+/**
+ * Writes loose files into a pack.
+ * @param pack_path The path of the pack to write.
+ * @param count The number of files.
+ * @param source_paths The paths on disk of the files to pack.
+ * @param entry_paths The paths the files have in the pack, relative to where it is mounted.
+ * @param compress Indicates if files which compress well are stored compressed.
+ * @returns True on success; otherwise false.
+ */
+KAPI b8 vfs_pack_write(const char* pack_path, u32 count, const char** source_paths, const char** entry_paths, b8 compress);
@@ -0,0 +1,90 @@
+#include "null_backend.h"
+
+#include "core/logger.h"
+#include "core/kmemory.h"
+
+// The null backend has no other state.
+static null_renderer_stats stats;
+
+b8 null_renderer_backend_initialize(renderer_backend* backend, const char* application_name)
+{
+    kzero_memory(&stats, sizeof(null_renderer_stats));
+    KINFO("Null renderer initialized. Nothing will be drawn.");
+    return true;
+}
+
+void null_renderer_backend_shutdown(renderer_backend* backend)
+{
+    KINFO("Null renderer shut down after %llu frames, %llu draws and %llu texture uploads (%llu bytes).",
+          stats.frame_count, stats.draw_count, stats.texture_upload_count, stats.texture_upload_bytes);
+}
+
+void null_renderer_backend_on_resized(renderer_backend* backend, u16 width, u16 height)
+{
+    stats.resize_count++;
+}
+
+b8 null_renderer_backend_begin_frame(renderer_backend* backend, f32 delta_time)
+{
+    return true;
+}
+
+void null_renderer_update_global_state(mat4 projection, mat4 view, vec3 view_position, vec4 ambient_color, i32 mode)
+{
+    stats.global_update_count++;
+}
+
+b8 null_renderer_backend_end_frame(renderer_backend* backend, f32 delta_time)
+{
+    stats.frame_count++;
+    return true;
+}
+
+void null_renderer_update_object(geometry_render_data data)
+{
+    stats.draw_count++;
+}
+
+void null_renderer_create_texture(const char* name, i32 width, i32 height, i32 channel_count, const u8* pixels, b8 has_transparency, const texture_sampler_params* sampler, texture* out_texture)
+{
+    out_texture->width = width;
+    out_texture->height = height;
+    out_texture->channel_count = channel_count;
+    out_texture->has_transparency = has_transparency;
+    out_texture->sampler = *sampler;
+    out_texture->internal_data = 0;
+
+    // Reports the mip chain a GPU backend would generate.
+    out_texture->mip_levels = 1;
+    if(!sampler->disable_mips)
+    {
+        u32 largest = width > height ? width : height;
+        while(largest > 1)
+        {
+            largest >>= 1;
+            out_texture->mip_levels++;
+        }
+    }
+    // Same as a GPU backend: INVALID_ID rolls over to 0 on the first upload.
+    out_texture->generation = INVALID_ID;
+    out_texture->generation++;
+
+    stats.texture_upload_count++;
+    stats.texture_upload_bytes += (u64)width * height * channel_count;
+}
+
+void null_renderer_destroy_texture(texture* texture)
+{
+    stats.texture_destroy_count++;
+    kzero_memory(texture, sizeof(struct texture));
+}
+
+b8 null_renderer_read_last_frame(renderer_backend* backend, u32* out_width, u32* out_height, u8* out_pixels)
+{
+    return false;
+}
+
+void null_renderer_get_stats(null_renderer_stats* out_stats)
+{
+    *out_stats = stats;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "renderer/renderer_backend.h"
+#include "resources/resource_types.h"
+
+/*
+    Counts of the calls made to the null renderer backend since it was initialized.
+*/
+typedef struct null_renderer_stats
+{
+    u64 frame_count;
+    u64 global_update_count;
+    // Objects submitted through update_object, each of which would be one draw call.
+    u64 draw_count;
+    u64 texture_upload_count;
+    u64 texture_upload_bytes;
+    u64 texture_destroy_count;
+    u64 resize_count;
+} null_renderer_stats;
+
+/*
+    A renderer backend which needs no GPU, window or display. Every call is accepted and counted, so
+    the application loop, texture system and game logic can run headless for tests and benchmarks.
+*/
+b8 null_renderer_backend_initialize(renderer_backend* backend, const char* application_name);
+void null_renderer_backend_shutdown(renderer_backend* backend);
+
+void null_renderer_backend_on_resized(renderer_backend* backend, u16 width, u16 height);
+
+b8 null_renderer_backend_begin_frame(renderer_backend* backend, f32 delta_time);
+void null_renderer_update_global_state(mat4 projection, mat4 view, vec3 view_position, vec4 ambient_color, i32 mode);
+b8 null_renderer_backend_end_frame(renderer_backend* backend, f32 delta_time);
+
+void null_renderer_update_object(geometry_render_data data);
+
+void null_renderer_create_texture(const char* name, i32 width, i32 height, i32 channel_count, const u8* pixels, b8 has_transparency, const texture_sampler_params* sampler, texture* out_texture);
+void null_renderer_destroy_texture(texture* texture);
+
+// Nothing is drawn, so there is never a frame to read back.
+b8 null_renderer_read_last_frame(renderer_backend* backend, u32* out_width, u32* out_height, u8* out_pixels);
+
+/**
+ * Copies the call counts recorded since the null backend was initialized.
+ */
+KAPI void null_renderer_get_stats(null_renderer_stats* out_stats);
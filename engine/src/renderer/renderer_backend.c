@@ -1,6 +1,7 @@
 #include "renderer_backend.h"
 
 #include "vulkan/vulkan_backend.h"
+#include "null/null_backend.h"
 
 b8 renderer_backend_create(renderer_backend_type type, renderer_backend* out_renderer_backend)
 {
@@ -15,6 +16,22 @@ b8 renderer_backend_create(renderer_backend_type type, renderer_backend* out_ren
         out_renderer_backend->update_object = vulkan_renderer_update_object;
         out_renderer_backend->create_texture = vulkan_renderer_create_texture;
         out_renderer_backend->destroy_texture = vulkan_renderer_destroy_texture;
+        out_renderer_backend->read_last_frame = vulkan_renderer_read_last_frame;
+
+        return true;
+    }
+    else if(type == RENDERER_BACKEND_TYPE_NULL)
+    {
+        out_renderer_backend->initialize = null_renderer_backend_initialize;
+        out_renderer_backend->shutdown = null_renderer_backend_shutdown;
+        out_renderer_backend->begin_frame = null_renderer_backend_begin_frame;
+        out_renderer_backend->update_global_state = null_renderer_update_global_state;
+        out_renderer_backend->end_frame = null_renderer_backend_end_frame;
+        out_renderer_backend->resized = null_renderer_backend_on_resized;
+        out_renderer_backend->update_object = null_renderer_update_object;
+        out_renderer_backend->create_texture = null_renderer_create_texture;
+        out_renderer_backend->destroy_texture = null_renderer_destroy_texture;
+        out_renderer_backend->read_last_frame = null_renderer_read_last_frame;
 
         return true;
     }
@@ -33,4 +50,19 @@ void renderer_backend_destroy(renderer_backend* renderer_backend)
     renderer_backend->update_object = 0;    
     renderer_backend->create_texture = 0;
     renderer_backend->destroy_texture = 0;
+    renderer_backend->read_last_frame = 0;
+}
+
+b8 renderer_backend_is_supported(renderer_backend_type type)
+{
+    if(type == RENDERER_BACKEND_TYPE_VULKAN)
+    {
+        return vulkan_renderer_backend_is_supported();
+    }
+    else if(type == RENDERER_BACKEND_TYPE_NULL)
+    {
+        return true;
+    }
+
+    return false;
 }
\ No newline at end of file
@@ -3,4 +3,7 @@
 #include "renderer_types.h"
 
 b8 renderer_backend_create(renderer_backend_type type, renderer_backend* out_renderer_backend);
-void renderer_backend_destroy(renderer_backend* renderer_backend);
\ No newline at end of file
+void renderer_backend_destroy(renderer_backend* renderer_backend);
+
+// Indicates whether the given backend can be initialized on this machine. The null backend always can.
+b8 renderer_backend_is_supported(renderer_backend_type type);
\ No newline at end of file
@@ -4,6 +4,7 @@
 
 #include "core/logger.h"
 #include "core/kmemory.h"
+#include "core/profiler.h"
 
 #include "math/kmath.h"
 
@@ -24,6 +25,7 @@ typedef struct renderer_system_state
     mat4 view;
     f32 near_clip;
     f32 far_clip;
+    u32 framebuffer_height;
 
     // TODO: temporary
     texture* test_diffuse;
@@ -50,8 +52,8 @@ b8 event_on_debug_event(u16 code, void* sender, void* listener_inst, event_conte
     choice++;
     choice %= 3;
 
-    // Acquire the new texture.
-    state_ptr->test_diffuse = texture_system_acquire(names[choice], true);
+    // Acquire the new texture without stalling the frame. The default texture is drawn until it has loaded.
+    state_ptr->test_diffuse = texture_system_acquire_async(names[choice], true);
 
     // Release the old texture.
     texture_system_release(old_name);
@@ -61,7 +63,7 @@ b8 event_on_debug_event(u16 code, void* sender, void* listener_inst, event_conte
 
 // TODO: end temp
 
-b8 renderer_system_initialize(u64* memory_requirement, void* state, const char* application_name) 
+b8 renderer_system_initialize(u64* memory_requirement, void* state, const char* application_name, renderer_backend_config backend_config) 
 {
     *memory_requirement = sizeof(renderer_system_state);
     if(state == 0) 
@@ -75,9 +77,14 @@ b8 renderer_system_initialize(u64* memory_requirement, void* state, const char*
     event_register(EVENT_CODE_DEBUG0, state_ptr, event_on_debug_event);
     // TODO: end temp
 
-    // TODO: make this configurable.
-    renderer_backend_create(RENDERER_BACKEND_TYPE_VULKAN, &state_ptr->backend);
+    if(!renderer_backend_create(backend_config.type, &state_ptr->backend))
+    {
+        KFATAL("Renderer backend type %i is not supported. Shutting down.", backend_config.type);
+        return false;
+    }
     state_ptr->backend.frame_number = 0;
+    state_ptr->backend.offscreen = backend_config.offscreen;
+    state_ptr->backend.readback = backend_config.readback;
 
     if(!state_ptr->backend.initialize(&state_ptr->backend, application_name)) 
     {
@@ -85,6 +92,7 @@ b8 renderer_system_initialize(u64* memory_requirement, void* state, const char*
         return false;
     }
 
+    state_ptr->framebuffer_height = 720;
     state_ptr->near_clip = 0.1f;
     state_ptr->far_clip = 1000.0f;
     state_ptr->projection = mat4_perspective(deg_to_rad(45.0f), 1280 / 720.0f, state_ptr->near_clip, state_ptr->far_clip);
@@ -134,6 +142,7 @@ void renderer_on_resized(u16 width, u16 height)
     if(state_ptr) 
     {
         state_ptr->projection = mat4_perspective(deg_to_rad(45.0f), width / (f32)height, state_ptr->near_clip, state_ptr->far_clip);
+        state_ptr->framebuffer_height = height;
         state_ptr->backend.resized(&state_ptr->backend, width, height);
     } 
     else 
@@ -142,8 +151,34 @@ void renderer_on_resized(u16 width, u16 height)
     }
 }
 
+/**
+ * Estimates how many pixels tall something world_size units across, centred at world_position, is drawn.
+ * Uses the distance from the camera, which is as large as it gets when facing the camera.
+ */
+static f32 projected_size(vec3 world_position, f32 world_size)
+{
+    mat4 v = state_ptr->view;
+    vec3 p = world_position;
+    vec3 view_position = {
+        v.data[0] * p.x + v.data[4] * p.y + v.data[8] * p.z + v.data[12],
+        v.data[1] * p.x + v.data[5] * p.y + v.data[9] * p.z + v.data[13],
+        v.data[2] * p.x + v.data[6] * p.y + v.data[10] * p.z + v.data[14]
+    };
+    f32 distance = vec3_length(view_position);
+    if(distance < state_ptr->near_clip)
+    {
+        distance = state_ptr->near_clip;
+    }
+
+    // The projection's y scale is 1 / tan(fov / 2), which maps half the framebuffer's height.
+    f32 pixels_per_unit = state_ptr->projection.data[5] * 0.5f * state_ptr->framebuffer_height / distance;
+    return world_size * pixels_per_unit;
+}
+
 b8 renderer_draw_frame(render_packet* packet) 
 {
+    KPROFILE_FUNCTION_BEGIN();
+
     // If the begin frame returned successfully, mid-frame operations may continue.
     if(renderer_begin_frame(packet->delta_time)) 
     {
@@ -168,16 +203,26 @@ b8 renderer_draw_frame(render_packet* packet)
         data.textures[0] = state_ptr->test_diffuse;
         state_ptr->backend.update_object(data);
 
+        // The test quad is 10 units across and textured once, so the texture covers as much of the screen.
+        // Lets a streamed texture load the mip this needs.
+        const f32 test_quad_size = 10.0f;
+        vec3 quad_position = {model.data[12], model.data[13], model.data[14]};
+        texture_system_request_screen_size(state_ptr->test_diffuse, projected_size(quad_position, test_quad_size));
+
         // End the frame. If this fails, it is likely unrecoverable.
+        KPROFILE_BEGIN("renderer_end_frame");
         b8 result = renderer_end_frame(packet->delta_time);
+        KPROFILE_END();
 
         if(!result) 
         {
             KERROR("renderer_end_frame failed. Application shutting down...");
+            KPROFILE_END();
             return false;
         }
     }
 
+    KPROFILE_END();
     return true;
 }
 
@@ -194,13 +239,26 @@ void renderer_create_texture
     i32 channel_count,
     const u8* pixels,
     b8 has_transparency,
+    const texture_sampler_params* sampler,
     struct texture* out_texture
 )
 {
-    state_ptr->backend.create_texture(name, width, height, channel_count, pixels, has_transparency, out_texture);
+    // Zeroed parameters are the defaults.
+    texture_sampler_params default_sampler = {};
+    state_ptr->backend.create_texture(name, width, height, channel_count, pixels, has_transparency, sampler ? sampler : &default_sampler, out_texture);
 }
 
 void renderer_destroy_texture(struct texture* texture)
 {
     state_ptr->backend.destroy_texture(texture);
-}
\ No newline at end of file
+}
+
+b8 renderer_read_last_frame(u32* out_width, u32* out_height, u8* out_pixels)
+{
+    if(!state_ptr)
+    {
+        return false;
+    }
+
+    return state_ptr->backend.read_last_frame(&state_ptr->backend, out_width, out_height, out_pixels);
+}
@@ -2,7 +2,7 @@
 
 #include "renderer_types.h"
 
-b8 renderer_system_initialize(u64* memory_requirement, void* state, const char* application_name);
+b8 renderer_system_initialize(u64* memory_requirement, void* state, const char* application_name, renderer_backend_config backend_config);
 void renderer_system_shutdown(void* state);
 
 void renderer_on_resized(u16 width, u16 height);
@@ -20,7 +20,17 @@ void renderer_create_texture
     i32 channel_count,
     const u8* pixels,
     b8 has_transparency,
+    const texture_sampler_params* sampler,
     struct texture* out_texture
 );
 
-void renderer_destroy_texture(struct texture* texture);
\ No newline at end of file
+void renderer_destroy_texture(struct texture* texture);
+/**
+ * Copies the most recently submitted frame to host memory, waiting for the GPU to finish it. Only
+ * available when the backend renders offscreen with readback enabled.
+ * @param out_width The frame's width in pixels.
+ * @param out_height The frame's height in pixels.
+ * @param out_pixels Receives width * height RGBA8 pixels, top row first. Pass 0 to query the size only.
+ * @return True if a frame was available; otherwise false.
+ */
+KAPI b8 renderer_read_last_frame(u32* out_width, u32* out_height, u8* out_pixels);
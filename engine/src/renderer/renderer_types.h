@@ -8,9 +8,21 @@ typedef enum renderer_backend_type
 {
     RENDERER_BACKEND_TYPE_VULKAN,
     RENDERER_BACKEND_TYPE_OPENGL,
-    RENDERER_BACKEND_TYPE_DIRECTX
+    RENDERER_BACKEND_TYPE_DIRECTX,
+    // Draws nothing and needs no GPU. Used for headless runs.
+    RENDERER_BACKEND_TYPE_NULL
 } renderer_backend_type;
 
+typedef struct renderer_backend_config
+{
+    renderer_backend_type type;
+    // Draws into a ring of offscreen images instead of a window's swapchain. Needs no window or
+    // display, and runs on software Vulkan implementations such as lavapipe. Vulkan only.
+    b8 offscreen;
+    // Copies every offscreen frame back to host memory, to be read with renderer_read_last_frame.
+    b8 readback;
+} renderer_backend_config;
+
 /*
     Nvidia cards wants uniform objects to be 256 bytes
 */  
@@ -44,6 +56,9 @@ typedef struct renderer_backend
 {
     struct platform_state* plat_state;
     u64 frame_number;
+    // Set from renderer_backend_config before initialize is called.
+    b8 offscreen;
+    b8 readback;
 
     b8 (*initialize)(struct renderer_backend* backend, const char* application_name);
 
@@ -65,11 +80,14 @@ typedef struct renderer_backend
         i32 channel_count, 
         const u8* pixels, 
         b8 has_transparency, 
+        const texture_sampler_params* sampler,
         struct texture* out_texture
     );
 
     void (*destroy_texture)(struct texture* texture);
 
+    b8 (*read_last_frame)(struct renderer_backend* backend, u32* out_width, u32* out_height, u8* out_pixels);
+
 } renderer_backend;
 
 /*
@@ -78,4 +96,6 @@ typedef struct renderer_backend
 typedef struct render_packet 
 {
     f32 delta_time;
+    // Scratch memory for building the packet's contents. Released when the frame ends.
+    struct frame_allocator* frame_allocator;
 } render_packet;
\ No newline at end of file
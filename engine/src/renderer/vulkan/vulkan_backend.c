@@ -11,6 +11,9 @@
 #include "vulkan_utils.h"
 #include "vulkan_buffer.h"
 #include "vulkan_image.h"
+#include "vulkan_staging.h"
+#include "vulkan_sampler.h"
+#include "vulkan_memory.h"
 
 #include "core/logger.h"
 #include "core/kstring.h"
@@ -49,7 +52,13 @@ b8 recreate_swapchain(renderer_backend* backend);
 
 void upload_data_range(vulkan_context* context, VkCommandPool pool, VkFence fence, VkQueue queue, vulkan_buffer* buffer, u64 offset, u64 size, void* data)
 {
-    // Create a host-visible staging buffer to upload to. Mark it as the source of the transfer.
+    // Batched through the staging ring; the copy executes when the ring is next flushed.
+    if(vulkan_staging_ring_upload_buffer(context, &context->staging, buffer, offset, size, data))
+    {
+        return;
+    }
+
+    // Too large for the ring. Create a host-visible staging buffer to upload to. Mark it as the source of the transfer.
     VkMemoryPropertyFlagBits flags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
     vulkan_buffer staging;
     vulkan_buffer_create(context, size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, flags, true, &staging);
@@ -72,6 +81,9 @@ b8 vulkan_renderer_backend_initialize(renderer_backend* backend, const char* app
     // TODO: Custom Allocator
     context.allocator = 0;
 
+    context.offscreen = backend->offscreen;
+    context.readback = backend->offscreen && backend->readback;
+
     // Get initial framebuffer size from the application
     application_get_framebuffer_size(&cached_framebuffer_width, &cached_framebuffer_height);
     context.framebuffer_width = (cached_framebuffer_width != 0) ? cached_framebuffer_width : 800;
@@ -92,8 +104,13 @@ b8 vulkan_renderer_backend_initialize(renderer_backend* backend, const char* app
 
     // Obtain a list of required extensions
     const char** required_extensions = darray_create(const char*);
-    darray_push(required_extensions, &VK_KHR_SURFACE_EXTENSION_NAME); // Generic surface extension
-    platform_get_required_extension_names(&required_extensions); // Platform-specific extension(s)
+    // Offscreen has no surface, so the surface extensions are not required. Software and headless
+    // drivers may not provide them.
+    if(!context.offscreen)
+    {
+        darray_push(required_extensions, &VK_KHR_SURFACE_EXTENSION_NAME); // Generic surface extension
+        platform_get_required_extension_names(&required_extensions); // Platform-specific extension(s)
+    }
 #if defined(_DEBUG)
     darray_push(required_extensions, &VK_EXT_DEBUG_UTILS_EXTENSION_NAME); // debug utilities
 
@@ -185,13 +202,20 @@ b8 vulkan_renderer_backend_initialize(renderer_backend* backend, const char* app
 #endif
 
     // Surface
-    KDEBUG("Creating Vulkan Surface...");
-    if(!platform_create_vulkan_surface(&context))
+    if(context.offscreen)
     {
-        KERROR("Failed to create platform surface!");
-        return false;
+        KINFO("Rendering offscreen. No surface will be created.");
+    }
+    else
+    {
+        KDEBUG("Creating Vulkan Surface...");
+        if(!platform_create_vulkan_surface(&context))
+        {
+            KERROR("Failed to create platform surface!");
+            return false;
+        }
+        KDEBUG("Vulkan Surface created.");
     }
-    KDEBUG("Vulkan Surface created.");
 
     // Device creation
     if(!vulkan_device_create(&context))
@@ -200,6 +224,13 @@ b8 vulkan_renderer_backend_initialize(renderer_backend* backend, const char* app
         return false;
     }
 
+    // Device memory allocator. Must exist before any buffer or image is created.
+    if(!vulkan_memory_allocator_create(&context, VULKAN_MEMORY_BLOCK_DEFAULT_SIZE, &context.memory_allocator))
+    {
+        KERROR("Failed to create the device memory allocator!");
+        return false;
+    }
+
     // Swapchain creation
     vulkan_swapchain_create(&context, context.framebuffer_width, context.framebuffer_height, &context.swapchain);
 
@@ -255,6 +286,22 @@ b8 vulkan_renderer_backend_initialize(renderer_backend* backend, const char* app
 
     create_buffers(&context);
 
+    if(!vulkan_staging_ring_create(&context, VULKAN_STAGING_RING_DEFAULT_SIZE, &context.staging))
+    {
+        KERROR("Failed to create the staging ring.");
+        return false;
+    }
+
+    // Texture internal data lives in a pool. Guarded in debug builds to catch stale texture pointers.
+#if defined(_DEBUG)
+    b8 guard_texture_pool = true;
+#else
+    b8 guard_texture_pool = false;
+#endif
+    pool_allocator_create(vulkan_texture_data, 256, guard_texture_pool, MEMORY_TAG_TEXTURE, &context.texture_data_pool);
+
+    vulkan_sampler_cache_create(&context.sampler_cache);
+
     // TODO: temporary test code
     const u32 vert_count = 4;
     vertex_3d verts[vert_count];
@@ -313,6 +360,9 @@ void vulkan_renderer_backend_shutdown(renderer_backend* backend)
 
     // Destroying resources in the opposite order that we created them.
 
+    // Staging (submits and waits for any uploads still pending)
+    vulkan_staging_ring_destroy(&context, &context.staging);
+
     // Buffers
     vulkan_buffer_destroy(&context, &context.object_vertex_buffer);
     vulkan_buffer_destroy(&context, &context.object_index_buffer);
@@ -320,6 +370,16 @@ void vulkan_renderer_backend_shutdown(renderer_backend* backend)
     // Shaders
     vulkan_material_shader_destroy(&context, &context.material_shader);
 
+    // Texture data - every texture should have been destroyed by now.
+    if(pool_allocator_live_count(&context.texture_data_pool) > 0)
+    {
+        KWARN("%u textures were not destroyed before renderer shutdown.", pool_allocator_live_count(&context.texture_data_pool));
+    }
+    pool_allocator_destroy(&context.texture_data_pool);
+
+    // Samplers
+    vulkan_sampler_cache_destroy(&context, &context.sampler_cache);
+
     // Sync objects
     for(u8 i = 0; i < context.swapchain.max_frames_in_flight; ++i) 
     {
@@ -389,6 +449,10 @@ void vulkan_renderer_backend_shutdown(renderer_backend* backend)
     KDEBUG("Destroying Swapchain");
     vulkan_swapchain_destroy(&context, &context.swapchain);
 
+    // Device memory - every buffer and image has been destroyed by now.
+    KDEBUG("Destroying Vulkan memory allocator...");
+    vulkan_memory_allocator_destroy(&context, &context.memory_allocator);
+
     KDEBUG("Destroying Vulkan device...");
     vulkan_device_destroy(&context);
 
@@ -474,6 +538,9 @@ b8 vulkan_renderer_backend_begin_frame(renderer_backend* backend, f32 delta_time
         return false;
     }
 
+    // Frames up to this one have retired, so staging space used by their uploads can be reused.
+    vulkan_staging_ring_reclaim(&context, &context.staging);
+
     // Acquire the next image from the swap chain. Pass along the semaphore that should signaled when this completes.
     // This same semaphore will later be waited on by the queue submission to ensure this image is available.
     if(!vulkan_swapchain_acquire_next_image_index(
@@ -549,6 +616,11 @@ b8 vulkan_renderer_backend_end_frame(renderer_backend* backend, f32 delta_time)
     // End renderpass
     vulkan_renderpass_end(command_buffer, &context.main_renderpass);
 
+    if(context.readback)
+    {
+        vulkan_swapchain_record_readback(&context, &context.swapchain, command_buffer, context.image_index);
+    }
+
     vulkan_command_buffer_end(command_buffer);
 
     // Command buffer is ready to be submitted. 
@@ -569,6 +641,9 @@ b8 vulkan_renderer_backend_end_frame(renderer_backend* backend, f32 delta_time)
     // Reset the fence for use on the next frame
     vulkan_fence_reset(&context, &context.in_flight_fences[context.current_frame]);
 
+    // Submit this frame's uploads ahead of the frame itself so its draws can read them.
+    vulkan_staging_ring_flush(&context, &context.staging);
+
     // Submit the queue and wait for the operation to complete.
     // Begin queue submission
     VkSubmitInfo submit_info = {VK_STRUCTURE_TYPE_SUBMIT_INFO};
@@ -592,6 +667,16 @@ b8 vulkan_renderer_backend_end_frame(renderer_backend* backend, f32 delta_time)
     VkPipelineStageFlags flags[1] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
     submit_info.pWaitDstStageMask = flags;
 
+    // Offscreen images are not acquired from or presented by anything, so there is nothing to wait on or signal.
+    if(context.offscreen)
+    {
+        submit_info.waitSemaphoreCount = 0;
+        submit_info.pWaitSemaphores = 0;
+        submit_info.pWaitDstStageMask = 0;
+        submit_info.signalSemaphoreCount = 0;
+        submit_info.pSignalSemaphores = 0;
+    }
+
     VkResult result = vkQueueSubmit(
         context.device.graphics_queue,
         1,
@@ -607,7 +692,7 @@ b8 vulkan_renderer_backend_end_frame(renderer_backend* backend, f32 delta_time)
     vulkan_command_buffer_update_submitted(command_buffer);
     // End queue submission
 
-    // Give the image back to the swapchain.
+    // Give the image back to the swapchain. Offscreen, this only records it as the newest frame.
     vulkan_swapchain_present(
         &context,
         &context.swapchain,
@@ -640,29 +725,54 @@ void vulkan_renderer_update_object(geometry_render_data data)
     // TODO: end temp test code.
 }
 
-void vulkan_renderer_create_texture(const char* name, i32 width, i32 height, i32 channel_count, const u8* pixels, b8 has_transparency, texture* out_texture)
+void vulkan_renderer_create_texture(const char* name, i32 width, i32 height, i32 channel_count, const u8* pixels, b8 has_transparency, const texture_sampler_params* sampler, texture* out_texture)
 {
     out_texture->width = width;
     out_texture->height = height;
     out_texture->channel_count = channel_count;
     out_texture->generation = INVALID_ID;
+    out_texture->sampler = *sampler;
 
     // Internal data allocation
-    // TODO: Use an allocator for this
-    out_texture->internal_data = (vulkan_texture_data*)kallocate(sizeof(vulkan_texture_data), MEMORY_TAG_TEXTURE);
+    out_texture->internal_data = (vulkan_texture_data*)pool_allocator_allocate(&context.texture_data_pool);
     vulkan_texture_data* data = (vulkan_texture_data*)out_texture->internal_data;
     VkDeviceSize image_size = channel_count * width * height;
 
     // NOTE: Assumes 8 bits per channel.
     VkFormat image_format = VK_FORMAT_R8G8B8A8_UNORM;
+
+    // A full chain down to 1x1, generated on the GPU from the uploaded pixels.
+    u32 mip_levels = 1;
+    if(!sampler->disable_mips && vulkan_image_can_generate_mips(&context, image_format))
+    {
+        u32 largest = width > height ? width : height;
+        while(largest > 1)
+        {
+            largest >>= 1;
+            mip_levels++;
+        }
+    }
+    out_texture->mip_levels = mip_levels;
     
-    // Create a staging buffer and load the data into it to be used to copy into the VkImage
-    VkBufferUsageFlags usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-    VkMemoryPropertyFlags memory_prop_flags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    // Stage the pixels in the ring if they fit, otherwise fall back to a dedicated staging buffer.
+    u64 staging_offset = 0;
+    void* staging_memory = 0;
+    b8 batched = vulkan_staging_ring_allocate(&context, &context.staging, image_size, 16, &staging_offset, &staging_memory);
     vulkan_buffer staging_buffer;
-    vulkan_buffer_create(&context, image_size, usage, memory_prop_flags, true, &staging_buffer);
-
-    vulkan_buffer_load_data(&context, &staging_buffer, 0, image_size, 0, pixels);
+    VkBuffer staging_handle;
+    if(batched)
+    {
+        kcopy_memory(staging_memory, pixels, image_size);
+        staging_handle = context.staging.buffer.handle;
+    }
+    else
+    {
+        VkBufferUsageFlags usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+        VkMemoryPropertyFlags memory_prop_flags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+        vulkan_buffer_create(&context, image_size, usage, memory_prop_flags, true, &staging_buffer);
+        vulkan_buffer_load_data(&context, &staging_buffer, 0, image_size, 0, pixels);
+        staging_handle = staging_buffer.handle;
+    }
 
     // NOTE: Lots of assumptions here, different texture types will require
     // different options here.
@@ -671,6 +781,7 @@ void vulkan_renderer_create_texture(const char* name, i32 width, i32 height, i32
         VK_IMAGE_TYPE_2D,
         width,
         height,
+        mip_levels,
         image_format,
         VK_IMAGE_TILING_OPTIMAL,
         VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
@@ -681,17 +792,26 @@ void vulkan_renderer_create_texture(const char* name, i32 width, i32 height, i32
     );
 
     // Now, we have the buffer and image copy the data from the buffer into the image.
+    // Batched uploads are recorded into the staging ring's command buffer and submitted with the rest of the frame's uploads.
     vulkan_command_buffer temp_buffer;
+    vulkan_command_buffer* command_buffer = &temp_buffer;
     VkCommandPool pool = context.device.graphics_command_pool;
     VkQueue queue = context.device.graphics_queue;
-    vulkan_command_buffer_allocate_and_begin_single_use(&context, pool, &temp_buffer);
+    if(batched)
+    {
+        command_buffer = vulkan_staging_ring_commands(&context, &context.staging);
+    }
+    else
+    {
+        vulkan_command_buffer_allocate_and_begin_single_use(&context, pool, &temp_buffer);
+    }
 
     // Copying from a buffer to a image requires image to be in the right layout first.
 
     // Transition the layout from whatever it is currently to optimal for receiving data.    
     vulkan_image_transition_layout(
         &context,
-        &temp_buffer,
+        command_buffer,
         &data->image,
         image_format,
         VK_IMAGE_LAYOUT_UNDEFINED,
@@ -699,45 +819,35 @@ void vulkan_renderer_create_texture(const char* name, i32 width, i32 height, i32
     );
 
     // Copy the data from the buffer.
-    vulkan_image_copy_from_buffer(&context, &data->image, staging_buffer.handle, &temp_buffer);
+    vulkan_image_copy_from_buffer(&context, &data->image, staging_handle, staging_offset, command_buffer);
 
-    // Transition from optimal for data receipt to shader-read-only optimal layout.
-    vulkan_image_transition_layout(
-        &context,
-        &temp_buffer,
-        &data->image,
-        image_format,
-        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
-    );
+    if(mip_levels > 1)
+    {
+        // Blit the rest of the chain down from the pixels just copied, which leaves it shader-read-only optimal.
+        vulkan_image_generate_mips(&context, &data->image, command_buffer);
+    }
+    else
+    {
+        // Transition from optimal for data receipt to shader-read-only optimal layout.
+        vulkan_image_transition_layout(
+            &context,
+            command_buffer,
+            &data->image,
+            image_format,
+            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+        );
+    }
 
-    vulkan_command_buffer_end_single_use(&context, pool, &temp_buffer, queue);
-
-    vulkan_buffer_destroy(&context, &staging_buffer);
-
-    // Create a sampler for the texture
-    VkSamplerCreateInfo sampler_info = {VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO};
-    // TODO: These filters should be configurable.
-    sampler_info.magFilter = VK_FILTER_LINEAR;
-    sampler_info.minFilter = VK_FILTER_LINEAR;
-    sampler_info.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-    sampler_info.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-    sampler_info.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-    sampler_info.anisotropyEnable = VK_TRUE;
-    sampler_info.maxAnisotropy = 16;
-    sampler_info.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
-    sampler_info.unnormalizedCoordinates = VK_FALSE;
-    sampler_info.compareEnable = VK_FALSE;
-    sampler_info.compareOp = VK_COMPARE_OP_ALWAYS;
-    sampler_info.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
-    sampler_info.mipLodBias = 0.0f;
-    sampler_info.minLod = 0.0f;
-    sampler_info.maxLod = 0.0f;
-
-    VkResult result = vkCreateSampler(context.device.logical_device, &sampler_info, context.allocator, &data->sampler);
-    if(!vulkan_result_is_success(VK_SUCCESS)) 
-    {
-        KERROR("Error creating texture sampler: %s", vulkan_result_string(result, true));
+    if(!batched)
+    {
+        vulkan_command_buffer_end_single_use(&context, pool, &temp_buffer, queue);
+        vulkan_buffer_destroy(&context, &staging_buffer);
+    }
+
+    // Textures with the same sampler parameters share a sampler.
+    if(!vulkan_sampler_cache_acquire(&context, &context.sampler_cache, sampler, &data->sampler))
+    {
         return;
     }
 
@@ -748,7 +858,8 @@ void vulkan_renderer_create_texture(const char* name, i32 width, i32 height, i32
 
 void vulkan_renderer_destroy_texture(texture* texture)
 {
-    // Make sure that texture is not in use
+    // Make sure that texture is not in use, including by an upload which has not been submitted yet.
+    vulkan_staging_ring_flush(&context, &context.staging);
     vkDeviceWaitIdle(context.device.logical_device);
 
     vulkan_texture_data* data = (vulkan_texture_data*)texture->internal_data;
@@ -758,15 +869,92 @@ void vulkan_renderer_destroy_texture(texture* texture)
         // Vulkan-side destruction
         vulkan_image_destroy(&context, &data->image);
         kzero_memory(&data->image, sizeof(vulkan_image));
-        vkDestroySampler(context.device.logical_device, data->sampler, context.allocator);
+        // The sampler belongs to the sampler cache.
         data->sampler = 0;
         // Host-side destruction
-        kfree(texture->internal_data, sizeof(vulkan_texture_data), MEMORY_TAG_TEXTURE);
+        pool_allocator_free(&context.texture_data_pool, texture->internal_data);
     }
 
     kzero_memory(texture, sizeof(struct texture));
 }
 
+b8 vulkan_renderer_backend_is_supported()
+{
+    VkApplicationInfo app_info = {VK_STRUCTURE_TYPE_APPLICATION_INFO};
+    app_info.apiVersion = VK_API_VERSION_1_2;
+    app_info.pEngineName = "KoEngine";
+
+    VkInstanceCreateInfo create_info = {VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO};
+    create_info.pApplicationInfo = &app_info;
+
+#if defined(_DEBUG)
+    // Initialization fails without the validation layer on non-release builds, so require it here as well.
+    const char* validation_layer_name = "VK_LAYER_KHRONOS_validation";
+    u32 available_layer_count = 0;
+    if(vkEnumerateInstanceLayerProperties(&available_layer_count, 0) != VK_SUCCESS || available_layer_count == 0)
+    {
+        return false;
+    }
+    VkLayerProperties* available_layers = darray_reserve(VkLayerProperties, available_layer_count);
+    vkEnumerateInstanceLayerProperties(&available_layer_count, available_layers);
+    b8 found = false;
+    for(u32 i = 0; i < available_layer_count; ++i)
+    {
+        if(strings_equal(validation_layer_name, available_layers[i].layerName))
+        {
+            found = true;
+            break;
+        }
+    }
+    darray_destroy(available_layers);
+    if(!found)
+    {
+        return false;
+    }
+    create_info.enabledLayerCount = 1;
+    create_info.ppEnabledLayerNames = &validation_layer_name;
+#endif
+
+    // Unlike initialization, a missing driver is not fatal here.
+    VkInstance instance;
+    if(vkCreateInstance(&create_info, 0, &instance) != VK_SUCCESS)
+    {
+        return false;
+    }
+
+    u32 physical_device_count = 0;
+    VkResult result = vkEnumeratePhysicalDevices(instance, &physical_device_count, 0);
+    vkDestroyInstance(instance, 0);
+
+    return result == VK_SUCCESS && physical_device_count > 0;
+}
+
+b8 vulkan_renderer_read_last_frame(renderer_backend* backend, u32* out_width, u32* out_height, u8* out_pixels)
+{
+    vulkan_swapchain* swapchain = &context.swapchain;
+    if(!context.readback || swapchain->last_image_index == INVALID_ID)
+    {
+        return false;
+    }
+
+    u32 index = swapchain->last_image_index;
+    *out_width = swapchain->offscreen_images[index].width;
+    *out_height = swapchain->offscreen_images[index].height;
+    if(!out_pixels)
+    {
+        return true;
+    }
+
+    // Wait for the frame which rendered to the image. Its copy to the readback buffer is part of the same submission.
+    if(context.images_in_flight[index] && !vulkan_fence_wait(&context, context.images_in_flight[index], UINT64_MAX))
+    {
+        KWARN("vulkan_renderer_read_last_frame - failed waiting for the frame to complete.");
+        return false;
+    }
+
+    return vulkan_swapchain_read_image(&context, swapchain, index, out_pixels);
+}
+
 VKAPI_ATTR VkBool32 VKAPI_CALL vk_debug_callback
 (
     VkDebugUtilsMessageSeverityFlagBitsEXT message_severity,
@@ -897,10 +1085,13 @@ b8 recreate_swapchain(renderer_backend* backend)
     }
 
     // Requery support
-    vulkan_device_query_swapchain_support(
-        context.device.physical_device,
-        context.surface,
-        &context.device.swapchain_support);
+    if(!context.offscreen)
+    {
+        vulkan_device_query_swapchain_support(
+            context.device.physical_device,
+            context.surface,
+            &context.device.swapchain_support);
+    }
         
     vulkan_device_detect_depth_format(&context.device);
 
@@ -14,5 +14,9 @@ b8 vulkan_renderer_backend_end_frame(renderer_backend* backend, f32 delta_time);
 
 void vulkan_renderer_update_object(geometry_render_data data);
 
-void vulkan_renderer_create_texture(const char* name, i32 width, i32 height, i32 channel_count, const u8* pixels, b8 has_transparency, texture* out_texture);
-void vulkan_renderer_destroy_texture(texture* texture);
\ No newline at end of file
+void vulkan_renderer_create_texture(const char* name, i32 width, i32 height, i32 channel_count, const u8* pixels, b8 has_transparency, const texture_sampler_params* sampler, texture* out_texture);
+void vulkan_renderer_destroy_texture(texture* texture);
+
+b8 vulkan_renderer_backend_is_supported();
+
+b8 vulkan_renderer_read_last_frame(renderer_backend* backend, u32* out_width, u32* out_height, u8* out_pixels);
\ No newline at end of file
@@ -3,6 +3,7 @@
 #include "vulkan_device.h"
 #include "vulkan_command_buffer.h"
 #include "vulkan_utils.h"
+#include "vulkan_memory.h"
 
 #include "core/logger.h"
 #include "core/kmemory.h"
@@ -42,22 +43,10 @@ b8 vulkan_buffer_create
         return false;
     }
 
-    // Allocate memory info
-    VkMemoryAllocateInfo allocate_info = {VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO};
-    allocate_info.allocationSize = requirements.size;
-    allocate_info.memoryTypeIndex = (u32)out_buffer->memory_index;
-
-    // Allocate the memory
-    VkResult result = vkAllocateMemory(
-        context->device.logical_device,
-        &allocate_info,
-        context->allocator,
-        &out_buffer->memory
-    );
-
-    if(result != VK_SUCCESS)
+    // Sub-allocate the memory from one of the device memory blocks.
+    if(!vulkan_memory_allocate(context, &context->memory_allocator, &requirements, out_buffer->memory_property_flags, false, &out_buffer->allocation))
     {
-        KERROR("Unable to create the vulkan buffer because the required memory allocation failed. Error: %i", result);
+        KERROR("Unable to create the vulkan buffer because the required memory allocation failed.");
         return false;
     }
 
@@ -71,11 +60,7 @@ b8 vulkan_buffer_create
 
 void vulkan_buffer_destroy(vulkan_context* context, vulkan_buffer* buffer)
 {
-    if(buffer->memory)
-    {
-        vkFreeMemory(context->device.logical_device, buffer->memory, context->allocator);
-        buffer->memory = 0;
-    }
+    vulkan_memory_free(context, &context->memory_allocator, &buffer->allocation);
 
     if(buffer->handle)
     {
@@ -111,23 +96,18 @@ b8 vulkan_buffer_resize
     VkMemoryRequirements requirements;
     vkGetBufferMemoryRequirements(context->device.logical_device, new_buffer, &requirements);
 
-    // Allocate memory info
-    VkMemoryAllocateInfo allocate_info = {VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO};
-    allocate_info.allocationSize = requirements.size;
-    allocate_info.memoryTypeIndex = (u32)buffer->memory_index;
-
     // Allocate the memory.
-    VkDeviceMemory new_memory;
-    VkResult result = vkAllocateMemory(context->device.logical_device, &allocate_info, context->allocator, &new_memory);
-    if(result != VK_SUCCESS) 
+    vulkan_allocation new_allocation;
+    if(!vulkan_memory_allocate(context, &context->memory_allocator, &requirements, buffer->memory_property_flags, false, &new_allocation))
     {
-        KERROR("Unable to resize vulkan buffer because the required memory allocation failed. Error: %i", result);
+        KERROR("Unable to resize vulkan buffer because the required memory allocation failed.");
+        vkDestroyBuffer(context->device.logical_device, new_buffer, context->allocator);
         return false;
     }
 
     // Copy the previous content to the new buffer
     // To work on the new buffer, bind it.
-    VK_CHECK(vkBindBufferMemory(context->device.logical_device, new_buffer, new_memory, 0));
+    VK_CHECK(vkBindBufferMemory(context->device.logical_device, new_buffer, new_allocation.memory, new_allocation.offset));
 
     // Copy
     vulkan_buffer_copy_to(context, pool, 0, queue, buffer->handle, 0, new_buffer, 0, buffer->total_size);
@@ -136,11 +116,7 @@ b8 vulkan_buffer_resize
     vkDeviceWaitIdle(context->device.logical_device);
 
     // Destroy the old buffer
-    if(buffer->memory) 
-    {
-        vkFreeMemory(context->device.logical_device, buffer->memory, context->allocator);
-        buffer->memory = 0;
-    }
+    vulkan_memory_free(context, &context->memory_allocator, &buffer->allocation);
 
     if(buffer->handle) 
     {
@@ -151,7 +127,7 @@ b8 vulkan_buffer_resize
     // Set new properties
     buffer->total_size = new_size;
     buffer->handle = new_buffer;
-    buffer->memory = new_memory;
+    buffer->allocation = new_allocation;
 
     return true;
     
@@ -159,27 +135,35 @@ b8 vulkan_buffer_resize
 
 void vulkan_buffer_bind(vulkan_context* context, vulkan_buffer* buffer, u64 offset) 
 {
-    VK_CHECK(vkBindBufferMemory(context->device.logical_device, buffer->handle, buffer->memory, offset));
+    VK_CHECK(vkBindBufferMemory(context->device.logical_device, buffer->handle, buffer->allocation.memory, buffer->allocation.offset + offset));
 }
 
 void* vulkan_buffer_lock_memory(vulkan_context* context, vulkan_buffer* buffer, u64 offset, u64 size, u32 flags) 
 {
-    void* data;
-    VK_CHECK(vkMapMemory(context->device.logical_device, buffer->memory, offset, size, flags, &data));
-    return data;
+    // Host-visible memory is mapped persistently by the allocator, so locking is just pointer arithmetic.
+    if(!buffer->allocation.mapped)
+    {
+        KERROR("vulkan_buffer_lock_memory - buffer memory is not host visible.");
+        return 0;
+    }
+
+    buffer->is_locked = true;
+    return (u8*)buffer->allocation.mapped + offset;
 }
 
 void vulkan_buffer_unlock_memory(vulkan_context* context, vulkan_buffer* buffer) 
 {
-    vkUnmapMemory(context->device.logical_device, buffer->memory);
+    buffer->is_locked = false;
 }
 
 void vulkan_buffer_load_data(vulkan_context* context, vulkan_buffer* buffer, u64 offset, u64 size, u32 flags, const void* data) 
 {
-    void* data_ptr;
-    VK_CHECK(vkMapMemory(context->device.logical_device, buffer->memory, offset, size, flags, &data_ptr));
-    kcopy_memory(data_ptr, data, size);
-    vkUnmapMemory(context->device.logical_device, buffer->memory);
+    void* data_ptr = vulkan_buffer_lock_memory(context, buffer, offset, size, flags);
+    if(data_ptr)
+    {
+        kcopy_memory(data_ptr, data, size);
+        vulkan_buffer_unlock_memory(context, buffer);
+    }
 }
 
 void vulkan_buffer_copy_to
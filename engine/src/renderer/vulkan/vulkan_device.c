@@ -105,6 +105,12 @@ b8 vulkan_device_create(vulkan_context* context)
     device_create_info.enabledExtensionCount = 1;
     const char* extension_names = VK_KHR_SWAPCHAIN_EXTENSION_NAME;
     device_create_info.ppEnabledExtensionNames = &extension_names;
+    if(context->offscreen)
+    {
+        // Nothing is presented, so the swapchain extension is not needed.
+        device_create_info.enabledExtensionCount = 0;
+        device_create_info.ppEnabledExtensionNames = 0;
+    }
 
     // Deprecated and ignored, so pass nothing.
     device_create_info.enabledLayerCount = 0;
@@ -322,6 +328,15 @@ b8 select_physical_device(vulkan_context* context)
         requirements.device_extension_names = darray_create(const char*);
         darray_push(requirements.device_extension_names, &VK_KHR_SWAPCHAIN_EXTENSION_NAME);
 
+        // Offscreen needs no presentation, and should run on any device including CPU implementations
+        // such as lavapipe.
+        if(context->offscreen)
+        {
+            requirements.present = false;
+            requirements.discrete_gpu = false;
+            darray_clear(requirements.device_extension_names);
+        }
+
         vulkan_physical_device_queue_family_info queue_info = {};
         b8 result = physical_device_meets_requirements(
             physical_devices[i],
@@ -389,6 +404,11 @@ b8 select_physical_device(vulkan_context* context)
             context->device.physical_device = physical_devices[i];
             context->device.graphics_queue_index = queue_info.graphics_family_index;
             context->device.present_queue_index = queue_info.present_family_index;
+            if(context->offscreen)
+            {
+                // Nothing is presented. Alias the graphics queue so no extra queue is created.
+                context->device.present_queue_index = queue_info.graphics_family_index;
+            }
             context->device.transfer_queue_index = queue_info.transfer_family_index;
             // NOTE: set compute index here if needed.
 
@@ -479,9 +499,12 @@ b8 physical_device_meets_requirements
             }
         }
 
-        // Present queue?
+        // Present queue? Only if there is a surface to present to.
         VkBool32 supports_present = VK_FALSE;
-        VK_CHECK(vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &supports_present));
+        if(surface)
+        {
+            VK_CHECK(vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &supports_present));
+        }
         if (supports_present) 
         {
             out_queue_info->present_family_index = i;
@@ -512,10 +535,13 @@ b8 physical_device_meets_requirements
         KTRACE("Transfer Family Index: %i", out_queue_info->transfer_family_index);
         KTRACE("Compute Family Index:  %i", out_queue_info->compute_family_index);
 
-        // Query swapchain support.
-        vulkan_device_query_swapchain_support(device, surface, out_swapchain_support);
+        // Query swapchain support. Without a surface there is no swapchain to support.
+        if(surface)
+        {
+            vulkan_device_query_swapchain_support(device, surface, out_swapchain_support);
+        }
         // Check swapchain requirements
-        if (out_swapchain_support->format_count < 1 || out_swapchain_support->present_mode_count < 1) 
+        if (surface && (out_swapchain_support->format_count < 1 || out_swapchain_support->present_mode_count < 1)) 
         {
             if (out_swapchain_support->formats) 
             {
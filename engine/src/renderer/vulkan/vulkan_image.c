@@ -1,6 +1,7 @@
 #include "vulkan_image.h"
 
 #include "vulkan_device.h"
+#include "vulkan_memory.h"
 
 #include "core/kmemory.h"
 #include "core/logger.h"
@@ -12,6 +13,7 @@ void vulkan_image_create
     VkImageType image_type,
     u32 width,
     u32 height,
+    u32 mip_levels,
     VkFormat format,
     VkImageTiling tiling,
     VkImageUsageFlags usage,
@@ -24,6 +26,7 @@ void vulkan_image_create
     // Copy params
     out_image->width = width;
     out_image->height = height;
+    out_image->mip_levels = mip_levels;
 
     // Creation info.
     VkImageCreateInfo image_create_info = {VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO};
@@ -31,7 +34,7 @@ void vulkan_image_create
     image_create_info.extent.width = width;
     image_create_info.extent.height = height;
     image_create_info.extent.depth = 1;  // TODO: Support configurable depth.
-    image_create_info.mipLevels = 4;     // TODO: Support mip mapping
+    image_create_info.mipLevels = mip_levels;
     image_create_info.arrayLayers = 1;   // TODO: Support number of layers in the image.
     image_create_info.format = format;
     image_create_info.tiling = tiling;
@@ -46,20 +49,15 @@ void vulkan_image_create
     VkMemoryRequirements memory_requirements;
     vkGetImageMemoryRequirements(context->device.logical_device, out_image->handle, &memory_requirements);
 
-    i32 memory_type = context->find_memory_index(memory_requirements.memoryTypeBits, memory_flags);
-    if(memory_type == -1)
+    // Allocate memory. Optimal-tiling images are kept apart from buffers to respect bufferImageGranularity.
+    b8 optimal = tiling == VK_IMAGE_TILING_OPTIMAL;
+    if(!vulkan_memory_allocate(context, &context->memory_allocator, &memory_requirements, memory_flags, optimal, &out_image->allocation))
     {
-        KERROR("Required memory type not found. Image is not valid.");
+        KERROR("Required memory could not be allocated. Image is not valid.");
     }
 
-    // Allocate memory
-    VkMemoryAllocateInfo memory_allocate_info = {VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO};
-    memory_allocate_info.allocationSize = memory_requirements.size;
-    memory_allocate_info.memoryTypeIndex = memory_type;
-    VK_CHECK(vkAllocateMemory(context->device.logical_device, &memory_allocate_info, context->allocator, &out_image->memory));
-
     // To do any operations with this memory, it first should be bound.
-    VK_CHECK(vkBindImageMemory(context->device.logical_device, out_image->handle, out_image->memory, 0)); // TODO: configurable memory offset
+    VK_CHECK(vkBindImageMemory(context->device.logical_device, out_image->handle, out_image->allocation.memory, out_image->allocation.offset));
 
     // Create view
     if(create_view)
@@ -86,7 +84,7 @@ void vulkan_image_view_create
 
     // TODO: Make configurable
     view_create_info.subresourceRange.baseMipLevel = 0;
-    view_create_info.subresourceRange.levelCount = 1;
+    view_create_info.subresourceRange.levelCount = image->mip_levels;
     view_create_info.subresourceRange.baseArrayLayer = 0;
     view_create_info.subresourceRange.layerCount = 1;
 
@@ -111,7 +109,7 @@ void vulkan_image_transition_layout
     barrier.image = image->handle;
     barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
     barrier.subresourceRange.baseMipLevel = 0;
-    barrier.subresourceRange.levelCount = 1;
+    barrier.subresourceRange.levelCount = image->mip_levels;
     barrier.subresourceRange.baseArrayLayer = 0;
     barrier.subresourceRange.layerCount = 1;
 
@@ -167,13 +165,14 @@ void vulkan_image_copy_from_buffer
     vulkan_context* context,
     vulkan_image* image,
     VkBuffer buffer,
+    u64 buffer_offset,
     vulkan_command_buffer* command_buffer
 )
 {
     // Region to copy
     VkBufferImageCopy region;
     kzero_memory(&region, sizeof(VkBufferImageCopy));
-    region.bufferOffset = 0; // Offset in bytes from the start of the buffer object where the image data is copied from.
+    region.bufferOffset = buffer_offset; // Offset in bytes from the start of the buffer object where the image data is copied from.
     // if either of those 2 is zero that means the buffer memory is considered to be tighty packed according to image extent
     region.bufferRowLength = 0;
     region.bufferImageHeight = 0;
@@ -197,6 +196,86 @@ void vulkan_image_copy_from_buffer
     );
 }
 
+b8 vulkan_image_can_generate_mips(vulkan_context* context, VkFormat format)
+{
+    // Blitting with a linear filter needs both to be supported for optimal tiling.
+    VkFormatProperties properties;
+    vkGetPhysicalDeviceFormatProperties(context->device.physical_device, format, &properties);
+    VkFormatFeatureFlags required = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+    return (properties.optimalTilingFeatures & required) == required;
+}
+
+void vulkan_image_generate_mips
+(
+    vulkan_context* context,
+    vulkan_image* image,
+    vulkan_command_buffer* command_buffer
+)
+{
+    VkImageMemoryBarrier barrier = {VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER};
+    barrier.srcQueueFamilyIndex = context->device.graphics_queue_index;
+    barrier.dstQueueFamilyIndex = context->device.graphics_queue_index;
+    barrier.image = image->handle;
+    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.levelCount = 1;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount = 1;
+
+    i32 width = image->width;
+    i32 height = image->height;
+    for(u32 level = 1; level < image->mip_levels; ++level)
+    {
+        // Wait for the level above to be written, then read from it.
+        barrier.subresourceRange.baseMipLevel = level - 1;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+        vkCmdPipelineBarrier(command_buffer->handle, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, 0, 0, 0, 1, &barrier);
+
+        i32 next_width = width > 1 ? width / 2 : 1;
+        i32 next_height = height > 1 ? height / 2 : 1;
+
+        VkImageBlit blit = {};
+        blit.srcOffsets[1].x = width;
+        blit.srcOffsets[1].y = height;
+        blit.srcOffsets[1].z = 1;
+        blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        blit.srcSubresource.mipLevel = level - 1;
+        blit.srcSubresource.layerCount = 1;
+        blit.dstOffsets[1].x = next_width;
+        blit.dstOffsets[1].y = next_height;
+        blit.dstOffsets[1].z = 1;
+        blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        blit.dstSubresource.mipLevel = level;
+        blit.dstSubresource.layerCount = 1;
+        vkCmdBlitImage(
+            command_buffer->handle,
+            image->handle, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+            image->handle, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            1, &blit,
+            VK_FILTER_LINEAR
+        );
+
+        // The level above is done with, so hand it to the fragment shader.
+        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        vkCmdPipelineBarrier(command_buffer->handle, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, 0, 0, 0, 1, &barrier);
+
+        width = next_width;
+        height = next_height;
+    }
+
+    // The last level was only ever written.
+    barrier.subresourceRange.baseMipLevel = image->mip_levels - 1;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    vkCmdPipelineBarrier(command_buffer->handle, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, 0, 0, 0, 1, &barrier);
+}
 
 void vulkan_image_destroy(vulkan_context* context, vulkan_image* image)
 {
@@ -206,11 +285,7 @@ void vulkan_image_destroy(vulkan_context* context, vulkan_image* image)
         image->view = 0;
     }
 
-    if (image->memory) 
-    {
-        vkFreeMemory(context->device.logical_device, image->memory, context->allocator);
-        image->memory = 0;
-    }
+    vulkan_memory_free(context, &context->memory_allocator, &image->allocation);
     
     if (image->handle) 
     {
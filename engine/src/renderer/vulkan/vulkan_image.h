@@ -8,6 +8,7 @@ void vulkan_image_create
     VkImageType image_type,
     u32 width,
     u32 height,
+    u32 mip_levels,
     VkFormat format,
     VkImageTiling tiling,
     VkImageUsageFlags usage,
@@ -26,7 +27,7 @@ void vulkan_image_view_create
 );
 
 /**
- * Transitions the provided image from old_layout to new_layout.
+ * Transitions every mip level of the provided image from old_layout to new_layout.
  */
 void vulkan_image_transition_layout
 (
@@ -43,13 +44,36 @@ void vulkan_image_transition_layout
  * @param context The Vulkan context.
  * @param image The image to copy the buffer's data to.
  * @param buffer The buffer whose data will be copied.
+ * @param buffer_offset The offset in bytes of the image data within the buffer.
+ * @param command_buffer The command buffer to record the copy into.
  */
 void vulkan_image_copy_from_buffer
 (
     vulkan_context* context,
     vulkan_image* image,
     VkBuffer buffer,
+    u64 buffer_offset,
     vulkan_command_buffer* command_buffer
 );
 
+/**
+ * Fills mip levels 1 and up by blitting each level down from the one before it. Level 0 must hold the
+ * image's pixels, with every level in VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL. Every level is left in
+ * VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL.
+ * @param context The Vulkan context.
+ * @param image The image to generate mips for.
+ * @param command_buffer The command buffer to record the blits into.
+ */
+void vulkan_image_generate_mips
+(
+    vulkan_context* context,
+    vulkan_image* image,
+    vulkan_command_buffer* command_buffer
+);
+
+/**
+ * Indicates if mips of the given format can be generated by vulkan_image_generate_mips.
+ */
+b8 vulkan_image_can_generate_mips(vulkan_context* context, VkFormat format);
+
 void vulkan_image_destroy(vulkan_context* context, vulkan_image* image);
\ No newline at end of file
@@ -0,0 +1,426 @@
+#include "vulkan_memory.h"
+
+#include "vulkan_utils.h"
+
+#include "core/logger.h"
+#include "core/kmemory.h"
+#include "containers/darray.h"
+
+// Initial capacity of a block's free range array. It grows by doubling when fragmented.
+#define FREE_RANGE_INITIAL_CAPACITY 16
+
+KINLINE u64 align_up(u64 value, u64 alignment)
+{
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+KINLINE b8 is_host_visible(vulkan_context* context, u32 memory_type_index)
+{
+    return (context->device.memory.memoryTypes[memory_type_index].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) != 0;
+}
+
+// Small heaps (such as host-visible device local memory) get proportionally smaller blocks.
+static u64 block_size_for_type(vulkan_context* context, vulkan_memory_allocator* allocator, u32 memory_type_index)
+{
+    u32 heap_index = context->device.memory.memoryTypes[memory_type_index].heapIndex;
+    u64 heap_size = context->device.memory.memoryHeaps[heap_index].size;
+    u64 size = allocator->block_size;
+    if(heap_size / 8 < size)
+    {
+        size = align_up(heap_size / 8, 256);
+    }
+    return size;
+}
+
+static void insert_range(vulkan_memory_block* block, u32 index, u64 offset, u64 size)
+{
+    if(block->free_range_count == block->free_range_capacity)
+    {
+        u32 new_capacity = block->free_range_capacity * 2;
+        vulkan_memory_range* ranges = kallocate(sizeof(vulkan_memory_range) * new_capacity, MEMORY_TAG_RENDERER);
+        kcopy_memory(ranges, block->free_ranges, sizeof(vulkan_memory_range) * block->free_range_count);
+        kfree(block->free_ranges, sizeof(vulkan_memory_range) * block->free_range_capacity, MEMORY_TAG_RENDERER);
+        block->free_ranges = ranges;
+        block->free_range_capacity = new_capacity;
+    }
+
+    for(u32 i = block->free_range_count; i > index; --i)
+    {
+        block->free_ranges[i] = block->free_ranges[i - 1];
+    }
+    block->free_ranges[index].offset = offset;
+    block->free_ranges[index].size = size;
+    block->free_range_count++;
+}
+
+static void remove_range(vulkan_memory_block* block, u32 index)
+{
+    for(u32 i = index; i + 1 < block->free_range_count; ++i)
+    {
+        block->free_ranges[i] = block->free_ranges[i + 1];
+    }
+    block->free_range_count--;
+}
+
+/**
+ * First-fit search of the block's free ranges. Padding in front of the aligned offset stays free.
+ */
+static b8 block_allocate(vulkan_memory_block* block, u64 size, u64 alignment, u64* out_offset)
+{
+    if(block->size - block->used < size)
+    {
+        return false;
+    }
+
+    for(u32 i = 0; i < block->free_range_count; ++i)
+    {
+        vulkan_memory_range* range = &block->free_ranges[i];
+        u64 start = align_up(range->offset, alignment);
+        u64 range_end = range->offset + range->size;
+        if(start + size > range_end)
+        {
+            continue;
+        }
+
+        u64 padding = start - range->offset;
+        u64 remainder = range_end - (start + size);
+        if(padding > 0 && remainder > 0)
+        {
+            range->size = padding;
+            insert_range(block, i + 1, start + size, remainder);
+        }
+        else if(padding > 0)
+        {
+            range->size = padding;
+        }
+        else if(remainder > 0)
+        {
+            range->offset = start + size;
+            range->size = remainder;
+        }
+        else
+        {
+            remove_range(block, i);
+        }
+
+        block->used += size;
+        block->allocation_count++;
+        *out_offset = start;
+        return true;
+    }
+
+    return false;
+}
+
+/**
+ * Returns a range to the block, merging it with the free ranges on either side.
+ */
+static void block_free(vulkan_memory_block* block, u64 offset, u64 size)
+{
+    u32 index = 0;
+    while(index < block->free_range_count && block->free_ranges[index].offset < offset)
+    {
+        index++;
+    }
+
+    b8 merge_prev = index > 0 && block->free_ranges[index - 1].offset + block->free_ranges[index - 1].size == offset;
+    b8 merge_next = index < block->free_range_count && offset + size == block->free_ranges[index].offset;
+
+    if(merge_prev && merge_next)
+    {
+        block->free_ranges[index - 1].size += size + block->free_ranges[index].size;
+        remove_range(block, index);
+    }
+    else if(merge_prev)
+    {
+        block->free_ranges[index - 1].size += size;
+    }
+    else if(merge_next)
+    {
+        block->free_ranges[index].offset = offset;
+        block->free_ranges[index].size += size;
+    }
+    else
+    {
+        insert_range(block, index, offset, size);
+    }
+
+    block->used -= size;
+    block->allocation_count--;
+}
+
+static void release_block(vulkan_context* context, vulkan_memory_block* block)
+{
+    // Freeing the memory implicitly unmaps it.
+    vkFreeMemory(context->device.logical_device, block->memory, context->allocator);
+    kfree(block->free_ranges, sizeof(vulkan_memory_range) * block->free_range_capacity, MEMORY_TAG_RENDERER);
+    kzero_memory(block, sizeof(vulkan_memory_block));
+}
+
+static b8 allocate_device_memory(vulkan_context* context, u64 size, u32 memory_type_index, VkDeviceMemory* out_memory, void** out_mapped)
+{
+    VkMemoryAllocateInfo allocate_info = {VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO};
+    allocate_info.allocationSize = size;
+    allocate_info.memoryTypeIndex = memory_type_index;
+
+    VkResult result = vkAllocateMemory(context->device.logical_device, &allocate_info, context->allocator, out_memory);
+    if(result != VK_SUCCESS)
+    {
+        KERROR("vkAllocateMemory of %lluB failed with '%s'.", size, vulkan_result_string(result, true));
+        return false;
+    }
+
+    *out_mapped = 0;
+    if(is_host_visible(context, memory_type_index))
+    {
+        // Host-visible memory stays mapped for its whole lifetime, since it can only be mapped once.
+        VK_CHECK(vkMapMemory(context->device.logical_device, *out_memory, 0, VK_WHOLE_SIZE, 0, out_mapped));
+    }
+
+    return true;
+}
+
+static vulkan_memory_block* create_block(vulkan_context* context, vulkan_memory_allocator* allocator, u32 memory_type_index, b8 optimal, u32* out_index)
+{
+    u64 size = block_size_for_type(context, allocator, memory_type_index);
+
+    vulkan_memory_block new_block = {};
+    if(!allocate_device_memory(context, size, memory_type_index, &new_block.memory, &new_block.mapped))
+    {
+        return 0;
+    }
+
+    new_block.size = size;
+    new_block.memory_type_index = memory_type_index;
+    new_block.optimal = optimal;
+    new_block.free_range_capacity = FREE_RANGE_INITIAL_CAPACITY;
+    new_block.free_ranges = kallocate(sizeof(vulkan_memory_range) * FREE_RANGE_INITIAL_CAPACITY, MEMORY_TAG_RENDERER);
+    new_block.free_ranges[0].offset = 0;
+    new_block.free_ranges[0].size = size;
+    new_block.free_range_count = 1;
+
+    // Reuse the slot of a released block if there is one.
+    u32 length = (u32)darray_length(allocator->blocks);
+    for(u32 i = 0; i < length; ++i)
+    {
+        if(!allocator->blocks[i].memory)
+        {
+            allocator->blocks[i] = new_block;
+            *out_index = i;
+            return &allocator->blocks[i];
+        }
+    }
+
+    darray_push(allocator->blocks, new_block);
+    *out_index = length;
+    return &allocator->blocks[length];
+}
+
+b8 vulkan_memory_allocator_create(vulkan_context* context, u64 block_size, vulkan_memory_allocator* out_allocator)
+{
+    kzero_memory(out_allocator, sizeof(vulkan_memory_allocator));
+    out_allocator->block_size = block_size;
+    out_allocator->blocks = darray_create(vulkan_memory_block);
+
+    // Most desktop GPUs report a granularity of 1, in which case buffers and images can share blocks.
+    out_allocator->separate_optimal = context->device.properties.limits.bufferImageGranularity > 1;
+
+    KDEBUG(
+        "Vulkan memory allocator created with %lluMiB blocks (bufferImageGranularity %llu, maxMemoryAllocationCount %u).",
+        block_size / (1024 * 1024),
+        (u64)context->device.properties.limits.bufferImageGranularity,
+        context->device.properties.limits.maxMemoryAllocationCount
+    );
+    return true;
+}
+
+void vulkan_memory_allocator_destroy(vulkan_context* context, vulkan_memory_allocator* allocator)
+{
+    if(!allocator->blocks)
+    {
+        return;
+    }
+
+    vulkan_memory_log_stats(context, allocator);
+
+    vulkan_memory_stats stats;
+    vulkan_memory_get_stats(allocator, &stats);
+    if(stats.allocation_count > 0)
+    {
+        KWARN("%u Vulkan memory allocations were not freed before the allocator was destroyed.", stats.allocation_count);
+    }
+
+    u32 length = (u32)darray_length(allocator->blocks);
+    for(u32 i = 0; i < length; ++i)
+    {
+        if(allocator->blocks[i].memory)
+        {
+            release_block(context, &allocator->blocks[i]);
+        }
+    }
+
+    darray_destroy(allocator->blocks);
+    kzero_memory(allocator, sizeof(vulkan_memory_allocator));
+}
+
+b8 vulkan_memory_allocate
+(
+    vulkan_context* context,
+    vulkan_memory_allocator* allocator,
+    const VkMemoryRequirements* requirements,
+    VkMemoryPropertyFlags property_flags,
+    b8 optimal_image,
+    vulkan_allocation* out_allocation
+)
+{
+    kzero_memory(out_allocation, sizeof(vulkan_allocation));
+
+    i32 memory_type = context->find_memory_index(requirements->memoryTypeBits, property_flags);
+    if(memory_type == -1)
+    {
+        KERROR("vulkan_memory_allocate - no memory type matches the required properties.");
+        return false;
+    }
+
+    u32 memory_type_index = (u32)memory_type;
+    b8 optimal = allocator->separate_optimal ? optimal_image : false;
+    u64 size = requirements->size;
+    u64 alignment = requirements->alignment ? requirements->alignment : 1;
+
+    out_allocation->memory_type_index = memory_type_index;
+    out_allocation->size = size;
+
+    // Large resources would waste most of a block, so they get their own memory.
+    if(size <= block_size_for_type(context, allocator, memory_type_index) / 2)
+    {
+        u64 offset = 0;
+        u32 block_index = INVALID_ID;
+        vulkan_memory_block* block = 0;
+
+        u32 length = (u32)darray_length(allocator->blocks);
+        for(u32 i = 0; i < length; ++i)
+        {
+            vulkan_memory_block* candidate = &allocator->blocks[i];
+            if(candidate->memory && candidate->memory_type_index == memory_type_index && candidate->optimal == optimal &&
+               block_allocate(candidate, size, alignment, &offset))
+            {
+                block = candidate;
+                block_index = i;
+                break;
+            }
+        }
+
+        if(!block)
+        {
+            block = create_block(context, allocator, memory_type_index, optimal, &block_index);
+            if(block && !block_allocate(block, size, alignment, &offset))
+            {
+                block = 0;
+            }
+        }
+
+        if(block)
+        {
+            out_allocation->memory = block->memory;
+            out_allocation->offset = offset;
+            out_allocation->mapped = block->mapped ? (u8*)block->mapped + offset : 0;
+            out_allocation->block_index = block_index;
+            return true;
+        }
+
+        // A new block could not be allocated. An exact-size allocation may still fit.
+        KWARN("vulkan_memory_allocate - unable to create a new block, trying a dedicated allocation of %lluB.", size);
+    }
+
+    if(!allocate_device_memory(context, size, memory_type_index, &out_allocation->memory, &out_allocation->mapped))
+    {
+        kzero_memory(out_allocation, sizeof(vulkan_allocation));
+        return false;
+    }
+
+    out_allocation->offset = 0;
+    out_allocation->block_index = INVALID_ID;
+    allocator->dedicated_count++;
+    allocator->dedicated_bytes += size;
+    return true;
+}
+
+void vulkan_memory_free(vulkan_context* context, vulkan_memory_allocator* allocator, vulkan_allocation* allocation)
+{
+    if(!allocation->memory)
+    {
+        return;
+    }
+
+    if(allocation->block_index == INVALID_ID)
+    {
+        vkFreeMemory(context->device.logical_device, allocation->memory, context->allocator);
+        allocator->dedicated_count--;
+        allocator->dedicated_bytes -= allocation->size;
+        kzero_memory(allocation, sizeof(vulkan_allocation));
+        return;
+    }
+
+    vulkan_memory_block* block = &allocator->blocks[allocation->block_index];
+    block_free(block, allocation->offset, allocation->size);
+
+    if(block->allocation_count == 0)
+    {
+        // Keep a single empty block of each kind around so that create/destroy cycles don't reach the driver.
+        u32 length = (u32)darray_length(allocator->blocks);
+        for(u32 i = 0; i < length; ++i)
+        {
+            vulkan_memory_block* other = &allocator->blocks[i];
+            if(i != allocation->block_index && other->memory && other->allocation_count == 0 &&
+               other->memory_type_index == block->memory_type_index && other->optimal == block->optimal)
+            {
+                release_block(context, block);
+                break;
+            }
+        }
+    }
+
+    kzero_memory(allocation, sizeof(vulkan_allocation));
+}
+
+void vulkan_memory_get_stats(const vulkan_memory_allocator* allocator, vulkan_memory_stats* out_stats)
+{
+    kzero_memory(out_stats, sizeof(vulkan_memory_stats));
+    out_stats->dedicated_count = allocator->dedicated_count;
+    out_stats->allocation_count = allocator->dedicated_count;
+    out_stats->reserved_bytes = allocator->dedicated_bytes;
+    out_stats->used_bytes = allocator->dedicated_bytes;
+
+    u32 length = allocator->blocks ? (u32)darray_length(allocator->blocks) : 0;
+    for(u32 i = 0; i < length; ++i)
+    {
+        const vulkan_memory_block* block = &allocator->blocks[i];
+        if(block->memory)
+        {
+            out_stats->block_count++;
+            out_stats->allocation_count += block->allocation_count;
+            out_stats->reserved_bytes += block->size;
+            out_stats->used_bytes += block->used;
+        }
+    }
+
+    out_stats->device_allocation_count = out_stats->block_count + out_stats->dedicated_count;
+}
+
+void vulkan_memory_log_stats(vulkan_context* context, const vulkan_memory_allocator* allocator)
+{
+    vulkan_memory_stats stats;
+    vulkan_memory_get_stats(allocator, &stats);
+
+    const f32 mib = 1024.0f * 1024.0f;
+    KINFO(
+        "Vulkan memory: %u resources in %u device allocations (%u blocks, %u dedicated, driver limit %u). %.2fMiB used of %.2fMiB reserved.",
+        stats.allocation_count,
+        stats.device_allocation_count,
+        stats.block_count,
+        stats.dedicated_count,
+        context->device.properties.limits.maxMemoryAllocationCount,
+        stats.used_bytes / mib,
+        stats.reserved_bytes / mib
+    );
+}
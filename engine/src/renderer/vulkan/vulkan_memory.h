@@ -0,0 +1,52 @@
+#pragma once
+
+#include "vulkan_types.h"
+
+/**
+ * Creates the device memory allocator. Must be called after the logical device is created.
+ * @param context The Vulkan context.
+ * @param block_size The size of each memory block. Allocations larger than half of this get their own VkDeviceMemory.
+ * @param out_allocator A pointer to hold the allocator.
+ * @return True on success; otherwise false.
+ */
+b8 vulkan_memory_allocator_create(vulkan_context* context, u64 block_size, vulkan_memory_allocator* out_allocator);
+
+/**
+ * Releases every block. All buffers and images should have been destroyed beforehand.
+ */
+void vulkan_memory_allocator_destroy(vulkan_context* context, vulkan_memory_allocator* allocator);
+
+/**
+ * Obtains device memory satisfying the given requirements.
+ * @param context The Vulkan context.
+ * @param allocator The allocator to obtain the memory from.
+ * @param requirements The memory requirements of the buffer or image.
+ * @param property_flags The required memory properties.
+ * @param optimal_image True if the memory is for an image with optimal tiling.
+ * @param out_allocation A pointer to hold the allocation.
+ * @return True on success; otherwise false.
+ */
+b8 vulkan_memory_allocate
+(
+    vulkan_context* context,
+    vulkan_memory_allocator* allocator,
+    const VkMemoryRequirements* requirements,
+    VkMemoryPropertyFlags property_flags,
+    b8 optimal_image,
+    vulkan_allocation* out_allocation
+);
+
+/**
+ * Returns an allocation to the allocator. The allocation is zeroed.
+ */
+void vulkan_memory_free(vulkan_context* context, vulkan_memory_allocator* allocator, vulkan_allocation* allocation);
+
+/**
+ * Gathers the current usage of the allocator.
+ */
+void vulkan_memory_get_stats(const vulkan_memory_allocator* allocator, vulkan_memory_stats* out_stats);
+
+/**
+ * Logs the current usage of the allocator against the driver's allocation limit.
+ */
+void vulkan_memory_log_stats(vulkan_context* context, const vulkan_memory_allocator* allocator);
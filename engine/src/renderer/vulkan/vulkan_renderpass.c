@@ -44,6 +44,11 @@ void vulkan_renderpass_create
     color_attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
     color_attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;      // Do not expect any particular layout before render pass starts.
     color_attachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;  // Transitioned to after the render pass
+    if(context->offscreen)
+    {
+        // Offscreen frames are never presented, only copied back to the host.
+        color_attachment.finalLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    }
     color_attachment.flags = 0;
 
     attachment_descriptions[0] = color_attachment;
@@ -101,14 +106,31 @@ void vulkan_renderpass_create
     dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT; // We want to read and write to it.
     dependency.dependencyFlags = 0;
 
+    // Offscreen, the image is copied from after the pass, so its color writes must finish before any transfer reads it.
+    VkSubpassDependency dependencies[2];
+    u32 dependency_count = 1;
+    dependencies[0] = dependency;
+    if(context->offscreen)
+    {
+        VkSubpassDependency readback_dependency;
+        readback_dependency.srcSubpass = 0;
+        readback_dependency.dstSubpass = VK_SUBPASS_EXTERNAL;
+        readback_dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+        readback_dependency.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+        readback_dependency.dstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+        readback_dependency.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+        readback_dependency.dependencyFlags = 0;
+        dependencies[dependency_count++] = readback_dependency;
+    }
+
     // Render pass create.
     VkRenderPassCreateInfo render_pass_create_info = {VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO};
     render_pass_create_info.attachmentCount = attachment_description_count;
     render_pass_create_info.pAttachments = attachment_descriptions;
     render_pass_create_info.subpassCount = 1;
     render_pass_create_info.pSubpasses = &subpass;
-    render_pass_create_info.dependencyCount = 1;
-    render_pass_create_info.pDependencies = &dependency;
+    render_pass_create_info.dependencyCount = dependency_count;
+    render_pass_create_info.pDependencies = dependencies;
     render_pass_create_info.pNext = 0;
     render_pass_create_info.flags = 0;
 
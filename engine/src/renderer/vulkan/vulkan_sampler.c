@@ -0,0 +1,105 @@
+#include "vulkan_sampler.h"
+
+#include "vulkan_utils.h"
+
+#include "core/logger.h"
+
+#include "containers/darray.h"
+
+static VkFilter to_vulkan_filter(texture_filter filter)
+{
+    return filter == TEXTURE_FILTER_NEAREST ? VK_FILTER_NEAREST : VK_FILTER_LINEAR;
+}
+
+static VkSamplerAddressMode to_vulkan_address_mode(texture_repeat repeat)
+{
+    switch(repeat)
+    {
+        case TEXTURE_REPEAT_MIRRORED_REPEAT:
+            return VK_SAMPLER_ADDRESS_MODE_MIRRORED_REPEAT;
+        case TEXTURE_REPEAT_CLAMP_TO_EDGE:
+            return VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        case TEXTURE_REPEAT_CLAMP_TO_BORDER:
+            return VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER;
+        case TEXTURE_REPEAT_REPEAT:
+        default:
+            return VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    }
+}
+
+// Whether a mip chain exists is up to the image, so disable_mips does not need a sampler of its own.
+static b8 same_sampler(const texture_sampler_params* a, const texture_sampler_params* b)
+{
+    return a->minify == b->minify &&
+           a->magnify == b->magnify &&
+           a->repeat_u == b->repeat_u &&
+           a->repeat_v == b->repeat_v &&
+           a->disable_anisotropy == b->disable_anisotropy;
+}
+
+void vulkan_sampler_cache_create(vulkan_sampler_cache* out_cache)
+{
+    out_cache->entries = darray_create(vulkan_sampler_cache_entry);
+}
+
+void vulkan_sampler_cache_destroy(vulkan_context* context, vulkan_sampler_cache* cache)
+{
+    if(!cache->entries)
+    {
+        return;
+    }
+
+    u64 count = darray_length(cache->entries);
+    for(u64 i = 0; i < count; ++i)
+    {
+        vkDestroySampler(context->device.logical_device, cache->entries[i].handle, context->allocator);
+    }
+    darray_destroy(cache->entries);
+    cache->entries = 0;
+}
+
+b8 vulkan_sampler_cache_acquire(vulkan_context* context, vulkan_sampler_cache* cache, const texture_sampler_params* params, VkSampler* out_sampler)
+{
+    u64 count = darray_length(cache->entries);
+    for(u64 i = 0; i < count; ++i)
+    {
+        if(same_sampler(&cache->entries[i].params, params))
+        {
+            *out_sampler = cache->entries[i].handle;
+            return true;
+        }
+    }
+
+    VkSamplerCreateInfo sampler_info = {VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO};
+    sampler_info.magFilter = to_vulkan_filter(params->magnify);
+    sampler_info.minFilter = to_vulkan_filter(params->minify);
+    sampler_info.addressModeU = to_vulkan_address_mode(params->repeat_u);
+    sampler_info.addressModeV = to_vulkan_address_mode(params->repeat_v);
+    sampler_info.addressModeW = to_vulkan_address_mode(params->repeat_u);
+    b8 anisotropic = !params->disable_anisotropy && context->device.features.samplerAnisotropy;
+    sampler_info.anisotropyEnable = anisotropic ? VK_TRUE : VK_FALSE;
+    f32 max_anisotropy = context->device.properties.limits.maxSamplerAnisotropy;
+    sampler_info.maxAnisotropy = max_anisotropy < 16.0f ? max_anisotropy : 16.0f;
+    sampler_info.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
+    sampler_info.unnormalizedCoordinates = VK_FALSE;
+    sampler_info.compareEnable = VK_FALSE;
+    sampler_info.compareOp = VK_COMPARE_OP_ALWAYS;
+    sampler_info.mipmapMode = params->minify == TEXTURE_FILTER_NEAREST ? VK_SAMPLER_MIPMAP_MODE_NEAREST : VK_SAMPLER_MIPMAP_MODE_LINEAR;
+    sampler_info.mipLodBias = 0.0f;
+    sampler_info.minLod = 0.0f;
+    // The image view limits sampling to the mips the texture has.
+    sampler_info.maxLod = VK_LOD_CLAMP_NONE;
+
+    vulkan_sampler_cache_entry entry;
+    entry.params = *params;
+    VkResult result = vkCreateSampler(context->device.logical_device, &sampler_info, context->allocator, &entry.handle);
+    if(!vulkan_result_is_success(result))
+    {
+        KERROR("Error creating texture sampler: %s", vulkan_result_string(result, true));
+        return false;
+    }
+
+    darray_push(cache->entries, entry);
+    *out_sampler = entry.handle;
+    return true;
+}
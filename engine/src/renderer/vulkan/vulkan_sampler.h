@@ -0,0 +1,24 @@
+#pragma once
+
+#include "vulkan_types.h"
+
+/**
+ * Creates an empty sampler cache.
+ */
+void vulkan_sampler_cache_create(vulkan_sampler_cache* out_cache);
+
+/**
+ * Destroys every sampler in the cache. No texture may still be using one.
+ */
+void vulkan_sampler_cache_destroy(vulkan_context* context, vulkan_sampler_cache* cache);
+
+/**
+ * Gets the sampler for the given parameters, creating it the first time they are seen. The sampler
+ * stays owned by the cache and must not be destroyed by the caller.
+ * @param context The Vulkan context.
+ * @param cache The sampler cache.
+ * @param params The sampler parameters.
+ * @param out_sampler Receives the sampler.
+ * @return True on success; otherwise false.
+ */
+b8 vulkan_sampler_cache_acquire(vulkan_context* context, vulkan_sampler_cache* cache, const texture_sampler_params* params, VkSampler* out_sampler);
@@ -4,7 +4,7 @@
 #include "core/logger.h"
 #include "core/kmemory.h"
 
-#include "platform/filesystem.h"
+#include "platform/vfs.h"
 
 b8 create_shader_module
 (
@@ -24,28 +24,16 @@ b8 create_shader_module
     kzero_memory(&shader_stages[stage_index].create_info, sizeof(VkShaderModuleCreateInfo));
     shader_stages[stage_index].create_info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
 
-    // Obtain file handle.
-    file_handle handle;
-    if(!filesystem_open(file_name, FILE_MODE_READ, true, &handle)) 
+    // Read the entire file through the VFS. Its data is 4 byte aligned however it is stored, as SPIR-V must be.
+    vfs_file file;
+    if(!vfs_read(file_name, &file)) 
     {
         KERROR("Unable to read shader module: %s.", file_name);
         return false;
     }
 
-    // Read the entire file as binary
-    u64 size = 0;
-    u8* file_buffer = 0;
-    if(!filesystem_read_all_bytes(&handle, &file_buffer, &size))
-    {
-        KERROR("Unable to read binary read shader module: %s.", file_name);
-        return false;
-    }
-
-    shader_stages[stage_index].create_info.codeSize = size;
-    shader_stages[stage_index].create_info.pCode = (u32*)file_buffer;
-
-    // Close the file
-    filesystem_close(&handle);
+    shader_stages[stage_index].create_info.codeSize = file.size;
+    shader_stages[stage_index].create_info.pCode = (const u32*)file.data;
 
     VK_CHECK(vkCreateShaderModule(
         context->device.logical_device,
@@ -54,6 +42,10 @@ b8 create_shader_module
         &shader_stages[stage_index].handle
     ));
 
+    // The module keeps its own copy of the code.
+    vfs_close(&file);
+    shader_stages[stage_index].create_info.pCode = 0;
+
     // Shader stage info to be later used while creating the pipeline
     kzero_memory(&shader_stages[stage_index].shader_stage_create_info, sizeof(VkPipelineShaderStageCreateInfo));
     shader_stages[stage_index].shader_stage_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
@@ -0,0 +1,235 @@
+#include "vulkan_staging.h"
+
+#include "vulkan_buffer.h"
+#include "vulkan_command_buffer.h"
+#include "vulkan_fence.h"
+#include "vulkan_utils.h"
+
+#include "core/logger.h"
+#include "core/kmemory.h"
+
+// Largest alignment an allocation may ask for. The ring size is kept a multiple of it so that
+// alignment survives wrapping.
+#define STAGING_MAX_ALIGNMENT 256ull
+
+KINLINE u64 align_up(u64 value, u64 alignment)
+{
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+KINLINE u32 recording_batch_index(vulkan_staging_ring* ring)
+{
+    return (ring->first_batch + ring->submitted_count) % VULKAN_STAGING_MAX_BATCHES;
+}
+
+// Blocks until the oldest submitted batch completes and releases its space.
+static void wait_oldest_batch(vulkan_context* context, vulkan_staging_ring* ring)
+{
+    vulkan_staging_batch* oldest = &ring->batches[ring->first_batch];
+    vulkan_fence_wait(context, &oldest->fence, UINT64_MAX);
+    vulkan_staging_ring_reclaim(context, ring);
+}
+
+b8 vulkan_staging_ring_create(vulkan_context* context, u64 size, vulkan_staging_ring* out_ring)
+{
+    kzero_memory(out_ring, sizeof(vulkan_staging_ring));
+    out_ring->size = align_up(size, STAGING_MAX_ALIGNMENT);
+
+    VkMemoryPropertyFlags flags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    if(!vulkan_buffer_create(context, out_ring->size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, flags, true, &out_ring->buffer))
+    {
+        KERROR("vulkan_staging_ring_create - failed to create the %lluB staging buffer.", out_ring->size);
+        return false;
+    }
+
+    // Coherent memory can stay mapped for the lifetime of the buffer.
+    out_ring->mapped = vulkan_buffer_lock_memory(context, &out_ring->buffer, 0, out_ring->size, 0);
+
+    for(u32 i = 0; i < VULKAN_STAGING_MAX_BATCHES; ++i)
+    {
+        vulkan_command_buffer_allocate(context, context->device.graphics_command_pool, true, &out_ring->batches[i].command_buffer);
+        vulkan_fence_create(context, false, &out_ring->batches[i].fence);
+    }
+
+    return true;
+}
+
+void vulkan_staging_ring_destroy(vulkan_context* context, vulkan_staging_ring* ring)
+{
+    if(!ring->mapped)
+    {
+        return;
+    }
+
+    vulkan_staging_ring_wait_idle(context, ring);
+
+    for(u32 i = 0; i < VULKAN_STAGING_MAX_BATCHES; ++i)
+    {
+        vulkan_command_buffer_free(context, context->device.graphics_command_pool, &ring->batches[i].command_buffer);
+        vulkan_fence_destroy(context, &ring->batches[i].fence);
+    }
+
+    vulkan_buffer_unlock_memory(context, &ring->buffer);
+    vulkan_buffer_destroy(context, &ring->buffer);
+    kzero_memory(ring, sizeof(vulkan_staging_ring));
+}
+
+void vulkan_staging_ring_reclaim(vulkan_context* context, vulkan_staging_ring* ring)
+{
+    while(ring->submitted_count > 0)
+    {
+        vulkan_staging_batch* oldest = &ring->batches[ring->first_batch];
+        if(!oldest->fence.is_signaled)
+        {
+            if(vkGetFenceStatus(context->device.logical_device, oldest->fence.handle) != VK_SUCCESS)
+            {
+                break;
+            }
+            oldest->fence.is_signaled = true;
+        }
+
+        ring->tail = oldest->end;
+        ring->first_batch = (ring->first_batch + 1) % VULKAN_STAGING_MAX_BATCHES;
+        ring->submitted_count--;
+    }
+}
+
+b8 vulkan_staging_ring_allocate(vulkan_context* context, vulkan_staging_ring* ring, u64 size, u64 alignment, u64* out_offset, void** out_mapped)
+{
+    if(size > ring->size || alignment > STAGING_MAX_ALIGNMENT)
+    {
+        return false;
+    }
+
+    u64 position;
+    u64 offset;
+    while(true)
+    {
+        position = align_up(ring->head, alignment);
+        offset = position % ring->size;
+        if(offset + size > ring->size)
+        {
+            // Never split a region across the end of the buffer; skip to the start instead.
+            position += ring->size - offset;
+            offset = 0;
+        }
+
+        if(position + size - ring->tail <= ring->size)
+        {
+            break;
+        }
+
+        if(ring->submitted_count == 0)
+        {
+            if(!ring->recording)
+            {
+                // Nothing is in flight, so the whole ring is free. Start again from the beginning.
+                ring->head = ring->tail = 0;
+                continue;
+            }
+            // The open batch itself holds the space it needs; submit it so it can be waited on.
+            vulkan_staging_ring_flush(context, ring);
+        }
+
+        vulkan_staging_ring_reclaim(context, ring);
+        if(ring->submitted_count > 0 && position + size - ring->tail > ring->size)
+        {
+            KDEBUG("vulkan_staging_ring_allocate - ring full, waiting on the GPU for %lluB.", size);
+            wait_oldest_batch(context, ring);
+        }
+    }
+
+    ring->head = position + size;
+    *out_offset = offset;
+    *out_mapped = ring->mapped + offset;
+    return true;
+}
+
+vulkan_command_buffer* vulkan_staging_ring_commands(vulkan_context* context, vulkan_staging_ring* ring)
+{
+    if(!ring->recording)
+    {
+        if(ring->submitted_count == VULKAN_STAGING_MAX_BATCHES)
+        {
+            wait_oldest_batch(context, ring);
+        }
+
+        // The pool allows individual resets, so beginning implicitly resets the reclaimed buffer.
+        vulkan_command_buffer* command_buffer = &ring->batches[recording_batch_index(ring)].command_buffer;
+        vulkan_command_buffer_reset(command_buffer);
+        vulkan_command_buffer_begin(command_buffer, true, false, false);
+        ring->recording = true;
+    }
+
+    return &ring->batches[recording_batch_index(ring)].command_buffer;
+}
+
+b8 vulkan_staging_ring_upload_buffer(vulkan_context* context, vulkan_staging_ring* ring, vulkan_buffer* dest, u64 dest_offset, u64 size, const void* data)
+{
+    u64 offset;
+    void* mapped;
+    if(!vulkan_staging_ring_allocate(context, ring, size, 16, &offset, &mapped))
+    {
+        return false;
+    }
+
+    kcopy_memory(mapped, data, size);
+
+    VkBufferCopy copy_region;
+    copy_region.srcOffset = offset;
+    copy_region.dstOffset = dest_offset;
+    copy_region.size = size;
+    vkCmdCopyBuffer(vulkan_staging_ring_commands(context, ring)->handle, ring->buffer.handle, dest->handle, 1, &copy_region);
+    return true;
+}
+
+void vulkan_staging_ring_flush(vulkan_context* context, vulkan_staging_ring* ring)
+{
+    if(!ring->recording)
+    {
+        return;
+    }
+
+    vulkan_staging_batch* batch = &ring->batches[recording_batch_index(ring)];
+
+    // Make the copies visible to anything submitted after this batch which reads vertices, indices or shader resources.
+    VkMemoryBarrier barrier = {VK_STRUCTURE_TYPE_MEMORY_BARRIER};
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+    vkCmdPipelineBarrier(
+        batch->command_buffer.handle,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+        0,
+        1, &barrier,
+        0, 0,
+        0, 0);
+
+    vulkan_command_buffer_end(&batch->command_buffer);
+
+    vulkan_fence_reset(context, &batch->fence);
+
+    VkSubmitInfo submit_info = {VK_STRUCTURE_TYPE_SUBMIT_INFO};
+    submit_info.commandBufferCount = 1;
+    submit_info.pCommandBuffers = &batch->command_buffer.handle;
+    VkResult result = vkQueueSubmit(context->device.graphics_queue, 1, &submit_info, batch->fence.handle);
+    if(!vulkan_result_is_success(result))
+    {
+        KERROR("vulkan_staging_ring_flush - vkQueueSubmit failed: '%s'", vulkan_result_string(result, true));
+    }
+    vulkan_command_buffer_update_submitted(&batch->command_buffer);
+
+    batch->end = ring->head;
+    ring->submitted_count++;
+    ring->recording = false;
+}
+
+void vulkan_staging_ring_wait_idle(vulkan_context* context, vulkan_staging_ring* ring)
+{
+    vulkan_staging_ring_flush(context, ring);
+    while(ring->submitted_count > 0)
+    {
+        wait_oldest_batch(context, ring);
+    }
+    ring->tail = ring->head;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "vulkan_types.h"
+
+/**
+ * Creates the staging ring and maps it persistently.
+ * @param context The Vulkan context.
+ * @param size The size of the ring in bytes. Uploads larger than this cannot be staged through it.
+ * @param out_ring A pointer to hold the ring.
+ * @return True on success; otherwise false.
+ */
+b8 vulkan_staging_ring_create(vulkan_context* context, u64 size, vulkan_staging_ring* out_ring);
+
+/**
+ * Submits any pending uploads, waits for them to complete and destroys the ring.
+ */
+void vulkan_staging_ring_destroy(vulkan_context* context, vulkan_staging_ring* ring);
+
+/**
+ * Releases the space of every batch whose fence has signaled. Never blocks.
+ */
+void vulkan_staging_ring_reclaim(vulkan_context* context, vulkan_staging_ring* ring);
+
+/**
+ * Reserves size bytes of the ring. Blocks on the oldest batches only if the ring is full.
+ * @param alignment Required alignment of the offset. Must be a power of two no larger than 256.
+ * @param out_offset The offset of the region within the ring's buffer.
+ * @param out_mapped Host pointer to the region.
+ * @return True on success; false if size is larger than the ring itself.
+ */
+b8 vulkan_staging_ring_allocate(vulkan_context* context, vulkan_staging_ring* ring, u64 size, u64 alignment, u64* out_offset, void** out_mapped);
+
+/**
+ * Returns the command buffer of the open batch, beginning a new batch if required.
+ * Commands recorded here execute when the batch is flushed.
+ */
+vulkan_command_buffer* vulkan_staging_ring_commands(vulkan_context* context, vulkan_staging_ring* ring);
+
+/**
+ * Stages data and records a copy of it into dest at dest_offset.
+ * @return True on success; false if the data does not fit in the ring.
+ */
+b8 vulkan_staging_ring_upload_buffer(vulkan_context* context, vulkan_staging_ring* ring, vulkan_buffer* dest, u64 dest_offset, u64 size, const void* data);
+
+/**
+ * Submits the open batch, if any, to the graphics queue. Work submitted to the queue afterwards
+ * observes the uploaded data.
+ */
+void vulkan_staging_ring_flush(vulkan_context* context, vulkan_staging_ring* ring);
+
+/**
+ * Flushes the open batch and waits for every submitted batch to complete.
+ */
+void vulkan_staging_ring_wait_idle(vulkan_context* context, vulkan_staging_ring* ring);
@@ -4,24 +4,42 @@
 #include "core/kmemory.h"
 #include "vulkan_device.h"
 #include "vulkan_image.h"
+#include "vulkan_buffer.h"
 
+// Images in the offscreen ring. Matches a typical swapchain so frames overlap the same way.
+#define OFFSCREEN_IMAGE_COUNT 3
 
 void create(vulkan_context* context, u32 width, u32 height, vulkan_swapchain* swapchain);
 void destroy(vulkan_context* context, vulkan_swapchain* swapchain);
+void create_offscreen(vulkan_context* context, u32 width, u32 height, vulkan_swapchain* swapchain);
+void destroy_offscreen(vulkan_context* context, vulkan_swapchain* swapchain);
+void create_depth_attachment(vulkan_context* context, u32 width, u32 height, vulkan_swapchain* swapchain);
 
 void vulkan_swapchain_create(vulkan_context* context, u32 width, u32 height, vulkan_swapchain* out_swapchain)
 {
+    if(context->offscreen)
+    {
+        create_offscreen(context, width, height, out_swapchain);
+        return;
+    }
+
     create(context, width, height, out_swapchain);
 }
 
 void vulkan_swapchain_recreate(vulkan_context* context, u32 width, u32 height, vulkan_swapchain* swapchain)
 {
-    destroy(context, swapchain);
-    create(context, width, height, swapchain);
+    vulkan_swapchain_destroy(context, swapchain);
+    vulkan_swapchain_create(context, width, height, swapchain);
 }
 
 void vulkan_swapchain_destroy(vulkan_context* context, vulkan_swapchain* swapchain)
 {
+    if(context->offscreen)
+    {
+        destroy_offscreen(context, swapchain);
+        return;
+    }
+
     destroy(context, swapchain);
 }
 
@@ -36,6 +54,15 @@ b8 vulkan_swapchain_acquire_next_image_index
     u32* out_image_index
 )
 {
+    // Offscreen images are handed out in turn. Nothing needs to be waited on, since the in-flight fences
+    // already keep an image from being reused before the frame rendering to it completes.
+    if(context->offscreen)
+    {
+        *out_image_index = swapchain->next_image_index;
+        swapchain->next_image_index = (swapchain->next_image_index + 1) % swapchain->image_count;
+        return true;
+    }
+
     VkResult result = vkAcquireNextImageKHR(
         context->device.logical_device,
         swapchain->handle,
@@ -70,6 +97,14 @@ void vulkan_swapchain_present
     u32 present_image_index
 )
 {
+    // There is nothing to present to offscreen. Just note which image holds the newest frame.
+    if(context->offscreen)
+    {
+        swapchain->last_image_index = present_image_index;
+        context->current_frame = (context->current_frame + 1) % (swapchain->max_frames_in_flight);
+        return;
+    }
+
     // Return the image to the swapchain for presentation.
     VkPresentInfoKHR present_info = {VK_STRUCTURE_TYPE_PRESENT_INFO_KHR};
     present_info.waitSemaphoreCount = 1;
@@ -231,6 +266,30 @@ void create(vulkan_context* context, u32 width, u32 height, vulkan_swapchain* sw
         VK_CHECK(vkCreateImageView(context->device.logical_device, &view_info, context->allocator, &swapchain->views[i]));
     }
 
+    create_depth_attachment(context, swapchain_extent.width, swapchain_extent.height, swapchain);
+
+    KINFO("Swapchain is created successfully.");
+
+}
+
+void destroy(vulkan_context* context, vulkan_swapchain* swapchain)
+{
+    // Make sure that the image is not being used by the device
+    vkDeviceWaitIdle(context->device.logical_device);
+    vulkan_image_destroy(context, &swapchain->depth_attachment);
+
+    // Only destroy the views, not the images, since those are owned by the swapchain and are thus
+    // destroyed when it is.
+    for(u32 i = 0; i < swapchain->image_count; ++i) 
+    {
+        vkDestroyImageView(context->device.logical_device, swapchain->views[i], context->allocator);
+    }
+
+    vkDestroySwapchainKHR(context->device.logical_device, swapchain->handle, context->allocator);
+}
+
+void create_depth_attachment(vulkan_context* context, u32 width, u32 height, vulkan_swapchain* swapchain)
+{
     // Depth resources
     if(!vulkan_device_detect_depth_format(&context->device))
     {
@@ -244,8 +303,9 @@ void create(vulkan_context* context, u32 width, u32 height, vulkan_swapchain* sw
     vulkan_image_create(
         context,
         VK_IMAGE_TYPE_2D,
-        swapchain_extent.width,
-        swapchain_extent.height,
+        width,
+        height,
+        1,
         context->device.depth_format,
         VK_IMAGE_TILING_OPTIMAL, // Let GPU to decide tiling
         VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
@@ -254,23 +314,173 @@ void create(vulkan_context* context, u32 width, u32 height, vulkan_swapchain* sw
         VK_IMAGE_ASPECT_DEPTH_BIT,
         &swapchain->depth_attachment
     );
+}
 
-    KINFO("Swapchain is created successfully.");
+void create_offscreen(vulkan_context* context, u32 width, u32 height, vulkan_swapchain* swapchain)
+{
+    // RGBA8 is what readback hands out, and is supported as a color attachment everywhere, lavapipe included.
+    swapchain->image_format.format = VK_FORMAT_R8G8B8A8_UNORM;
+    swapchain->image_format.colorSpace = VK_COLOR_SPACE_SRGB_NONLINEAR_KHR;
+    swapchain->handle = 0;
+    swapchain->image_count = OFFSCREEN_IMAGE_COUNT;
+    swapchain->max_frames_in_flight = OFFSCREEN_IMAGE_COUNT - 1;
+    swapchain->next_image_index = 0;
+    swapchain->last_image_index = INVALID_ID;
+
+    context->current_frame = 0;
+
+    if(!swapchain->images)
+    {
+        swapchain->images = (VkImage*)kallocate(sizeof(VkImage) * swapchain->image_count, MEMORY_TAG_RENDERER);
+    }
+
+    if(!swapchain->views)
+    {
+        swapchain->views = (VkImageView*)kallocate(sizeof(VkImageView) * swapchain->image_count, MEMORY_TAG_RENDERER);
+    }
+
+    if(!swapchain->offscreen_images)
+    {
+        swapchain->offscreen_images = (vulkan_image*)kallocate(sizeof(vulkan_image) * swapchain->image_count, MEMORY_TAG_RENDERER);
+    }
+
+    // Color images. The main renderpass leaves them ready to be copied from.
+    for(u32 i = 0; i < swapchain->image_count; ++i)
+    {
+        vulkan_image_create(
+            context,
+            VK_IMAGE_TYPE_2D,
+            width,
+            height,
+            1,
+            swapchain->image_format.format,
+            VK_IMAGE_TILING_OPTIMAL,
+            VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+            true,
+            VK_IMAGE_ASPECT_COLOR_BIT,
+            &swapchain->offscreen_images[i]
+        );
+
+        swapchain->images[i] = swapchain->offscreen_images[i].handle;
+        swapchain->views[i] = swapchain->offscreen_images[i].view;
+    }
+
+    if(context->readback)
+    {
+        if(!swapchain->readback_buffers)
+        {
+            swapchain->readback_buffers = (vulkan_buffer*)kallocate(sizeof(vulkan_buffer) * swapchain->image_count, MEMORY_TAG_RENDERER);
+        }
 
+        u64 size = (u64)width * height * 4;
+        for(u32 i = 0; i < swapchain->image_count; ++i)
+        {
+            vulkan_buffer_create(
+                context,
+                size,
+                VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                true,
+                &swapchain->readback_buffers[i]);
+        }
+    }
+
+    create_depth_attachment(context, width, height, swapchain);
+
+    KINFO("Offscreen swapchain is created successfully (%ux%u, %u images).", width, height, swapchain->image_count);
 }
 
-void destroy(vulkan_context* context, vulkan_swapchain* swapchain)
+void destroy_offscreen(vulkan_context* context, vulkan_swapchain* swapchain)
 {
-    // Make sure that the image is not being used by the device
     vkDeviceWaitIdle(context->device.logical_device);
     vulkan_image_destroy(context, &swapchain->depth_attachment);
 
-    // Only destroy the views, not the images, since those are owned by the swapchain and are thus
-    // destroyed when it is.
-    for(u32 i = 0; i < swapchain->image_count; ++i) 
+    for(u32 i = 0; i < swapchain->image_count; ++i)
     {
-        vkDestroyImageView(context->device.logical_device, swapchain->views[i], context->allocator);
+        vulkan_image_destroy(context, &swapchain->offscreen_images[i]);
+        swapchain->images[i] = 0;
+        swapchain->views[i] = 0;
+
+        if(swapchain->readback_buffers)
+        {
+            vulkan_buffer_destroy(context, &swapchain->readback_buffers[i]);
+        }
     }
 
-    vkDestroySwapchainKHR(context->device.logical_device, swapchain->handle, context->allocator);
-}
\ No newline at end of file
+    swapchain->last_image_index = INVALID_ID;
+}
+
+void vulkan_swapchain_record_readback(vulkan_context* context, vulkan_swapchain* swapchain, vulkan_command_buffer* command_buffer, u32 image_index)
+{
+    if(!context->offscreen || !swapchain->readback_buffers)
+    {
+        return;
+    }
+
+    vulkan_image* image = &swapchain->offscreen_images[image_index];
+
+    // Tightly packed, top row first.
+    VkBufferImageCopy region = {};
+    region.bufferOffset = 0;
+    region.bufferRowLength = 0;
+    region.bufferImageHeight = 0;
+    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.mipLevel = 0;
+    region.imageSubresource.baseArrayLayer = 0;
+    region.imageSubresource.layerCount = 1;
+    region.imageExtent.width = image->width;
+    region.imageExtent.height = image->height;
+    region.imageExtent.depth = 1;
+
+    // The renderpass has already transitioned the image to TRANSFER_SRC_OPTIMAL, and its outgoing
+    // dependency orders the color writes before this copy.
+    vkCmdCopyImageToBuffer(
+        command_buffer->handle,
+        image->handle,
+        VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+        swapchain->readback_buffers[image_index].handle,
+        1,
+        &region);
+
+    // Make the copy visible to the host once the frame's fence signals.
+    VkBufferMemoryBarrier barrier = {VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER};
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.buffer = swapchain->readback_buffers[image_index].handle;
+    barrier.offset = 0;
+    barrier.size = VK_WHOLE_SIZE;
+
+    vkCmdPipelineBarrier(
+        command_buffer->handle,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_HOST_BIT,
+        0,
+        0, 0,
+        1, &barrier,
+        0, 0);
+}
+
+b8 vulkan_swapchain_read_image(vulkan_context* context, vulkan_swapchain* swapchain, u32 image_index, u8* out_pixels)
+{
+    if(!swapchain->readback_buffers || image_index >= swapchain->image_count)
+    {
+        return false;
+    }
+
+    vulkan_image* image = &swapchain->offscreen_images[image_index];
+    vulkan_buffer* buffer = &swapchain->readback_buffers[image_index];
+    u64 size = (u64)image->width * image->height * 4;
+
+    void* data = vulkan_buffer_lock_memory(context, buffer, 0, size, 0);
+    if(!data)
+    {
+        return false;
+    }
+
+    kcopy_memory(out_pixels, data, size);
+    vulkan_buffer_unlock_memory(context, buffer);
+    return true;
+}
@@ -26,4 +26,17 @@ void vulkan_swapchain_present
     VkQueue present_queue,
     VkSemaphore render_complete_semaphore,
     u32 present_image_index
-);
\ No newline at end of file
+);
+
+/**
+ * Offscreen only. Records a copy of an image into its readback buffer. Must be recorded after the
+ * main renderpass ends. Does nothing unless readback is enabled.
+ */
+void vulkan_swapchain_record_readback(vulkan_context* context, vulkan_swapchain* swapchain, vulkan_command_buffer* command_buffer, u32 image_index);
+
+/**
+ * Offscreen only. Copies an image's readback buffer to out_pixels as tightly packed RGBA8. The frame
+ * which rendered to the image must have completed.
+ * @return True on success; false if readback is disabled or the index is out of range.
+ */
+b8 vulkan_swapchain_read_image(vulkan_context* context, vulkan_swapchain* swapchain, u32 image_index, u8* out_pixels);
@@ -4,6 +4,7 @@
 #include "core/asserts.h"
 
 #include "renderer/renderer_types.h"
+#include "memory/pool_allocator.h"
 
 #include <vulkan/vulkan.h>
 
@@ -14,13 +15,79 @@
     }
 
 
+// Default size of the device memory blocks which resources are sub-allocated from.
+#define VULKAN_MEMORY_BLOCK_DEFAULT_SIZE (64 * 1024 * 1024)
+
+// A region of device memory owned by one buffer or image.
+typedef struct vulkan_allocation
+{
+    VkDeviceMemory memory;
+    u64 offset;
+    u64 size;
+    // Host pointer to offset, or 0 if the memory is not host visible.
+    void* mapped;
+    // Index of the owning block, or INVALID_ID if the allocation has its own VkDeviceMemory.
+    u32 block_index;
+    u32 memory_type_index;
+} vulkan_allocation;
+
+typedef struct vulkan_memory_range
+{
+    u64 offset;
+    u64 size;
+} vulkan_memory_range;
+
+// A single vkAllocateMemory call which is carved up into many allocations.
+typedef struct vulkan_memory_block
+{
+    VkDeviceMemory memory;
+    u64 size;
+    u64 used;
+    u32 memory_type_index;
+    // Blocks hold either optimal-tiling images or buffers/linear images, never both, so that
+    // neighbouring allocations can never violate bufferImageGranularity.
+    b8 optimal;
+    // Persistently mapped for host-visible memory types; otherwise 0.
+    void* mapped;
+    // Free ranges, sorted by offset and never adjacent to each other.
+    vulkan_memory_range* free_ranges;
+    u32 free_range_count;
+    u32 free_range_capacity;
+    u32 allocation_count;
+} vulkan_memory_block;
+
+typedef struct vulkan_memory_stats
+{
+    // Number of live VkDeviceMemory objects, blocks and dedicated allocations included.
+    u32 device_allocation_count;
+    u32 block_count;
+    u32 dedicated_count;
+    // Number of live buffer and image allocations.
+    u32 allocation_count;
+    // Bytes obtained from the driver.
+    u64 reserved_bytes;
+    // Bytes handed out to buffers and images.
+    u64 used_bytes;
+} vulkan_memory_stats;
+
+typedef struct vulkan_memory_allocator
+{
+    u64 block_size;
+    // darray of blocks. Released blocks leave an empty slot (memory == 0) so indices stay valid.
+    vulkan_memory_block* blocks;
+    // True if the device requires buffers and optimal images to be kept apart.
+    b8 separate_optimal;
+    u32 dedicated_count;
+    u64 dedicated_bytes;
+} vulkan_memory_allocator;
+
 typedef struct vulkan_buffer
 {
     u64 total_size;
     VkBuffer handle;
     VkBufferUsageFlagBits usage;
     b8 is_locked;
-    VkDeviceMemory memory;
+    vulkan_allocation allocation;
     i32 memory_index;
     u32 memory_property_flags;
 } vulkan_buffer;
@@ -60,10 +127,11 @@ typedef struct vulkan_device
 typedef struct vulkan_image
 {
     VkImage handle;
-    VkDeviceMemory memory;
+    vulkan_allocation allocation;
     VkImageView view;
     u32 width;
     u32 height;
+    u32 mip_levels;
 } vulkan_image;
 
 typedef enum vulkan_render_pass_state 
@@ -109,6 +177,15 @@ typedef struct vulkan_swapchain
 
     // framebuffers used for on-screen rendering. (to render onto the images of the swapchain)
     vulkan_framebuffer* framebuffers;
+
+    // Offscreen only. The images which images and views refer to, owned by the swapchain rather than a VkSwapchainKHR.
+    vulkan_image* offscreen_images;
+    // Offscreen with readback only. Host-visible copies of each image, filled when its frame is submitted.
+    vulkan_buffer* readback_buffers;
+    // Offscreen only. Index of the next image to hand out.
+    u32 next_image_index;
+    // Offscreen only. Index of the image most recently submitted, or INVALID_ID before the first frame.
+    u32 last_image_index;
 } vulkan_swapchain;
 
 typedef enum vulkan_command_buffer_state 
@@ -202,6 +279,61 @@ typedef struct vulkan_material_shader
 
 } vulkan_material_shader;
 
+// Maximum number of staging batches which can be in flight at once.
+#define VULKAN_STAGING_MAX_BATCHES 8
+
+// Default size of the persistently mapped staging ring used for uploads.
+#define VULKAN_STAGING_RING_DEFAULT_SIZE (64 * 1024 * 1024)
+
+// A group of uploads recorded into one command buffer and submitted together.
+typedef struct vulkan_staging_batch
+{
+    vulkan_command_buffer command_buffer;
+    // Signaled once the GPU has consumed every upload in the batch.
+    vulkan_fence fence;
+    // Ring position just past the last byte used by this batch.
+    u64 end;
+} vulkan_staging_batch;
+
+/*
+    Host-visible buffer which stays mapped for its whole lifetime and is sub-allocated front to back
+    for uploads. Positions grow monotonically and wrap onto the buffer with % size, so the used range
+    is always [tail, head). Space is reclaimed when the fence of the batch that used it signals.
+*/
+typedef struct vulkan_staging_ring
+{
+    vulkan_buffer buffer;
+    u8* mapped;
+    u64 size;
+    u64 head;
+    u64 tail;
+
+    vulkan_staging_batch batches[VULKAN_STAGING_MAX_BATCHES];
+    // Index of the oldest submitted batch.
+    u32 first_batch;
+    // Number of batches submitted and not yet reclaimed.
+    u32 submitted_count;
+    // True while the batch after the submitted ones is open for recording.
+    b8 recording;
+} vulkan_staging_ring;
+
+// A sampler shared by every texture sampled with the same parameters.
+typedef struct vulkan_sampler_cache_entry
+{
+    texture_sampler_params params;
+    VkSampler handle;
+} vulkan_sampler_cache_entry;
+
+/*
+    Samplers are immutable and there are only a handful of distinct parameter sets, so each is created
+    once and kept until shutdown instead of one being created per texture.
+*/
+typedef struct vulkan_sampler_cache
+{
+    // darray
+    vulkan_sampler_cache_entry* entries;
+} vulkan_sampler_cache;
+
 typedef struct vulkan_context
 {
     f32 frame_delta_time;
@@ -223,6 +355,11 @@ typedef struct vulkan_context
     VkAllocationCallbacks* allocator;
     VkSurfaceKHR surface;
 
+    // Renders into the swapchain's offscreen images, with no surface or presentation.
+    b8 offscreen;
+    // Copies each offscreen frame into the swapchain's readback buffers.
+    b8 readback;
+
 #if defined(_DEBUG)
     VkDebugUtilsMessengerEXT debug_messenger;
 #endif
@@ -262,10 +399,23 @@ typedef struct vulkan_context
 
     i32 (*find_memory_index)(u32 type_filter, u32 property_flags);
 
+    // Every buffer and image gets its device memory from here.
+    vulkan_memory_allocator memory_allocator;
+
+    // Backing storage for vulkan_texture_data.
+    pool_allocator texture_data_pool;
+
+    // Staging memory for buffer and texture uploads.
+    vulkan_staging_ring staging;
+
+    // Samplers used by textures.
+    vulkan_sampler_cache sampler_cache;
+
 } vulkan_context;
 
 typedef struct vulkan_texture_data
 {
     vulkan_image image;
+    // Owned by the context's sampler cache.
     VkSampler sampler;
 } vulkan_texture_data;
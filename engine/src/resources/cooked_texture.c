@@ -0,0 +1,237 @@
+#include "cooked_texture.h"
+
+#include "core/logger.h"
+#include "core/kmemory.h"
+#include "core/kstring.h"
+#include "containers/hashtable.h"
+#include "platform/platform.h"
+
+KINLINE u64 align_up(u64 value, u64 alignment)
+{
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+static u32 mip_count_for(u32 width, u32 height)
+{
+    u32 largest = width > height ? width : height;
+    u32 count = 1;
+    while(largest > 1)
+    {
+        largest >>= 1;
+        count++;
+    }
+    return count;
+}
+
+// Halves a mip with a 2x2 box filter. Odd edges reuse their last row or column.
+static void downsample(const u8* source, u32 source_width, u32 source_height, u8* out_pixels, u32 width, u32 height)
+{
+    for(u32 y = 0; y < height; ++y)
+    {
+        u32 y0 = y * 2;
+        u32 y1 = y0 + 1 < source_height ? y0 + 1 : y0;
+        for(u32 x = 0; x < width; ++x)
+        {
+            u32 x0 = x * 2;
+            u32 x1 = x0 + 1 < source_width ? x0 + 1 : x0;
+            const u8* p00 = source + ((u64)y0 * source_width + x0) * 4;
+            const u8* p01 = source + ((u64)y0 * source_width + x1) * 4;
+            const u8* p10 = source + ((u64)y1 * source_width + x0) * 4;
+            const u8* p11 = source + ((u64)y1 * source_width + x1) * 4;
+            u8* out = out_pixels + ((u64)y * width + x) * 4;
+            for(u32 c = 0; c < 4; ++c)
+            {
+                out[c] = (u8)((p00[c] + p01[c] + p10[c] + p11[c] + 2) / 4);
+            }
+        }
+    }
+}
+
+b8 cooked_texture_write(const char* path, const file_info* source_info, u64 source_hash, u32 width, u32 height, const u8* pixels, b8 has_transparency)
+{
+    if(width == 0 || height == 0 || !pixels)
+    {
+        return false;
+    }
+
+    cooked_texture_header header = {};
+    header.magic = COOKED_TEXTURE_MAGIC;
+    header.version = COOKED_TEXTURE_VERSION;
+    header.source_size = source_info->size;
+    header.source_modified_time = source_info->modified_time;
+    header.source_hash = source_hash;
+    header.width = width;
+    header.height = height;
+    header.format = COOKED_TEXTURE_FORMAT_RGBA8;
+    header.mip_count = mip_count_for(width, height);
+    header.has_transparency = has_transparency;
+
+    // Lay out every mip first, so the table can be written ahead of the pixels.
+    u64 mips_size = sizeof(cooked_texture_mip) * header.mip_count;
+    cooked_texture_mip* mips = kallocate(mips_size, MEMORY_TAG_TEXTURE);
+    u64 offset = align_up(sizeof(cooked_texture_header) + mips_size, COOKED_TEXTURE_ALIGNMENT);
+    u32 mip_width = width;
+    u32 mip_height = height;
+    for(u32 i = 0; i < header.mip_count; ++i)
+    {
+        mips[i].offset = offset;
+        mips[i].size = (u64)mip_width * mip_height * 4;
+        mips[i].width = mip_width;
+        mips[i].height = mip_height;
+        offset = align_up(offset + mips[i].size, COOKED_TEXTURE_ALIGNMENT);
+        mip_width = mip_width > 1 ? mip_width / 2 : 1;
+        mip_height = mip_height > 1 ? mip_height / 2 : 1;
+    }
+
+    // Written beside the target and moved over it once complete, since other loads may have the
+    // current file mapped. Named per thread, as two loads of a texture can cook it at once.
+    char temp_path[512];
+    if(string_length(path) + 32 > sizeof(temp_path))
+    {
+        kfree(mips, mips_size, MEMORY_TAG_TEXTURE);
+        return false;
+    }
+    string_format(temp_path, "%s.%llu.tmp", path, platform_current_thread_id());
+    file_handle file;
+    if(!filesystem_open(temp_path, FILE_MODE_WRITE, true, &file))
+    {
+        kfree(mips, mips_size, MEMORY_TAG_TEXTURE);
+        return false;
+    }
+
+    // Each mip is built from the one before it, so only two are held at once.
+    u64 scratch_size = mips[header.mip_count > 1 ? 1 : 0].size;
+    u8* scratch[2] = {kallocate(scratch_size, MEMORY_TAG_TEXTURE), kallocate(scratch_size, MEMORY_TAG_TEXTURE)};
+    const u8 padding[COOKED_TEXTURE_ALIGNMENT] = {};
+
+    u64 written = 0;
+    u64 position = 0;
+    b8 result = filesystem_write(&file, sizeof(header), &header, &written) &&
+                filesystem_write(&file, mips_size, mips, &written);
+    position = sizeof(header) + mips_size;
+
+    const u8* previous = pixels;
+    for(u32 i = 0; i < header.mip_count && result; ++i)
+    {
+        const u8* mip_pixels = pixels;
+        if(i > 0)
+        {
+            u8* out = scratch[i % 2];
+            downsample(previous, mips[i - 1].width, mips[i - 1].height, out, mips[i].width, mips[i].height);
+            mip_pixels = out;
+        }
+
+        if(mips[i].offset > position)
+        {
+            result = filesystem_write(&file, mips[i].offset - position, padding, &written);
+        }
+        result = result && filesystem_write(&file, mips[i].size, mip_pixels, &written);
+        position = mips[i].offset + mips[i].size;
+        previous = mip_pixels;
+    }
+
+    filesystem_close(&file);
+    kfree(scratch[0], scratch_size, MEMORY_TAG_TEXTURE);
+    kfree(scratch[1], scratch_size, MEMORY_TAG_TEXTURE);
+    kfree(mips, mips_size, MEMORY_TAG_TEXTURE);
+
+    result = result && filesystem_replace(temp_path, path);
+    if(!result)
+    {
+        filesystem_remove(temp_path);
+        KWARN("cooked_texture_write - failed writing '%s'.", path);
+    }
+    return result;
+}
+
+// Checks that a file holds a complete cooked texture.
+static b8 validate(const cooked_texture* texture)
+{
+    const cooked_texture_header* header = texture->header;
+    u64 size = texture->file.size;
+    if(size < sizeof(cooked_texture_header) ||
+       header->magic != COOKED_TEXTURE_MAGIC ||
+       header->version != COOKED_TEXTURE_VERSION ||
+       header->format != COOKED_TEXTURE_FORMAT_RGBA8 ||
+       header->mip_count == 0 ||
+       header->mip_count != mip_count_for(header->width, header->height))
+    {
+        return false;
+    }
+
+    if(sizeof(cooked_texture_header) + sizeof(cooked_texture_mip) * header->mip_count > size)
+    {
+        return false;
+    }
+
+    for(u32 i = 0; i < header->mip_count; ++i)
+    {
+        const cooked_texture_mip* mip = &texture->mips[i];
+        b8 in_bounds = mip->offset <= size && mip->size <= size - mip->offset;
+        if(!in_bounds || mip->size != (u64)mip->width * mip->height * 4)
+        {
+            // Most likely a write which was cut short.
+            return false;
+        }
+    }
+    return texture->mips[0].width == header->width && texture->mips[0].height == header->height;
+}
+
+// Hashes a whole file the same way the hash stored at cook time was made.
+static b8 hash_file(const char* path, u64* out_hash)
+{
+    vfs_file file;
+    if(!vfs_read(path, &file))
+    {
+        return false;
+    }
+    *out_hash = hash_bytes(file.data, file.size, 0);
+    vfs_close(&file);
+    return true;
+}
+
+b8 cooked_texture_open(const char* path, const char* source_path, const file_info* source_info, cooked_texture* out_texture)
+{
+    kzero_memory(out_texture, sizeof(cooked_texture));
+    if(!vfs_read(path, &out_texture->file))
+    {
+        return false;
+    }
+    if(out_texture->file.size < sizeof(cooked_texture_header))
+    {
+        vfs_close(&out_texture->file);
+        return false;
+    }
+    out_texture->header = (const cooked_texture_header*)out_texture->file.data;
+    out_texture->mips = (const cooked_texture_mip*)(out_texture->file.data + sizeof(cooked_texture_header));
+
+    b8 usable = validate(out_texture) && out_texture->header->source_size == source_info->size;
+    if(usable && out_texture->header->source_modified_time != source_info->modified_time)
+    {
+        u64 hash = 0;
+        usable = hash_file(source_path, &hash) && hash == out_texture->header->source_hash;
+    }
+
+    if(!usable)
+    {
+        cooked_texture_close(out_texture);
+        return false;
+    }
+    return true;
+}
+
+void cooked_texture_close(cooked_texture* texture)
+{
+    vfs_close(&texture->file);
+    texture->header = 0;
+    texture->mips = 0;
+}
+
+const u8* cooked_texture_mip_pixels(const cooked_texture* texture, u32 level)
+{
+    if(!texture->header || level >= texture->header->mip_count)
+    {
+        return 0;
+    }
+    return texture->file.data + texture->mips[level].offset;
+}
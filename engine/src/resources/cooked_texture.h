@@ -0,0 +1,102 @@
+#pragma once
+
+#include "defines.h"
+#include "platform/filesystem.h"
+#include "platform/vfs.h"
+
+/*
+    Cooked textures are a texture's pixels stored the way the renderer consumes them, so loading one
+    is a file mapping rather than a decode. A cooked file sits next to its source, with the extension
+    COOKED_TEXTURE_EXTENSION, and remembers the source's size, modification time and hash so a stale
+    one is never used. Both are read through the VFS, so a pack can hold cooked files as well.
+
+    Layout, all little-endian:
+        cooked_texture_header
+        cooked_texture_mip[mip_count]    Largest first, down to 1x1.
+        Pixel data for each mip, at the offsets in its cooked_texture_mip.
+*/
+
+#define COOKED_TEXTURE_EXTENSION "ktex"
+// "KTEX"
+#define COOKED_TEXTURE_MAGIC 0x5845544B
+#define COOKED_TEXTURE_VERSION 1
+// Each mip's pixels start on this many bytes, which keeps copies out of the mapping aligned.
+#define COOKED_TEXTURE_ALIGNMENT 16
+
+typedef enum cooked_texture_format
+{
+    // 8 bits per channel, RGBA, rows bottom to top.
+    COOKED_TEXTURE_FORMAT_RGBA8 = 1
+} cooked_texture_format;
+
+typedef struct cooked_texture_header
+{
+    u32 magic;
+    u32 version;
+    // The source file this was cooked from.
+    u64 source_size;
+    u64 source_modified_time;
+    u64 source_hash;
+    u32 width;
+    u32 height;
+    u32 format;
+    u32 mip_count;
+    u8 has_transparency;
+    u8 reserved[7];
+} cooked_texture_header;
+
+typedef struct cooked_texture_mip
+{
+    // From the start of the file.
+    u64 offset;
+    u64 size;
+    u32 width;
+    u32 height;
+} cooked_texture_mip;
+
+// A cooked texture read in place through the VFS.
+typedef struct cooked_texture
+{
+    vfs_file file;
+    const cooked_texture_header* header;
+    const cooked_texture_mip* mips;
+} cooked_texture;
+
+/**
+ * Cooks RGBA8 pixels and their full mip chain into a file.
+ * @param path The path on disk of the cooked file to write.
+ * @param source_info The size and modification time of the source the pixels were decoded from.
+ * @param source_hash The hash_bytes hash of the source file, seed 0.
+ * @param width The width of the pixels.
+ * @param height The height of the pixels.
+ * @param pixels The pixels, 4 bytes each, rows bottom to top.
+ * @param has_transparency Indicates if any pixel has an alpha below 255.
+ * @returns True if the file was written; otherwise false.
+ */
+KAPI b8 cooked_texture_write(const char* path, const file_info* source_info, u64 source_hash, u32 width, u32 height, const u8* pixels, b8 has_transparency);
+
+/**
+ * Reads a cooked file through the VFS and checks that it is intact and was cooked from the given
+ * source. If the modification time differs but the size matches, the source is hashed to decide, so
+ * that touching a file without changing it does not force a recook.
+ * @param path The VFS path of the cooked file.
+ * @param source_path The VFS path of the source file, hashed only if needed.
+ * @param source_info The current size and modification time of the source.
+ * @param out_texture A pointer to hold the mapped texture. Must be closed with cooked_texture_close.
+ * @returns True if the cooked file is usable; otherwise false, in which case nothing is left open.
+ */
+KAPI b8 cooked_texture_open(const char* path, const char* source_path, const file_info* source_info, cooked_texture* out_texture);
+
+/**
+ * Closes a cooked texture.
+ * @param texture A pointer to the texture to close.
+ */
+KAPI void cooked_texture_close(cooked_texture* texture);
+
+/**
+ * Gets the pixels of one mip of a cooked texture, pointing into the file's data.
+ * @param texture A pointer to an open cooked texture.
+ * @param level The mip level, 0 being the largest.
+ * @returns The pixels, or 0 if there is no such level.
+ */
+KAPI const u8* cooked_texture_mip_pixels(const cooked_texture* texture, u32 level);
@@ -0,0 +1,154 @@
+#include "image.h"
+
+#include "core/logger.h"
+#include "core/kmemory.h"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "vendor/stb_image.h"
+
+// Picked at compile time: x64 always has SSE2, and AVX2 is used when the build enables it.
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define IMAGE_SIMD_AVX2
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define IMAGE_SIMD_SSE2
+#endif
+
+b8 image_decode(const char* name, const u8* bytes, u64 size, image* out_image)
+{
+    kzero_memory(out_image, sizeof(image));
+
+    // Decoded as stored, then flipped and expanded to RGBA in one pass rather than letting stb_image
+    // make a pass for each.
+    i32 width;
+    i32 height;
+    i32 channel_count;
+    u8* data = stbi_load_from_memory(bytes, (i32)size, &width, &height, &channel_count, 0);
+    if(!data)
+    {
+        KWARN("image_decode - failed to decode '%s': %s", name, stbi_failure_reason());
+        return false;
+    }
+
+    out_image->width = width;
+    out_image->height = height;
+    out_image->pixels = kallocate_no_zero((u64)width * height * 4, MEMORY_TAG_TEXTURE);
+    out_image->has_transparency = image_to_rgba_flipped(data, width, height, channel_count, out_image->pixels);
+    stbi_image_free(data);
+    return true;
+}
+
+void image_free(image* img)
+{
+    if(img->pixels)
+    {
+        kfree(img->pixels, (u64)img->width * img->height * 4, MEMORY_TAG_TEXTURE);
+    }
+    img->pixels = 0;
+}
+
+b8 image_to_rgba_flipped(const u8* source, u32 width, u32 height, u32 channel_count, u8* out_pixels)
+{
+    b8 has_transparency = false;
+    u64 source_stride = (u64)width * channel_count;
+    u64 stride = (u64)width * 4;
+    for(u32 y = 0; y < height; ++y)
+    {
+        const u8* in = source + source_stride * (height - 1 - y);
+        u8* out = out_pixels + stride * y;
+        switch(channel_count)
+        {
+            case 4:
+                kcopy_memory(out, in, stride);
+                // Scanned while the row is still in cache. Once one pixel is found, the rest need not be.
+                if(!has_transparency)
+                {
+                    has_transparency = !image_is_opaque(out, width);
+                }
+                break;
+            case 3:
+                for(u32 x = 0; x < width; ++x)
+                {
+                    out[x * 4 + 0] = in[x * 3 + 0];
+                    out[x * 4 + 1] = in[x * 3 + 1];
+                    out[x * 4 + 2] = in[x * 3 + 2];
+                    out[x * 4 + 3] = 255;
+                }
+                break;
+            case 2:
+            {
+                u8 alpha = 255;
+                for(u32 x = 0; x < width; ++x)
+                {
+                    out[x * 4 + 0] = in[x * 2];
+                    out[x * 4 + 1] = in[x * 2];
+                    out[x * 4 + 2] = in[x * 2];
+                    out[x * 4 + 3] = in[x * 2 + 1];
+                    alpha &= in[x * 2 + 1];
+                }
+                has_transparency = has_transparency || alpha != 255;
+                break;
+            }
+            default:
+                for(u32 x = 0; x < width; ++x)
+                {
+                    out[x * 4 + 0] = in[x];
+                    out[x * 4 + 1] = in[x];
+                    out[x * 4 + 2] = in[x];
+                    out[x * 4 + 3] = 255;
+                }
+                break;
+        }
+    }
+    return has_transparency;
+}
+
+b8 image_is_opaque(const u8* rgba, u64 pixel_count)
+{
+    u64 i = 0;
+
+    // The colour bytes are set to 0xFF, which leaves every byte 0xFF only if the alpha was too. Several
+    // vectors are combined before each check to keep the branch out of the way of the loads.
+#if defined(IMAGE_SIMD_AVX2)
+    const __m256i colour_mask = _mm256_set1_epi32(0x00FFFFFF);
+    const __m256i all_set = _mm256_set1_epi32(-1);
+    for(; i + 32 <= pixel_count; i += 32)
+    {
+        const __m256i* p = (const __m256i*)(rgba + i * 4);
+        __m256i combined = _mm256_and_si256(
+            _mm256_and_si256(_mm256_loadu_si256(p + 0), _mm256_loadu_si256(p + 1)),
+            _mm256_and_si256(_mm256_loadu_si256(p + 2), _mm256_loadu_si256(p + 3)));
+        combined = _mm256_or_si256(combined, colour_mask);
+        if(_mm256_movemask_epi8(_mm256_cmpeq_epi8(combined, all_set)) != -1)
+        {
+            return false;
+        }
+    }
+#elif defined(IMAGE_SIMD_SSE2)
+    const __m128i colour_mask = _mm_set1_epi32(0x00FFFFFF);
+    const __m128i all_set = _mm_set1_epi32(-1);
+    for(; i + 16 <= pixel_count; i += 16)
+    {
+        const __m128i* p = (const __m128i*)(rgba + i * 4);
+        __m128i combined = _mm_and_si128(
+            _mm_and_si128(_mm_loadu_si128(p + 0), _mm_loadu_si128(p + 1)),
+            _mm_and_si128(_mm_loadu_si128(p + 2), _mm_loadu_si128(p + 3)));
+        combined = _mm_or_si128(combined, colour_mask);
+        if(_mm_movemask_epi8(_mm_cmpeq_epi8(combined, all_set)) != 0xFFFF)
+        {
+            return false;
+        }
+    }
+#endif
+
+    // Whatever is left over, or everything when there is no SIMD.
+    for(; i < pixel_count; ++i)
+    {
+        if(rgba[i * 4 + 3] != 255)
+        {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "defines.h"
+
+/*
+    Decodes image files into the pixels textures are created from: 8 bits per channel RGBA, rows
+    bottom to top. Safe to call from any thread, so files can be decoded side by side on the job system.
+*/
+
+// Pixels decoded from an image file.
+typedef struct image
+{
+    // width * height * 4 bytes, rows bottom to top.
+    u8* pixels;
+    u32 width;
+    u32 height;
+    // Indicates if any pixel has an alpha below 255.
+    b8 has_transparency;
+} image;
+
+/**
+ * Decodes an image file already read into memory. Files with fewer than 4 channels are expanded,
+ * with missing alpha being opaque.
+ * @param name The name of the image, for reporting errors.
+ * @param bytes The contents of the file.
+ * @param size The size of bytes.
+ * @param out_image A pointer to hold the image. Must be freed with image_free.
+ * @returns True on success; otherwise false, in which case nothing needs to be freed.
+ */
+KAPI b8 image_decode(const char* name, const u8* bytes, u64 size, image* out_image);
+
+/**
+ * Frees the pixels of a decoded image.
+ * @param img A pointer to the image to free.
+ */
+KAPI void image_free(image* img);
+
+/**
+ * Copies pixels of 1 (grey), 2 (grey and alpha), 3 (RGB) or 4 (RGBA) channels into RGBA, reversing
+ * the order of the rows, in a single pass.
+ * @param source The source pixels, rows top to bottom and tightly packed.
+ * @param width The width in pixels.
+ * @param height The height in pixels.
+ * @param channel_count The number of channels in source.
+ * @param out_pixels A pointer to width * height * 4 bytes to hold the result.
+ * @returns True if any pixel has an alpha below 255; otherwise false.
+ */
+KAPI b8 image_to_rgba_flipped(const u8* source, u32 width, u32 height, u32 channel_count, u8* out_pixels);
+
+/**
+ * Indicates if every RGBA pixel has an alpha of 255. Uses AVX2 or SSE2 when the engine is built for
+ * them, and a plain loop otherwise.
+ * @param rgba The pixels, 4 bytes each.
+ * @param pixel_count The number of pixels.
+ * @returns True if no pixel has any transparency; otherwise false.
+ */
+KAPI b8 image_is_opaque(const u8* rgba, u64 pixel_count);
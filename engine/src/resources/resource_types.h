@@ -2,6 +2,32 @@
 
 #include "math/math_types.h"
 
+typedef enum texture_filter
+{
+    TEXTURE_FILTER_LINEAR = 0,
+    TEXTURE_FILTER_NEAREST = 1
+} texture_filter;
+
+typedef enum texture_repeat
+{
+    TEXTURE_REPEAT_REPEAT = 0,
+    TEXTURE_REPEAT_MIRRORED_REPEAT = 1,
+    TEXTURE_REPEAT_CLAMP_TO_EDGE = 2,
+    TEXTURE_REPEAT_CLAMP_TO_BORDER = 3
+} texture_repeat;
+
+// How a texture is sampled. Zeroed, it is filtered linearly, repeats, and is mipmapped and anisotropic.
+typedef struct texture_sampler_params
+{
+    texture_filter minify;
+    texture_filter magnify;
+    texture_repeat repeat_u;
+    texture_repeat repeat_v;
+    // Creates the texture with a single mip level.
+    b8 disable_mips;
+    b8 disable_anisotropy;
+} texture_sampler_params;
+
 typedef struct texture
 {
     u32 id;
@@ -10,5 +36,8 @@ typedef struct texture
     u8 channel_count;
     b8 has_transparency;
     u32 generation;
+    // Generated by the renderer on upload, so 1 unless the backend supports mips.
+    u32 mip_levels;
+    texture_sampler_params sampler;
     void* internal_data;
 } texture;
\ No newline at end of file
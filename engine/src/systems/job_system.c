@@ -0,0 +1,437 @@
+#include "job_system.h"
+
+#include "core/logger.h"
+#include "core/kmemory.h"
+#include "core/kstring.h"
+#include "core/profiler.h"
+#include "platform/platform.h"
+
+typedef struct job
+{
+    // First and 16 byte aligned, so entry points can cast it to a struct of any type.
+    _Alignas(16) u8 params[JOB_MAX_PARAM_SIZE];
+    job_entry_point entry_point;
+    job_counter* counter;
+    // Set by the owning thread when the slot is handed out; cleared by whichever thread ran the job.
+    volatile i32 in_use;
+} job;
+
+/*
+    Chase-Lev work-stealing deque. The owning thread pushes and pops at the bottom; other threads
+    steal from the top. Indices only ever grow and are masked into the entry array.
+*/
+typedef struct job_deque
+{
+    job** entries;
+    i64 mask;
+    volatile i64 top;
+    volatile i64 bottom;
+} job_deque;
+
+typedef struct job_thread_context
+{
+    job_deque deques[JOB_PRIORITY_COUNT];
+    // Ring of job slots. Only the owning thread hands them out.
+    job* jobs;
+    u32 next_job;
+    // Seed used to pick which thread to steal from first.
+    u32 random_state;
+    u32 index;
+    platform_thread thread;
+} job_thread_context;
+
+typedef struct job_system_state
+{
+    // Workers plus the main thread, which always has index 0.
+    u32 thread_count;
+    u32 jobs_per_thread;
+    job_thread_context* contexts;
+
+    volatile i32 running;
+    // Workers which are about to wait, or are waiting, on wake_semaphore.
+    volatile i32 sleeping_count;
+    platform_semaphore wake_semaphore;
+} job_system_state;
+
+static job_system_state* state_ptr;
+
+// Index of the calling thread's context, or -1 for threads the job system does not own.
+static _Thread_local i32 current_thread_index = -1;
+
+static u32 resolve_worker_count(job_system_config config)
+{
+    i32 count = config.worker_count;
+    if(count == 0)
+    {
+        count = platform_get_processor_count() - 1;
+    }
+    if(count < 1)
+    {
+        count = 1;
+    }
+    return count > JOB_MAX_WORKERS ? JOB_MAX_WORKERS : (u32)count;
+}
+
+static u32 resolve_jobs_per_thread(job_system_config config)
+{
+    u32 requested = config.max_jobs_per_thread ? config.max_jobs_per_thread : JOB_DEFAULT_JOBS_PER_THREAD;
+    u32 count = 16;
+    while(count < requested)
+    {
+        count <<= 1;
+    }
+    return count;
+}
+
+static b8 deque_push(job_deque* deque, job* j)
+{
+    i64 bottom = platform_atomic_load_i64(&deque->bottom);
+    i64 top = platform_atomic_load_i64(&deque->top);
+    if(bottom - top > deque->mask)
+    {
+        return false;
+    }
+
+    platform_atomic_store_ptr((void* volatile*)&deque->entries[bottom & deque->mask], j);
+    platform_atomic_store_i64(&deque->bottom, bottom + 1);
+    return true;
+}
+
+static job* deque_pop(job_deque* deque)
+{
+    i64 bottom = platform_atomic_load_i64(&deque->bottom) - 1;
+    platform_atomic_store_i64(&deque->bottom, bottom);
+    i64 top = platform_atomic_load_i64(&deque->top);
+
+    if(top > bottom)
+    {
+        // Empty.
+        platform_atomic_store_i64(&deque->bottom, bottom + 1);
+        return 0;
+    }
+
+    job* j = platform_atomic_load_ptr((void* volatile*)&deque->entries[bottom & deque->mask]);
+    if(top == bottom)
+    {
+        // Last entry, so a thief may be taking it at the same time. Whoever advances top wins.
+        if(!platform_atomic_compare_exchange_i64(&deque->top, top, top + 1))
+        {
+            j = 0;
+        }
+        platform_atomic_store_i64(&deque->bottom, bottom + 1);
+    }
+    return j;
+}
+
+static job* deque_steal(job_deque* deque)
+{
+    i64 top = platform_atomic_load_i64(&deque->top);
+    i64 bottom = platform_atomic_load_i64(&deque->bottom);
+    if(top >= bottom)
+    {
+        return 0;
+    }
+
+    job* j = platform_atomic_load_ptr((void* volatile*)&deque->entries[top & deque->mask]);
+    if(!platform_atomic_compare_exchange_i64(&deque->top, top, top + 1))
+    {
+        // Lost the race to the owner or another thief.
+        return 0;
+    }
+    return j;
+}
+
+static job* find_job(job_thread_context* context)
+{
+    u32 thread_count = state_ptr->thread_count;
+    for(u32 priority = 0; priority < JOB_PRIORITY_COUNT; ++priority)
+    {
+        job* j = deque_pop(&context->deques[priority]);
+        if(j)
+        {
+            return j;
+        }
+
+        // xorshift, so that idle threads spread their stealing across victims.
+        u32 x = context->random_state;
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        context->random_state = x;
+
+        u32 start = x % thread_count;
+        for(u32 i = 0; i < thread_count; ++i)
+        {
+            u32 victim = (start + i) % thread_count;
+            if(victim == context->index)
+            {
+                continue;
+            }
+
+            j = deque_steal(&state_ptr->contexts[victim].deques[priority]);
+            if(j)
+            {
+                return j;
+            }
+        }
+    }
+
+    return 0;
+}
+
+static void execute_job(job* j)
+{
+    j->entry_point(j->params);
+
+    if(j->counter)
+    {
+        platform_atomic_add_i32(&j->counter->value, -1);
+    }
+    platform_atomic_store_i32(&j->in_use, 0);
+}
+
+static job* acquire_job_slot(job_thread_context* context)
+{
+    u32 mask = state_ptr->jobs_per_thread - 1;
+    u32 attempts = 0;
+    for(;;)
+    {
+        job* j = &context->jobs[context->next_job & mask];
+        context->next_job++;
+        if(!platform_atomic_load_i32(&j->in_use))
+        {
+            platform_atomic_store_i32(&j->in_use, 1);
+            return j;
+        }
+
+        // Every slot is busy. Help drain the queues until one frees up.
+        if(++attempts == state_ptr->jobs_per_thread)
+        {
+            attempts = 0;
+            job* pending = find_job(context);
+            if(pending)
+            {
+                execute_job(pending);
+            }
+            else
+            {
+                platform_thread_yield();
+            }
+        }
+    }
+}
+
+static u32 worker_thread_run(void* params)
+{
+    job_thread_context* context = params;
+    current_thread_index = (i32)context->index;
+
+    char thread_name[32];
+    string_format(thread_name, "Job worker %u", context->index);
+    profiler_set_thread_name(thread_name);
+
+    while(platform_atomic_load_i32(&state_ptr->running))
+    {
+        job* j = find_job(context);
+        if(j)
+        {
+            execute_job(j);
+            continue;
+        }
+
+        // Announce the intent to sleep before looking once more, so a job submitted in between is
+        // either found here or its submitter sees the sleeper and signals.
+        platform_atomic_add_i32(&state_ptr->sleeping_count, 1);
+        j = find_job(context);
+        if(j)
+        {
+            platform_atomic_add_i32(&state_ptr->sleeping_count, -1);
+            execute_job(j);
+            continue;
+        }
+
+        if(platform_atomic_load_i32(&state_ptr->running))
+        {
+            platform_semaphore_wait(&state_ptr->wake_semaphore);
+        }
+        platform_atomic_add_i32(&state_ptr->sleeping_count, -1);
+    }
+
+    return 0;
+}
+
+b8 job_system_initialize(u64* memory_requirement, void* state, job_system_config config)
+{
+    u32 thread_count = resolve_worker_count(config) + 1;
+    u32 jobs_per_thread = resolve_jobs_per_thread(config);
+
+    // Block of memory will contain the state structure, then the thread contexts, job slots and deque entries.
+    u64 struct_requirement = sizeof(job_system_state);
+    u64 context_requirement = sizeof(job_thread_context) * thread_count;
+    // Padded so the job slots start on their alignment, given a block aligned at least that much.
+    context_requirement = ((struct_requirement + context_requirement + _Alignof(job) - 1) & ~(u64)(_Alignof(job) - 1)) - struct_requirement;
+    u64 job_requirement = sizeof(job) * jobs_per_thread * thread_count;
+    u64 deque_requirement = sizeof(job*) * jobs_per_thread * JOB_PRIORITY_COUNT * thread_count;
+    *memory_requirement = struct_requirement + context_requirement + job_requirement + deque_requirement;
+
+    if(!state)
+    {
+        return true;
+    }
+
+    kzero_memory(state, *memory_requirement);
+    state_ptr = state;
+    state_ptr->thread_count = thread_count;
+    state_ptr->jobs_per_thread = jobs_per_thread;
+    state_ptr->contexts = (void*)((u8*)state + struct_requirement);
+
+    job* job_block = (void*)((u8*)state_ptr->contexts + context_requirement);
+    job** deque_block = (void*)((u8*)job_block + job_requirement);
+    for(u32 i = 0; i < thread_count; ++i)
+    {
+        job_thread_context* context = &state_ptr->contexts[i];
+        context->index = i;
+        context->random_state = 0x9E3779B9u * (i + 1);
+        context->jobs = job_block + (u64)i * jobs_per_thread;
+        for(u32 p = 0; p < JOB_PRIORITY_COUNT; ++p)
+        {
+            context->deques[p].entries = deque_block + ((u64)i * JOB_PRIORITY_COUNT + p) * jobs_per_thread;
+            context->deques[p].mask = jobs_per_thread - 1;
+        }
+    }
+
+    if(!platform_semaphore_create(0, &state_ptr->wake_semaphore))
+    {
+        KERROR("job_system_initialize - failed to create the wake semaphore.");
+        state_ptr = 0;
+        return false;
+    }
+
+    // The calling thread becomes the main thread of the job system.
+    current_thread_index = 0;
+    state_ptr->running = true;
+
+    for(u32 i = 1; i < thread_count; ++i)
+    {
+        if(!platform_thread_create(worker_thread_run, &state_ptr->contexts[i], false, &state_ptr->contexts[i].thread))
+        {
+            KERROR("job_system_initialize - failed to start worker thread %u.", i);
+            // Run with the workers that did start.
+            state_ptr->thread_count = i;
+            break;
+        }
+    }
+
+    KINFO("Job system started with %u worker threads.", state_ptr->thread_count - 1);
+    return true;
+}
+
+void job_system_shutdown(void* state)
+{
+    if(!state_ptr)
+    {
+        return;
+    }
+
+    platform_atomic_store_i32(&state_ptr->running, false);
+    platform_semaphore_signal(&state_ptr->wake_semaphore, state_ptr->thread_count);
+    for(u32 i = 1; i < state_ptr->thread_count; ++i)
+    {
+        platform_thread_join(&state_ptr->contexts[i].thread);
+    }
+
+    // Nothing submitted is dropped: whatever the workers left behind runs here.
+    job* j;
+    while((j = find_job(&state_ptr->contexts[0])))
+    {
+        execute_job(j);
+    }
+
+    platform_semaphore_destroy(&state_ptr->wake_semaphore);
+    current_thread_index = -1;
+    state_ptr = 0;
+}
+
+b8 job_system_submit(job_entry_point entry_point, const void* params, u32 param_size, job_priority priority, job_counter* counter)
+{
+    if(!entry_point || param_size > JOB_MAX_PARAM_SIZE || priority >= JOB_PRIORITY_COUNT)
+    {
+        KERROR("job_system_submit - requires an entry point, a priority and at most %u bytes of parameters.", JOB_MAX_PARAM_SIZE);
+        return false;
+    }
+
+    if(!state_ptr)
+    {
+        // No workers to hand the job to, so do it now.
+        _Alignas(16) u8 local_params[JOB_MAX_PARAM_SIZE];
+        if(param_size)
+        {
+            kcopy_memory(local_params, params, param_size);
+        }
+        entry_point(local_params);
+        return true;
+    }
+
+    if(current_thread_index < 0)
+    {
+        KERROR("job_system_submit - jobs can only be submitted from the main thread or from other jobs.");
+        return false;
+    }
+
+    job_thread_context* context = &state_ptr->contexts[current_thread_index];
+    job* j = acquire_job_slot(context);
+    j->entry_point = entry_point;
+    j->counter = counter;
+    if(param_size)
+    {
+        kcopy_memory(j->params, params, param_size);
+    }
+
+    if(counter)
+    {
+        platform_atomic_add_i32(&counter->value, 1);
+    }
+
+    // Cannot fail: the deque is as large as the slot ring and only holds this thread's jobs.
+    deque_push(&context->deques[priority], j);
+
+    if(platform_atomic_load_i32(&state_ptr->sleeping_count) > 0)
+    {
+        platform_semaphore_signal(&state_ptr->wake_semaphore, 1);
+    }
+
+    return true;
+}
+
+void job_system_wait(job_counter* counter)
+{
+    if(!counter)
+    {
+        return;
+    }
+
+    while(platform_atomic_load_i32(&counter->value) > 0)
+    {
+        if(state_ptr && current_thread_index >= 0)
+        {
+            // Help out rather than idle.
+            job* j = find_job(&state_ptr->contexts[current_thread_index]);
+            if(j)
+            {
+                execute_job(j);
+                continue;
+            }
+        }
+        platform_thread_yield();
+    }
+}
+
+b8 job_system_is_complete(job_counter* counter)
+{
+    return !counter || platform_atomic_load_i32(&counter->value) <= 0;
+}
+
+u32 job_system_thread_count()
+{
+    return state_ptr ? state_ptr->thread_count : 1;
+}
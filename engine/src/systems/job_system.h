@@ -0,0 +1,82 @@
+#pragma once
+
+#include "defines.h"
+
+// Bytes of parameter data copied into each job, so callers may pass pointers to stack data.
+#define JOB_MAX_PARAM_SIZE 128
+// Upper bound on worker threads, regardless of the processor count.
+#define JOB_MAX_WORKERS 32
+// Jobs each thread can have queued or running at once when the config does not say otherwise.
+#define JOB_DEFAULT_JOBS_PER_THREAD 1024
+
+typedef void (*job_entry_point)(void* params);
+
+typedef enum job_priority
+{
+    JOB_PRIORITY_HIGH,
+    JOB_PRIORITY_NORMAL,
+    JOB_PRIORITY_LOW,
+    JOB_PRIORITY_COUNT
+} job_priority;
+
+/*
+    Number of jobs submitted against the counter which have not finished yet. Zero it before first
+    use. Several jobs can share a counter, which makes waiting on it a fan-in of all of them.
+*/
+typedef struct job_counter
+{
+    volatile i32 value;
+} job_counter;
+
+typedef struct job_system_config
+{
+    // Number of worker threads. 0 uses one per logical processor, less one for the main thread.
+    u8 worker_count;
+    // Jobs each thread can have in flight. Rounded up to a power of two. 0 uses JOB_DEFAULT_JOBS_PER_THREAD.
+    u32 max_jobs_per_thread;
+} job_system_config;
+
+/*
+    Runs jobs on a pool of worker threads. Every thread (the main thread included) owns one work-stealing
+    deque per priority: it pushes and pops its own jobs at one end while idle threads steal from the other.
+    Higher priorities are always drained first, both locally and when stealing.
+
+    Jobs may only be submitted from the main thread or from within other jobs. Before the system is
+    initialized, submitted jobs run immediately on the calling thread.
+
+    The state block must be at least 16 byte aligned.
+*/
+b8 job_system_initialize(u64* memory_requirement, void* state, job_system_config config);
+
+/**
+ * Runs every job still queued, stops the workers and waits for them to exit.
+ */
+void job_system_shutdown(void* state);
+
+/**
+ * Queues a job.
+ * @param entry_point The function to run.
+ * @param params Data passed to the entry point. Copied, so it need not outlive this call. May be 0.
+ *        The copy the entry point receives is 16 byte aligned.
+ * @param param_size The size of params in bytes. At most JOB_MAX_PARAM_SIZE.
+ * @param priority The priority of the job.
+ * @param counter Incremented now and decremented when the job completes. Optional.
+ * @return True on success; otherwise false.
+ */
+KAPI b8 job_system_submit(job_entry_point entry_point, const void* params, u32 param_size, job_priority priority, job_counter* counter);
+
+/**
+ * Blocks until counter reaches zero. Threads owned by the job system run other jobs while waiting,
+ * so this may be called from inside a job.
+ */
+KAPI void job_system_wait(job_counter* counter);
+
+/**
+ * Indicates if every job submitted against counter has completed. Never blocks.
+ */
+KAPI b8 job_system_is_complete(job_counter* counter);
+
+/**
+ * The number of threads which run jobs, the main thread included. 1 before initialization.
+ */
+KAPI u32 job_system_thread_count();
@@ -3,14 +3,101 @@
 #include "core/logger.h"
 #include "core/kstring.h"
 #include "core/kmemory.h"
+#include "core/profiler.h"
 #include "containers/hashtable.h"
+#include "containers/darray.h"
+
+#include "platform/vfs.h"
+
+#include "resources/cooked_texture.h"
+#include "resources/image.h"
 
 #include "renderer/renderer_frontend.h"
 
-// TODO: Resource loader
-#define STB_IMAGE_IMPLEMENTATION
-#include "vendor/stb_image.h"
+#include "systems/job_system.h"
+
+// Uploads per texture_system_update when the config does not say otherwise.
+#define DEFAULT_MAX_UPLOADS_PER_FRAME 4
 
+// Frames a streamed texture keeps a mip nothing has asked for before dropping back to its base mip.
+#define STREAM_DOWNGRADE_FRAMES 120
+
+// Passed as a mip level to load a texture at its base mip.
+#define BASE_MIP INVALID_ID
+
+// Pixels decoded from a texture file, ready to be uploaded.
+typedef struct decoded_texture
+{
+    // Either the decoded image's, or inside the cooked texture's mapping.
+    const u8* pixels;
+    u32 width;
+    u32 height;
+    b8 has_transparency;
+    b8 is_cooked;
+    cooked_texture cooked;
+    image decoded_image;
+    // The mip the pixels are, out of mip_count which can be loaded. Only cooked textures have more than one.
+    u32 mip_level;
+    u32 mip_count;
+    // The mip loaded when nothing asks for more.
+    u32 base_mip;
+    // Size of mip 0.
+    u32 full_width;
+    u32 full_height;
+} decoded_texture;
+
+// A texture being decoded by the job system for texture_system_acquire_async.
+typedef struct texture_load_request
+{
+    // Freed once the load is finished.
+    char* name;
+    u32 handle;
+    // The mip to load, or BASE_MIP.
+    u32 mip_level;
+    // Reaches zero once the decoding job is done with the request.
+    job_counter counter;
+    // Written by the decoding job.
+    b8 succeeded;
+    decoded_texture decoded;
+    // Set if the texture is released before it is uploaded, in which case it never is.
+    b8 cancelled;
+} texture_load_request;
+
+/*
+    Residency of one texture slot. Loaded textures which nothing references are kept in a least
+    recently released list, linked through these by slot index, and are evicted from its head when
+    the budget is exceeded.
+*/
+typedef struct texture_residency
+{
+    // GPU memory used by the slot's texture while it is loaded.
+    u64 gpu_bytes;
+    // Generation of the last texture uploaded to the slot, which the next upload carries on from, even
+    // once the slot is reused. Keeps the renderer from mistaking a new texture for one it has seen.
+    // INVALID_ID if the slot has never held one.
+    u32 last_generation;
+    // Bumped each time the slot is freed, so handles to its old texture no longer resolve. Starts at 1.
+    u32 slot_generation;
+    // Index in live_slots while the slot is in use, otherwise INVALID_ID.
+    u32 live_index;
+    u32 lru_prev;
+    u32 lru_next;
+    b8 in_lru;
+
+    // Streaming, for textures with more than one mip to load. The name is needed to load other mips.
+    char* name;
+    u32 mip_count;
+    u32 base_mip;
+    u32 resident_mip;
+    u32 full_width;
+    u32 full_height;
+    // The highest resolution mip asked for in the frame last_request_frame.
+    u32 requested_mip;
+    u64 last_request_frame;
+    // The last frame the resident mip, or a higher resolution one, was asked for.
+    u64 last_needed_frame;
+    b8 in_stream_list;
+} texture_residency;
 
 typedef struct texture_system_state
 {
@@ -22,6 +109,27 @@ typedef struct texture_system_state
 
     // Hashtable for texture lookups
     hashtable registered_texture_table;
+
+    // Asynchronous loads which have not been removed by texture_system_update yet, oldest first.
+    texture_load_request** pending_loads;
+
+    // Per slot of registered_textures.
+    texture_residency* residency;
+    // Stack of unused slots, popped from the end.
+    u32* free_slots;
+    u32 free_count;
+    // Slots in use, in no particular order.
+    u32* live_slots;
+    u32 live_count;
+    // Least recently released evictable texture, and the most recent.
+    u32 lru_head;
+    u32 lru_tail;
+    texture_residency_stats residency_stats;
+
+    // Handles of streamed textures which have been asked for a mip since their base mip was loaded.
+    u32* stream_list;
+    // Counts texture_system_update calls.
+    u64 frame_number;
 } texture_system_state;
 
 typedef struct texture_reference
@@ -35,7 +143,22 @@ static texture_system_state* state_ptr = 0;
 
 b8 create_default_textures(texture_system_state* state);
 void destroy_default_textures(texture_system_state* state);
-b8 load_texture(const char* texture_name, texture* t);
+b8 load_texture(const char* texture_name, texture* t, u32 mip_level);
+static b8 decode_texture(const char* texture_name, u32 mip_level, decoded_texture* out_decoded);
+static void upload_texture(const char* texture_name, texture* t, decoded_texture* decoded);
+static void free_decoded(decoded_texture* decoded);
+static b8 start_load(const char* texture_name, u32 handle, u32 mip_level);
+static texture_load_request* find_pending_load(u32 handle);
+static b8 finish_load(texture_load_request* request);
+static void free_load(texture_load_request* request);
+static u64 texture_gpu_size(const texture* t);
+static void lru_push(u32 handle);
+static void lru_remove(u32 handle);
+static void unload_texture(u32 handle);
+static void enforce_vram_budget();
+static void update_streaming();
+static u32 allocate_slot();
+static void free_slot(u32 handle);
 
 b8 texture_system_initialize(u64* memory_requirement, void* state, texture_system_config config)
 {
@@ -49,7 +172,9 @@ b8 texture_system_initialize(u64* memory_requirement, void* state, texture_syste
     u64 struct_requirement = sizeof(texture_system_state);
     u64 array_requirement = config.max_texture_count * sizeof(texture);
     u64 hashtable_requirement = config.max_texture_count * sizeof(texture_reference);
-    *memory_requirement = struct_requirement + array_requirement + hashtable_requirement;
+    u64 residency_requirement = config.max_texture_count * sizeof(texture_residency);
+    u64 slots_requirement = config.max_texture_count * sizeof(u32);
+    *memory_requirement = struct_requirement + array_requirement + hashtable_requirement + residency_requirement + slots_requirement * 2;
 
     if(!state)
     {
@@ -58,6 +183,14 @@ b8 texture_system_initialize(u64* memory_requirement, void* state, texture_syste
 
     state_ptr = state;
     state_ptr->config = config;
+    if(state_ptr->config.max_uploads_per_frame == 0)
+    {
+        state_ptr->config.max_uploads_per_frame = DEFAULT_MAX_UPLOADS_PER_FRAME;
+    }
+    state_ptr->pending_loads = darray_create(texture_load_request*);
+    state_ptr->stream_list = darray_create(u32);
+    // Starts at 1 so that no texture counts as asked for before it has been.
+    state_ptr->frame_number = 1;
 
     // The array block is after the state. Already allocated, so just set the pointer
     void* array_block = state + struct_requirement;
@@ -82,6 +215,26 @@ b8 texture_system_initialize(u64* memory_requirement, void* state, texture_syste
     invalid_ref.reference_count = 0;
     hashtable_fill(&state_ptr->registered_texture_table, &invalid_ref);
 
+    // Residency block is after the hashtable.
+    state_ptr->residency = hashtable_block + hashtable_requirement;
+    kzero_memory(state_ptr->residency, residency_requirement);
+    // Slot lists are after the residency block. Slots are handed out lowest first.
+    void* slots_block = (void*)state_ptr->residency + residency_requirement;
+    state_ptr->free_slots = slots_block;
+    state_ptr->live_slots = slots_block + slots_requirement;
+    for(u32 i = 0; i < count; ++i)
+    {
+        state_ptr->residency[i].last_generation = INVALID_ID;
+        state_ptr->residency[i].slot_generation = 1;
+        state_ptr->residency[i].live_index = INVALID_ID;
+        state_ptr->free_slots[i] = count - 1 - i;
+    }
+    state_ptr->free_count = count;
+    state_ptr->live_count = 0;
+    state_ptr->lru_head = INVALID_ID;
+    state_ptr->lru_tail = INVALID_ID;
+    kzero_memory(&state_ptr->residency_stats, sizeof(texture_residency_stats));
+
     // Create default textures for use in the system.
     create_default_textures(state_ptr);
 
@@ -92,23 +245,98 @@ void texture_system_shutdown(void* state)
 {
     if(state_ptr) 
     {
+        // Wait for and discard loads which were never uploaded.
+        u64 pending_count = darray_length(state_ptr->pending_loads);
+        for(u64 i = 0; i < pending_count; ++i)
+        {
+            texture_load_request* request = state_ptr->pending_loads[i];
+            job_system_wait(&request->counter);
+            request->cancelled = true;
+            finish_load(request);
+            free_load(request);
+        }
+        darray_destroy(state_ptr->pending_loads);
+        state_ptr->pending_loads = 0;
+
         // Destroy all loaded textures.
-        for(u32 i = 0; i < state_ptr->config.max_texture_count; ++i) 
+        for(u32 l = 0; l < state_ptr->live_count; ++l) 
         {
-            texture* t = &state_ptr->registered_textures[i];
-            if(t->generation != INVALID_ID) 
+            u32 i = state_ptr->live_slots[l];
+            if(state_ptr->registered_textures[i].generation != INVALID_ID) 
+            {
+                unload_texture(i);
+            }
+
+            char* stream_name = state_ptr->residency[i].name;
+            if(stream_name)
             {
-                renderer_destroy_texture(t);
+                kfree(stream_name, string_length(stream_name) + 1, MEMORY_TAG_STRING);
             }
         }
 
         destroy_default_textures(state_ptr);
+        hashtable_destroy(&state_ptr->registered_texture_table);
+        darray_destroy(state_ptr->stream_list);
+        state_ptr->stream_list = 0;
 
         state_ptr = 0;
     }
 }
 
+static texture* acquire_texture(const char* name, b8 auto_release, b8 async);
+
 texture* texture_system_acquire(const char* name, b8 auto_release)
+{
+    KPROFILE_FUNCTION_BEGIN();
+    texture* t = acquire_texture(name, auto_release, false);
+    KPROFILE_END();
+    return t;
+}
+
+texture* texture_system_acquire_async(const char* name, b8 auto_release)
+{
+    KPROFILE_FUNCTION_BEGIN();
+    texture* t = acquire_texture(name, auto_release, true);
+    KPROFILE_END();
+    return t;
+}
+
+b8 texture_system_acquire_batch(u32 count, const char** names, b8 auto_release, texture** out_textures)
+{
+    KPROFILE_FUNCTION_BEGIN();
+
+    // Start every load before waiting on any, so the files are decoded side by side on the workers.
+    b8 result = true;
+    for(u32 i = 0; i < count; ++i)
+    {
+        out_textures[i] = acquire_texture(names[i], auto_release, true);
+        result = result && out_textures[i];
+    }
+
+    // Waiting runs queued decodes on this thread too. A name given twice shares one load, which the
+    // first wait finishes.
+    for(u32 i = 0; i < count; ++i)
+    {
+        texture* t = out_textures[i];
+        if(!t || t < state_ptr->registered_textures || t >= state_ptr->registered_textures + state_ptr->config.max_texture_count)
+        {
+            continue;
+        }
+
+        texture_load_request* request = find_pending_load((u32)(t - state_ptr->registered_textures));
+        if(request)
+        {
+            job_system_wait(&request->counter);
+            finish_load(request);
+        }
+        result = result && t->generation != INVALID_ID;
+    }
+
+    KPROFILE_END();
+    return result;
+}
+
+static texture* acquire_texture(const char* name, b8 auto_release, b8 async)
 {
     // Return default texture, but warn about it since this should be returned via get_default_texture();
     if(strings_equali(name, DEFAULT_TEXTURE_NAME)) 
@@ -125,47 +353,79 @@ texture* texture_system_acquire(const char* name, b8 auto_release)
         if(ref.reference_count == 0)
         {
             ref.auto_release = auto_release;
+
+            // Referenced again, so it cannot be evicted.
+            if(ref.handle != INVALID_ID)
+            {
+                lru_remove(ref.handle);
+            }
         }
 
         ++ref.reference_count;
         
         if(ref.handle == INVALID_ID)
         {
-            // This means no texture exists here. Find a free index first.
-            u32 count = state_ptr->config.max_texture_count;
-            texture* t = 0;
-            for(u32 i = 0 ; i < count; ++i)
-            {
-                if(state_ptr->registered_textures[i].id == INVALID_ID)
-                {
-                    // A free slot has been found. Use its index as the handle
-                    ref.handle = i;
-                    t = &state_ptr->registered_textures[i];
-                    break;
-                }
-            }
-
-            // Make sure an empty slot was actually found.
-            if(!t || ref.handle == INVALID_ID) 
+            // This means no texture exists here. Take a free slot first, and use its index as the handle.
+            ref.handle = allocate_slot();
+            if(ref.handle == INVALID_ID) 
             {
                 KFATAL("texture_system_acquire - Texture system cannot hold anymore textures. Adjust configuration to allow more.");
                 return 0;
             }
+            texture* t = &state_ptr->registered_textures[ref.handle];
 
-            // Create the new texture
-            if(!load_texture(name, t))
+            if(async)
             {
-                KERROR("Failed to load texture '%s'.", name);
-                return 0;
+                // Reserve the slot. It keeps an invalid generation until the load is uploaded.
+                if(!start_load(name, ref.handle, BASE_MIP))
+                {
+                    KERROR("Failed to start loading texture '%s'.", name);
+                    free_slot(ref.handle);
+                    return 0;
+                }
+                t->id = ref.handle;
+                KTRACE("Texture '%s' does not yet exist. Loading it, and ref_count is now %i.", name, ref.reference_count);
             }
+            else
+            {
+                // Create the new texture
+                KPROFILE_BEGIN("load_texture");
+                b8 loaded = load_texture(name, t, BASE_MIP);
+                KPROFILE_END();
+                if(!loaded)
+                {
+                    KERROR("Failed to load texture '%s'.", name);
+                    free_slot(ref.handle);
+                    return 0;
+                }
 
-            // Also use the handle as the texture id.
-            t->id = ref.handle;
-            KTRACE("Texture '%s' does not yet exist. Created, and ref_count is now %i.", name, ref.reference_count);
-
+                // Also use the handle as the texture id.
+                t->id = ref.handle;
+                KTRACE("Texture '%s' does not yet exist. Created, and ref_count is now %i.", name, ref.reference_count);
+            }
         }
         else 
         {
+            texture* t = &state_ptr->registered_textures[ref.handle];
+            texture_load_request* request = find_pending_load(ref.handle);
+            if(request)
+            {
+                // A synchronous acquire cannot return a texture which is still loading, so finish the load now.
+                if(!async)
+                {
+                    job_system_wait(&request->counter);
+                    finish_load(request);
+                }
+            }
+            else if(t->generation == INVALID_ID)
+            {
+                // Evicted to stay within the VRAM budget, so load it again. Its generation carries on from before.
+                b8 loaded = async ? start_load(name, ref.handle, BASE_MIP) : load_texture(name, t, BASE_MIP);
+                if(!loaded)
+                {
+                    KERROR("Failed to reload texture '%s'. The default texture will be used in its place.", name);
+                }
+            }
             KTRACE("Texture '%s' already exists, ref_count increased to %i.", name, ref.reference_count);
         }
 
@@ -202,13 +462,32 @@ void texture_system_release(const char* name)
         {
             texture* t = &state_ptr->registered_textures[ref.handle];
 
-            // Release texture.
-            renderer_destroy_texture(t);
+            // If it is still loading, the load is dropped once it finishes decoding.
+            texture_load_request* request = find_pending_load(ref.handle);
+            if(request)
+            {
+                request->cancelled = true;
+            }
+
+            // Release texture, if it was ever uploaded.
+            texture_residency* residency = &state_ptr->residency[ref.handle];
+            if(t->generation != INVALID_ID)
+            {
+                residency->last_generation = t->generation;
+                unload_texture(ref.handle);
+            }
 
             // Reset the array entry, ensure invalid ids are set.
             kzero_memory(t, sizeof(texture));
             t->id = INVALID_ID;
             t->generation = INVALID_ID;
+            if(residency->name)
+            {
+                kfree(residency->name, string_length(residency->name) + 1, MEMORY_TAG_STRING);
+                residency->name = 0;
+            }
+            residency->mip_count = 0;
+            free_slot(ref.handle);
 
             // Reset the reference.
             ref.handle = INVALID_ID;
@@ -217,6 +496,12 @@ void texture_system_release(const char* name)
         } 
         else 
         {
+            // Kept loaded while within the budget, but can now be evicted.
+            if(ref.reference_count == 0 && state_ptr->registered_textures[ref.handle].generation != INVALID_ID)
+            {
+                lru_push(ref.handle);
+                enforce_vram_budget();
+            }
             KTRACE("Released texture '%s', now has a reference count of '%i' (auto_release=%s).", name, ref.reference_count, ref.auto_release ? "true" : "false");
         }
 
@@ -230,6 +515,30 @@ void texture_system_release(const char* name)
     }
 }
 
+b8 texture_system_set_sampler(const char* name, texture_sampler_params sampler)
+{
+    texture_reference ref;
+    if(!state_ptr || !hashtable_get(&state_ptr->registered_texture_table, name, &ref) || ref.handle == INVALID_ID)
+    {
+        KWARN("texture_system_set_sampler called for texture '%s', which is not acquired.", name);
+        return false;
+    }
+
+    texture* t = &state_ptr->registered_textures[ref.handle];
+    t->sampler = sampler;
+
+    // A pending load picks the parameters up when it is uploaded. A loaded texture is uploaded again, since
+    // turning mips on or off changes its image.
+    texture_residency* residency = &state_ptr->residency[ref.handle];
+    u32 mip_level = residency->mip_count > 1 ? residency->resident_mip : BASE_MIP;
+    if(t->generation != INVALID_ID && !load_texture(name, t, mip_level))
+    {
+        KERROR("texture_system_set_sampler failed to reload texture '%s'.", name);
+        return false;
+    }
+    return true;
+}
+
 texture* texture_system_get_default_texture() 
 {
     if(state_ptr) 
@@ -241,6 +550,85 @@ texture* texture_system_get_default_texture()
     return 0;
 }
 
+texture_handle texture_system_get_handle(const texture* t)
+{
+    if(!state_ptr || t < state_ptr->registered_textures || t >= state_ptr->registered_textures + state_ptr->config.max_texture_count)
+    {
+        return INVALID_TEXTURE_HANDLE;
+    }
+
+    u32 slot = (u32)(t - state_ptr->registered_textures);
+    texture_residency* residency = &state_ptr->residency[slot];
+    if(residency->live_index == INVALID_ID)
+    {
+        return INVALID_TEXTURE_HANDLE;
+    }
+    return ((u64)residency->slot_generation << 32) | slot;
+}
+
+texture* texture_system_resolve(texture_handle handle)
+{
+    if(!state_ptr || handle == INVALID_TEXTURE_HANDLE)
+    {
+        return 0;
+    }
+
+    u32 slot = (u32)(handle & 0xFFFFFFFF);
+    u32 generation = (u32)(handle >> 32);
+    if(slot >= state_ptr->config.max_texture_count)
+    {
+        return 0;
+    }
+
+    texture_residency* residency = &state_ptr->residency[slot];
+    if(residency->live_index == INVALID_ID || residency->slot_generation != generation)
+    {
+        return 0;
+    }
+    return &state_ptr->registered_textures[slot];
+}
+
+void texture_system_request_screen_size(texture* t, f32 screen_size)
+{
+    if(!state_ptr || t < state_ptr->registered_textures || t >= state_ptr->registered_textures + state_ptr->config.max_texture_count)
+    {
+        // The default texture, which is never streamed.
+        return;
+    }
+
+    u32 handle = (u32)(t - state_ptr->registered_textures);
+    texture_residency* residency = &state_ptr->residency[handle];
+    if(t->generation == INVALID_ID || residency->base_mip == 0)
+    {
+        return;
+    }
+
+    // The smallest mip which still has a texel for every pixel it covers.
+    u32 largest = residency->full_width > residency->full_height ? residency->full_width : residency->full_height;
+    u32 level = 0;
+    while(level < residency->base_mip && (f32)(largest >> (level + 1)) >= screen_size)
+    {
+        level++;
+    }
+
+    if(residency->last_request_frame != state_ptr->frame_number || level < residency->requested_mip)
+    {
+        residency->requested_mip = level;
+    }
+    residency->last_request_frame = state_ptr->frame_number;
+
+    if(!residency->in_stream_list)
+    {
+        residency->in_stream_list = true;
+        darray_push(state_ptr->stream_list, handle);
+    }
+}
+
+void texture_system_get_residency_stats(texture_residency_stats* out_stats)
+{
+    *out_stats = state_ptr->residency_stats;
+}
+
 b8 create_default_textures(texture_system_state* state)
 {
     // NOTE: Create default texture, a 256x256 blue/white checkerboard pattern.
@@ -279,7 +667,7 @@ b8 create_default_textures(texture_system_state* state)
         }
     }
 
-    renderer_create_texture(DEFAULT_TEXTURE_NAME, tex_dimension, tex_dimension, 4, pixels, false, &state->default_texture);
+    renderer_create_texture(DEFAULT_TEXTURE_NAME, tex_dimension, tex_dimension, 4, pixels, false, 0, &state->default_texture);
     // Manually set the texture generation to invalid since this is a default texture.
     state_ptr->default_texture.generation = INVALID_ID;
 
@@ -294,94 +682,537 @@ void destroy_default_textures(texture_system_state* state)
     }
 }
 
-b8 load_texture(const char* texture_name, texture* t) 
+void texture_system_update()
 {
-    // TODO: Should be able to be located anywhere.
-    char* format_str = "assets/textures/%s.%s";
-    const i32 required_channel_count = 4;
-    stbi_set_flip_vertically_on_load(true);
-    char full_file_path[512];
+    if(!state_ptr)
+    {
+        return;
+    }
 
-    // TODO: try different extensions
-    string_format(full_file_path, format_str, texture_name, "png");
+    KPROFILE_FUNCTION_BEGIN();
 
-    // Use a temporary texture to load into.
-    texture temp_texture;
+    // Upload finished loads, oldest first. The rest, and any over the limit, wait for the next frame.
+    u32 uploaded = 0;
+    u64 count = darray_length(state_ptr->pending_loads);
+    u64 kept = 0;
+    for(u64 i = 0; i < count; ++i)
+    {
+        texture_load_request* request = state_ptr->pending_loads[i];
+        // Cancelled and already finished loads upload nothing, so do not count against the limit.
+        b8 can_finish = request->cancelled || !request->name || uploaded < state_ptr->config.max_uploads_per_frame;
+        if(can_finish && job_system_is_complete(&request->counter))
+        {
+            if(finish_load(request))
+            {
+                uploaded++;
+            }
+            free_load(request);
+            continue;
+        }
+        state_ptr->pending_loads[kept++] = request;
+    }
+    darray_length_set(state_ptr->pending_loads, kept);
 
-    u8* data = stbi_load(
-        full_file_path,
-        (i32*)&temp_texture.width,
-        (i32*)&temp_texture.height,
-        (i32*)&temp_texture.channel_count,
-        required_channel_count
-    );
+    update_streaming();
+    state_ptr->frame_number++;
+
+    KPROFILE_END();
+}
+
+b8 load_texture(const char* texture_name, texture* t, u32 mip_level) 
+{
+    decoded_texture decoded;
+    if(!decode_texture(texture_name, mip_level, &decoded))
+    {
+        return false;
+    }
+
+    upload_texture(texture_name, t, &decoded);
+    free_decoded(&decoded);
+    return true;
+}
+
+static void decode_texture_job(void* params)
+{
+    texture_load_request* request = *(texture_load_request**)params;
+    request->succeeded = decode_texture(request->name, request->mip_level, &request->decoded);
+}
+
+// Queues a job to decode a mip of a texture, or BASE_MIP, for the slot with the given handle.
+static b8 start_load(const char* texture_name, u32 handle, u32 mip_level)
+{
+    texture_load_request* request = kallocate(sizeof(texture_load_request), MEMORY_TAG_TEXTURE);
+    request->name = string_duplicate(texture_name);
+    request->handle = handle;
+    request->mip_level = mip_level;
+
+    if(!job_system_submit(decode_texture_job, &request, sizeof(request), JOB_PRIORITY_LOW, &request->counter))
+    {
+        kfree(request->name, string_length(request->name) + 1, MEMORY_TAG_STRING);
+        free_load(request);
+        return false;
+    }
 
-    temp_texture.channel_count = required_channel_count;
+    darray_push(state_ptr->pending_loads, request);
+    return true;
+}
 
-    if(data) 
+// Returns the pending load for a handle which is neither cancelled nor finished, or 0 if there is none.
+static texture_load_request* find_pending_load(u32 handle)
+{
+    u64 count = darray_length(state_ptr->pending_loads);
+    for(u64 i = 0; i < count; ++i)
     {
-        u32 current_generation = t->generation;
-        t->generation = INVALID_ID;
+        texture_load_request* request = state_ptr->pending_loads[i];
+        if(request->handle == handle && !request->cancelled && request->name)
+        {
+            return request;
+        }
+    }
+    return 0;
+}
 
-        u64 total_size = temp_texture.width * temp_texture.height * required_channel_count;
-        // Check for transparency
-        b32 has_transparency = false;
-        for(u64 i = 0; i < total_size; i += required_channel_count) 
+/**
+ * Uploads a decoded load unless it was cancelled, and frees its pixels. The decoding job must be done.
+ * Does nothing if the load was already finished. The request stays in the pending list until
+ * texture_system_update removes it.
+ * Returns true if a texture was uploaded.
+ */
+static b8 finish_load(texture_load_request* request)
+{
+    if(!request->name)
+    {
+        return false;
+    }
+
+    b8 uploaded = false;
+    if(!request->cancelled)
+    {
+        if(request->succeeded)
         {
-            u8 a = data[i + 3];
-            if(a < 255) 
+            texture* t = &state_ptr->registered_textures[request->handle];
+            upload_texture(request->name, t, &request->decoded);
+            t->id = request->handle;
+            uploaded = true;
+
+            // Released while it was loading, but not unloaded, so it can be evicted straight away.
+            texture_reference ref;
+            if(hashtable_get(&state_ptr->registered_texture_table, request->name, &ref) && ref.reference_count == 0)
             {
-                has_transparency = true;
-                break;
+                lru_push(request->handle);
+                enforce_vram_budget();
             }
         }
+        else
+        {
+            KERROR("Failed to load texture '%s'. The default texture will be used in its place.", request->name);
+        }
+    }
+
+    if(request->succeeded)
+    {
+        free_decoded(&request->decoded);
+    }
+    kfree(request->name, string_length(request->name) + 1, MEMORY_TAG_STRING);
+    request->name = 0;
+    return uploaded;
+}
+
+static void free_load(texture_load_request* request)
+{
+    kfree(request, sizeof(texture_load_request), MEMORY_TAG_TEXTURE);
+}
+
+// Takes the pixels of a mip, or the base mip, from an open cooked texture.
+static void use_cooked_mip(u32 mip_level, decoded_texture* decoded)
+{
+    const cooked_texture* cooked = &decoded->cooked;
+    decoded->mip_count = cooked->header->mip_count;
 
-        if(stbi_failure_reason()) 
+    // The base mip is the largest one no bigger than the configured size.
+    decoded->base_mip = 0;
+    u32 base_size = state_ptr->config.stream_base_size;
+    if(base_size > 0)
+    {
+        while(decoded->base_mip + 1 < decoded->mip_count &&
+              (cooked->mips[decoded->base_mip].width > base_size || cooked->mips[decoded->base_mip].height > base_size))
         {
-            KWARN("load_texture() failed to load file '%s': %s", full_file_path, stbi_failure_reason());
+            decoded->base_mip++;
         }
+    }
 
-        // Acquire internal texture resources and upload to GPU.
-        renderer_create_texture(
-            texture_name,
-            temp_texture.width,
-            temp_texture.height,
-            temp_texture.channel_count,
-            data,
-            has_transparency,
-            &temp_texture
-        );
+    u32 level = mip_level == BASE_MIP ? decoded->base_mip : mip_level;
+    if(level >= decoded->mip_count)
+    {
+        level = decoded->mip_count - 1;
+    }
 
-        // Take a copy of the old texture.
-        texture old = *t;
+    // The pixels are used straight out of the mapping.
+    decoded->is_cooked = true;
+    decoded->mip_level = level;
+    decoded->pixels = cooked_texture_mip_pixels(cooked, level);
+    decoded->width = cooked->mips[level].width;
+    decoded->height = cooked->mips[level].height;
+    decoded->full_width = cooked->header->width;
+    decoded->full_height = cooked->header->height;
+    decoded->has_transparency = cooked->header->has_transparency;
+}
 
-        // Assign the temp texture to the pointer.
-        *t = temp_texture;
+// Decodes a mip of a texture's file, or its base mip, into pixels, which must be freed with free_decoded.
+// An up to date cooked copy of the file is mapped in its place, and a missing or stale one is cooked. Only
+// cooked textures have mips to choose from. Safe to call from any thread.
+static b8 decode_texture(const char* texture_name, u32 mip_level, decoded_texture* out_decoded)
+{
+    kzero_memory(out_decoded, sizeof(decoded_texture));
 
-        // Destroy the old texture.
-        renderer_destroy_texture(&old);
+    // Paths in the VFS, which finds them in whichever directory or pack is mounted there.
+    char* format_str = "assets/textures/%s.%s";
+    char full_file_path[512];
+
+    // TODO: try different extensions
+    string_format(full_file_path, format_str, texture_name, "png");
 
-        if(current_generation == INVALID_ID) 
+    file_info source_info;
+    b8 use_cooked = !state_ptr->config.disable_cooked_textures && vfs_get_info(full_file_path, &source_info);
+    char cooked_file_path[512];
+    if(use_cooked)
+    {
+        string_format(cooked_file_path, format_str, texture_name, COOKED_TEXTURE_EXTENSION);
+        if(cooked_texture_open(cooked_file_path, full_file_path, &source_info, &out_decoded->cooked))
         {
-            t->generation = 0;
-        } 
-        else 
+            use_cooked_mip(mip_level, out_decoded);
+            return true;
+        }
+    }
+
+    // Read the whole file, since a cooked copy needs its hash.
+    vfs_file file;
+    if(!vfs_read(full_file_path, &file))
+    {
+        KWARN("load_texture() failed to open file '%s'.", full_file_path);
+        return false;
+    }
+
+    image img;
+    if(!image_decode(full_file_path, file.data, file.size, &img))
+    {
+        vfs_close(&file);
+        return false;
+    }
+
+    if(use_cooked)
+    {
+        // Not being able to cook, such as from a read-only asset folder, only costs the next load a decode.
+        // The cooked copy goes to the most recent directory mount covering its path, even for a texture
+        // read from a pack, so with the working directory mounted at "" a packed texture is cooked into
+        // ./assets/textures. Only when the pack already holds a cooked copy, or no directory covers the
+        // path, is nothing written.
+        u64 source_hash = hash_bytes(file.data, file.size, 0);
+        vfs_close(&file);
+        char cooked_real_path[512];
+        b8 cooked = vfs_get_real_path(cooked_file_path, cooked_real_path, sizeof(cooked_real_path)) &&
+                    cooked_texture_write(cooked_real_path, &source_info, source_hash, img.width, img.height, img.pixels, img.has_transparency);
+        if(!cooked)
+        {
+            KDEBUG("load_texture() could not write cooked texture '%s'.", cooked_file_path);
+        }
+        else if(cooked_texture_open(cooked_file_path, full_file_path, &source_info, &out_decoded->cooked))
         {
-            t->generation = current_generation + 1;
+            // Load from the new copy, which has the mips.
+            image_free(&img);
+            use_cooked_mip(mip_level, out_decoded);
+            return true;
         }
+    }
+    else
+    {
+        vfs_close(&file);
+    }
 
-        // Clean up data.
-        stbi_image_free(data);
+    out_decoded->decoded_image = img;
+    out_decoded->pixels = img.pixels;
+    out_decoded->width = img.width;
+    out_decoded->height = img.height;
+    out_decoded->has_transparency = img.has_transparency;
+    out_decoded->mip_count = 1;
+    out_decoded->full_width = img.width;
+    out_decoded->full_height = img.height;
+    return true;
+}
 
-        return true;
+static void free_decoded(decoded_texture* decoded)
+{
+    if(decoded->is_cooked)
+    {
+        cooked_texture_close(&decoded->cooked);
+    }
+    else
+    {
+        image_free(&decoded->decoded_image);
+    }
+    decoded->pixels = 0;
+}
+
+// Creates the renderer's texture from decoded pixels and swaps it in for t, bumping its generation.
+static void upload_texture(const char* texture_name, texture* t, decoded_texture* decoded)
+{
+    u32 current_generation = t->generation;
+    t->generation = INVALID_ID;
+
+    // Use a temporary texture to load into.
+    texture temp_texture;
+
+    // Acquire internal texture resources and upload to GPU.
+    renderer_create_texture(
+        texture_name,
+        decoded->width,
+        decoded->height,
+        4,
+        decoded->pixels,
+        decoded->has_transparency,
+        &t->sampler,
+        &temp_texture
+    );
+
+    // Take a copy of the old texture.
+    texture old = *t;
+
+    // Assign the temp texture to the pointer, keeping its slot.
+    *t = temp_texture;
+    t->id = old.id;
+
+    // Destroy the old texture, if there is one. Destroying waits for the GPU to go idle, which a first
+    // upload does not need to do.
+    if(current_generation != INVALID_ID)
+    {
+        renderer_destroy_texture(&old);
+    }
+
+    u32 handle = (u32)(t - state_ptr->registered_textures);
+    texture_residency* residency = &state_ptr->residency[handle];
+    if(current_generation == INVALID_ID)
+    {
+        state_ptr->residency_stats.resident_count++;
+        // Carry on from the slot's last texture, so the texture's users see a new generation.
+        current_generation = residency->last_generation;
+    }
+    state_ptr->residency_stats.resident_bytes -= residency->gpu_bytes;
+    residency->gpu_bytes = texture_gpu_size(t);
+    state_ptr->residency_stats.resident_bytes += residency->gpu_bytes;
+
+    residency->mip_count = decoded->mip_count;
+    residency->base_mip = decoded->base_mip;
+    residency->resident_mip = decoded->mip_level;
+    residency->full_width = decoded->full_width;
+    residency->full_height = decoded->full_height;
+    residency->last_needed_frame = state_ptr->frame_number;
+    if(decoded->base_mip > 0 && !residency->name)
+    {
+        residency->name = string_duplicate(texture_name);
+    }
+
+    if(current_generation == INVALID_ID) 
+    {
+        t->generation = 0;
     } 
     else 
     {
-        if(stbi_failure_reason()) 
+        t->generation = current_generation + 1;
+    }
+
+    enforce_vram_budget();
+}
+
+/*
+    Loads a higher resolution mip for each streamed texture asked for one in the last frame, and drops
+    back to the base mip once a higher one has not been asked for in STREAM_DOWNGRADE_FRAMES. Both swap
+    the texture through the usual asynchronous load, so its generation changes when the new mip is in.
+*/
+static void update_streaming()
+{
+    u64 frame = state_ptr->frame_number;
+    u64 count = darray_length(state_ptr->stream_list);
+    u64 kept = 0;
+    for(u64 i = 0; i < count; ++i)
+    {
+        u32 handle = state_ptr->stream_list[i];
+        texture_residency* residency = &state_ptr->residency[handle];
+        texture* t = &state_ptr->registered_textures[handle];
+
+        // Unloaded, or evicted, since it was asked for. It comes back at its base mip.
+        if(t->generation == INVALID_ID || !residency->name)
         {
-            KWARN("load_texture() failed to load file '%s': %s", full_file_path, stbi_failure_reason());
+            residency->in_stream_list = false;
+            continue;
         }
 
-        return false;
+        u32 target = residency->resident_mip;
+        if(residency->last_request_frame == frame && residency->requested_mip <= residency->resident_mip)
+        {
+            residency->last_needed_frame = frame;
+            target = residency->requested_mip;
+        }
+        else if(frame - residency->last_needed_frame > STREAM_DOWNGRADE_FRAMES)
+        {
+            // Drawn smaller than the resident mip for a while, or not drawn at all.
+            target = residency->last_request_frame == frame ? residency->requested_mip : residency->base_mip;
+        }
+
+        if(target != residency->resident_mip && !find_pending_load(handle))
+        {
+            if(!start_load(residency->name, handle, target))
+            {
+                KWARN("Failed to start streaming mip %u of texture '%s'.", target, residency->name);
+            }
+        }
+
+        // Back at the base mip, with nothing asking for more.
+        if(residency->resident_mip == residency->base_mip && target == residency->base_mip && residency->last_request_frame != frame)
+        {
+            residency->in_stream_list = false;
+            continue;
+        }
+        state_ptr->stream_list[kept++] = handle;
     }
-}
\ No newline at end of file
+    darray_length_set(state_ptr->stream_list, kept);
+}
+
+// GPU memory used by a texture and its mips.
+static u64 texture_gpu_size(const texture* t)
+{
+    u64 size = 0;
+    u32 width = t->width;
+    u32 height = t->height;
+    u32 levels = t->mip_levels > 0 ? t->mip_levels : 1;
+    for(u32 level = 0; level < levels; ++level)
+    {
+        size += (u64)width * height * t->channel_count;
+        width = width > 1 ? width / 2 : 1;
+        height = height > 1 ? height / 2 : 1;
+    }
+    return size;
+}
+
+// Adds a loaded texture which nothing references to the back of the eviction order.
+static void lru_push(u32 handle)
+{
+    texture_residency* residency = &state_ptr->residency[handle];
+    if(residency->in_lru)
+    {
+        return;
+    }
+
+    residency->in_lru = true;
+    residency->lru_prev = state_ptr->lru_tail;
+    residency->lru_next = INVALID_ID;
+    if(state_ptr->lru_tail != INVALID_ID)
+    {
+        state_ptr->residency[state_ptr->lru_tail].lru_next = handle;
+    }
+    else
+    {
+        state_ptr->lru_head = handle;
+    }
+    state_ptr->lru_tail = handle;
+    state_ptr->residency_stats.evictable_count++;
+}
+
+static void lru_remove(u32 handle)
+{
+    texture_residency* residency = &state_ptr->residency[handle];
+    if(!residency->in_lru)
+    {
+        return;
+    }
+
+    if(residency->lru_prev != INVALID_ID)
+    {
+        state_ptr->residency[residency->lru_prev].lru_next = residency->lru_next;
+    }
+    else
+    {
+        state_ptr->lru_head = residency->lru_next;
+    }
+    if(residency->lru_next != INVALID_ID)
+    {
+        state_ptr->residency[residency->lru_next].lru_prev = residency->lru_prev;
+    }
+    else
+    {
+        state_ptr->lru_tail = residency->lru_prev;
+    }
+    residency->in_lru = false;
+    state_ptr->residency_stats.evictable_count--;
+}
+
+// Destroys a slot's texture and stops counting it as resident. Resetting the slot is up to the caller.
+static void unload_texture(u32 handle)
+{
+    texture_residency* residency = &state_ptr->residency[handle];
+    lru_remove(handle);
+    renderer_destroy_texture(&state_ptr->registered_textures[handle]);
+    state_ptr->residency_stats.resident_bytes -= residency->gpu_bytes;
+    state_ptr->residency_stats.resident_count--;
+    residency->gpu_bytes = 0;
+}
+
+// Unloads a texture but keeps its slot, so the next acquire loads it again.
+static void evict_texture(u32 handle)
+{
+    texture* t = &state_ptr->registered_textures[handle];
+    u32 id = t->id;
+    u32 generation = t->generation;
+    texture_sampler_params sampler = t->sampler;
+
+    unload_texture(handle);
+
+    t->id = id;
+    t->generation = INVALID_ID;
+    t->sampler = sampler;
+    state_ptr->residency[handle].last_generation = generation;
+    state_ptr->residency_stats.eviction_count++;
+}
+
+// Evicts the least recently released textures until within the budget, or until none are left to evict.
+static void enforce_vram_budget()
+{
+    u64 budget = state_ptr->config.vram_budget;
+    if(budget == 0)
+    {
+        return;
+    }
+
+    while(state_ptr->residency_stats.resident_bytes > budget && state_ptr->lru_head != INVALID_ID)
+    {
+        evict_texture(state_ptr->lru_head);
+    }
+}
+
+// Takes an unused slot and marks it live. Returns INVALID_ID if every slot is in use.
+static u32 allocate_slot()
+{
+    if(state_ptr->free_count == 0)
+    {
+        return INVALID_ID;
+    }
+
+    u32 handle = state_ptr->free_slots[--state_ptr->free_count];
+    state_ptr->residency[handle].live_index = state_ptr->live_count;
+    state_ptr->live_slots[state_ptr->live_count++] = handle;
+    return handle;
+}
+
+// Returns a slot to the free stack. Handles to its texture stop resolving.
+static void free_slot(u32 handle)
+{
+    texture_residency* residency = &state_ptr->residency[handle];
+
+    // Swap the last live slot into this one's place.
+    u32 last = state_ptr->live_slots[--state_ptr->live_count];
+    state_ptr->live_slots[residency->live_index] = last;
+    state_ptr->residency[last].live_index = residency->live_index;
+    residency->live_index = INVALID_ID;
+
+    residency->slot_generation++;
+    state_ptr->free_slots[state_ptr->free_count++] = handle;
+}
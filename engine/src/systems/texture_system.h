@@ -5,14 +5,112 @@
 typedef struct texture_system_config
 {
     u32 max_texture_count;
+    // Textures loaded with texture_system_acquire_async which are uploaded per texture_system_update.
+    // Spreads the cost of a burst of loads over several frames. 0 uses 4.
+    u32 max_uploads_per_frame;
+    // Textures are normally loaded from a cooked copy next to their file, which is written the first time
+    // the file is loaded. Set to always decode the file instead.
+    b8 disable_cooked_textures;
+    // Bytes of GPU memory loaded textures may use, or 0 for no limit. When over it, textures nothing
+    // references are unloaded, least recently released first, and loaded again when next acquired.
+    u64 vram_budget;
+    // 0 loads textures whole. Otherwise textures are loaded at the largest mip no bigger than this on
+    // either side, and higher resolution mips are streamed in as texture_system_request_screen_size asks
+    // for them. Only cooked textures have mips to stream.
+    u32 stream_base_size;
 } texture_system_config;
 
+typedef struct texture_residency_stats
+{
+    // GPU memory used by loaded textures, mips included. The default texture is not counted.
+    u64 resident_bytes;
+    u32 resident_count;
+    // Loaded textures with no references, which can be evicted.
+    u32 evictable_count;
+    // Textures evicted to stay within the budget since initialization.
+    u64 eviction_count;
+} texture_residency_stats;
+
+// Refers to a texture slot for as long as the texture in it stays acquired. Packs the slot index in the
+// low 32 bits and the slot's generation in the high 32, so a handle kept after its texture is released
+// does not resolve to whatever reuses the slot.
+typedef u64 texture_handle;
+#define INVALID_TEXTURE_HANDLE 0
+
 #define DEFAULT_TEXTURE_NAME "default"
 
 b8 texture_system_initialize(u64* memory_requirement, void* state, texture_system_config config);
 void texture_system_shutdown(void* state);
 
 texture* texture_system_acquire(const char* name, b8 auto_release);
+
+/**
+ * Acquires a texture like texture_system_acquire, but without waiting for it to load. A texture which
+ * is not loaded yet is returned with an invalid generation, which the renderer draws as the default
+ * texture. Its file is decoded by the job system, and it is uploaded by a later texture_system_update,
+ * which gives it a valid generation.
+ * @param name The name of the texture.
+ * @param auto_release Indicates if the texture is unloaded once its reference count reaches 0.
+ * @returns The texture, or 0 if it cannot be acquired.
+ */
+texture* texture_system_acquire_async(const char* name, b8 auto_release);
+
+/**
+ * Acquires several textures like texture_system_acquire, decoding their files in parallel on the job
+ * system, and returns once all of them are loaded. Much quicker than acquiring them one at a time when
+ * loading a level.
+ * @param count The number of textures.
+ * @param names The names of the textures.
+ * @param auto_release Indicates if the textures are unloaded once their reference counts reach 0.
+ * @param out_textures An array of count pointers to hold the textures. One which cannot be acquired is
+ * set to 0. One whose file fails to load is still acquired, and drawn as the default texture.
+ * @returns True if every texture was acquired and loaded; otherwise false.
+ */
+b8 texture_system_acquire_batch(u32 count, const char** names, b8 auto_release, texture** out_textures);
 void texture_system_release(const char* name);
 
-texture* texture_system_get_default_texture();
\ No newline at end of file
+/**
+ * Sets how an acquired texture is sampled. A texture which is already loaded is uploaded again, and
+ * gets a new generation. The parameters are kept until the texture is unloaded.
+ * @param name The name of the texture.
+ * @param sampler The sampler parameters.
+ * @returns True on success; otherwise false.
+ */
+b8 texture_system_set_sampler(const char* name, texture_sampler_params sampler);
+
+texture* texture_system_get_default_texture();
+
+/**
+ * Gets a handle to an acquired texture, which can be held instead of the pointer to find out whether
+ * the texture has since been released.
+ * @param t The texture.
+ * @returns The handle, or INVALID_TEXTURE_HANDLE for the default texture or one not acquired.
+ */
+texture_handle texture_system_get_handle(const texture* t);
+
+/**
+ * Gets the texture a handle refers to.
+ * @param handle The handle.
+ * @returns The texture, or 0 if it has been released since the handle was made.
+ */
+texture* texture_system_resolve(texture_handle handle);
+
+/**
+ * Reports how large a texture is drawn this frame, so a streamed texture can load the mip it needs.
+ * Called by the renderer for each texture it draws. Textures which are not streamed are ignored.
+ * @param t The texture.
+ * @param screen_size The size in pixels which the whole texture covers on screen, along its larger side.
+ */
+void texture_system_request_screen_size(texture* t, f32 screen_size);
+
+/**
+ * Gets the texture system's GPU memory use.
+ * @param out_stats A pointer to hold the stats.
+ */
+void texture_system_get_residency_stats(texture_residency_stats* out_stats);
+
+/**
+ * Uploads textures whose asynchronous load has finished decoding, up to the configured number per
+ * frame. Must be called on the main thread, once per frame before rendering.
+ */
+void texture_system_update();
\ No newline at end of file
@@ -0,0 +1,89 @@
+#include <defines.h>
+
+#include <core/kmemory.h>
+#include <core/log_binary.h>
+#include <platform/filesystem.h>
+
+// TODO: temporary
+#include <stdio.h>
+
+/*
+    Converts a console.log written by the engine in binary mode (logger_config.binary) back to text.
+
+    Usage: logdecode <binary log> [output file]
+    Without an output file the text is written to stdout.
+*/
+
+typedef struct decode_output
+{
+    file_handle file;
+    b8 to_file;
+    u64 message_count;
+} decode_output;
+
+static void write_message(log_level level, const char* text, u32 length, void* user_data)
+{
+    decode_output* output = user_data;
+    if(output->to_file)
+    {
+        u64 written = 0;
+        filesystem_write(&output->file, length, text, &written);
+    }
+    else
+    {
+        fwrite(text, 1, length, stdout);
+    }
+    output->message_count++;
+}
+
+int main(int argc, char** argv)
+{
+    if(argc < 2 || argc > 3)
+    {
+        fprintf(stderr, "Usage: %s <binary log> [output file]\n", argv[0]);
+        return 1;
+    }
+
+    file_handle input;
+    if(!filesystem_open(argv[1], FILE_MODE_READ, true, &input))
+    {
+        fprintf(stderr, "Unable to open '%s'.\n", argv[1]);
+        return 1;
+    }
+    u8* bytes = 0;
+    u64 size = 0;
+    b8 read = filesystem_read_all_bytes(&input, &bytes, &size);
+    filesystem_close(&input);
+    if(!read)
+    {
+        fprintf(stderr, "Unable to read '%s'.\n", argv[1]);
+        return 1;
+    }
+
+    decode_output output = {};
+    if(argc == 3)
+    {
+        if(!filesystem_open(argv[2], FILE_MODE_WRITE, true, &output.file))
+        {
+            fprintf(stderr, "Unable to open '%s' for writing.\n", argv[2]);
+            kfree(bytes, size, MEMORY_TAG_STRING);
+            return 1;
+        }
+        output.to_file = true;
+    }
+
+    b8 result = log_binary_decode(bytes, size, write_message, &output);
+
+    if(output.to_file)
+    {
+        filesystem_close(&output.file);
+    }
+    kfree(bytes, size, MEMORY_TAG_STRING);
+
+    if(!result)
+    {
+        fprintf(stderr, "'%s' is not a binary log, or is corrupt. %llu messages were decoded.\n", argv[1], output.message_count);
+        return 1;
+    }
+    return 0;
+}
@@ -4,6 +4,9 @@
 
 #include <core/kmemory.h>
 
+// TODO: temporary
+#include <stdlib.h>
+
 // Define the function to create a game.
 b8 create_game(game* out_game)
 {
@@ -14,6 +17,22 @@ b8 create_game(game* out_game)
     out_game->app_config.start_height = 720;
     out_game->app_config.name = "KoEngine Testbed";
 
+    // Set KOENGINE_HEADLESS to run without a window or GPU, e.g. on build machines. Headless runs
+    // are for frame-time benchmarks, so they stop after a fixed number of frames.
+    // KOENGINE_OFFSCREEN does the same, but still renders through Vulkan (lavapipe will do) into
+    // offscreen images, so the frame times include real rendering work.
+    out_game->app_config.offscreen = getenv("KOENGINE_OFFSCREEN") != 0;
+    out_game->app_config.headless = getenv("KOENGINE_HEADLESS") != 0 || out_game->app_config.offscreen;
+    out_game->app_config.frame_limit = out_game->app_config.headless ? 1000 : 0;
+
+    // Simulate at a fixed 60 Hz. Windowed runs are paced to 120 fps rather than spinning flat out;
+    // headless benchmark runs are not paced at all.
+    out_game->app_config.loop_mode = APPLICATION_LOOP_MODE_FIXED;
+    out_game->app_config.fixed_update_rate = 60;
+    out_game->app_config.max_updates_per_frame = 5;
+    out_game->app_config.target_frame_rate = out_game->app_config.headless ? 0 : 120;
+    out_game->app_config.frame_pacing_spin_ms = 1.0f;
+
     // Assign function pointers of the game.
     out_game->update = game_update;
     out_game->render = game_render;
@@ -58,12 +58,14 @@ b8 game_initialize(game* game_inst)
 
 b8 game_update(game* game_inst, f32 delta_time) 
 {
-    static u64 alloc_count = 0;
-    u64 prev_alloc_count = alloc_count; 
-    alloc_count = get_memory_alloc_count();
     if(input_is_key_up('M') && input_was_key_down('M'))
     {
-        KDEBUG("Allocations: %llu (%llu this frame)", alloc_count, alloc_count - prev_alloc_count);
+        // Frame stats describe the last completed frame.
+        memory_stats stats;
+        if(memory_system_get_stats(&stats))
+        {
+            KDEBUG("Allocations: %llu (%llu last frame, %lldB net), peak %lluB", stats.allocation_count, stats.frame_allocation_count, stats.frame_delta_bytes, stats.peak_allocated);
+        }
     }
 
     // TODO: temp
@@ -154,7 +156,7 @@ b8 game_update(game* game_inst, f32 delta_time)
     return true;
 }
 
-b8 game_render(game* game_inst, f32 delta_time) 
+b8 game_render(game* game_inst, f32 delta_time, f32 interpolation) 
 {
     return true;
 }
@@ -18,6 +18,6 @@ b8 game_initialize(game* game_inst);
 
 b8 game_update(game* game_inst, f32 delta_time);
 
-b8 game_render(game* game_inst, f32 delta_time);
+b8 game_render(game* game_inst, f32 delta_time, f32 interpolation);
 
 void game_on_resize(game* game_inst, u32 width, u32 height);
\ No newline at end of file
@@ -0,0 +1,174 @@
+#include "hashtable_benchmarks.h"
+#include "../test_manager.h"
+#include "../expect.h"
+
+#include <defines.h>
+#include <containers/hashtable.h>
+#include <core/kmemory.h>
+#include <core/kstring.h>
+#include <core/logger.h>
+#include <core/clock.h>
+
+/*
+    Benchmarks comparing the open-addressing hashtable against the original implementation,
+    which hashed with a multiply-by-97 loop and wrote straight into hash % element_count
+    without storing keys. The original is kept here verbatim as the baseline.
+*/
+
+#define BENCH_TABLE_SIZE 65536
+#define BENCH_NAME_COUNT 16384
+#define BENCH_NAME_LENGTH 32
+#define BENCH_ITERATIONS 8
+
+static u64 legacy_hash_name(const char* name, u32 element_count)
+{
+    static const u64 multiplier = 97;
+
+    unsigned const char* us;
+    u64 hash = 0;
+
+    for(us = (unsigned const char*)name; *us; us++)
+    {
+        hash = hash * multiplier + *us;
+    }
+
+    hash %= element_count;
+
+    return hash;
+}
+
+static void legacy_set(void* memory, u64 element_size, u32 element_count, const char* name, void* value)
+{
+    u64 hash = legacy_hash_name(name, element_count);
+    kcopy_memory(memory + (element_size * hash), value, element_size);
+}
+
+static void legacy_get(void* memory, u64 element_size, u32 element_count, const char* name, void* out_value)
+{
+    u64 hash = legacy_hash_name(name, element_count);
+    kcopy_memory(out_value, memory + (element_size * hash), element_size);
+}
+
+static char* create_bench_names()
+{
+    // Names shaped like asset names, e.g. "textures/level_3/brick_0417".
+    char* names = kallocate(BENCH_NAME_COUNT * BENCH_NAME_LENGTH, MEMORY_TAG_STRING);
+    for(u32 i = 0; i < BENCH_NAME_COUNT; ++i)
+    {
+        string_format(names + (i * BENCH_NAME_LENGTH), "textures/level_%u/brick_%04u", i % 7, i);
+    }
+    return names;
+}
+
+u8 hashtable_benchmark_set_and_get()
+{
+    char* names = create_bench_names();
+    u64* memory = kallocate(sizeof(u64) * BENCH_TABLE_SIZE, MEMORY_TAG_DICT);
+
+    // Legacy table. Only the sets and gets are timed, on both sides.
+    f64 legacy_seconds = 0;
+    u64 legacy_misses = 0;
+    for(u32 iteration = 0; iteration < BENCH_ITERATIONS; ++iteration)
+    {
+        kzero_memory(memory, sizeof(u64) * BENCH_TABLE_SIZE);
+        clock legacy_time;
+        clock_start(&legacy_time);
+        for(u64 i = 0; i < BENCH_NAME_COUNT; ++i)
+        {
+            legacy_set(memory, sizeof(u64), BENCH_TABLE_SIZE, names + (i * BENCH_NAME_LENGTH), &i);
+        }
+        for(u64 i = 0; i < BENCH_NAME_COUNT; ++i)
+        {
+            u64 value = 0;
+            legacy_get(memory, sizeof(u64), BENCH_TABLE_SIZE, names + (i * BENCH_NAME_LENGTH), &value);
+            legacy_misses += (value != i);
+        }
+        clock_update(&legacy_time);
+        legacy_seconds += legacy_time.elapsed;
+    }
+
+    // Open-addressing table.
+    f64 new_seconds = 0;
+    u64 new_misses = 0;
+    for(u32 iteration = 0; iteration < BENCH_ITERATIONS; ++iteration)
+    {
+        hashtable table;
+        hashtable_create(sizeof(u64), BENCH_TABLE_SIZE, memory, false, &table);
+        clock new_time;
+        clock_start(&new_time);
+        for(u64 i = 0; i < BENCH_NAME_COUNT; ++i)
+        {
+            hashtable_set(&table, names + (i * BENCH_NAME_LENGTH), &i);
+        }
+        for(u64 i = 0; i < BENCH_NAME_COUNT; ++i)
+        {
+            u64 value = 0;
+            hashtable_get(&table, names + (i * BENCH_NAME_LENGTH), &value);
+            new_misses += (value != i);
+        }
+        clock_update(&new_time);
+        new_seconds += new_time.elapsed;
+        hashtable_destroy(&table);
+    }
+
+    u64 operations = (u64)BENCH_ITERATIONS * BENCH_NAME_COUNT * 2;
+    KINFO("hashtable bench (%u names, %u slots): legacy %.2f ns/op, %llu wrong lookups | open addressing %.2f ns/op, %llu wrong lookups",
+          BENCH_NAME_COUNT, BENCH_TABLE_SIZE,
+          (legacy_seconds * 1000000000.0) / operations, legacy_misses,
+          (new_seconds * 1000000000.0) / operations, new_misses);
+
+    kfree(memory, sizeof(u64) * BENCH_TABLE_SIZE, MEMORY_TAG_DICT);
+    kfree(names, BENCH_NAME_COUNT * BENCH_NAME_LENGTH, MEMORY_TAG_STRING);
+
+    // Correctness is the point of the replacement: every lookup must find its own value.
+    expect_should_be(0, new_misses);
+
+    return true;
+}
+
+u8 hashtable_benchmark_lookup_miss()
+{
+    char* names = create_bench_names();
+    u64* memory = kallocate(sizeof(u64) * BENCH_TABLE_SIZE, MEMORY_TAG_DICT);
+
+    hashtable table;
+    hashtable_create(sizeof(u64), BENCH_TABLE_SIZE, memory, false, &table);
+    for(u64 i = 0; i < BENCH_NAME_COUNT; ++i)
+    {
+        hashtable_set(&table, names + (i * BENCH_NAME_LENGTH), &i);
+    }
+
+    // Names which were never inserted. Robin Hood ordering should let these stop early.
+    char* missing = kallocate(BENCH_NAME_COUNT * BENCH_NAME_LENGTH, MEMORY_TAG_STRING);
+    for(u32 i = 0; i < BENCH_NAME_COUNT; ++i)
+    {
+        string_format(missing + (i * BENCH_NAME_LENGTH), "models/level_%u/crate_%04u", i % 7, i);
+    }
+
+    u64 found = 0;
+    clock miss_time;
+    clock_start(&miss_time);
+    for(u32 i = 0; i < BENCH_NAME_COUNT; ++i)
+    {
+        found += hashtable_contains(&table, missing + (i * BENCH_NAME_LENGTH));
+    }
+    clock_update(&miss_time);
+
+    KINFO("hashtable bench: %u missing-name lookups at 25%% load, %.2f ns/op",
+          BENCH_NAME_COUNT, (miss_time.elapsed * 1000000000.0) / BENCH_NAME_COUNT);
+
+    hashtable_destroy(&table);
+    kfree(missing, BENCH_NAME_COUNT * BENCH_NAME_LENGTH, MEMORY_TAG_STRING);
+    kfree(memory, sizeof(u64) * BENCH_TABLE_SIZE, MEMORY_TAG_DICT);
+    kfree(names, BENCH_NAME_COUNT * BENCH_NAME_LENGTH, MEMORY_TAG_STRING);
+
+    expect_should_be(0, found);
+
+    return true;
+}
+
+void hashtable_register_benchmarks()
+{
+    test_manager_register_test(hashtable_benchmark_set_and_get, "Hashtable benchmark: set and get against the legacy table");
+    test_manager_register_test(hashtable_benchmark_lookup_miss, "Hashtable benchmark: lookups of missing names");
+}
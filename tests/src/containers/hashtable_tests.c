@@ -4,6 +4,7 @@
 
 #include <defines.h>
 #include <containers/hashtable.h>
+#include <core/kstring.h>
 
 u8 hashtable_should_create_and_destroy() {
     hashtable table;
@@ -318,6 +319,136 @@ u8 hashtable_should_set_get_and_update_ptr_successfully() {
     return true;
 }
 
+u8 hashtable_should_keep_all_entries_when_full() {
+    hashtable table;
+    const u32 element_count = 64;
+    u64 memory[64];
+
+    hashtable_create(sizeof(u64), element_count, memory, false, &table);
+
+    // Fill every slot. With 64 names in 64 slots, plenty of them share a home slot.
+    char name[32];
+    for(u64 i = 0; i < element_count; ++i) {
+        string_format(name, "texture_%llu", i);
+        b8 result = hashtable_set(&table, name, &i);
+        expect_to_be_true(result);
+    }
+    expect_should_be(element_count, table.entry_count);
+
+    // Every value must still be retrievable under its own name.
+    for(u64 i = 0; i < element_count; ++i) {
+        string_format(name, "texture_%llu", i);
+        u64 value = 999;
+        hashtable_get(&table, name, &value);
+        expect_should_be(i, value);
+    }
+
+    // No room for another entry.
+    KDEBUG("The following error message is intentional.");
+    u64 extra = 12345;
+    b8 result = hashtable_set(&table, "one_too_many", &extra);
+    expect_to_be_false(result);
+
+    hashtable_destroy(&table);
+
+    return true;
+}
+
+u8 hashtable_should_remove_without_losing_neighbours() {
+    hashtable table;
+    const u32 element_count = 32;
+    u64 memory[32];
+
+    hashtable_create(sizeof(u64), element_count, memory, false, &table);
+
+    char name[32];
+    for(u64 i = 0; i < 24; ++i) {
+        string_format(name, "entry_%llu", i);
+        hashtable_set(&table, name, &i);
+    }
+
+    // Remove every other entry.
+    for(u64 i = 0; i < 24; i += 2) {
+        string_format(name, "entry_%llu", i);
+        expect_to_be_true(hashtable_remove(&table, name));
+    }
+    expect_should_be(12, table.entry_count);
+
+    // Removed entries are gone, the rest are intact.
+    for(u64 i = 0; i < 24; ++i) {
+        string_format(name, "entry_%llu", i);
+        if(i % 2 == 0) {
+            expect_to_be_false(hashtable_contains(&table, name));
+        } else {
+            u64 value = 0;
+            hashtable_get(&table, name, &value);
+            expect_should_be(i, value);
+        }
+    }
+
+    // Removing again should report nothing was removed.
+    expect_to_be_false(hashtable_remove(&table, "entry_0"));
+
+    hashtable_destroy(&table);
+
+    return true;
+}
+
+u8 hashtable_should_keep_keys_across_arena_growth() {
+    hashtable table;
+    const u32 element_count = 4;
+    u64 memory[4];
+
+    hashtable_create(sizeof(u64), element_count, memory, false, &table);
+
+    // Keys much longer than the arena was sized for, replaced many times over, so it is both
+    // compacted to reclaim removed keys and grown to fit live ones.
+    char name[160];
+    for(u64 round = 0; round < 50; ++round) {
+        for(u64 i = 0; i < element_count; ++i) {
+            string_format(name, "%0120llu/round_%llu/entry_%llu", i, round, i);
+            u64 value = round * 10 + i;
+            expect_to_be_true(hashtable_set(&table, name, &value));
+        }
+        for(u64 i = 0; i < element_count; ++i) {
+            string_format(name, "%0120llu/round_%llu/entry_%llu", i, round, i);
+            u64 value = 0;
+            hashtable_get(&table, name, &value);
+            expect_should_be(round * 10 + i, value);
+            expect_to_be_true(hashtable_remove(&table, name));
+        }
+    }
+    expect_should_be(0, table.entry_count);
+
+    hashtable_destroy(&table);
+
+    return true;
+}
+
+u8 hashtable_should_return_fill_value_for_nonexistant() {
+    hashtable table;
+    u64 memory[8];
+
+    hashtable_create(sizeof(u64), 8, memory, false, &table);
+
+    u64 fill = 77;
+    hashtable_fill(&table, &fill);
+
+    u64 value = 0;
+    hashtable_get(&table, "never_set", &value);
+    expect_should_be(77, value);
+
+    u64 testval = 5;
+    hashtable_set(&table, "set", &testval);
+    hashtable_remove(&table, "set");
+    hashtable_get(&table, "set", &value);
+    expect_should_be(77, value);
+
+    hashtable_destroy(&table);
+
+    return true;
+}
+
 void hashtable_register_tests() {
     test_manager_register_test(hashtable_should_create_and_destroy, "Hashtable should create and destroy");
     test_manager_register_test(hashtable_should_set_and_get_successfully, "Hashtable should set and get");
@@ -328,4 +459,8 @@ void hashtable_register_tests() {
     test_manager_register_test(hashtable_try_call_non_ptr_on_ptr_table, "Hashtable try calling non-pointer functions on pointer type table.");
     test_manager_register_test(hashtable_try_call_ptr_on_non_ptr_table, "Hashtable try calling pointer functions on non-pointer type table.");
     test_manager_register_test(hashtable_should_set_get_and_update_ptr_successfully, "Hashtable Should get pointer, update, and get again successfully.");
+    test_manager_register_test(hashtable_should_keep_all_entries_when_full, "Hashtable should keep colliding entries apart until full.");
+    test_manager_register_test(hashtable_should_remove_without_losing_neighbours, "Hashtable should remove entries without losing neighbouring entries.");
+    test_manager_register_test(hashtable_should_keep_keys_across_arena_growth, "Hashtable should keep keys when its key arena compacts and grows.");
+    test_manager_register_test(hashtable_should_return_fill_value_for_nonexistant, "Hashtable should return the fill value for non-existent entries.");
 }
\ No newline at end of file
@@ -0,0 +1,80 @@
+#include "clock_tests.h"
+#include "../test_manager.h"
+#include "../expect.h"
+
+#include <defines.h>
+
+#include <core/clock.h>
+#include <platform/platform.h>
+
+u8 fixed_timestep_should_hand_out_whole_steps()
+{
+    fixed_timestep timestep;
+    fixed_timestep_create(0.25, 5, &timestep);
+
+    // Less than a step runs nothing, and is carried over.
+    expect_should_be(0, fixed_timestep_advance(&timestep, 0.125));
+    expect_float_to_be(0.5f, fixed_timestep_alpha(&timestep));
+
+    // Which with the next frame makes two steps, and a quarter left over.
+    expect_should_be(2, fixed_timestep_advance(&timestep, 0.4375));
+    expect_float_to_be(0.25f, fixed_timestep_alpha(&timestep));
+
+    // Negative time, e.g. from a clock reset, is ignored.
+    expect_should_be(0, fixed_timestep_advance(&timestep, -1.0));
+    expect_float_to_be(0.25f, fixed_timestep_alpha(&timestep));
+    expect_should_be(0, timestep.dropped_steps);
+
+    return true;
+}
+
+u8 fixed_timestep_should_drop_what_it_cannot_catch_up()
+{
+    fixed_timestep timestep;
+    fixed_timestep_create(0.25, 3, &timestep);
+
+    // Ten and a half steps' worth, e.g. after a hitch. Only three run; the other seven are dropped, but
+    // the partial step is kept.
+    expect_should_be(3, fixed_timestep_advance(&timestep, 2.625));
+    expect_should_be(7, timestep.dropped_steps);
+    expect_float_to_be(0.5f, fixed_timestep_alpha(&timestep));
+
+    // Afterwards it carries on as normal.
+    expect_should_be(1, fixed_timestep_advance(&timestep, 0.125));
+    expect_float_to_be(0.0f, fixed_timestep_alpha(&timestep));
+    expect_should_be(7, timestep.dropped_steps);
+
+    return true;
+}
+
+u8 clock_wait_until_should_not_return_early()
+{
+    const f64 spin_seconds = 0.001;
+
+    for(u32 i = 0; i < 5; ++i)
+    {
+        f64 target = platform_get_absolute_time() + 0.004;
+        clock_wait_until(target, spin_seconds);
+        f64 now = platform_get_absolute_time();
+        b8 reached = now >= target;
+        // Generous, as the machine running the tests may be busy. Only catches a wait gone badly wrong.
+        b8 prompt = now - target < 0.05;
+        expect_to_be_true(reached);
+        expect_to_be_true(prompt);
+    }
+
+    // A time already passed returns at once.
+    f64 before = platform_get_absolute_time();
+    clock_wait_until(before - 1.0, spin_seconds);
+    b8 returned_at_once = platform_get_absolute_time() - before < 0.05;
+    expect_to_be_true(returned_at_once);
+
+    return true;
+}
+
+void clock_register_tests()
+{
+    test_manager_register_test(fixed_timestep_should_hand_out_whole_steps, "Fixed timestep should hand out whole steps");
+    test_manager_register_test(fixed_timestep_should_drop_what_it_cannot_catch_up, "Fixed timestep should drop what it cannot catch up");
+    test_manager_register_test(clock_wait_until_should_not_return_early, "Clock wait until should not return early");
+}
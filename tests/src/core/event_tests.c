@@ -0,0 +1,406 @@
+#include "event_tests.h"
+#include "../test_manager.h"
+#include "../expect.h"
+
+#include <defines.h>
+
+#include <core/event.h>
+#include <core/kmemory.h>
+#include <platform/platform.h>
+
+#define TEST_EVENT_CODE 0x200
+
+typedef struct event_recorder
+{
+    u32 count;
+    u16 codes[8];
+    event_context contexts[8];
+    // When set, the listener posts this code back the first time it is called.
+    u16 repost_code;
+} event_recorder;
+
+static b8 record_event(u16 code, void* sender, void* listener_inst, event_context context)
+{
+    event_recorder* recorder = listener_inst;
+    if(recorder->count < 8)
+    {
+        recorder->codes[recorder->count] = code;
+        recorder->contexts[recorder->count] = context;
+    }
+    recorder->count++;
+
+    if(recorder->repost_code)
+    {
+        event_post(recorder->repost_code, 0, context);
+        recorder->repost_code = 0;
+    }
+    return false;
+}
+
+static void* start_event_system(u64* out_requirement)
+{
+    event_system_initialize(out_requirement, 0);
+    void* state = kallocate(*out_requirement, MEMORY_TAG_APPLICATION);
+    event_system_initialize(out_requirement, state);
+    return state;
+}
+
+static void stop_event_system(void* state, u64 requirement)
+{
+    event_system_shutdown(state);
+    kfree(state, requirement, MEMORY_TAG_APPLICATION);
+}
+
+u8 event_post_should_wait_for_dispatch()
+{
+    u64 requirement = 0;
+    void* state = start_event_system(&requirement);
+
+    event_recorder recorder = {};
+    event_register(TEST_EVENT_CODE, &recorder, record_event);
+    event_register(EVENT_CODE_DEBUG0, &recorder, record_event);
+
+    event_context context = {};
+    context.data.u32[0] = 1;
+    expect_to_be_true(event_post(TEST_EVENT_CODE, 0, context));
+    context.data.u32[0] = 2;
+    expect_to_be_true(event_post(EVENT_CODE_DEBUG0, 0, context));
+    context.data.u32[0] = 3;
+    expect_to_be_true(event_post(TEST_EVENT_CODE, 0, context));
+    expect_should_be(0, recorder.count);
+
+    // Uncoalesced events are all fired, in the order they were posted.
+    expect_should_be(3, event_dispatch_queued());
+    expect_should_be(3, recorder.count);
+    expect_should_be(TEST_EVENT_CODE, recorder.codes[0]);
+    expect_should_be(1, recorder.contexts[0].data.u32[0]);
+    expect_should_be(EVENT_CODE_DEBUG0, recorder.codes[1]);
+    expect_should_be(3, recorder.contexts[2].data.u32[0]);
+
+    // Which empties the queue.
+    expect_should_be(0, event_dispatch_queued());
+    expect_should_be(3, recorder.count);
+
+    stop_event_system(state, requirement);
+    return true;
+}
+
+u8 event_post_should_coalesce_per_code()
+{
+    u64 requirement = 0;
+    void* state = start_event_system(&requirement);
+
+    event_recorder recorder = {};
+    event_register(EVENT_CODE_RESIZED, &recorder, record_event);
+    event_register(EVENT_CODE_MOUSE_WHEEL, &recorder, record_event);
+    event_register(TEST_EVENT_CODE, &recorder, record_event);
+    event_set_coalesce_mode(TEST_EVENT_CODE, EVENT_COALESCE_KEEP_LAST);
+
+    // A burst of resizes, with other events in between.
+    event_context context = {};
+    for(u16 i = 1; i <= 10; ++i)
+    {
+        context.data.u16[0] = i * 100;
+        context.data.u16[1] = i * 50;
+        event_post(EVENT_CODE_RESIZED, 0, context);
+
+        event_context wheel = {};
+        wheel.data.i8[0] = (i % 2) ? 20 : -5;
+        event_post(EVENT_CODE_MOUSE_WHEEL, 0, wheel);
+    }
+    context.data.u32[0] = 7;
+    event_post(TEST_EVENT_CODE, 0, context);
+
+    // One of each, in the order each code was first posted.
+    expect_should_be(3, event_dispatch_queued());
+    expect_should_be(EVENT_CODE_RESIZED, recorder.codes[0]);
+    expect_should_be(1000, recorder.contexts[0].data.u16[0]);
+    expect_should_be(500, recorder.contexts[0].data.u16[1]);
+    expect_should_be(EVENT_CODE_MOUSE_WHEEL, recorder.codes[1]);
+    expect_should_be(75, recorder.contexts[1].data.i8[0]);
+    expect_should_be(TEST_EVENT_CODE, recorder.codes[2]);
+    expect_should_be(7, recorder.contexts[2].data.u32[0]);
+
+    // Summed deltas saturate rather than wrap.
+    recorder.count = 0;
+    event_context wheel = {};
+    wheel.data.i8[0] = 100;
+    event_post(EVENT_CODE_MOUSE_WHEEL, 0, wheel);
+    event_post(EVENT_CODE_MOUSE_WHEEL, 0, wheel);
+    expect_should_be(1, event_dispatch_queued());
+    expect_should_be(127, recorder.contexts[0].data.i8[0]);
+
+    // Once coalescing is turned off, every event is kept.
+    recorder.count = 0;
+    event_set_coalesce_mode(TEST_EVENT_CODE, EVENT_COALESCE_NONE);
+    event_post(TEST_EVENT_CODE, 0, context);
+    event_post(TEST_EVENT_CODE, 0, context);
+    expect_should_be(2, event_dispatch_queued());
+
+    stop_event_system(state, requirement);
+    return true;
+}
+
+u8 event_post_from_listener_should_wait_for_next_dispatch()
+{
+    u64 requirement = 0;
+    void* state = start_event_system(&requirement);
+
+    event_recorder recorder = {};
+    recorder.repost_code = TEST_EVENT_CODE;
+    event_register(TEST_EVENT_CODE, &recorder, record_event);
+
+    event_context context = {};
+    event_post(TEST_EVENT_CODE, 0, context);
+    expect_should_be(1, event_dispatch_queued());
+    expect_should_be(1, recorder.count);
+
+    expect_should_be(1, event_dispatch_queued());
+    expect_should_be(2, recorder.count);
+
+    stop_event_system(state, requirement);
+    return true;
+}
+
+u8 event_post_should_fail_when_queue_is_full()
+{
+    u64 requirement = 0;
+    void* state = start_event_system(&requirement);
+
+    event_context context = {};
+    u32 posted = 0;
+    while(event_post(TEST_EVENT_CODE, 0, context) && posted < 100000)
+    {
+        posted++;
+    }
+    b8 filled = posted > 0 && posted < 100000;
+    expect_to_be_true(filled);
+
+    // A coalescing code with nothing queued yet needs a slot of its own too.
+    expect_to_be_false(event_post(EVENT_CODE_RESIZED, 0, context));
+
+    KDEBUG("Note: The following warning is intentionally caused by this test.");
+    expect_should_be(posted, event_dispatch_queued());
+    expect_to_be_true(event_post(TEST_EVENT_CODE, 0, context));
+
+    stop_event_system(state, requirement);
+    return true;
+}
+
+#define PRODUCER_COUNT 4
+// Several inboxes' worth in total, so producers refill the inbox while it is being drained.
+#define EVENTS_PER_PRODUCER 2000
+// Bytes past the end of the event system's state which must not be written.
+#define STATE_GUARD_SIZE 64
+
+typedef struct producer_order
+{
+    // Next sequence number expected from each producer.
+    u32 next[PRODUCER_COUNT];
+    u32 received;
+    b8 out_of_order;
+} producer_order;
+
+static b8 check_producer_order(u16 code, void* sender, void* listener_inst, event_context context)
+{
+    producer_order* order = listener_inst;
+    u32 producer = context.data.u32[0];
+    if(producer >= PRODUCER_COUNT || context.data.u32[1] != order->next[producer])
+    {
+        order->out_of_order = true;
+    }
+    else
+    {
+        order->next[producer]++;
+    }
+    order->received++;
+    return true;
+}
+
+static u32 post_from_producer(void* params)
+{
+    u32 producer = *(u32*)params;
+    for(u32 i = 0; i < EVENTS_PER_PRODUCER; ++i)
+    {
+        event_context context = {};
+        context.data.u32[0] = producer;
+        context.data.u32[1] = i;
+        // Wait for the dispatch to make room rather than dropping the event.
+        while(!event_post(TEST_EVENT_CODE, 0, context))
+        {
+            platform_thread_yield();
+        }
+    }
+    return 0;
+}
+
+u8 event_post_should_accept_events_from_many_threads()
+{
+    // The last field of the state is the batch, so an overlong drain would run into the guard.
+    u64 requirement = 0;
+    event_system_initialize(&requirement, 0);
+    u8* state = kallocate(requirement + STATE_GUARD_SIZE, MEMORY_TAG_APPLICATION);
+    event_system_initialize(&requirement, state);
+
+    producer_order order = {};
+    event_register(TEST_EVENT_CODE, &order, check_producer_order);
+
+    u32 producer_ids[PRODUCER_COUNT];
+    platform_thread threads[PRODUCER_COUNT];
+    for(u32 i = 0; i < PRODUCER_COUNT; ++i)
+    {
+        producer_ids[i] = i;
+        expect_to_be_true(platform_thread_create(post_from_producer, &producer_ids[i], false, &threads[i]));
+    }
+
+    // Dispatch while the producers are still posting.
+    while(order.received < PRODUCER_COUNT * EVENTS_PER_PRODUCER)
+    {
+        if(event_dispatch_queued() == 0)
+        {
+            platform_thread_yield();
+        }
+    }
+    for(u32 i = 0; i < PRODUCER_COUNT; ++i)
+    {
+        platform_thread_join(&threads[i]);
+    }
+
+    // Everything arrives, and each producer's events arrive in the order it posted them.
+    expect_should_be(PRODUCER_COUNT * EVENTS_PER_PRODUCER, order.received);
+    expect_to_be_false(order.out_of_order);
+    expect_should_be(0, event_dispatch_queued());
+    for(u32 i = 0; i < STATE_GUARD_SIZE; ++i)
+    {
+        expect_should_be(0, state[requirement + i]);
+    }
+
+    event_system_shutdown(state);
+    kfree(state, requirement + STATE_GUARD_SIZE, MEMORY_TAG_APPLICATION);
+    return true;
+}
+
+static b8 unregister_self(u16 code, void* sender, void* listener_inst, event_context context)
+{
+    event_recorder* recorder = listener_inst;
+    recorder->count++;
+    event_unregister(code, listener_inst, unregister_self);
+    return false;
+}
+
+u8 event_unregister_during_fire_should_not_skip_listeners()
+{
+    u64 requirement = 0;
+    void* state = start_event_system(&requirement);
+
+    event_recorder first = {};
+    event_recorder second = {};
+    event_register(TEST_EVENT_CODE, &first, unregister_self);
+    event_register(TEST_EVENT_CODE, &second, record_event);
+
+    // The fire in progress keeps walking the listeners it started with.
+    event_context context = {};
+    event_fire(TEST_EVENT_CODE, 0, context);
+    expect_should_be(1, first.count);
+    expect_should_be(1, second.count);
+
+    // Later fires no longer see the unregistered listener.
+    event_fire(TEST_EVENT_CODE, 0, context);
+    expect_should_be(1, first.count);
+    expect_should_be(2, second.count);
+
+    // Dispatching frees the replaced listener lists.
+    event_dispatch_queued();
+
+    stop_event_system(state, requirement);
+    return true;
+}
+
+static b8 record_listener(u16 code, void* sender, void* listener_inst, event_context context)
+{
+    u32* order = sender;
+    order[order[0] + 1] = (u32)(u64)listener_inst;
+    order[0]++;
+    return false;
+}
+
+static b8 record_listener_again(u16 code, void* sender, void* listener_inst, event_context context)
+{
+    return record_listener(code, sender, listener_inst, context);
+}
+
+u8 event_listeners_should_be_called_by_priority()
+{
+    u64 requirement = 0;
+    void* state = start_event_system(&requirement);
+
+    // Listeners 1 to 5, registered out of priority order.
+    event_listener_handle low = event_register_listener(TEST_EVENT_CODE, (void*)1, record_listener, -10);
+    event_listener_handle first_default = event_register_listener(TEST_EVENT_CODE, (void*)2, record_listener, EVENT_PRIORITY_DEFAULT);
+    event_listener_handle high = event_register_listener(TEST_EVENT_CODE, (void*)3, record_listener, 100);
+    expect_to_be_true(event_register(TEST_EVENT_CODE, (void*)4, record_listener));
+    event_listener_handle other_code = event_register_listener(EVENT_CODE_DEBUG0, (void*)5, record_listener, 1000);
+    expect_should_not_be(INVALID_EVENT_LISTENER_HANDLE, low);
+    expect_should_not_be(INVALID_EVENT_LISTENER_HANDLE, high);
+    expect_should_not_be(INVALID_EVENT_LISTENER_HANDLE, other_code);
+
+    // The same listener/callback combo is a duplicate, but the same listener with another callback is not.
+    expect_should_be(INVALID_EVENT_LISTENER_HANDLE, event_register_listener(TEST_EVENT_CODE, (void*)2, record_listener, 50));
+    event_listener_handle again = event_register_listener(TEST_EVENT_CODE, (void*)2, record_listener_again, -20);
+    expect_should_not_be(INVALID_EVENT_LISTENER_HANDLE, again);
+
+    // Highest priority first, and registration order within a priority.
+    u32 order[8] = {};
+    event_context context = {};
+    event_fire(TEST_EVENT_CODE, order, context);
+    expect_should_be(5, order[0]);
+    expect_should_be(3, order[1]);
+    expect_should_be(2, order[2]);
+    expect_should_be(4, order[3]);
+    expect_should_be(1, order[4]);
+    expect_should_be(2, order[5]);
+
+    // Unregistering by handle works once; the handle is stale afterwards.
+    expect_to_be_true(event_unregister_listener(first_default));
+    expect_to_be_false(event_unregister_listener(first_default));
+    expect_to_be_true(event_unregister(TEST_EVENT_CODE, (void*)4, record_listener));
+    expect_to_be_false(event_unregister_listener(INVALID_EVENT_LISTENER_HANDLE));
+
+    kzero_memory(order, sizeof(order));
+    event_fire(TEST_EVENT_CODE, order, context);
+    expect_should_be(3, order[0]);
+    expect_should_be(3, order[1]);
+    expect_should_be(1, order[2]);
+
+    // Compacting the registry on dispatch keeps the remaining handles valid, and a reused slot does not
+    // revive the stale handle.
+    event_dispatch_queued();
+    event_listener_handle reused = event_register_listener(TEST_EVENT_CODE, (void*)6, record_listener, 0);
+    expect_should_not_be(first_default, reused);
+    expect_to_be_false(event_unregister_listener(first_default));
+    expect_to_be_true(event_unregister_listener(high));
+    expect_to_be_true(event_unregister_listener(low));
+    expect_to_be_true(event_unregister_listener(again));
+    expect_to_be_true(event_unregister_listener(reused));
+
+    kzero_memory(order, sizeof(order));
+    event_fire(TEST_EVENT_CODE, order, context);
+    expect_should_be(0, order[0]);
+    event_fire(EVENT_CODE_DEBUG0, order, context);
+    expect_should_be(1, order[0]);
+    expect_should_be(5, order[1]);
+
+    stop_event_system(state, requirement);
+    return true;
+}
+
+void event_register_tests()
+{
+    test_manager_register_test(event_post_should_wait_for_dispatch, "Posted events should wait for dispatch");
+    test_manager_register_test(event_post_should_coalesce_per_code, "Posted events should coalesce per code");
+    test_manager_register_test(event_post_from_listener_should_wait_for_next_dispatch, "Events posted during dispatch should wait for the next");
+    test_manager_register_test(event_post_should_fail_when_queue_is_full, "Posting to a full event queue should fail");
+    test_manager_register_test(event_post_should_accept_events_from_many_threads, "Events should be postable from many threads");
+    test_manager_register_test(event_listeners_should_be_called_by_priority, "Event listeners should be called by priority");
+    test_manager_register_test(event_unregister_during_fire_should_not_skip_listeners, "Unregistering during a fire should not skip listeners");
+}
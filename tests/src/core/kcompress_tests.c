@@ -0,0 +1,116 @@
+#include "kcompress_tests.h"
+#include "../test_manager.h"
+#include "../expect.h"
+
+#include <defines.h>
+#include <core/kmemory.h>
+#include <core/kcompress.h>
+
+// Compresses and decompresses data, returning the compressed size, or 0 if it did not come back the same.
+static u64 round_trip(const u8* data, u64 size)
+{
+    u64 capacity = kcompress_bound(size);
+    u8* compressed = kallocate(capacity, MEMORY_TAG_ARRAY);
+    u8* decompressed = kallocate(size + 1, MEMORY_TAG_ARRAY);
+
+    u64 compressed_size = kcompress(data, size, compressed, capacity);
+    b8 same = compressed_size > 0 && kdecompress(compressed, compressed_size, decompressed, size);
+    for(u64 i = 0; i < size && same; ++i)
+    {
+        same = decompressed[i] == data[i];
+    }
+
+    kfree(decompressed, size + 1, MEMORY_TAG_ARRAY);
+    kfree(compressed, capacity, MEMORY_TAG_ARRAY);
+    return same ? compressed_size : 0;
+}
+
+static void fill_random(u8* data, u64 size, u32 seed)
+{
+    for(u64 i = 0; i < size; ++i)
+    {
+        seed = seed * 1664525 + 1013904223;
+        data[i] = (u8)(seed >> 24);
+    }
+}
+
+u8 kcompress_should_round_trip()
+{
+    const u64 size = 100000;
+    u8* data = kallocate(size, MEMORY_TAG_ARRAY);
+
+    // Text-like data shrinks.
+    for(u64 i = 0; i < size; ++i)
+    {
+        data[i] = "assets/textures/brick_"[i % 22] + (u8)((i / 997) % 3);
+    }
+    u64 text_size = round_trip(data, size);
+    expect_should_not_be(0, text_size);
+    b8 smaller = text_size < size / 4;
+    expect_to_be_true(smaller);
+
+    // A single repeated byte, which is matched against itself and needs long length encodings.
+    kzero_memory(data, size);
+    u64 zeros_size = round_trip(data, size);
+    expect_should_not_be(0, zeros_size);
+    b8 tiny = zeros_size < 1024;
+    expect_to_be_true(tiny);
+
+    // Random data does not shrink, but stays within the bound.
+    fill_random(data, size, 7);
+    u64 random_size = round_trip(data, size);
+    expect_should_not_be(0, random_size);
+    b8 within_bound = random_size <= kcompress_bound(size);
+    expect_to_be_true(within_bound);
+
+    // Inputs too short to hold a match, up to a little past the shortest which can.
+    for(u64 length = 0; length < 32; ++length)
+    {
+        expect_should_not_be(0, round_trip(data, length));
+    }
+
+    kfree(data, size, MEMORY_TAG_ARRAY);
+    return true;
+}
+
+u8 kdecompress_should_reject_malformed_data()
+{
+    const u64 size = 4096;
+    u8* data = kallocate(size, MEMORY_TAG_ARRAY);
+    for(u64 i = 0; i < size; ++i)
+    {
+        data[i] = (u8)(i % 61);
+    }
+    u64 capacity = kcompress_bound(size);
+    u8* compressed = kallocate(capacity, MEMORY_TAG_ARRAY);
+    u8* out = kallocate(size, MEMORY_TAG_ARRAY);
+    u64 compressed_size = kcompress(data, size, compressed, capacity);
+    expect_should_not_be(0, compressed_size);
+    expect_to_be_true(kdecompress(compressed, compressed_size, out, size));
+
+    // Cut short, or decompressed to the wrong size.
+    expect_to_be_false(kdecompress(compressed, compressed_size - 1, out, size));
+    expect_to_be_false(kdecompress(compressed, compressed_size, out, size - 1));
+
+    // A match reaching back before the start of the output.
+    const u8 bad_offset[] = {0x10, 'a', 0x08, 0x00, 0x00};
+    expect_to_be_false(kdecompress(bad_offset, sizeof(bad_offset), out, 5));
+
+    // Literals running past the end of the input.
+    const u8 bad_length[] = {0xF0, 0xFF};
+    expect_to_be_false(kdecompress(bad_length, sizeof(bad_length), out, size));
+
+    // Too small a buffer to compress into.
+    expect_should_be(0, kcompress(data, size, compressed, 16));
+
+    kfree(out, size, MEMORY_TAG_ARRAY);
+    kfree(compressed, capacity, MEMORY_TAG_ARRAY);
+    kfree(data, size, MEMORY_TAG_ARRAY);
+    return true;
+}
+
+void kcompress_register_tests()
+{
+    test_manager_register_test(kcompress_should_round_trip, "kcompress should round trip");
+    test_manager_register_test(kdecompress_should_reject_malformed_data, "kdecompress should reject malformed data");
+}
@@ -0,0 +1,93 @@
+#include "kmemory_tests.h"
+#include "../test_manager.h"
+#include "../expect.h"
+
+#include <defines.h>
+
+#include <core/kmemory.h>
+
+// Brings the memory system up on a small reserved block for the duration of a test.
+static void* start_memory_system(u64* out_requirement)
+{
+    memory_system_config config;
+    config.total_alloc_size = 1024 * 1024;
+    config.alignment = 16;
+    memory_system_initialize(out_requirement, 0, config);
+    void* state = kallocate(*out_requirement, MEMORY_TAG_APPLICATION);
+    memory_system_initialize(out_requirement, state, config);
+    return state;
+}
+
+static void stop_memory_system(void* state, u64 requirement)
+{
+    memory_system_shutdown(state);
+    kfree(state, requirement, MEMORY_TAG_APPLICATION);
+}
+
+u8 kmemory_should_allocate_aligned()
+{
+    u64 requirement = 0;
+    void* state = start_memory_system(&requirement);
+
+    u64 alignments[] = {16, 64, 256, 4096};
+    for(u32 i = 0; i < 4; ++i)
+    {
+        u8* block = kallocate_aligned(100, alignments[i], MEMORY_TAG_RENDERER);
+        expect_should_not_be(0, block);
+        expect_should_be(0, (u64)block % alignments[i]);
+        expect_should_be(0, block[99]);
+        kfree_aligned(block, 100, alignments[i], MEMORY_TAG_RENDERER);
+    }
+
+    stop_memory_system(state, requirement);
+
+    // Also valid before the memory system exists, where it goes to the platform.
+    void* block = kallocate_aligned(100, 128, MEMORY_TAG_RENDERER);
+    expect_should_be(0, (u64)block % 128);
+    kfree_aligned(block, 100, 128, MEMORY_TAG_RENDERER);
+
+    return true;
+}
+
+u8 kmemory_should_track_peaks_and_counts()
+{
+    u64 requirement = 0;
+    void* state = start_memory_system(&requirement);
+
+    void* a = kallocate(1000, MEMORY_TAG_TEXTURE);
+    void* b = kallocate(3000, MEMORY_TAG_TEXTURE);
+    kfree(a, 1000, MEMORY_TAG_TEXTURE);
+    void* c = kallocate(500, MEMORY_TAG_STRING);
+
+    memory_stats stats;
+    expect_to_be_true(memory_system_get_stats(&stats));
+    expect_should_be(3000, stats.tags[MEMORY_TAG_TEXTURE].current_bytes);
+    expect_should_be(4000, stats.tags[MEMORY_TAG_TEXTURE].peak_bytes);
+    expect_should_be(2, stats.tags[MEMORY_TAG_TEXTURE].allocation_count);
+    expect_should_be(1, stats.tags[MEMORY_TAG_TEXTURE].free_count);
+    expect_should_be(500, stats.tags[MEMORY_TAG_STRING].peak_bytes);
+    expect_should_be(3500, stats.total_allocated);
+    expect_should_be(4000, stats.peak_allocated);
+
+    // Frame deltas cover everything since the previous frame mark.
+    memory_system_end_frame();
+    expect_to_be_true(memory_system_get_stats(&stats));
+    expect_should_be(3, stats.frame_allocation_count);
+    expect_should_be(3500, stats.frame_delta_bytes);
+
+    kfree(b, 3000, MEMORY_TAG_TEXTURE);
+    kfree(c, 500, MEMORY_TAG_STRING);
+    memory_system_end_frame();
+    expect_to_be_true(memory_system_get_stats(&stats));
+    expect_should_be(0, stats.frame_allocation_count);
+    expect_should_be(-3500, stats.frame_delta_bytes);
+
+    stop_memory_system(state, requirement);
+    return true;
+}
+
+void kmemory_register_tests()
+{
+    test_manager_register_test(kmemory_should_allocate_aligned, "kallocate_aligned should honour alignment");
+    test_manager_register_test(kmemory_should_track_peaks_and_counts, "Memory stats should track peaks, counts and frame deltas");
+}
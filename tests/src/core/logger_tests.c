@@ -0,0 +1,309 @@
+#include "logger_tests.h"
+#include "../test_manager.h"
+#include "../expect.h"
+
+#include <defines.h>
+
+#include <core/logger.h>
+#include <core/kmemory.h>
+#include <core/kstring.h>
+#include <core/log_binary.h>
+#include <platform/filesystem.h>
+#include <systems/job_system.h>
+
+#define LOGGER_TEST_MARKER "logger-test-line"
+
+// Size of the buffers binary logs are decoded into.
+#define DECODED_TEXT_CAPACITY (64 * 1024)
+
+typedef struct decoded_text
+{
+    char* text;
+    u64 length;
+} decoded_text;
+
+static void* start_logging(logger_config config, u64* out_requirement)
+{
+    initialize_logging(out_requirement, 0, config);
+    void* state = kallocate(*out_requirement, MEMORY_TAG_APPLICATION);
+    if(!initialize_logging(out_requirement, state, config))
+    {
+        kfree(state, *out_requirement, MEMORY_TAG_APPLICATION);
+        return 0;
+    }
+    return state;
+}
+
+static void stop_logging(void* state, u64 requirement)
+{
+    shutdown_logging(state);
+    kfree(state, requirement, MEMORY_TAG_APPLICATION);
+}
+
+static void append_decoded(log_level level, const char* text, u32 length, void* user_data)
+{
+    decoded_text* decoded = user_data;
+    if(decoded->length + length < DECODED_TEXT_CAPACITY)
+    {
+        kcopy_memory(decoded->text + decoded->length, text, length);
+        decoded->length += length;
+        decoded->text[decoded->length] = 0;
+    }
+}
+
+// Decodes the binary console.log into decoded, which must be freed by the caller.
+static b8 decode_log_file(decoded_text* decoded)
+{
+    decoded->text = kallocate(DECODED_TEXT_CAPACITY, MEMORY_TAG_STRING);
+    decoded->length = 0;
+
+    file_handle handle;
+    if(!filesystem_open("console.log", FILE_MODE_READ, true, &handle))
+    {
+        return false;
+    }
+    u8* bytes = 0;
+    u64 size = 0;
+    filesystem_read_all_bytes(&handle, &bytes, &size);
+    filesystem_close(&handle);
+
+    b8 result = log_binary_decode(bytes, size, append_decoded, decoded);
+    kfree(bytes, size, MEMORY_TAG_STRING);
+    return result;
+}
+
+static b8 matches_marker(const u8* bytes, u64 length)
+{
+    for(u64 i = 0; i < length; ++i)
+    {
+        if(bytes[i] != (u8)LOGGER_TEST_MARKER[i])
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Counts the lines of console.log which contain the test marker.
+static u32 count_logged_lines()
+{
+    file_handle handle;
+    if(!filesystem_open("console.log", FILE_MODE_READ, false, &handle))
+    {
+        return 0;
+    }
+
+    u8* bytes = 0;
+    u64 size = 0;
+    filesystem_read_all_bytes(&handle, &bytes, &size);
+    filesystem_close(&handle);
+
+    u32 count = 0;
+    u64 marker_length = string_length(LOGGER_TEST_MARKER);
+    for(u64 i = 0; i + marker_length <= size; ++i)
+    {
+        if(matches_marker(bytes + i, marker_length))
+        {
+            count++;
+        }
+    }
+
+    kfree(bytes, size, MEMORY_TAG_STRING);
+    return count;
+}
+
+static void log_lines_job(void* params)
+{
+    u32 count = *(u32*)params;
+    for(u32 i = 0; i < count; ++i)
+    {
+        KDEBUG(LOGGER_TEST_MARKER " %u", i);
+    }
+}
+
+u8 logger_should_write_every_message_when_blocking()
+{
+    logger_config config = {LOG_OVERFLOW_BLOCK, 16, false, false};
+    u64 requirement = 0;
+    void* state = start_logging(config, &requirement);
+    expect_should_not_be(0, state);
+
+    // Far more than the queue holds, so producers must wait for the writer.
+    for(u32 i = 0; i < 300; ++i)
+    {
+        KTRACE(LOGGER_TEST_MARKER " %u", i);
+    }
+    logger_flush();
+    expect_should_be(0, logger_dropped_count());
+
+    // Flushing waits for the file write, not just for the writer to take the messages.
+    expect_should_be(300, count_logged_lines());
+
+    stop_logging(state, requirement);
+    expect_should_be(300, count_logged_lines());
+    return true;
+}
+
+u8 logger_should_account_for_dropped_messages()
+{
+    logger_config config = {LOG_OVERFLOW_DROP, 16, false, false};
+    u64 requirement = 0;
+    void* state = start_logging(config, &requirement);
+    expect_should_not_be(0, state);
+
+    for(u32 i = 0; i < 2000; ++i)
+    {
+        KTRACE(LOGGER_TEST_MARKER " %u", i);
+    }
+    logger_flush();
+    u64 dropped = logger_dropped_count();
+
+    stop_logging(state, requirement);
+    expect_should_be(2000, count_logged_lines() + dropped);
+    return true;
+}
+
+u8 logger_should_accept_messages_from_many_threads()
+{
+    job_system_config job_config = {3, 0};
+    u64 job_requirement = 0;
+    job_system_initialize(&job_requirement, 0, job_config);
+    void* job_state = kallocate_aligned(job_requirement, 64, MEMORY_TAG_JOB);
+    job_system_initialize(&job_requirement, job_state, job_config);
+
+    logger_config config = {LOG_OVERFLOW_BLOCK, 64, false, false};
+    u64 requirement = 0;
+    void* state = start_logging(config, &requirement);
+    expect_should_not_be(0, state);
+
+    job_counter counter = {};
+    u32 lines_per_job = 100;
+    for(u32 i = 0; i < 8; ++i)
+    {
+        job_system_submit(log_lines_job, &lines_per_job, sizeof(lines_per_job), JOB_PRIORITY_NORMAL, &counter);
+    }
+    job_system_wait(&counter);
+
+    stop_logging(state, requirement);
+    job_system_shutdown(job_state);
+    kfree_aligned(job_state, job_requirement, 64, MEMORY_TAG_JOB);
+
+    expect_should_be(800, count_logged_lines());
+    return true;
+}
+
+// Logs a debug message and appends the text it should decode to onto expected.
+#define LOG_AND_EXPECT(format, ...)                                                                   \
+    KDEBUG(format, ##__VA_ARGS__);                                                                    \
+    expected_length += string_format(expected + expected_length, "[DEBUG]: " format "\n", ##__VA_ARGS__)
+
+u8 logger_binary_should_decode_to_the_same_text()
+{
+    logger_config config = {LOG_OVERFLOW_BLOCK, 16, false, true};
+    u64 requirement = 0;
+    void* state = start_logging(config, &requirement);
+    expect_should_not_be(0, state);
+
+    char* expected = kallocate(DECODED_TEXT_CAPACITY, MEMORY_TAG_STRING);
+    u64 expected_length = 0;
+
+    for(i32 i = 0; i < 3; ++i)
+    {
+        LOG_AND_EXPECT("%d apples and %u pears", -5 * i, 7u + i);
+    }
+    LOG_AND_EXPECT("%s/%s", "path", "file.png");
+    LOG_AND_EXPECT("%.3f %e %g", 3.14159, 1e-7, 2.5f);
+    LOG_AND_EXPECT("%llu %lld %zu %ld", 18446744073709551615ull, -9000000000ll, (u64)123456789, -42l);
+    LOG_AND_EXPECT("%x %X %o %#x %08.3f", 0xbeefu, 0xcafeu, 8u, 255u, -1.5);
+    LOG_AND_EXPECT("%c%c 100%%", 'o', 'k');
+    LOG_AND_EXPECT("[%5.*s|%-*d]", 2, "hello", 4, 9);
+    LOG_AND_EXPECT("%hhu %hd", 300, 70000);
+    LOG_AND_EXPECT("%p", (void*)0x1234);
+    // Logged as text, since a long double loses precision as an f64.
+    LOG_AND_EXPECT("%.20Lf", 1.0L / 3.0L);
+    LOG_AND_EXPECT("no arguments");
+
+    // A format buffer which changes after its address was given an id must not decode with the old string.
+    char format[32];
+    string_format(format, "dynamic %%d");
+    KDEBUG(format, 1);
+    expected_length += string_format(expected + expected_length, "[DEBUG]: dynamic 1\n");
+    string_format(format, "changed %%s");
+    KDEBUG(format, "text");
+    expected_length += string_format(expected + expected_length, "[DEBUG]: changed text\n");
+
+    stop_logging(state, requirement);
+
+    decoded_text decoded;
+    expect_to_be_true(decode_log_file(&decoded));
+    expect_to_be_true(strings_equal(expected, decoded.text));
+
+    // Text logs are rejected.
+    expect_to_be_false(log_binary_decode((const u8*)"[INFO]:  text\n", 14, append_decoded, &decoded));
+
+    // As are format ids no logger could have assigned.
+    u8 bad_id[LOG_BINARY_MAGIC_LENGTH + LOG_BINARY_RECORD_HEADER_SIZE + sizeof(u32) + 2];
+    kcopy_memory(bad_id, LOG_BINARY_MAGIC, LOG_BINARY_MAGIC_LENGTH);
+    u8 header[LOG_BINARY_RECORD_HEADER_SIZE] = {LOG_BINARY_RECORD_FORMAT, LOG_LEVEL_INFO, sizeof(u32) + 2, 0};
+    kcopy_memory(bad_id + LOG_BINARY_MAGIC_LENGTH, header, LOG_BINARY_RECORD_HEADER_SIZE);
+    u32 id = 0xFFFFFFFF;
+    kcopy_memory(bad_id + LOG_BINARY_MAGIC_LENGTH + LOG_BINARY_RECORD_HEADER_SIZE, &id, sizeof(u32));
+    kcopy_memory(bad_id + sizeof(bad_id) - 2, "%d", 2);
+    expect_to_be_false(log_binary_decode(bad_id, sizeof(bad_id), append_decoded, &decoded));
+
+    kfree(decoded.text, DECODED_TEXT_CAPACITY, MEMORY_TAG_STRING);
+    kfree(expected, DECODED_TEXT_CAPACITY, MEMORY_TAG_STRING);
+    return true;
+}
+
+u8 logger_binary_should_accept_messages_from_many_threads()
+{
+    job_system_config job_config = {3, 0};
+    u64 job_requirement = 0;
+    job_system_initialize(&job_requirement, 0, job_config);
+    void* job_state = kallocate_aligned(job_requirement, 64, MEMORY_TAG_JOB);
+    job_system_initialize(&job_requirement, job_state, job_config);
+
+    logger_config config = {LOG_OVERFLOW_BLOCK, 64, false, true};
+    u64 requirement = 0;
+    void* state = start_logging(config, &requirement);
+    expect_should_not_be(0, state);
+
+    // Every thread races to register the same format.
+    job_counter counter = {};
+    u32 lines_per_job = 100;
+    for(u32 i = 0; i < 8; ++i)
+    {
+        job_system_submit(log_lines_job, &lines_per_job, sizeof(lines_per_job), JOB_PRIORITY_NORMAL, &counter);
+    }
+    job_system_wait(&counter);
+
+    stop_logging(state, requirement);
+    job_system_shutdown(job_state);
+    kfree_aligned(job_state, job_requirement, 64, MEMORY_TAG_JOB);
+
+    decoded_text decoded;
+    expect_to_be_true(decode_log_file(&decoded));
+    u32 count = 0;
+    u64 marker_length = string_length(LOGGER_TEST_MARKER);
+    for(u64 i = 0; i + marker_length <= decoded.length; ++i)
+    {
+        if(matches_marker((const u8*)decoded.text + i, marker_length))
+        {
+            count++;
+        }
+    }
+    kfree(decoded.text, DECODED_TEXT_CAPACITY, MEMORY_TAG_STRING);
+
+    expect_should_be(800, count);
+    return true;
+}
+
+void logger_register_tests()
+{
+    test_manager_register_test(logger_should_write_every_message_when_blocking, "Logger should write every message when blocking");
+    test_manager_register_test(logger_should_account_for_dropped_messages, "Logger should account for dropped messages");
+    test_manager_register_test(logger_should_accept_messages_from_many_threads, "Logger should accept messages from many threads");
+    test_manager_register_test(logger_binary_should_decode_to_the_same_text, "Binary logs should decode to the same text");
+    test_manager_register_test(logger_binary_should_accept_messages_from_many_threads, "Binary logs should accept messages from many threads");
+}
@@ -0,0 +1,188 @@
+#include "profiler_tests.h"
+#include "../test_manager.h"
+#include "../expect.h"
+
+#include <defines.h>
+
+#include <core/profiler.h>
+#include <core/kmemory.h>
+#include <core/kstring.h>
+#include <platform/filesystem.h>
+#include <systems/job_system.h>
+
+#define PROFILER_TEST_TRACE "profiler_test_trace.json"
+
+static void* start_profiler(profiler_config config, u64* out_requirement)
+{
+    profiler_initialize(out_requirement, 0, config);
+    void* state = kallocate(*out_requirement, MEMORY_TAG_APPLICATION);
+    if(!profiler_initialize(out_requirement, state, config))
+    {
+        kfree(state, *out_requirement, MEMORY_TAG_APPLICATION);
+        return 0;
+    }
+    return state;
+}
+
+static void stop_profiler(void* state, u64 requirement)
+{
+    profiler_shutdown(state);
+    kfree(state, requirement, MEMORY_TAG_APPLICATION);
+}
+
+// Counts the occurrences of text in the exported trace.
+static u32 count_in_trace(const char* text)
+{
+    file_handle handle;
+    if(!filesystem_open(PROFILER_TEST_TRACE, FILE_MODE_READ, true, &handle))
+    {
+        return 0;
+    }
+    u8* bytes = 0;
+    u64 size = 0;
+    filesystem_read_all_bytes(&handle, &bytes, &size);
+    filesystem_close(&handle);
+
+    u32 count = 0;
+    u64 length = string_length(text);
+    for(u64 i = 0; i + length <= size; ++i)
+    {
+        u64 j = 0;
+        while(j < length && bytes[i + j] == (u8)text[j])
+        {
+            j++;
+        }
+        if(j == length)
+        {
+            count++;
+        }
+    }
+
+    kfree(bytes, size, MEMORY_TAG_STRING);
+    return count;
+}
+
+static void zone_job(void* params)
+{
+    KPROFILE_BEGIN("test job");
+    KPROFILE_BEGIN("test job inner");
+    KPROFILE_END();
+    KPROFILE_END();
+}
+
+u8 profiler_should_export_nested_zones()
+{
+    profiler_config config = {};
+    u64 requirement = 0;
+    void* state = start_profiler(config, &requirement);
+    expect_should_not_be(0, state);
+
+    KPROFILE_FRAME();
+    KPROFILE_BEGIN("test outer");
+    KPROFILE_BEGIN("test inner");
+    KPROFILE_END();
+    KPROFILE_END();
+
+    expect_to_be_true(profiler_export_chrome_trace(PROFILER_TEST_TRACE));
+    stop_profiler(state, requirement);
+
+    expect_should_be(1, count_in_trace("\"traceEvents\":["));
+    expect_should_be(1, count_in_trace("\"name\":\"Frame\""));
+    expect_should_be(1, count_in_trace("\"name\":\"test outer\""));
+    expect_should_be(1, count_in_trace("\"name\":\"test inner\""));
+    expect_should_be(1, count_in_trace("\"name\":\"Main thread\""));
+    return true;
+}
+
+u8 profiler_should_record_zones_from_many_threads()
+{
+    // Before the job system, so workers only ever see a running profiler.
+    profiler_config config = {};
+    u64 requirement = 0;
+    void* state = start_profiler(config, &requirement);
+    expect_should_not_be(0, state);
+
+    job_system_config job_config = {3, 0};
+    u64 job_requirement = 0;
+    job_system_initialize(&job_requirement, 0, job_config);
+    void* job_state = kallocate_aligned(job_requirement, 64, MEMORY_TAG_JOB);
+    job_system_initialize(&job_requirement, job_state, job_config);
+
+    KPROFILE_FRAME();
+    job_counter counter = {};
+    for(u32 i = 0; i < 64; ++i)
+    {
+        job_system_submit(zone_job, 0, 0, JOB_PRIORITY_NORMAL, &counter);
+    }
+    job_system_wait(&counter);
+
+    job_system_shutdown(job_state);
+    kfree_aligned(job_state, job_requirement, 64, MEMORY_TAG_JOB);
+
+    expect_to_be_true(profiler_export_chrome_trace(PROFILER_TEST_TRACE));
+    stop_profiler(state, requirement);
+
+    expect_should_be(64, count_in_trace("\"name\":\"test job\""));
+    expect_should_be(64, count_in_trace("\"name\":\"test job inner\""));
+    return true;
+}
+
+u8 profiler_should_keep_only_recent_frames()
+{
+    profiler_config config = {4, 0};
+    u64 requirement = 0;
+    void* state = start_profiler(config, &requirement);
+    expect_should_not_be(0, state);
+
+    for(u32 i = 0; i < 10; ++i)
+    {
+        KPROFILE_FRAME();
+        KPROFILE_BEGIN("test frame zone");
+        KPROFILE_END();
+    }
+
+    expect_to_be_true(profiler_export_chrome_trace(PROFILER_TEST_TRACE));
+    stop_profiler(state, requirement);
+
+    expect_should_be(4, count_in_trace("\"name\":\"Frame\""));
+    expect_should_be(4, count_in_trace("\"name\":\"test frame zone\""));
+    expect_should_be(1, count_in_trace("\"frame\":9}"));
+    expect_should_be(0, count_in_trace("\"frame\":5}"));
+    return true;
+}
+
+u8 profiler_should_stay_balanced_past_max_depth()
+{
+    profiler_config config = {};
+    u64 requirement = 0;
+    void* state = start_profiler(config, &requirement);
+    expect_should_not_be(0, state);
+
+    KPROFILE_FRAME();
+    for(u32 i = 0; i < PROFILER_MAX_ZONE_DEPTH + 10; ++i)
+    {
+        KPROFILE_BEGIN("test deep");
+    }
+    for(u32 i = 0; i < PROFILER_MAX_ZONE_DEPTH + 10; ++i)
+    {
+        KPROFILE_END();
+    }
+    // The stack must be empty again.
+    KPROFILE_BEGIN("test after");
+    KPROFILE_END();
+
+    expect_to_be_true(profiler_export_chrome_trace(PROFILER_TEST_TRACE));
+    stop_profiler(state, requirement);
+
+    expect_should_be(PROFILER_MAX_ZONE_DEPTH, count_in_trace("\"name\":\"test deep\""));
+    expect_should_be(1, count_in_trace("\"name\":\"test after\""));
+    return true;
+}
+
+void profiler_register_tests()
+{
+    test_manager_register_test(profiler_should_export_nested_zones, "Profiler should export nested zones");
+    test_manager_register_test(profiler_should_record_zones_from_many_threads, "Profiler should record zones from many threads");
+    test_manager_register_test(profiler_should_keep_only_recent_frames, "Profiler should keep only recent frames");
+    test_manager_register_test(profiler_should_stay_balanced_past_max_depth, "Profiler should stay balanced past the maximum depth");
+}
@@ -1,7 +1,26 @@
 #include "test_manager.h"
 
 #include "memory/linear_allocator_tests.h"
+#include "memory/dynamic_allocator_tests.h"
+#include "memory/dynamic_allocator_benchmarks.h"
+#include "memory/frame_allocator_tests.h"
+#include "memory/pool_allocator_tests.h"
 #include "containers/hashtable_tests.h"
+#include "core/kmemory_tests.h"
+#include "containers/hashtable_benchmarks.h"
+#include "systems/job_system_tests.h"
+#include "systems/texture_system_tests.h"
+#include "systems/texture_system_benchmarks.h"
+#include "resources/cooked_texture_tests.h"
+#include "resources/image_tests.h"
+#include "core/logger_tests.h"
+#include "core/profiler_tests.h"
+#include "core/clock_tests.h"
+#include "core/event_tests.h"
+#include "core/kcompress_tests.h"
+#include "platform/vfs_tests.h"
+#include "renderer/null_renderer_tests.h"
+#include "renderer/vulkan_renderer_tests.h"
 
 #include <core/logger.h>
 
@@ -12,7 +31,26 @@ int main()
 
     // TODO: add test registrations here.
     linear_allocator_register_tests();
+    dynamic_allocator_register_tests();
+    dynamic_allocator_register_benchmarks();
+    frame_allocator_register_tests();
+    pool_allocator_register_tests();
     hashtable_register_tests();
+    hashtable_register_benchmarks();
+    kmemory_register_tests();
+    job_system_register_tests();
+    texture_system_register_tests();
+    texture_system_register_benchmarks();
+    cooked_texture_register_tests();
+    image_register_tests();
+    logger_register_tests();
+    profiler_register_tests();
+    clock_register_tests();
+    event_register_tests();
+    kcompress_register_tests();
+    vfs_register_tests();
+    null_renderer_register_tests();
+    vulkan_renderer_register_tests();
 
     KDEBUG("Starting tests...");
 
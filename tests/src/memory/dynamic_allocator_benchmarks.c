@@ -0,0 +1,153 @@
+#include "dynamic_allocator_benchmarks.h"
+#include "../test_manager.h"
+#include "../expect.h"
+
+#include <defines.h>
+#include <core/kmemory.h>
+#include <core/logger.h>
+#include <core/clock.h>
+#include <memory/dynamic_allocator.h>
+
+#include <stdlib.h>
+
+/*
+    Benchmarks comparing the dynamic allocator against the C runtime's malloc/free, using the
+    allocation patterns the engine actually produces: darrays growing by doubling, and many short
+    strings from string_duplicate released in a different order than they were made.
+*/
+
+#define BENCH_POOL_SIZE (64 * 1024 * 1024)
+#define BENCH_ARRAY_COUNT 256
+#define BENCH_ARRAY_GROWTHS 12
+#define BENCH_STRING_COUNT 65536
+#define BENCH_ITERATIONS 8
+
+typedef struct bench_allocator
+{
+    void* (*allocate)(void* user, u64 size);
+    void (*free)(void* user, void* block);
+    void* user;
+} bench_allocator;
+
+static void* malloc_allocate(void* user, u64 size)
+{
+    return malloc(size);
+}
+
+static void malloc_free(void* user, void* block)
+{
+    free(block);
+}
+
+static void* dynamic_allocate(void* user, u64 size)
+{
+    return dynamic_allocator_allocate(user, size);
+}
+
+static void dynamic_free(void* user, void* block)
+{
+    dynamic_allocator_free(user, block);
+}
+
+// Mirrors _darray_resize: allocate twice the capacity, copy, release the old block.
+static u64 run_darray_pattern(bench_allocator* allocator, void** arrays)
+{
+    u64 failures = 0;
+    for(u32 a = 0; a < BENCH_ARRAY_COUNT; ++a)
+    {
+        arrays[a] = allocator->allocate(allocator->user, 24 + 16);
+    }
+
+    u64 capacity = 1;
+    for(u32 growth = 0; growth < BENCH_ARRAY_GROWTHS; ++growth)
+    {
+        for(u32 a = 0; a < BENCH_ARRAY_COUNT; ++a)
+        {
+            void* grown = allocator->allocate(allocator->user, 24 + capacity * 2 * 16);
+            failures += (grown == 0);
+            kcopy_memory(grown, arrays[a], 24 + capacity * 16);
+            allocator->free(allocator->user, arrays[a]);
+            arrays[a] = grown;
+        }
+        capacity *= 2;
+    }
+
+    for(u32 a = 0; a < BENCH_ARRAY_COUNT; ++a)
+    {
+        allocator->free(allocator->user, arrays[a]);
+    }
+    return failures;
+}
+
+// Mirrors string_duplicate on asset-like names, freed in a scattered order.
+static u64 run_string_pattern(bench_allocator* allocator, void** strings)
+{
+    u64 failures = 0;
+    for(u32 i = 0; i < BENCH_STRING_COUNT; ++i)
+    {
+        u64 length = 8 + (i * 7) % 57;
+        strings[i] = allocator->allocate(allocator->user, length + 1);
+        failures += (strings[i] == 0);
+    }
+
+    // BENCH_STRING_COUNT is a power of two, so an odd stride visits every string once.
+    for(u32 i = 0; i < BENCH_STRING_COUNT; ++i)
+    {
+        u32 index = (i * 40503u) & (BENCH_STRING_COUNT - 1);
+        allocator->free(allocator->user, strings[index]);
+    }
+    return failures;
+}
+
+static f64 time_pattern(u64 (*pattern)(bench_allocator*, void**), bench_allocator* allocator, void** scratch, u64* failures)
+{
+    clock timer;
+    clock_start(&timer);
+    for(u32 i = 0; i < BENCH_ITERATIONS; ++i)
+    {
+        *failures += pattern(allocator, scratch);
+    }
+    clock_update(&timer);
+    return timer.elapsed;
+}
+
+u8 dynamic_allocator_benchmark_against_malloc()
+{
+    void* pool = kallocate(BENCH_POOL_SIZE, MEMORY_TAG_APPLICATION);
+    dynamic_allocator dynamic;
+    dynamic_allocator_create(BENCH_POOL_SIZE, pool, &dynamic);
+
+    bench_allocator with_malloc = {malloc_allocate, malloc_free, 0};
+    bench_allocator with_dynamic = {dynamic_allocate, dynamic_free, &dynamic};
+    void** scratch = kallocate(sizeof(void*) * BENCH_STRING_COUNT, MEMORY_TAG_ARRAY);
+
+    u64 failures = 0;
+    f64 malloc_darray = time_pattern(run_darray_pattern, &with_malloc, scratch, &failures);
+    f64 dynamic_darray = time_pattern(run_darray_pattern, &with_dynamic, scratch, &failures);
+    f64 malloc_strings = time_pattern(run_string_pattern, &with_malloc, scratch, &failures);
+    f64 dynamic_strings = time_pattern(run_string_pattern, &with_dynamic, scratch, &failures);
+
+    u64 darray_ops = (u64)BENCH_ITERATIONS * BENCH_ARRAY_COUNT * (BENCH_ARRAY_GROWTHS + 1) * 2;
+    u64 string_ops = (u64)BENCH_ITERATIONS * BENCH_STRING_COUNT * 2;
+    KINFO("dynamic allocator bench, darray growth: malloc %.2f ns/op | dynamic %.2f ns/op",
+          (malloc_darray * 1000000000.0) / darray_ops, (dynamic_darray * 1000000000.0) / darray_ops);
+    KINFO("dynamic allocator bench, string duplicates: malloc %.2f ns/op | dynamic %.2f ns/op",
+          (malloc_strings * 1000000000.0) / string_ops, (dynamic_strings * 1000000000.0) / string_ops);
+
+    // Everything was returned, so only blocks parked in small bins may still be out.
+    u64 free_space = dynamic_allocator_free_space(&dynamic);
+
+    kfree(scratch, sizeof(void*) * BENCH_STRING_COUNT, MEMORY_TAG_ARRAY);
+    dynamic_allocator_destroy(&dynamic);
+    kfree(pool, BENCH_POOL_SIZE, MEMORY_TAG_APPLICATION);
+
+    expect_should_be(0, failures);
+    expect_to_be_true((free_space > BENCH_POOL_SIZE / 2));
+
+    return true;
+}
+
+void dynamic_allocator_register_benchmarks()
+{
+    test_manager_register_test(dynamic_allocator_benchmark_against_malloc, "Dynamic allocator benchmark: darray and string patterns against malloc");
+}
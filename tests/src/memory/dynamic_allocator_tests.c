@@ -0,0 +1,195 @@
+#include "dynamic_allocator_tests.h"
+#include "../test_manager.h"
+#include "../expect.h"
+
+#include <defines.h>
+
+#include <core/kmemory.h>
+#include <memory/dynamic_allocator.h>
+
+#define TEST_POOL_SIZE (64 * 1024)
+
+u8 dynamic_allocator_should_create_and_destroy()
+{
+    void* memory = kallocate(TEST_POOL_SIZE, MEMORY_TAG_APPLICATION);
+    dynamic_allocator alloc;
+    expect_to_be_true(dynamic_allocator_create(TEST_POOL_SIZE, memory, &alloc));
+
+    expect_should_not_be(0, alloc.memory);
+    expect_should_be(TEST_POOL_SIZE, alloc.total_size);
+    expect_should_be(TEST_POOL_SIZE, dynamic_allocator_free_space(&alloc));
+
+    dynamic_allocator_destroy(&alloc);
+
+    expect_should_be(0, alloc.memory);
+    expect_should_be(0, alloc.total_size);
+
+    kfree(memory, TEST_POOL_SIZE, MEMORY_TAG_APPLICATION);
+    return true;
+}
+
+u8 dynamic_allocator_single_allocation_and_free()
+{
+    void* memory = kallocate(TEST_POOL_SIZE, MEMORY_TAG_APPLICATION);
+    dynamic_allocator alloc;
+    dynamic_allocator_create(TEST_POOL_SIZE, memory, &alloc);
+
+    void* block = dynamic_allocator_allocate(&alloc, 1024);
+    expect_should_not_be(0, block);
+    expect_should_be(0, (u64)block % 16);
+    expect_to_be_true(dynamic_allocator_owns(&alloc, block));
+    expect_to_be_true((dynamic_allocator_block_size(&alloc, block) >= 1024));
+    expect_to_be_true((dynamic_allocator_free_space(&alloc) < TEST_POOL_SIZE));
+
+    expect_to_be_true(dynamic_allocator_free(&alloc, block));
+    expect_should_be(TEST_POOL_SIZE, dynamic_allocator_free_space(&alloc));
+
+    dynamic_allocator_destroy(&alloc);
+    kfree(memory, TEST_POOL_SIZE, MEMORY_TAG_APPLICATION);
+    return true;
+}
+
+u8 dynamic_allocator_should_coalesce_freed_blocks()
+{
+    void* memory = kallocate(TEST_POOL_SIZE, MEMORY_TAG_APPLICATION);
+    dynamic_allocator alloc;
+    dynamic_allocator_create(TEST_POOL_SIZE, memory, &alloc);
+
+    // Fill the pool with equally sized blocks.
+    void* blocks[60];
+    for(u32 i = 0; i < 60; ++i)
+    {
+        blocks[i] = dynamic_allocator_allocate(&alloc, 1000);
+        expect_should_not_be(0, blocks[i]);
+    }
+
+    // Free every other block, then the rest, so each free merges with both neighbours.
+    for(u32 i = 0; i < 60; i += 2)
+    {
+        expect_to_be_true(dynamic_allocator_free(&alloc, blocks[i]));
+    }
+    for(u32 i = 1; i < 60; i += 2)
+    {
+        expect_to_be_true(dynamic_allocator_free(&alloc, blocks[i]));
+    }
+    expect_should_be(TEST_POOL_SIZE, dynamic_allocator_free_space(&alloc));
+
+    // Only possible if everything merged back into one block.
+    void* whole = dynamic_allocator_allocate(&alloc, TEST_POOL_SIZE - 16);
+    expect_should_not_be(0, whole);
+
+    dynamic_allocator_destroy(&alloc);
+    kfree(memory, TEST_POOL_SIZE, MEMORY_TAG_APPLICATION);
+    return true;
+}
+
+u8 dynamic_allocator_should_reuse_small_blocks()
+{
+    void* memory = kallocate(TEST_POOL_SIZE, MEMORY_TAG_APPLICATION);
+    dynamic_allocator alloc;
+    dynamic_allocator_create(TEST_POOL_SIZE, memory, &alloc);
+
+    void* first = dynamic_allocator_allocate(&alloc, 24);
+    expect_should_not_be(0, first);
+    expect_to_be_true(dynamic_allocator_free(&alloc, first));
+
+    // Same size class comes straight back out of its bin.
+    void* second = dynamic_allocator_allocate(&alloc, 20);
+    expect_should_be((u64)first, (u64)second);
+    expect_to_be_true(dynamic_allocator_free(&alloc, second));
+
+    dynamic_allocator_destroy(&alloc);
+    kfree(memory, TEST_POOL_SIZE, MEMORY_TAG_APPLICATION);
+    return true;
+}
+
+u8 dynamic_allocator_should_bin_small_blocks_by_class()
+{
+    void* memory = kallocate(TEST_POOL_SIZE, MEMORY_TAG_APPLICATION);
+    // Anything written past the small bins lands on the guard.
+    struct
+    {
+        dynamic_allocator alloc;
+        u64 guard;
+    } guarded = {};
+    dynamic_allocator_create(TEST_POOL_SIZE, memory, &guarded.alloc);
+
+    // Frees a 288 byte block, which the 256 byte class then takes whole: the 16 byte remainder is too
+    // small to split off.
+    void* first = dynamic_allocator_allocate(&guarded.alloc, 272);
+    void* second = dynamic_allocator_allocate(&guarded.alloc, 272);
+    expect_to_be_true(dynamic_allocator_free(&guarded.alloc, first));
+    void* small = dynamic_allocator_allocate(&guarded.alloc, 256);
+    expect_should_be((u64)first, (u64)small);
+    expect_to_be_true(dynamic_allocator_free(&guarded.alloc, small));
+    expect_should_be(0, guarded.guard);
+
+    // The block went back to the 256 byte class, not past the end of the bins.
+    void* again = dynamic_allocator_allocate(&guarded.alloc, 250);
+    expect_should_be((u64)small, (u64)again);
+    expect_to_be_true(dynamic_allocator_free(&guarded.alloc, again));
+    expect_to_be_true(dynamic_allocator_free(&guarded.alloc, second));
+
+    dynamic_allocator_destroy(&guarded.alloc);
+    kfree(memory, TEST_POOL_SIZE, MEMORY_TAG_APPLICATION);
+    return true;
+}
+
+u8 dynamic_allocator_should_respect_alignment()
+{
+    void* memory = kallocate(TEST_POOL_SIZE, MEMORY_TAG_APPLICATION);
+    dynamic_allocator alloc;
+    dynamic_allocator_create(TEST_POOL_SIZE, memory, &alloc);
+
+    u64 alignments[] = {32, 64, 256, 4096};
+    void* blocks[4];
+    for(u32 i = 0; i < 4; ++i)
+    {
+        blocks[i] = dynamic_allocator_allocate_aligned(&alloc, 100, alignments[i]);
+        expect_should_not_be(0, blocks[i]);
+        expect_should_be(0, (u64)blocks[i] % alignments[i]);
+        expect_to_be_true((dynamic_allocator_block_size(&alloc, blocks[i]) >= 100));
+    }
+
+    for(u32 i = 0; i < 4; ++i)
+    {
+        expect_to_be_true(dynamic_allocator_free(&alloc, blocks[i]));
+    }
+    expect_should_be(TEST_POOL_SIZE, dynamic_allocator_free_space(&alloc));
+
+    dynamic_allocator_destroy(&alloc);
+    kfree(memory, TEST_POOL_SIZE, MEMORY_TAG_APPLICATION);
+    return true;
+}
+
+u8 dynamic_allocator_try_over_allocate()
+{
+    void* memory = kallocate(TEST_POOL_SIZE, MEMORY_TAG_APPLICATION);
+    dynamic_allocator alloc;
+    dynamic_allocator_create(TEST_POOL_SIZE, memory, &alloc);
+
+    void* block = dynamic_allocator_allocate(&alloc, TEST_POOL_SIZE);
+    expect_should_be(0, block);
+    expect_should_be(TEST_POOL_SIZE, dynamic_allocator_free_space(&alloc));
+
+    KDEBUG("Note: The following error is intentionally caused by this test.");
+
+    // Freeing something the allocator does not own should be refused.
+    u64 outside = 0;
+    expect_to_be_false(dynamic_allocator_free(&alloc, &outside));
+
+    dynamic_allocator_destroy(&alloc);
+    kfree(memory, TEST_POOL_SIZE, MEMORY_TAG_APPLICATION);
+    return true;
+}
+
+void dynamic_allocator_register_tests()
+{
+    test_manager_register_test(dynamic_allocator_should_create_and_destroy, "Dynamic allocator should create and destroy");
+    test_manager_register_test(dynamic_allocator_single_allocation_and_free, "Dynamic allocator single alloc and free");
+    test_manager_register_test(dynamic_allocator_should_coalesce_freed_blocks, "Dynamic allocator should coalesce freed blocks");
+    test_manager_register_test(dynamic_allocator_should_reuse_small_blocks, "Dynamic allocator should reuse small blocks");
+    test_manager_register_test(dynamic_allocator_should_bin_small_blocks_by_class, "Dynamic allocator should bin small blocks by class");
+    test_manager_register_test(dynamic_allocator_should_respect_alignment, "Dynamic allocator should respect alignment");
+    test_manager_register_test(dynamic_allocator_try_over_allocate, "Dynamic allocator try over allocate");
+}
@@ -0,0 +1,80 @@
+#include "frame_allocator_tests.h"
+#include "../test_manager.h"
+#include "../expect.h"
+
+#include <defines.h>
+
+#include <memory/frame_allocator.h>
+
+u8 frame_allocator_should_reset_each_frame()
+{
+    frame_allocator alloc;
+    frame_allocator_create(1024, false, &alloc);
+    expect_should_be(1, alloc.buffer_count);
+
+    u8* first = frame_allocator_allocate(&alloc, 100);
+    expect_should_not_be(0, first);
+    expect_should_be(0, (u64)first % 16);
+    u8* second = frame_allocator_allocate(&alloc, 100);
+    expect_should_be(0, (u64)second % 16);
+    // The second block starts at the next 16 byte boundary after the first.
+    expect_should_be(212, alloc.buffers[0].allocated);
+
+    frame_allocator_end_frame(&alloc);
+    expect_should_be(0, alloc.buffers[0].allocated);
+    expect_should_be(212, alloc.peak_allocated);
+
+    // Same memory is handed out again next frame.
+    u8* next_frame = frame_allocator_allocate(&alloc, 100);
+    expect_should_be((u64)first, (u64)next_frame);
+
+    frame_allocator_destroy(&alloc);
+    expect_should_be(0, alloc.buffer_count);
+    return true;
+}
+
+u8 frame_allocator_double_buffered_should_survive_one_frame()
+{
+    frame_allocator alloc;
+    frame_allocator_create(1024, true, &alloc);
+
+    u64* value = frame_allocator_allocate(&alloc, sizeof(u64));
+    *value = 42;
+    frame_allocator_end_frame(&alloc);
+
+    // Allocations in the following frame must not overlap the previous frame's data.
+    u64* other = frame_allocator_allocate(&alloc, sizeof(u64));
+    *other = 7;
+    expect_should_be(42, *value);
+
+    frame_allocator_end_frame(&alloc);
+
+    // Two frames later the first buffer is reused.
+    u64* reused = frame_allocator_allocate(&alloc, sizeof(u64));
+    expect_should_be((u64)value, (u64)reused);
+
+    frame_allocator_destroy(&alloc);
+    return true;
+}
+
+u8 frame_allocator_try_over_allocate()
+{
+    frame_allocator alloc;
+    frame_allocator_create(64, false, &alloc);
+
+    expect_should_not_be(0, frame_allocator_allocate(&alloc, 40));
+
+    KDEBUG("Note: The following error is intentionally caused by this test.");
+    // 40 rounds up to 48 before the next block, leaving only 16 bytes.
+    expect_should_be(0, frame_allocator_allocate(&alloc, 24));
+
+    frame_allocator_destroy(&alloc);
+    return true;
+}
+
+void frame_allocator_register_tests()
+{
+    test_manager_register_test(frame_allocator_should_reset_each_frame, "Frame allocator should reset each frame");
+    test_manager_register_test(frame_allocator_double_buffered_should_survive_one_frame, "Double-buffered frame allocator keeps data for one frame");
+    test_manager_register_test(frame_allocator_try_over_allocate, "Frame allocator try over allocate");
+}
@@ -108,7 +108,7 @@ u8 linear_allocator_multi_allocation_all_space_then_free()
     }
 
     // Validate that pointer is reset.
-    linear_allocator_free_all(&alloc);
+    linear_allocator_free_all(&alloc, true);
     expect_should_be(0, alloc.allocated);
 
     linear_allocator_destroy(&alloc);
@@ -116,6 +116,27 @@ u8 linear_allocator_multi_allocation_all_space_then_free()
     return true;
 }
 
+u8 linear_allocator_free_all_without_clear() 
+{
+    linear_allocator alloc;
+    linear_allocator_create(sizeof(u64) * 4, 0, &alloc);
+
+    u64* block = linear_allocator_allocate(&alloc, sizeof(u64));
+    *block = 1234;
+
+    // Without clearing, only the offset is reset and the old contents remain.
+    linear_allocator_free_all(&alloc, false);
+    expect_should_be(0, alloc.allocated);
+    expect_should_be(1234, *block);
+
+    linear_allocator_free_all(&alloc, true);
+    expect_should_be(0, *block);
+
+    linear_allocator_destroy(&alloc);
+
+    return true;
+}
+
 void linear_allocator_register_tests() 
 {
     test_manager_register_test(linear_allocator_should_create_and_destroy, "Linear allocator should create and destroy");
@@ -123,4 +144,5 @@ void linear_allocator_register_tests()
     test_manager_register_test(linear_allocator_multi_allocation_all_space, "Linear allocator multi alloc for all space");
     test_manager_register_test(linear_allocator_multi_allocation_over_allocate, "Linear allocator try over allocate");
     test_manager_register_test(linear_allocator_multi_allocation_all_space_then_free, "Linear allocator allocated should be 0 after free_all");
+    test_manager_register_test(linear_allocator_free_all_without_clear, "Linear allocator free_all without clear keeps contents");
 }
\ No newline at end of file
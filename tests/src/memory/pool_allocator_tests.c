@@ -0,0 +1,123 @@
+#include "pool_allocator_tests.h"
+#include "../test_manager.h"
+#include "../expect.h"
+
+#include <defines.h>
+
+#include <containers/darray.h>
+#include <memory/pool_allocator.h>
+
+typedef struct pool_test_object
+{
+    u64 id;
+    f32 values[5];
+} pool_test_object;
+
+u8 pool_allocator_should_create_and_destroy()
+{
+    pool_allocator pool;
+    expect_to_be_true(pool_allocator_create(pool_test_object, 16, false, MEMORY_TAG_ENTITY, &pool));
+    expect_should_be(sizeof(pool_test_object), pool.element_size);
+    expect_should_be(64, pool.slot_size);
+    expect_should_be(0, pool_allocator_live_count(&pool));
+
+    pool_allocator_destroy(&pool);
+    expect_should_be(0, pool.chunks);
+    return true;
+}
+
+u8 pool_allocator_should_grow_and_reuse_slots()
+{
+    pool_allocator pool;
+    pool_allocator_create(pool_test_object, 4, false, MEMORY_TAG_ENTITY, &pool);
+
+    pool_test_object* objects[10];
+    for(u32 i = 0; i < 10; ++i)
+    {
+        objects[i] = pool_allocator_allocate(&pool);
+        expect_should_not_be(0, objects[i]);
+        expect_should_be(0, (u64)objects[i] % 64);
+        expect_should_be(0, objects[i]->id);
+        objects[i]->id = i + 1;
+    }
+    expect_should_be(3, darray_length(pool.chunks));
+    expect_should_be(10, pool_allocator_live_count(&pool));
+
+    // Freed slots are handed out again before growing.
+    expect_to_be_true(pool_allocator_free(&pool, objects[5]));
+    pool_test_object* reused = pool_allocator_allocate(&pool);
+    expect_should_be((u64)objects[5], (u64)reused);
+    expect_should_be(0, reused->id);
+    expect_should_be(3, darray_length(pool.chunks));
+
+    // Earlier objects were not disturbed by growth.
+    expect_should_be(1, objects[0]->id);
+    expect_should_be(10, objects[9]->id);
+
+    pool_allocator_destroy(&pool);
+    return true;
+}
+
+u8 pool_allocator_should_iterate_live_objects()
+{
+    pool_allocator pool;
+    pool_allocator_create(pool_test_object, 70, false, MEMORY_TAG_ENTITY, &pool);
+
+    pool_test_object* objects[150];
+    for(u32 i = 0; i < 150; ++i)
+    {
+        objects[i] = pool_allocator_allocate(&pool);
+        objects[i]->id = i;
+    }
+
+    // Free every third object.
+    for(u32 i = 0; i < 150; i += 3)
+    {
+        pool_allocator_free(&pool, objects[i]);
+    }
+
+    u32 visited = 0;
+    u64 id_sum = 0;
+    pool_iterator it = {0};
+    pool_test_object* object;
+    while((object = pool_allocator_next(&pool, &it)))
+    {
+        expect_to_be_true((object->id % 3 != 0));
+        visited++;
+        id_sum += object->id;
+    }
+
+    expect_should_be(100, visited);
+    expect_should_be(100, pool_allocator_live_count(&pool));
+    // Sum of 0..149 minus the sum of the multiples of 3.
+    expect_should_be(11175 - 3675, id_sum);
+
+    pool_allocator_destroy(&pool);
+    return true;
+}
+
+u8 pool_allocator_should_reject_double_free()
+{
+    pool_allocator pool;
+    pool_allocator_create(pool_test_object, 8, true, MEMORY_TAG_ENTITY, &pool);
+    // The 28 byte object, 16 byte guard band and trailer still fit in one cache line.
+    expect_should_be(64, pool.slot_size);
+
+    pool_test_object* object = pool_allocator_allocate(&pool);
+    expect_to_be_true(pool_allocator_free(&pool, object));
+
+    KDEBUG("Note: The following error is intentionally caused by this test.");
+    expect_to_be_false(pool_allocator_free(&pool, object));
+    expect_should_be(0, pool_allocator_live_count(&pool));
+
+    pool_allocator_destroy(&pool);
+    return true;
+}
+
+void pool_allocator_register_tests()
+{
+    test_manager_register_test(pool_allocator_should_create_and_destroy, "Pool allocator should create and destroy");
+    test_manager_register_test(pool_allocator_should_grow_and_reuse_slots, "Pool allocator should grow and reuse slots");
+    test_manager_register_test(pool_allocator_should_iterate_live_objects, "Pool allocator should iterate live objects only");
+    test_manager_register_test(pool_allocator_should_reject_double_free, "Pool allocator should reject a double free");
+}
@@ -0,0 +1,270 @@
+#include "vfs_tests.h"
+#include "../test_manager.h"
+#include "../expect.h"
+
+#include <defines.h>
+
+#include <core/logger.h>
+#include <core/kmemory.h>
+#include <core/kstring.h>
+#include <platform/filesystem.h>
+#include <platform/vfs.h>
+
+// Written next to the test executable.
+#define TEST_LOOSE_PATH "vfs_test_loose.txt"
+#define TEST_TEXT_PATH "vfs_test_text.txt"
+#define TEST_BINARY_PATH "vfs_test_binary.bin"
+#define TEST_EMPTY_PATH "vfs_test_empty.bin"
+#define TEST_PACK_PATH "vfs_test." VFS_PACK_EXTENSION
+
+#define TEST_TEXT_SIZE 2000
+#define TEST_BINARY_SIZE 300
+
+static b8 write_file(const char* path, u64 size, const void* data)
+{
+    file_handle f;
+    if(!filesystem_open(path, FILE_MODE_WRITE, true, &f))
+    {
+        return false;
+    }
+    u64 written = 0;
+    b8 result = size == 0 || filesystem_write(&f, size, data, &written);
+    filesystem_close(&f);
+    return result;
+}
+
+static b8 file_equals(const vfs_file* file, u64 size, const void* data)
+{
+    if(file->size != size)
+    {
+        return false;
+    }
+    const u8* expected = data;
+    for(u64 i = 0; i < size; ++i)
+    {
+        if(file->data[i] != expected[i])
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void fill_test_data(u8* text, u8* binary)
+{
+    for(u32 i = 0; i < TEST_TEXT_SIZE; ++i)
+    {
+        text[i] = "compressible "[i % 13];
+    }
+    u32 seed = 1;
+    for(u32 i = 0; i < TEST_BINARY_SIZE; ++i)
+    {
+        seed = seed * 1664525 + 1013904223;
+        binary[i] = (u8)(seed >> 24);
+    }
+}
+
+typedef struct vfs_test_system
+{
+    u64 requirement;
+    void* state;
+} vfs_test_system;
+
+static b8 start_vfs(vfs_test_system* out_system)
+{
+    vfs_config config = {};
+    vfs_initialize(&out_system->requirement, 0, config);
+    out_system->state = kallocate(out_system->requirement, MEMORY_TAG_APPLICATION);
+    return vfs_initialize(&out_system->requirement, out_system->state, config);
+}
+
+static void stop_vfs(vfs_test_system* system)
+{
+    vfs_shutdown(system->state);
+    kfree(system->state, system->requirement, MEMORY_TAG_APPLICATION);
+}
+
+u8 vfs_should_read_loose_files_before_initialization()
+{
+    const char text[] = "loose";
+    expect_to_be_true(write_file(TEST_LOOSE_PATH, 5, text));
+
+    vfs_file file;
+    expect_to_be_true(vfs_read(TEST_LOOSE_PATH, &file));
+    b8 equal = file_equals(&file, 5, text);
+    expect_to_be_true(equal);
+    vfs_close(&file);
+
+    file_info info;
+    expect_to_be_true(vfs_get_info(TEST_LOOSE_PATH, &info));
+    expect_should_be(5, info.size);
+    expect_to_be_false(vfs_exists("vfs_test_missing.txt"));
+    expect_to_be_false(vfs_read("vfs_test_missing.txt", &file));
+
+    char real_path[64];
+    expect_to_be_true(vfs_get_real_path(TEST_LOOSE_PATH, real_path, sizeof(real_path)));
+    expect_to_be_true(strings_equal(TEST_LOOSE_PATH, real_path));
+    return true;
+}
+
+u8 vfs_pack_should_round_trip()
+{
+    u8 text[TEST_TEXT_SIZE];
+    u8 binary[TEST_BINARY_SIZE];
+    fill_test_data(text, binary);
+    expect_to_be_true(write_file(TEST_TEXT_PATH, TEST_TEXT_SIZE, text));
+    expect_to_be_true(write_file(TEST_BINARY_PATH, TEST_BINARY_SIZE, binary));
+    expect_to_be_true(write_file(TEST_EMPTY_PATH, 0, 0));
+
+    const char* sources[] = {TEST_TEXT_PATH, TEST_BINARY_PATH, TEST_EMPTY_PATH};
+    const char* entries[] = {"data/text.txt", "data/binary.bin", "data/empty.bin"};
+    expect_to_be_true(vfs_pack_write(TEST_PACK_PATH, 3, sources, entries, true));
+
+    vfs_test_system system = {};
+    expect_to_be_true(start_vfs(&system));
+    expect_to_be_true(vfs_mount_pack("packed/", TEST_PACK_PATH));
+
+    // Compressed, so decompressed into a buffer of its own.
+    vfs_file file;
+    expect_to_be_true(vfs_read("packed/data/text.txt", &file));
+    b8 equal = file_equals(&file, TEST_TEXT_SIZE, text);
+    expect_to_be_true(equal);
+    expect_should_not_be(0, file.decompressed);
+    vfs_close(&file);
+
+    // Does not compress, so read in place, aligned.
+    expect_to_be_true(vfs_read("packed/data/binary.bin", &file));
+    equal = file_equals(&file, TEST_BINARY_SIZE, binary);
+    expect_to_be_true(equal);
+    expect_should_be(0, file.decompressed);
+    expect_should_be(0, (u64)file.data % VFS_PACK_ALIGNMENT);
+    vfs_close(&file);
+
+    expect_to_be_true(vfs_read("packed/data/empty.bin", &file));
+    expect_should_be(0, file.size);
+    vfs_close(&file);
+
+    // Sizes and times are those of the files packed.
+    file_info source_info;
+    file_info info;
+    expect_to_be_true(filesystem_get_info(TEST_TEXT_PATH, &source_info));
+    expect_to_be_true(vfs_get_info("packed/data/text.txt", &info));
+    expect_should_be(TEST_TEXT_SIZE, info.size);
+    expect_should_be(source_info.modified_time, info.modified_time);
+
+    // Only under the mount point, and there is no directory to write next to them in.
+    expect_to_be_false(vfs_exists("data/text.txt"));
+    expect_to_be_false(vfs_exists("packed/data/missing.txt"));
+    expect_to_be_false(vfs_exists("packeddata/text.txt"));
+    char real_path[64];
+    expect_to_be_false(vfs_get_real_path("packed/data/text.txt", real_path, sizeof(real_path)));
+
+    stop_vfs(&system);
+    return true;
+}
+
+u8 vfs_should_search_recent_mounts_first()
+{
+    u8 text[TEST_TEXT_SIZE];
+    u8 binary[TEST_BINARY_SIZE];
+    fill_test_data(text, binary);
+    expect_to_be_true(write_file(TEST_LOOSE_PATH, 5, "loose"));
+    expect_to_be_true(write_file(TEST_TEXT_PATH, TEST_TEXT_SIZE, text));
+
+    // The pack holds its own copy of the loose file.
+    const char* sources[] = {TEST_TEXT_PATH};
+    const char* entries[] = {TEST_LOOSE_PATH};
+    expect_to_be_true(vfs_pack_write(TEST_PACK_PATH, 1, sources, entries, false));
+
+    vfs_test_system system = {};
+    expect_to_be_true(start_vfs(&system));
+    expect_to_be_true(vfs_mount_directory("", "."));
+
+    vfs_file file;
+    expect_to_be_true(vfs_read(TEST_LOOSE_PATH, &file));
+    b8 equal = file_equals(&file, 5, "loose");
+    expect_to_be_true(equal);
+    vfs_close(&file);
+
+    // Mounted over the directory, the pack's copy is found first.
+    expect_to_be_true(vfs_mount_pack("", TEST_PACK_PATH));
+    expect_to_be_true(vfs_read(TEST_LOOSE_PATH, &file));
+    equal = file_equals(&file, TEST_TEXT_SIZE, text);
+    expect_to_be_true(equal);
+    vfs_close(&file);
+
+    // Files only in the directory are still found there.
+    expect_to_be_true(vfs_exists(TEST_TEXT_PATH));
+
+    // New files are written to the directory.
+    char real_path[64];
+    expect_to_be_false(vfs_get_real_path(TEST_LOOSE_PATH, real_path, sizeof(real_path)));
+    expect_to_be_true(vfs_get_real_path("vfs_test_new.txt", real_path, sizeof(real_path)));
+    expect_to_be_true(strings_equal("./vfs_test_new.txt", real_path));
+
+    stop_vfs(&system);
+    return true;
+}
+
+u8 vfs_should_reject_bad_packs()
+{
+    vfs_test_system system = {};
+    expect_to_be_true(start_vfs(&system));
+
+    expect_to_be_true(write_file(TEST_LOOSE_PATH, 5, "loose"));
+
+    KDEBUG("Note: The following warnings are intentionally caused by this test.");
+    const char* sources[] = {TEST_LOOSE_PATH, TEST_LOOSE_PATH};
+    const char* entries[] = {"same", "same"};
+    expect_to_be_false(vfs_pack_write(TEST_PACK_PATH, 2, sources, entries, false));
+
+    // Not a pack at all, then one cut short.
+    expect_to_be_false(vfs_mount_pack("", TEST_LOOSE_PATH));
+    expect_to_be_true(vfs_pack_write(TEST_PACK_PATH, 1, sources, entries, false));
+    file_mapping pack;
+    expect_to_be_true(filesystem_map(TEST_PACK_PATH, &pack));
+    u64 pack_size = pack.size;
+    u8* bytes = kallocate(pack_size, MEMORY_TAG_STRING);
+    kcopy_memory(bytes, pack.data, pack_size);
+    filesystem_unmap(&pack);
+    expect_to_be_true(write_file(TEST_BINARY_PATH, pack_size - 1, bytes));
+    expect_to_be_false(vfs_mount_pack("", TEST_BINARY_PATH));
+
+    // The only entry, found as the one slot in use.
+    vfs_pack_header* header = (vfs_pack_header*)bytes;
+    vfs_pack_entry* entry = (vfs_pack_entry*)(header + 1);
+    while(entry->path_length == 0)
+    {
+        entry++;
+    }
+    vfs_pack_entry original = *entry;
+
+    // Data which is not aligned.
+    entry->offset -= 4;
+    expect_to_be_true(write_file(TEST_BINARY_PATH, pack_size, bytes));
+    expect_to_be_false(vfs_mount_pack("", TEST_BINARY_PATH));
+
+    // A compressed entry claiming far more than its stored bytes could hold.
+    *entry = original;
+    entry->compression = VFS_COMPRESSION_LZ4;
+    entry->size = 0xFFFFFFFFFFull;
+    expect_to_be_true(write_file(TEST_BINARY_PATH, pack_size, bytes));
+    expect_to_be_false(vfs_mount_pack("", TEST_BINARY_PATH));
+
+    // Unchanged, it mounts.
+    *entry = original;
+    expect_to_be_true(write_file(TEST_BINARY_PATH, pack_size, bytes));
+    expect_to_be_true(vfs_mount_pack("", TEST_BINARY_PATH));
+    kfree(bytes, pack_size, MEMORY_TAG_STRING);
+
+    stop_vfs(&system);
+    return true;
+}
+
+void vfs_register_tests()
+{
+    test_manager_register_test(vfs_should_read_loose_files_before_initialization, "VFS should read loose files before initialization");
+    test_manager_register_test(vfs_pack_should_round_trip, "VFS pack should round trip");
+    test_manager_register_test(vfs_should_search_recent_mounts_first, "VFS should search recent mounts first");
+    test_manager_register_test(vfs_should_reject_bad_packs, "VFS should reject bad packs");
+}
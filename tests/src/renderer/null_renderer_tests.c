@@ -0,0 +1,71 @@
+#include "null_renderer_tests.h"
+#include "../test_manager.h"
+#include "../expect.h"
+
+#include <defines.h>
+
+#include <core/kmemory.h>
+#include <math/kmath.h>
+#include <renderer/renderer_backend.h>
+#include <renderer/null/null_backend.h>
+
+u8 null_renderer_should_count_draws_and_uploads()
+{
+    renderer_backend backend = {};
+    expect_to_be_true(renderer_backend_create(RENDERER_BACKEND_TYPE_NULL, &backend));
+    expect_to_be_true(backend.initialize(&backend, "null renderer test"));
+
+    geometry_render_data data = {};
+    data.model = mat4_identity();
+    for(u32 frame = 0; frame < 3; ++frame)
+    {
+        expect_to_be_true(backend.begin_frame(&backend, 0.016f));
+        backend.update_global_state(mat4_identity(), mat4_identity(), vec3_zero(), vec4_one(), 0);
+        backend.update_object(data);
+        backend.update_object(data);
+        expect_to_be_true(backend.end_frame(&backend, 0.016f));
+    }
+
+    u8 pixels[4 * 4 * 4] = {};
+    texture t = {};
+    texture_sampler_params sampler = {};
+    sampler.minify = TEXTURE_FILTER_NEAREST;
+    backend.create_texture("null test texture", 4, 4, 4, pixels, false, &sampler, &t);
+    expect_should_be(4, t.width);
+    expect_should_be(4, t.height);
+    // 4x4, 2x2 and 1x1.
+    expect_should_be(3, t.mip_levels);
+    expect_should_be(TEXTURE_FILTER_NEAREST, t.sampler.minify);
+    // First upload, as with the GPU backends.
+    expect_should_be(0, t.generation);
+    backend.destroy_texture(&t);
+    expect_should_be(0, t.width);
+
+    backend.resized(&backend, 640, 480);
+
+    // Nothing was drawn, so there is no frame to read back.
+    u32 width = 0;
+    u32 height = 0;
+    expect_to_be_false(backend.read_last_frame(&backend, &width, &height, 0));
+
+    null_renderer_stats stats;
+    null_renderer_get_stats(&stats);
+    expect_should_be(3, stats.frame_count);
+    expect_should_be(3, stats.global_update_count);
+    expect_should_be(6, stats.draw_count);
+    expect_should_be(1, stats.texture_upload_count);
+    expect_should_be(64, stats.texture_upload_bytes);
+    expect_should_be(1, stats.texture_destroy_count);
+    expect_should_be(1, stats.resize_count);
+
+    backend.shutdown(&backend);
+    renderer_backend_destroy(&backend);
+    expect_should_be(0, backend.initialize);
+    expect_should_be(0, backend.read_last_frame);
+    return true;
+}
+
+void null_renderer_register_tests()
+{
+    test_manager_register_test(null_renderer_should_count_draws_and_uploads, "Null renderer should count draws and uploads");
+}
@@ -0,0 +1,3 @@
+#pragma once
+
+void null_renderer_register_tests();
@@ -0,0 +1,68 @@
+#include "vulkan_renderer_tests.h"
+#include "../test_manager.h"
+#include "../expect.h"
+
+#include <defines.h>
+
+#include <core/logger.h>
+#include <core/kmemory.h>
+#include <math/kmath.h>
+#include <renderer/renderer_backend.h>
+
+u8 vulkan_renderer_should_read_back_offscreen_frames()
+{
+    if(!renderer_backend_is_supported(RENDERER_BACKEND_TYPE_VULKAN))
+    {
+        KDEBUG("No Vulkan device present. Skipping offscreen readback test.");
+        return BYPASS;
+    }
+
+    renderer_backend backend = {};
+    expect_to_be_true(renderer_backend_create(RENDERER_BACKEND_TYPE_VULKAN, &backend));
+    backend.offscreen = true;
+    backend.readback = true;
+    expect_to_be_true(backend.initialize(&backend, "vulkan renderer test"));
+
+    // Nothing was drawn yet.
+    u32 width = 0;
+    u32 height = 0;
+    expect_to_be_false(backend.read_last_frame(&backend, &width, &height, 0));
+
+    for(u32 frame = 0; frame < 2; ++frame)
+    {
+        expect_to_be_true(backend.begin_frame(&backend, 0.016f));
+        backend.update_global_state(mat4_identity(), mat4_identity(), vec3_zero(), vec4_one(), 0);
+        expect_to_be_true(backend.end_frame(&backend, 0.016f));
+        backend.frame_number++;
+    }
+
+    // Without an application the backend falls back to 800x600.
+    expect_to_be_true(backend.read_last_frame(&backend, &width, &height, 0));
+    expect_should_be(800, width);
+    expect_should_be(600, height);
+
+    u64 size = (u64)width * height * 4;
+    u8* pixels = kallocate(size, MEMORY_TAG_RENDERER);
+    expect_to_be_true(backend.read_last_frame(&backend, &width, &height, pixels));
+
+    // Nothing but the main renderpass clear colour (0, 0, 0.2, 1) should have been drawn.
+    u64 mismatches = 0;
+    for(u64 i = 0; i < size; i += 4)
+    {
+        if(pixels[i] != 0 || pixels[i + 1] != 0 || pixels[i + 2] != 51 || pixels[i + 3] != 255)
+        {
+            mismatches++;
+        }
+    }
+    kfree(pixels, size, MEMORY_TAG_RENDERER);
+    expect_should_be(0, mismatches);
+
+    backend.shutdown(&backend);
+    renderer_backend_destroy(&backend);
+    return true;
+}
+
+void vulkan_renderer_register_tests()
+{
+    test_manager_register_test(vulkan_renderer_should_read_back_offscreen_frames, "Vulkan renderer should read back offscreen frames");
+}
@@ -0,0 +1,3 @@
+#pragma once
+
+void vulkan_renderer_register_tests();
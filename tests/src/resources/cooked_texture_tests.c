@@ -0,0 +1,164 @@
+#include "cooked_texture_tests.h"
+#include "../test_manager.h"
+#include "../expect.h"
+
+#include <defines.h>
+
+#include <core/logger.h>
+#include <core/kmemory.h>
+#include <containers/hashtable.h>
+#include <platform/filesystem.h>
+#include <resources/cooked_texture.h>
+
+// Written next to the test executable.
+#define TEST_COOKED_PATH "cooked_texture_test." COOKED_TEXTURE_EXTENSION
+#define TEST_SOURCE_PATH "cooked_texture_test.bin"
+
+static b8 write_file(const char* path, u64 size, const void* data)
+{
+    file_handle f;
+    if(!filesystem_open(path, FILE_MODE_WRITE, true, &f))
+    {
+        return false;
+    }
+    u64 written = 0;
+    b8 result = filesystem_write(&f, size, data, &written);
+    filesystem_close(&f);
+    return result;
+}
+
+u8 cooked_texture_should_round_trip_with_mips()
+{
+    // 5x3, each pixel's channels set to its index.
+    u8 pixels[5 * 3 * 4];
+    for(u32 i = 0; i < 5 * 3; ++i)
+    {
+        pixels[i * 4 + 0] = (u8)i;
+        pixels[i * 4 + 1] = (u8)i;
+        pixels[i * 4 + 2] = (u8)i;
+        pixels[i * 4 + 3] = 255;
+    }
+
+    file_info source_info = {123, 456};
+    expect_to_be_true(cooked_texture_write(TEST_COOKED_PATH, &source_info, 789, 5, 3, pixels, false));
+
+    cooked_texture cooked;
+    expect_to_be_true(cooked_texture_open(TEST_COOKED_PATH, TEST_SOURCE_PATH, &source_info, &cooked));
+    expect_should_be(5, cooked.header->width);
+    expect_should_be(3, cooked.header->height);
+    expect_should_be(false, cooked.header->has_transparency);
+
+    // 5x3, 2x1, 1x1.
+    expect_should_be(3, cooked.header->mip_count);
+    expect_should_be(2, cooked.mips[1].width);
+    expect_should_be(1, cooked.mips[1].height);
+    expect_should_be(1, cooked.mips[2].width);
+    expect_should_be(1, cooked.mips[2].height);
+    for(u32 i = 0; i < cooked.header->mip_count; ++i)
+    {
+        b8 aligned = cooked.mips[i].offset % COOKED_TEXTURE_ALIGNMENT == 0;
+        expect_to_be_true(aligned);
+    }
+
+    const u8* level0 = cooked_texture_mip_pixels(&cooked, 0);
+    for(u32 i = 0; i < sizeof(pixels); ++i)
+    {
+        expect_should_be(pixels[i], level0[i]);
+    }
+
+    // Each texel of a mip averages the 2x2 block above it: (0 + 1 + 5 + 6) / 4, rounded.
+    const u8* level1 = cooked_texture_mip_pixels(&cooked, 1);
+    expect_should_be(3, level1[0]);
+    expect_should_be(255, level1[3]);
+    expect_should_be(0, cooked_texture_mip_pixels(&cooked, 3));
+
+    cooked_texture_close(&cooked);
+    return true;
+}
+
+u8 cooked_texture_should_reject_stale_or_damaged_files()
+{
+    u8 source[64];
+    for(u32 i = 0; i < sizeof(source); ++i)
+    {
+        source[i] = (u8)i;
+    }
+    expect_to_be_true(write_file(TEST_SOURCE_PATH, sizeof(source), source));
+    file_info source_info;
+    expect_to_be_true(filesystem_get_info(TEST_SOURCE_PATH, &source_info));
+    expect_should_be(sizeof(source), source_info.size);
+
+    u8 pixels[4 * 4 * 4] = {};
+    u64 hash = hash_bytes(source, sizeof(source), 0);
+    expect_to_be_true(cooked_texture_write(TEST_COOKED_PATH, &source_info, hash, 4, 4, pixels, true));
+
+    // A different size never matches.
+    cooked_texture cooked;
+    file_info resized = source_info;
+    resized.size++;
+    expect_to_be_false(cooked_texture_open(TEST_COOKED_PATH, TEST_SOURCE_PATH, &resized, &cooked));
+
+    // A different time with the same contents does, by hash.
+    file_info touched = source_info;
+    touched.modified_time++;
+    expect_to_be_true(cooked_texture_open(TEST_COOKED_PATH, TEST_SOURCE_PATH, &touched, &cooked));
+    expect_should_be(true, cooked.header->has_transparency);
+    cooked_texture_close(&cooked);
+
+    // But not once the contents change.
+    source[0] = 255;
+    expect_to_be_true(write_file(TEST_SOURCE_PATH, sizeof(source), source));
+    expect_to_be_false(cooked_texture_open(TEST_COOKED_PATH, TEST_SOURCE_PATH, &touched, &cooked));
+
+    // A file cut short is never used.
+    expect_to_be_true(cooked_texture_write(TEST_COOKED_PATH, &source_info, hash, 4, 4, pixels, true));
+    file_handle f;
+    expect_to_be_true(filesystem_open(TEST_COOKED_PATH, FILE_MODE_READ, true, &f));
+    u8* bytes = 0;
+    u64 size = 0;
+    expect_to_be_true(filesystem_read_all_bytes(&f, &bytes, &size));
+    filesystem_close(&f);
+    expect_to_be_true(write_file(TEST_COOKED_PATH, size - 1, bytes));
+    kfree(bytes, size, MEMORY_TAG_STRING);
+    expect_to_be_false(cooked_texture_open(TEST_COOKED_PATH, TEST_SOURCE_PATH, &source_info, &cooked));
+    return true;
+}
+
+u8 cooked_texture_should_survive_a_recook_while_open()
+{
+    u8 pixels[8 * 8 * 4];
+    kzero_memory(pixels, sizeof(pixels));
+    file_info source_info = {123, 456};
+    expect_to_be_true(cooked_texture_write(TEST_COOKED_PATH, &source_info, 789, 8, 8, pixels, false));
+
+    cooked_texture old_cooked;
+    expect_to_be_true(cooked_texture_open(TEST_COOKED_PATH, TEST_SOURCE_PATH, &source_info, &old_cooked));
+
+    // Recooked smaller while the old one is open, which must neither change nor cut short what it reads.
+    u8 small_pixels[2 * 2 * 4];
+    for(u32 i = 0; i < sizeof(small_pixels); ++i)
+    {
+        small_pixels[i] = 200;
+    }
+    expect_to_be_true(cooked_texture_write(TEST_COOKED_PATH, &source_info, 789, 2, 2, small_pixels, true));
+
+    expect_should_be(8, old_cooked.header->width);
+    const u8* old_smallest = cooked_texture_mip_pixels(&old_cooked, old_cooked.header->mip_count - 1);
+    expect_should_be(0, old_smallest[0]);
+
+    cooked_texture new_cooked;
+    expect_to_be_true(cooked_texture_open(TEST_COOKED_PATH, TEST_SOURCE_PATH, &source_info, &new_cooked));
+    expect_should_be(2, new_cooked.header->width);
+    expect_should_be(200, cooked_texture_mip_pixels(&new_cooked, 0)[0]);
+
+    cooked_texture_close(&new_cooked);
+    cooked_texture_close(&old_cooked);
+    return true;
+}
+
+void cooked_texture_register_tests()
+{
+    test_manager_register_test(cooked_texture_should_round_trip_with_mips, "Cooked texture should round trip with mips");
+    test_manager_register_test(cooked_texture_should_reject_stale_or_damaged_files, "Cooked texture should reject stale or damaged files");
+    test_manager_register_test(cooked_texture_should_survive_a_recook_while_open, "Cooked texture should survive a recook while open");
+}
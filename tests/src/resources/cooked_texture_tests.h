@@ -0,0 +1,3 @@
+#pragma once
+
+void cooked_texture_register_tests();
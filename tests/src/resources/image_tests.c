@@ -0,0 +1,113 @@
+#include "image_tests.h"
+#include "../test_manager.h"
+#include "../expect.h"
+
+#include <defines.h>
+
+#include <core/logger.h>
+#include <core/kmemory.h>
+#include <platform/filesystem.h>
+#include <resources/image.h>
+
+u8 image_to_rgba_flipped_should_expand_and_flip()
+{
+    // 2x2 of each channel count, the top row first.
+    const u8 grey[] = {10, 20, 30, 40};
+    const u8 grey_alpha[] = {10, 255, 20, 255, 30, 128, 40, 255};
+    const u8 rgb[] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12};
+    u8 out[2 * 2 * 4];
+
+    expect_to_be_false(image_to_rgba_flipped(grey, 2, 2, 1, out));
+    // The bottom row comes first.
+    expect_should_be(30, out[0]);
+    expect_should_be(30, out[2]);
+    expect_should_be(255, out[3]);
+    expect_should_be(10, out[8]);
+
+    expect_to_be_true(image_to_rgba_flipped(grey_alpha, 2, 2, 2, out));
+    expect_should_be(30, out[1]);
+    expect_should_be(128, out[3]);
+    expect_should_be(20, out[12]);
+    expect_should_be(255, out[15]);
+
+    expect_to_be_false(image_to_rgba_flipped(rgb, 2, 2, 3, out));
+    expect_should_be(7, out[0]);
+    expect_should_be(9, out[2]);
+    expect_should_be(255, out[3]);
+    expect_should_be(4, out[12]);
+    expect_should_be(255, out[15]);
+
+    const u8 rgba[] = {1, 2, 3, 255, 4, 5, 6, 255, 7, 8, 9, 0, 10, 11, 12, 255};
+    expect_to_be_true(image_to_rgba_flipped(rgba, 2, 2, 4, out));
+    expect_should_be(7, out[0]);
+    expect_should_be(0, out[3]);
+    expect_should_be(1, out[8]);
+
+    return true;
+}
+
+u8 image_is_opaque_should_find_any_transparent_pixel()
+{
+    // Long enough for the widest vector loop, with a remainder the plain loop has to finish.
+    const u32 pixel_count = 131;
+    u8* pixels = kallocate(pixel_count * 4, MEMORY_TAG_TEXTURE);
+    kset_memory(pixels, 255, pixel_count * 4);
+    expect_to_be_true(image_is_opaque(pixels, pixel_count));
+
+    // Transparent colour bytes do not count.
+    pixels[0] = 0;
+    pixels[pixel_count * 4 - 2] = 0;
+    expect_to_be_true(image_is_opaque(pixels, pixel_count));
+
+    // An alpha below 255 anywhere is found, whichever loop covers it.
+    for(u32 i = 0; i < pixel_count; ++i)
+    {
+        pixels[i * 4 + 3] = 254;
+        b8 opaque = image_is_opaque(pixels, pixel_count);
+        pixels[i * 4 + 3] = 255;
+        expect_to_be_false(opaque);
+    }
+
+    expect_to_be_true(image_is_opaque(pixels, 0));
+
+    kfree(pixels, pixel_count * 4, MEMORY_TAG_TEXTURE);
+    return true;
+}
+
+u8 image_decode_should_load_a_png()
+{
+    // From assets/textures, which is copied next to the test executable by post-build.
+    const char* path = "assets/textures/paving.png";
+    file_handle f;
+    expect_to_be_true(filesystem_open(path, FILE_MODE_READ, true, &f));
+    u8* bytes = 0;
+    u64 size = 0;
+    b8 read = filesystem_read_all_bytes(&f, &bytes, &size);
+    filesystem_close(&f);
+    expect_to_be_true(read);
+
+    image img;
+    b8 decoded = image_decode(path, bytes, size, &img);
+    expect_to_be_true(decoded);
+    expect_should_be(480, img.width);
+    expect_should_be(480, img.height);
+    expect_should_not_be(0, img.pixels);
+    b8 opaque = image_is_opaque(img.pixels, (u64)img.width * img.height);
+    b8 matches_scan = opaque != img.has_transparency;
+    expect_to_be_true(matches_scan);
+    image_free(&img);
+    expect_should_be(0, img.pixels);
+
+    KDEBUG("Note: The following warning is intentionally caused by this test.");
+    expect_to_be_false(image_decode(path, bytes, 16, &img));
+
+    kfree(bytes, size, MEMORY_TAG_STRING);
+    return true;
+}
+
+void image_register_tests()
+{
+    test_manager_register_test(image_to_rgba_flipped_should_expand_and_flip, "Image to RGBA should expand channels and flip rows");
+    test_manager_register_test(image_is_opaque_should_find_any_transparent_pixel, "Image opacity scan should find any transparent pixel");
+    test_manager_register_test(image_decode_should_load_a_png, "Image decode should load a PNG");
+}
@@ -0,0 +1,177 @@
+#include "job_system_tests.h"
+#include "../test_manager.h"
+#include "../expect.h"
+
+#include <defines.h>
+
+#include <core/kmemory.h>
+#include <platform/platform.h>
+#include <systems/job_system.h>
+
+typedef struct increment_params
+{
+    volatile i32* target;
+    i32 amount;
+} increment_params;
+
+typedef struct fan_out_params
+{
+    volatile i32* target;
+    u32 child_count;
+} fan_out_params;
+
+static void increment_job(void* params)
+{
+    increment_params* p = params;
+    platform_atomic_add_i32(p->target, p->amount);
+}
+
+// Counts the jobs whose parameters arrived misaligned for a struct of u64s.
+static void check_alignment_job(void* params)
+{
+    increment_params* p = params;
+    if((u64)params % 16 != 0)
+    {
+        platform_atomic_add_i32(p->target, 1);
+    }
+}
+
+// Submits children from inside a job and waits for them, which requires the worker to help while waiting.
+static void fan_out_job(void* params)
+{
+    fan_out_params* p = params;
+    job_counter children = {};
+    for(u32 i = 0; i < p->child_count; ++i)
+    {
+        increment_params child = {p->target, 1};
+        job_system_submit(increment_job, &child, sizeof(child), JOB_PRIORITY_HIGH, &children);
+    }
+    job_system_wait(&children);
+}
+
+static void* start_job_system(u8 worker_count, u32 jobs_per_thread)
+{
+    job_system_config config = {worker_count, jobs_per_thread};
+    u64 requirement = 0;
+    job_system_initialize(&requirement, 0, config);
+    void* state = kallocate_aligned(requirement, 64, MEMORY_TAG_JOB);
+    job_system_initialize(&requirement, state, config);
+    return state;
+}
+
+static void stop_job_system(void* state, u8 worker_count, u32 jobs_per_thread)
+{
+    job_system_config config = {worker_count, jobs_per_thread};
+    u64 requirement = 0;
+    job_system_initialize(&requirement, 0, config);
+    job_system_shutdown(state);
+    kfree_aligned(state, requirement, 64, MEMORY_TAG_JOB);
+}
+
+u8 job_system_should_run_inline_when_not_initialized()
+{
+    volatile i32 value = 0;
+    job_counter counter = {};
+    increment_params params = {&value, 5};
+    expect_to_be_true(job_system_submit(increment_job, &params, sizeof(params), JOB_PRIORITY_NORMAL, &counter));
+    expect_should_be(5, value);
+    expect_to_be_true(job_system_is_complete(&counter));
+    expect_should_be(1, job_system_thread_count());
+    return true;
+}
+
+u8 job_system_should_run_every_job()
+{
+    // A small slot ring forces the submitter to recycle slots and help out when they run short.
+    void* state = start_job_system(3, 64);
+    expect_should_be(4, job_system_thread_count());
+
+    volatile i32 value = 0;
+    job_counter counter = {};
+    for(u32 i = 0; i < 5000; ++i)
+    {
+        increment_params params = {&value, 1};
+        job_priority priority = (job_priority)(i % JOB_PRIORITY_COUNT);
+        expect_to_be_true(job_system_submit(increment_job, &params, sizeof(params), priority, &counter));
+    }
+
+    job_system_wait(&counter);
+    expect_to_be_true(job_system_is_complete(&counter));
+    expect_should_be(5000, value);
+
+    stop_job_system(state, 3, 64);
+    return true;
+}
+
+u8 job_system_should_fan_in_nested_jobs()
+{
+    void* state = start_job_system(2, 0);
+
+    volatile i32 value = 0;
+    job_counter counter = {};
+    for(u32 i = 0; i < 16; ++i)
+    {
+        fan_out_params params = {&value, 32};
+        job_system_submit(fan_out_job, &params, sizeof(params), JOB_PRIORITY_NORMAL, &counter);
+    }
+
+    job_system_wait(&counter);
+    expect_should_be(16 * 32, value);
+
+    stop_job_system(state, 2, 0);
+    return true;
+}
+
+u8 job_system_should_finish_queued_jobs_on_shutdown()
+{
+    void* state = start_job_system(1, 0);
+
+    volatile i32 value = 0;
+    for(u32 i = 0; i < 500; ++i)
+    {
+        increment_params params = {&value, 2};
+        job_system_submit(increment_job, &params, sizeof(params), JOB_PRIORITY_LOW, 0);
+    }
+
+    // No wait: shutdown itself must not drop anything.
+    stop_job_system(state, 1, 0);
+    expect_should_be(1000, value);
+    return true;
+}
+
+u8 job_system_should_align_job_params()
+{
+    volatile i32 misaligned = 0;
+    increment_params params = {&misaligned, 0};
+    job_system_submit(check_alignment_job, &params, sizeof(params), JOB_PRIORITY_NORMAL, 0);
+
+    void* state = start_job_system(2, 64);
+    job_counter counter = {};
+    for(u32 i = 0; i < 200; ++i)
+    {
+        job_system_submit(check_alignment_job, &params, sizeof(params), JOB_PRIORITY_NORMAL, &counter);
+    }
+    job_system_wait(&counter);
+    stop_job_system(state, 2, 64);
+
+    expect_should_be(0, misaligned);
+    return true;
+}
+
+u8 job_system_should_reject_oversized_params()
+{
+    u8 params[JOB_MAX_PARAM_SIZE + 1];
+    KDEBUG("Note: The following error is intentionally caused by this test.");
+    expect_to_be_false(job_system_submit(increment_job, params, sizeof(params), JOB_PRIORITY_NORMAL, 0));
+    return true;
+}
+
+void job_system_register_tests()
+{
+    test_manager_register_test(job_system_should_run_inline_when_not_initialized, "Job system should run jobs inline when not initialized");
+    test_manager_register_test(job_system_should_run_every_job, "Job system should run every submitted job");
+    test_manager_register_test(job_system_should_fan_in_nested_jobs, "Job system should fan in nested jobs");
+    test_manager_register_test(job_system_should_finish_queued_jobs_on_shutdown, "Job system should finish queued jobs on shutdown");
+    test_manager_register_test(job_system_should_align_job_params, "Job system should align job parameters");
+    test_manager_register_test(job_system_should_reject_oversized_params, "Job system should reject oversized parameters");
+}
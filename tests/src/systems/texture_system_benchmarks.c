@@ -0,0 +1,211 @@
+#include "texture_system_benchmarks.h"
+#include "../test_manager.h"
+#include "../expect.h"
+
+#include <defines.h>
+#include <core/kmemory.h>
+#include <core/logger.h>
+#include <core/clock.h>
+#include <core/kstring.h>
+#include <platform/filesystem.h>
+#include <renderer/renderer_frontend.h>
+#include <resources/image.h>
+#include <systems/job_system.h>
+#include <systems/texture_system.h>
+
+/*
+    Benchmarks of loading textures the way a level load does: every file in assets/textures decoded
+    from scratch, with cooking disabled so nothing is mapped from an earlier run. The files' pages are
+    dropped from the OS cache before every iteration, outside the timed part, so each one reads from the
+    disk. Where that is not supported the load is from a warm cache, and the result says so. Acquiring
+    them one at a time is compared against texture_system_acquire_batch on the job system. The alpha scan, which
+    used to be a byte at a time loop over every pixel, is compared against the original separately.
+*/
+
+#define BENCH_ITERATIONS 4
+#define BENCH_WORKER_COUNT 4
+#define BENCH_SCAN_SIZE 2048
+
+// Everything in assets/textures. The filesystem has no directory listing to find them with.
+static const char* bench_texture_names[] = {"cobblestone", "paving", "paving2"};
+#define BENCH_TEXTURE_COUNT (sizeof(bench_texture_names) / sizeof(bench_texture_names[0]))
+
+typedef struct bench_systems
+{
+    u64 job_requirement;
+    void* job_state;
+    u64 renderer_requirement;
+    void* renderer_state;
+    u64 texture_requirement;
+    void* texture_state;
+} bench_systems;
+
+static b8 start_bench_systems(bench_systems* out_systems)
+{
+    job_system_config job_config = {BENCH_WORKER_COUNT, 0};
+    job_system_initialize(&out_systems->job_requirement, 0, job_config);
+    out_systems->job_state = kallocate_aligned(out_systems->job_requirement, 64, MEMORY_TAG_JOB);
+    if(!job_system_initialize(&out_systems->job_requirement, out_systems->job_state, job_config))
+    {
+        return false;
+    }
+
+    renderer_backend_config backend_config = {};
+    backend_config.type = RENDERER_BACKEND_TYPE_NULL;
+    renderer_system_initialize(&out_systems->renderer_requirement, 0, 0, backend_config);
+    out_systems->renderer_state = kallocate(out_systems->renderer_requirement, MEMORY_TAG_RENDERER);
+    if(!renderer_system_initialize(&out_systems->renderer_requirement, out_systems->renderer_state, "texture system benchmark", backend_config))
+    {
+        return false;
+    }
+
+    texture_system_config config = {};
+    config.max_texture_count = 16;
+    config.disable_cooked_textures = true;
+    texture_system_initialize(&out_systems->texture_requirement, 0, config);
+    out_systems->texture_state = kallocate(out_systems->texture_requirement, MEMORY_TAG_TEXTURE);
+    return texture_system_initialize(&out_systems->texture_requirement, out_systems->texture_state, config);
+}
+
+static void stop_bench_systems(bench_systems* systems)
+{
+    texture_system_shutdown(systems->texture_state);
+    kfree(systems->texture_state, systems->texture_requirement, MEMORY_TAG_TEXTURE);
+    renderer_system_shutdown(systems->renderer_state);
+    kfree(systems->renderer_state, systems->renderer_requirement, MEMORY_TAG_RENDERER);
+    job_system_shutdown(systems->job_state);
+    kfree_aligned(systems->job_state, systems->job_requirement, 64, MEMORY_TAG_JOB);
+}
+
+static void release_bench_textures()
+{
+    for(u32 i = 0; i < BENCH_TEXTURE_COUNT; ++i)
+    {
+        texture_system_release(bench_texture_names[i]);
+    }
+}
+
+// Drops the source files from the page cache. False if any of them stays cached.
+static b8 drop_bench_textures()
+{
+    b8 dropped = true;
+    char path[512];
+    for(u32 i = 0; i < BENCH_TEXTURE_COUNT; ++i)
+    {
+        string_format(path, "assets/textures/%s.png", bench_texture_names[i]);
+        dropped = filesystem_drop_cached_pages(path) && dropped;
+    }
+    return dropped;
+}
+
+u8 texture_system_benchmark_cold_directory_load()
+{
+    bench_systems systems = {};
+    expect_to_be_true(start_bench_systems(&systems));
+
+    b8 cold = true;
+
+    // One at a time, each decoded on the calling thread before the next starts.
+    clock sequential_time;
+    f64 sequential_elapsed = 0;
+    u32 sequential_loaded = 0;
+    for(u32 iteration = 0; iteration < BENCH_ITERATIONS; ++iteration)
+    {
+        cold = drop_bench_textures() && cold;
+        clock_start(&sequential_time);
+        for(u32 i = 0; i < BENCH_TEXTURE_COUNT; ++i)
+        {
+            texture* t = texture_system_acquire(bench_texture_names[i], true);
+            sequential_loaded += t && t->generation != INVALID_ID;
+        }
+        clock_update(&sequential_time);
+        sequential_elapsed += sequential_time.elapsed;
+        release_bench_textures();
+    }
+
+    // All at once, decoded side by side on the workers.
+    clock batch_time;
+    f64 batch_elapsed = 0;
+    u32 batch_loaded = 0;
+    texture* textures[BENCH_TEXTURE_COUNT];
+    for(u32 iteration = 0; iteration < BENCH_ITERATIONS; ++iteration)
+    {
+        cold = drop_bench_textures() && cold;
+        clock_start(&batch_time);
+        if(texture_system_acquire_batch(BENCH_TEXTURE_COUNT, bench_texture_names, true, textures))
+        {
+            batch_loaded += BENCH_TEXTURE_COUNT;
+        }
+        clock_update(&batch_time);
+        batch_elapsed += batch_time.elapsed;
+        release_bench_textures();
+    }
+
+    u32 load_count = BENCH_ITERATIONS * BENCH_TEXTURE_COUNT;
+    KINFO("texture system bench (%u files, %u threads, %s cache): one at a time %.2f ms/texture | batch %.2f ms/texture",
+          (u32)BENCH_TEXTURE_COUNT, job_system_thread_count(), cold ? "cold" : "warm",
+          (sequential_elapsed * 1000.0) / load_count,
+          (batch_elapsed * 1000.0) / load_count);
+
+    stop_bench_systems(&systems);
+
+    expect_should_be(load_count, sequential_loaded);
+    expect_should_be(load_count, batch_loaded);
+
+    return true;
+}
+
+u8 texture_system_benchmark_alpha_scan()
+{
+    u64 pixel_count = (u64)BENCH_SCAN_SIZE * BENCH_SCAN_SIZE;
+    u8* pixels = kallocate(pixel_count * 4, MEMORY_TAG_TEXTURE);
+    kset_memory(pixels, 255, pixel_count * 4);
+
+    // The original scan from load_texture. An opaque image is its worst case, since it never stops early.
+    clock legacy_time;
+    clock_start(&legacy_time);
+    u32 legacy_transparent = 0;
+    for(u32 iteration = 0; iteration < BENCH_ITERATIONS; ++iteration)
+    {
+        b8 has_transparency = false;
+        for(u64 i = 0; i < pixel_count * 4; i += 4)
+        {
+            u8 a = pixels[i + 3];
+            if(a < 255)
+            {
+                has_transparency = true;
+                break;
+            }
+        }
+        legacy_transparent += has_transparency;
+    }
+    clock_update(&legacy_time);
+
+    clock scan_time;
+    clock_start(&scan_time);
+    u32 scan_transparent = 0;
+    for(u32 iteration = 0; iteration < BENCH_ITERATIONS; ++iteration)
+    {
+        scan_transparent += !image_is_opaque(pixels, pixel_count);
+    }
+    clock_update(&scan_time);
+
+    u64 scanned = pixel_count * BENCH_ITERATIONS;
+    KINFO("texture system bench: alpha scan of %ux%u opaque pixels, byte loop %.3f ns/pixel | image_is_opaque %.3f ns/pixel",
+          BENCH_SCAN_SIZE, BENCH_SCAN_SIZE,
+          (legacy_time.elapsed * 1000000000.0) / scanned,
+          (scan_time.elapsed * 1000000000.0) / scanned);
+
+    kfree(pixels, pixel_count * 4, MEMORY_TAG_TEXTURE);
+
+    expect_should_be(0, legacy_transparent);
+    expect_should_be(0, scan_transparent);
+
+    return true;
+}
+
+void texture_system_register_benchmarks()
+{
+    test_manager_register_test(texture_system_benchmark_cold_directory_load, "Texture system benchmark: cold load of every texture, one at a time against a batch");
+    test_manager_register_test(texture_system_benchmark_alpha_scan, "Texture system benchmark: alpha scan against the byte loop");
+}
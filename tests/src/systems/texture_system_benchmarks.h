@@ -0,0 +1,3 @@
+#pragma once
+
+void texture_system_register_benchmarks();
@@ -0,0 +1,474 @@
+#include "texture_system_tests.h"
+#include "../test_manager.h"
+#include "../expect.h"
+
+#include <defines.h>
+
+#include <core/kmemory.h>
+#include <platform/platform.h>
+#include <platform/filesystem.h>
+#include <platform/vfs.h>
+#include <resources/cooked_texture.h>
+#include <renderer/renderer_frontend.h>
+#include <systems/job_system.h>
+#include <systems/texture_system.h>
+
+// Textures from assets/textures, which is copied next to the test executable by post-build.
+#define TEST_TEXTURE "paving"
+#define OTHER_TEST_TEXTURE "cobblestone"
+
+typedef struct texture_test_systems
+{
+    u64 renderer_requirement;
+    void* renderer_state;
+    u64 texture_requirement;
+    void* texture_state;
+} texture_test_systems;
+
+// Starts the texture system on top of a null renderer.
+static b8 start_texture_system_with_config(u32 max_uploads_per_frame, u64 vram_budget, u32 stream_base_size, texture_test_systems* out_systems)
+{
+    renderer_backend_config backend_config = {};
+    backend_config.type = RENDERER_BACKEND_TYPE_NULL;
+    renderer_system_initialize(&out_systems->renderer_requirement, 0, 0, backend_config);
+    out_systems->renderer_state = kallocate(out_systems->renderer_requirement, MEMORY_TAG_RENDERER);
+    if(!renderer_system_initialize(&out_systems->renderer_requirement, out_systems->renderer_state, "texture system test", backend_config))
+    {
+        return false;
+    }
+
+    texture_system_config config = {};
+    config.max_texture_count = 8;
+    config.max_uploads_per_frame = max_uploads_per_frame;
+    config.vram_budget = vram_budget;
+    config.stream_base_size = stream_base_size;
+    texture_system_initialize(&out_systems->texture_requirement, 0, config);
+    out_systems->texture_state = kallocate(out_systems->texture_requirement, MEMORY_TAG_TEXTURE);
+    return texture_system_initialize(&out_systems->texture_requirement, out_systems->texture_state, config);
+}
+
+static b8 start_texture_system(u32 max_uploads_per_frame, texture_test_systems* out_systems)
+{
+    return start_texture_system_with_config(max_uploads_per_frame, 0, 0, out_systems);
+}
+
+static void stop_texture_system(texture_test_systems* systems)
+{
+    texture_system_shutdown(systems->texture_state);
+    kfree(systems->texture_state, systems->texture_requirement, MEMORY_TAG_TEXTURE);
+    renderer_system_shutdown(systems->renderer_state);
+    kfree(systems->renderer_state, systems->renderer_requirement, MEMORY_TAG_RENDERER);
+}
+
+u8 texture_acquire_async_should_upload_on_update()
+{
+    texture_test_systems systems = {};
+    expect_to_be_true(start_texture_system(1, &systems));
+
+    // Returned straight away, but drawn as the default texture until uploaded.
+    texture* t = texture_system_acquire_async(TEST_TEXTURE, false);
+    expect_should_not_be(0, t);
+    expect_should_not_be(INVALID_ID, t->id);
+    expect_should_be(INVALID_ID, t->generation);
+
+    // Acquiring it again while loading returns the same texture without loading it twice.
+    expect_should_be(t, texture_system_acquire_async(TEST_TEXTURE, false));
+    texture* other = texture_system_acquire_async(OTHER_TEST_TEXTURE, false);
+    expect_should_not_be(t, other);
+
+    // One upload per update, oldest first.
+    texture_system_update();
+    expect_should_be(0, t->generation);
+    expect_should_be(INVALID_ID, other->generation);
+    b8 has_size = t->width > 0 && t->height > 0;
+    expect_to_be_true(has_size);
+
+    texture_system_update();
+    expect_should_be(0, other->generation);
+
+    stop_texture_system(&systems);
+    return true;
+}
+
+u8 texture_acquire_should_finish_a_pending_load()
+{
+    texture_test_systems systems = {};
+    expect_to_be_true(start_texture_system(0, &systems));
+
+    texture* t = texture_system_acquire_async(TEST_TEXTURE, false);
+    expect_should_be(INVALID_ID, t->generation);
+
+    // A synchronous acquire always returns a loaded texture.
+    expect_should_be(t, texture_system_acquire(TEST_TEXTURE, false));
+    expect_should_be(0, t->generation);
+
+    // So the update has nothing left to upload.
+    texture_system_update();
+    expect_should_be(0, t->generation);
+
+    stop_texture_system(&systems);
+    return true;
+}
+
+u8 texture_release_should_cancel_a_pending_load()
+{
+    texture_test_systems systems = {};
+    expect_to_be_true(start_texture_system(0, &systems));
+
+    texture* t = texture_system_acquire_async(TEST_TEXTURE, true);
+    u32 id = t->id;
+    texture_system_release(TEST_TEXTURE);
+    expect_should_be(INVALID_ID, t->id);
+
+    // The cancelled load must not be uploaded into the freed slot.
+    texture_system_update();
+    expect_should_be(INVALID_ID, t->id);
+    expect_should_be(INVALID_ID, t->generation);
+
+    // Which can be reused, and loads normally.
+    texture* again = texture_system_acquire_async(TEST_TEXTURE, true);
+    expect_should_be(id, again->id);
+    texture_system_update();
+    expect_should_be(0, again->generation);
+
+    stop_texture_system(&systems);
+    return true;
+}
+
+u8 texture_acquire_async_should_keep_default_for_missing_files()
+{
+    texture_test_systems systems = {};
+    expect_to_be_true(start_texture_system(0, &systems));
+
+    KDEBUG("Note: The following warning and error are intentionally caused by this test.");
+    texture* t = texture_system_acquire_async("this_texture_does_not_exist", false);
+    expect_should_not_be(0, t);
+
+    texture_system_update();
+    expect_should_be(INVALID_ID, t->generation);
+
+    stop_texture_system(&systems);
+    return true;
+}
+
+u8 texture_acquire_async_should_decode_on_workers()
+{
+    job_system_config job_config = {2, 0};
+    u64 job_requirement = 0;
+    job_system_initialize(&job_requirement, 0, job_config);
+    void* job_state = kallocate_aligned(job_requirement, 64, MEMORY_TAG_JOB);
+    expect_to_be_true(job_system_initialize(&job_requirement, job_state, job_config));
+
+    texture_test_systems systems = {};
+    expect_to_be_true(start_texture_system(0, &systems));
+
+    texture* t = texture_system_acquire_async(TEST_TEXTURE, false);
+    texture* other = texture_system_acquire_async(OTHER_TEST_TEXTURE, false);
+    for(u32 i = 0; i < 5000 && (t->generation == INVALID_ID || other->generation == INVALID_ID); ++i)
+    {
+        texture_system_update();
+        platform_sleep(1);
+    }
+    expect_should_be(0, t->generation);
+    expect_should_be(0, other->generation);
+
+    // Loads still in flight at shutdown are waited for and discarded.
+    texture_system_acquire_async(TEST_TEXTURE "2", false);
+    stop_texture_system(&systems);
+
+    job_system_shutdown(job_state);
+    kfree_aligned(job_state, job_requirement, 64, MEMORY_TAG_JOB);
+    return true;
+}
+
+u8 texture_load_should_cook_and_reuse_the_file()
+{
+    texture_test_systems systems = {};
+    expect_to_be_true(start_texture_system(0, &systems));
+
+    // The first load decodes the file and leaves a cooked copy, unless an earlier run already has.
+    texture* t = texture_system_acquire(TEST_TEXTURE, true);
+    u32 width = t->width;
+    u32 height = t->height;
+    b8 has_transparency = t->has_transparency;
+    texture_system_release(TEST_TEXTURE);
+    expect_to_be_true(filesystem_exists("assets/textures/" TEST_TEXTURE "." COOKED_TEXTURE_EXTENSION));
+
+    // Which the next load maps, and matches the decoded texture. It reuses the slot, whose generation carries on.
+    t = texture_system_acquire(TEST_TEXTURE, true);
+    expect_should_be(1, t->generation);
+    expect_should_be(width, t->width);
+    expect_should_be(height, t->height);
+    expect_should_be(has_transparency, t->has_transparency);
+    texture_system_release(TEST_TEXTURE);
+
+    stop_texture_system(&systems);
+    return true;
+}
+
+u8 texture_set_sampler_should_reupload_loaded_textures()
+{
+    texture_test_systems systems = {};
+    expect_to_be_true(start_texture_system(0, &systems));
+
+    // Mipmapped by default.
+    texture* t = texture_system_acquire(TEST_TEXTURE, true);
+    expect_should_be(0, t->generation);
+    b8 mipmapped = t->mip_levels > 1;
+    expect_to_be_true(mipmapped);
+
+    texture_sampler_params sampler = {};
+    sampler.minify = TEXTURE_FILTER_NEAREST;
+    sampler.magnify = TEXTURE_FILTER_NEAREST;
+    sampler.disable_mips = true;
+    expect_to_be_true(texture_system_set_sampler(TEST_TEXTURE, sampler));
+    expect_should_be(1, t->generation);
+    expect_should_be(1, t->mip_levels);
+    expect_should_be(TEXTURE_FILTER_NEAREST, t->sampler.magnify);
+
+    // Kept by an async load, which picks them up when uploaded.
+    texture* other = texture_system_acquire_async(OTHER_TEST_TEXTURE, true);
+    expect_to_be_true(texture_system_set_sampler(OTHER_TEST_TEXTURE, sampler));
+    expect_should_be(INVALID_ID, other->generation);
+    texture_system_update();
+    expect_should_be(0, other->generation);
+    expect_should_be(1, other->mip_levels);
+
+    texture_system_release(TEST_TEXTURE);
+    texture_system_release(OTHER_TEST_TEXTURE);
+
+    KDEBUG("Note: The following warning is intentionally caused by this test.");
+    expect_to_be_false(texture_system_set_sampler(TEST_TEXTURE, sampler));
+
+    stop_texture_system(&systems);
+    return true;
+}
+
+// Loads a texture on its own to find how much GPU memory it takes.
+static u64 measure_texture(const char* name)
+{
+    texture_test_systems systems = {};
+    start_texture_system(0, &systems);
+    texture_system_acquire(name, true);
+    texture_residency_stats stats;
+    texture_system_get_residency_stats(&stats);
+    texture_system_release(name);
+    stop_texture_system(&systems);
+    return stats.resident_bytes;
+}
+
+u8 texture_budget_should_evict_least_recently_released()
+{
+    u64 paving_bytes = measure_texture(TEST_TEXTURE);
+    u64 paving2_bytes = measure_texture(TEST_TEXTURE "2");
+    u64 cobblestone_bytes = measure_texture(OTHER_TEST_TEXTURE);
+    b8 measured = paving_bytes > 0 && paving2_bytes > 0 && cobblestone_bytes > 0;
+    expect_to_be_true(measured);
+
+    // Room for all but one byte of the three.
+    texture_test_systems systems = {};
+    expect_to_be_true(start_texture_system_with_config(0, paving_bytes + paving2_bytes + cobblestone_bytes - 1, 0, &systems));
+
+    texture* paving = texture_system_acquire(TEST_TEXTURE, false);
+    texture* paving2 = texture_system_acquire(TEST_TEXTURE "2", false);
+    texture_system_release(TEST_TEXTURE "2");
+    texture_system_release(TEST_TEXTURE);
+
+    // Unreferenced, but within the budget, so still loaded.
+    texture_residency_stats stats;
+    texture_system_get_residency_stats(&stats);
+    expect_should_be(2, stats.resident_count);
+    expect_should_be(2, stats.evictable_count);
+    expect_should_be(paving_bytes + paving2_bytes, stats.resident_bytes);
+
+    // A third goes over, which evicts the texture released first.
+    texture* cobblestone = texture_system_acquire(OTHER_TEST_TEXTURE, false);
+    expect_should_be(0, cobblestone->generation);
+    expect_should_be(INVALID_ID, paving2->generation);
+    expect_should_be(0, paving->generation);
+    texture_system_get_residency_stats(&stats);
+    expect_should_be(1, stats.eviction_count);
+    expect_should_be(paving_bytes + cobblestone_bytes, stats.resident_bytes);
+
+    // Acquiring it again loads it with a new generation, which evicts the other unreferenced one.
+    expect_should_be(paving2, texture_system_acquire(TEST_TEXTURE "2", false));
+    expect_should_be(1, paving2->generation);
+    expect_should_be(INVALID_ID, paving->generation);
+    texture_system_get_residency_stats(&stats);
+    expect_should_be(2, stats.eviction_count);
+    expect_should_be(0, stats.evictable_count);
+    expect_should_be(paving2_bytes + cobblestone_bytes, stats.resident_bytes);
+
+    // Referenced textures are never evicted, even over the budget.
+    texture_system_acquire(TEST_TEXTURE, false);
+    expect_should_be(1, paving->generation);
+    texture_system_get_residency_stats(&stats);
+    expect_should_be(3, stats.resident_count);
+
+    stop_texture_system(&systems);
+    return true;
+}
+
+u8 texture_streaming_should_follow_screen_size()
+{
+    // 480x480, so the mips are 480, 240, 120 and 60 across, and 60 is the base.
+    texture_test_systems systems = {};
+    expect_to_be_true(start_texture_system_with_config(0, 0, 64, &systems));
+    texture* t = texture_system_acquire(TEST_TEXTURE, true);
+    expect_should_be(60, t->width);
+    expect_should_be(0, t->generation);
+
+    // Drawn at 130 pixels, which needs the 240 mip. It is loaded by one update and uploaded by the next.
+    // With no job system, the load runs as soon as it is started.
+    texture_system_request_screen_size(t, 130.0f);
+    texture_system_update();
+    texture_system_request_screen_size(t, 130.0f);
+    texture_system_update();
+    expect_should_be(240, t->width);
+    expect_should_be(1, t->generation);
+
+    // Drawn smaller again, it keeps the mip for a while before dropping to the base.
+    for(u32 i = 0; i < 200 && t->width != 60; ++i)
+    {
+        texture_system_update();
+        b8 kept_for_a_while = t->width == 240 || i > 100;
+        expect_to_be_true(kept_for_a_while);
+    }
+    expect_should_be(60, t->width);
+    expect_should_be(2, t->generation);
+
+    // Never above the base for textures drawn small.
+    texture_system_request_screen_size(t, 10.0f);
+    texture_system_update();
+    texture_system_update();
+    expect_should_be(60, t->width);
+
+    texture_system_release(TEST_TEXTURE);
+    stop_texture_system(&systems);
+    return true;
+}
+
+u8 texture_acquire_batch_should_load_every_texture()
+{
+    job_system_config job_config = {2, 0};
+    u64 job_requirement = 0;
+    job_system_initialize(&job_requirement, 0, job_config);
+    void* job_state = kallocate_aligned(job_requirement, 64, MEMORY_TAG_JOB);
+    expect_to_be_true(job_system_initialize(&job_requirement, job_state, job_config));
+
+    texture_test_systems systems = {};
+    expect_to_be_true(start_texture_system(0, &systems));
+
+    // Loaded by the time it returns, without any updates. A repeated name is the same texture.
+    const char* names[] = {TEST_TEXTURE, OTHER_TEST_TEXTURE, TEST_TEXTURE "2", TEST_TEXTURE};
+    texture* textures[4];
+    expect_to_be_true(texture_system_acquire_batch(4, names, false, textures));
+    for(u32 i = 0; i < 4; ++i)
+    {
+        expect_should_not_be(0, textures[i]);
+        expect_should_be(0, textures[i]->generation);
+    }
+    expect_should_be(textures[0], textures[3]);
+    expect_should_not_be(textures[0], textures[1]);
+
+    // A missing file is still acquired, but reported.
+    KDEBUG("Note: The following warnings and error are intentionally caused by this test.");
+    const char* missing[] = {OTHER_TEST_TEXTURE, "this_texture_does_not_exist"};
+    expect_to_be_false(texture_system_acquire_batch(2, missing, false, textures));
+    expect_should_be(0, textures[0]->generation);
+    expect_should_be(INVALID_ID, textures[1]->generation);
+
+    stop_texture_system(&systems);
+    job_system_shutdown(job_state);
+    kfree_aligned(job_state, job_requirement, 64, MEMORY_TAG_JOB);
+    return true;
+}
+
+u8 texture_load_should_read_from_a_mounted_pack()
+{
+    // Packed under the path it has on disk, then read with only the pack mounted.
+    const char* pack_path = "texture_test." VFS_PACK_EXTENSION;
+    const char* sources[] = {"assets/textures/" OTHER_TEST_TEXTURE ".png"};
+    expect_to_be_true(vfs_pack_write(pack_path, 1, sources, sources, true));
+
+    vfs_config config = {};
+    u64 vfs_requirement = 0;
+    vfs_initialize(&vfs_requirement, 0, config);
+    void* vfs_state = kallocate(vfs_requirement, MEMORY_TAG_APPLICATION);
+    expect_to_be_true(vfs_initialize(&vfs_requirement, vfs_state, config));
+    expect_to_be_true(vfs_mount_pack("", pack_path));
+
+    texture_test_systems systems = {};
+    expect_to_be_true(start_texture_system(0, &systems));
+
+    // Nothing in the pack is cooked, and there is no directory mounted to cook it in, so it is decoded.
+    texture* t = texture_system_acquire(OTHER_TEST_TEXTURE, true);
+    expect_should_not_be(0, t);
+    expect_should_be(0, t->generation);
+    expect_should_be(512, t->width);
+
+    // Files outside the pack are not found.
+    KDEBUG("Note: The following warning and error are intentionally caused by this test.");
+    expect_should_be(0, texture_system_acquire(TEST_TEXTURE, true));
+
+    texture_system_release(OTHER_TEST_TEXTURE);
+    stop_texture_system(&systems);
+    vfs_shutdown(vfs_state);
+    kfree(vfs_state, vfs_requirement, MEMORY_TAG_APPLICATION);
+    return true;
+}
+
+u8 texture_handle_should_go_stale_when_released()
+{
+    texture_test_systems systems = {};
+    expect_to_be_true(start_texture_system(0, &systems));
+
+    texture* t = texture_system_acquire(TEST_TEXTURE, true);
+    texture_handle handle = texture_system_get_handle(t);
+    expect_should_not_be(INVALID_TEXTURE_HANDLE, handle);
+    expect_should_be(t, texture_system_resolve(handle));
+    expect_should_be(INVALID_TEXTURE_HANDLE, texture_system_get_handle(texture_system_get_default_texture()));
+
+    // The freed slot is the next one handed out, but the old handle does not resolve to its new texture.
+    texture_system_release(TEST_TEXTURE);
+    expect_should_be(0, texture_system_resolve(handle));
+    texture* other = texture_system_acquire(OTHER_TEST_TEXTURE, true);
+    expect_should_be(t, other);
+    expect_should_be(0, texture_system_resolve(handle));
+    texture_handle other_handle = texture_system_get_handle(other);
+    expect_should_not_be(handle, other_handle);
+    expect_should_be(other, texture_system_resolve(other_handle));
+
+    // Nor does the renderer see the same id and generation for a different texture.
+    expect_should_be(1, other->generation);
+
+    // Once all 8 slots are taken, acquiring another fails until one is released.
+    const char* names[] = {TEST_TEXTURE, TEST_TEXTURE "2", "missing_0", "missing_1", "missing_2", "missing_3", "missing_4"};
+    KDEBUG("Note: The following warnings and fatal message are intentionally caused by this test.");
+    for(u32 i = 0; i < 7; ++i)
+    {
+        expect_should_not_be(0, texture_system_acquire_async(names[i], true));
+    }
+    expect_should_be(0, texture_system_acquire_async("missing_5", true));
+    texture_system_release(names[2]);
+    expect_should_not_be(0, texture_system_acquire_async(names[2], true));
+
+    stop_texture_system(&systems);
+    return true;
+}
+
+void texture_system_register_tests()
+{
+    test_manager_register_test(texture_acquire_async_should_upload_on_update, "Async texture acquire should upload on update");
+    test_manager_register_test(texture_acquire_should_finish_a_pending_load, "Texture acquire should finish a pending async load");
+    test_manager_register_test(texture_release_should_cancel_a_pending_load, "Texture release should cancel a pending async load");
+    test_manager_register_test(texture_acquire_async_should_keep_default_for_missing_files, "Async texture acquire should keep the default for missing files");
+    test_manager_register_test(texture_acquire_async_should_decode_on_workers, "Async texture acquire should decode on worker threads");
+    test_manager_register_test(texture_load_should_cook_and_reuse_the_file, "Texture load should cook and reuse the file");
+    test_manager_register_test(texture_set_sampler_should_reupload_loaded_textures, "Texture set sampler should reupload loaded textures");
+    test_manager_register_test(texture_budget_should_evict_least_recently_released, "Texture budget should evict the least recently released");
+    test_manager_register_test(texture_streaming_should_follow_screen_size, "Texture streaming should follow screen size");
+    test_manager_register_test(texture_acquire_batch_should_load_every_texture, "Texture batch acquire should load every texture");
+    test_manager_register_test(texture_load_should_read_from_a_mounted_pack, "Texture load should read from a mounted pack");
+    test_manager_register_test(texture_handle_should_go_stale_when_released, "Texture handle should go stale when released");
+}